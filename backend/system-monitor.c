@@ -1,4 +1,6 @@
+#define _GNU_SOURCE
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <time.h>
@@ -15,6 +17,28 @@
 #include <gnu/libc-version.h>
 #include <sys/statvfs.h>
 #include <pwd.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <math.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/file.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <sys/ioctl.h>
+#include <scsi/sg.h>
+#include <linux/nvme_ioctl.h>
+#include <dlfcn.h>
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#include <elf.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 volatile sig_atomic_t stop = 0;
 
@@ -65,8 +89,6 @@ typedef struct ProcSample {
 } ProcSample;
 
 // CPU Core Monitoring Structures
-#define MAX_CORES 32
-
 // CPU statistics structure for tracking various CPU time states
 typedef struct {
     unsigned long user;
@@ -90,8 +112,11 @@ typedef struct {
 // CPU data structure containing overall usage and individual core information
 typedef struct {
     int total_cores;
-    CoreData cores[MAX_CORES];
+    int capacity;
+    CoreData *cores;
+    CoreData overall;
     double overall_usage;
+    int samples;
 } CPUData;
 
 typedef struct {
@@ -105,35 +130,292 @@ typedef struct {
     unsigned long steal;
 } CPUUtilization;
 
+// Block I/O Monitoring Structures
+// Cumulative counters of one /proc/diskstats line
+typedef struct {
+    unsigned long long reads;
+    unsigned long long read_sectors;
+    unsigned long long read_ms;
+    unsigned long long writes;
+    unsigned long long write_sectors;
+    unsigned long long write_ms;
+    unsigned long long in_flight;
+    unsigned long long io_ms;
+    unsigned long long queue_ms;
+} DiskStats;
+
+// One block device with its current and previous counters and the rates derived from them
+typedef struct {
+    char name[32];
+    int partition;
+    int seen;
+    int samples;
+    DiskStats stats;
+    DiskStats prev_stats;
+    double read_bytes;
+    double write_bytes;
+    double read_iops;
+    double write_iops;
+    double await_ms;
+    double queue_depth;
+    double utilization;
+} DiskData;
+
+// Every whole disk seen in /proc/diskstats, in kernel order
+typedef struct {
+    int count;
+    int capacity;
+    DiskData *disks;
+    double sample_time;
+    int samples;
+} DiskIOData;
+
 // History tracking
-#define HISTORY_SIZE 10
+#define HISTORY_MAX_LEVELS 4
+#define HISTORY_NAME_SIZE 64
+#define HISTORY_MAX_RULES 32
 
-// Circular buffer structure for storing historical metric values
+// Retention of one rollup level: bucket width in seconds and number of buckets kept
 typedef struct {
-    float values[HISTORY_SIZE];
-    int index;
+    int step;
+    int capacity;
+} HistoryRetention;
+
+// Aggregate of every sample that fell into one rollup bucket
+typedef struct {
+    double sum;
+    float min;
+    float max;
+    unsigned int count;
+} HistoryBucket;
+
+// Ring buffer of bucket slots, used as a monotonic deque for sliding min/max
+typedef struct {
+    int *slots;
+    int first;
+    int len;
+} SlotDeque;
+
+// One rollup level: a ring of fixed-width buckets with running window aggregates
+typedef struct {
+    int step;
+    int capacity;
+    HistoryBucket *buckets;
+    int head;
+    int count;
+    time_t head_start;
+    double window_sum;
+    unsigned long window_samples;
+    SlotDeque min_deque;
+    SlotDeque max_deque;
+} HistoryLevel;
+
+// Persistent history file layout
+#define HISTORY_BLOCK_SIZE 4096
+#define HISTORY_MAX_SERIES 1024
+#define HISTORY_GROW_BLOCKS 256
+#define HISTORY_GROW_ENTRIES 1024
+#define HISTORY_BLOCK_MAGIC 0x4b4c4248u // "HBLK"
+
+// Header at the start of the index file; counts are published with release stores
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_size;
+    uint32_t series_count;
+    uint32_t entry_count;
+    uint32_t block_count;
+    uint32_t unsorted;          // Set once an entry starts before the one it follows, e.g. after the clock stepped back between runs
+    uint32_t reserved[8];
+} HistoryIndexHeader;
+
+// One fixed-size name slot per series; the slot number is the series id
+typedef struct {
+    char name[HISTORY_NAME_SIZE];
+} HistorySeriesSlot;
+
+// Index entry per data block so range queries only touch overlapping blocks
+typedef struct {
+    uint32_t series_id;
+    uint32_t block;
+    int64_t first_time;
+    int64_t last_time;
+    uint32_t count;
+    uint32_t reserved;
+} HistoryIndexEntry;
+
+// Header of each data block; the compressed samples follow it
+typedef struct {
+    uint32_t magic;
+    uint32_t series_id;
+    uint32_t count;
+    uint32_t bit_length;
+    int64_t first_time;
+    int64_t last_time;
+    double min;
+    double max;
+    uint8_t reserved[16];
+} HistoryBlockHeader;
+
+#define HISTORY_PAYLOAD_BITS ((uint64_t)(HISTORY_BLOCK_SIZE - sizeof(HistoryBlockHeader)) * 8)
+// Worst case for one sample: 4 + 32 bits of timestamp, 2 + 5 + 6 + 64 bits of value
+#define HISTORY_MAX_SAMPLE_BITS 113
+
+// Encoder state of the block a series is currently appending to
+typedef struct {
+    uint32_t block;
+    uint32_t entry;
+    uint64_t bit_pos;
+    int64_t prev_time;
+    int64_t prev_delta;
+    uint64_t prev_bits;
+    int prev_leading;
+    int prev_trailing;
+} HistoryWriter;
+
+// A named metric series with one ring per rollup level
+typedef struct {
+    int id;
+    char name[HISTORY_NAME_SIZE];
+    int level_count;
+    HistoryLevel levels[HISTORY_MAX_LEVELS];
+    float last_value;
+    time_t last_time;
+    int file_series;
+    HistoryWriter writer;
+    int alert_head;
+} TimeSeries;
+
+// Aggregates over the full retention window of one rollup level
+typedef struct {
+    unsigned long count;
+    double average;
+    float min;
+    float max;
+} HistoryStats;
+
+// Retention override for every series whose name matches the pattern
+typedef struct {
+    char pattern[HISTORY_NAME_SIZE];
+    int level_count;
+    HistoryRetention levels[HISTORY_MAX_LEVELS];
+} HistoryRetentionRule;
+
+// Dynamic set of metric series, created by name on first use
+typedef struct {
+    TimeSeries **series;
     int count;
-} HistoryBuffer;
-
-// Comprehensive system history structure tracking all monitored metrics
-typedef struct {
-    HistoryBuffer cpu_usage;
-    HistoryBuffer load_1min;
-    HistoryBuffer load_5min;
-    HistoryBuffer load_15min;
-    HistoryBuffer cpu_temp;
-    HistoryBuffer gpu_temp;
-    HistoryBuffer vrm_temp;
-    HistoryBuffer chipset_temp;
-    HistoryBuffer motherboard_temp;
-    HistoryBuffer psu_temp;
-    HistoryBuffer case_temp;
-    HistoryBuffer storage_temps[16];
-    HistoryBuffer core_usage[MAX_CORES];
-    HistoryBuffer total_processes;
-    int storage_count;
+    int capacity;
+    HistoryRetentionRule rules[HISTORY_MAX_RULES];
+    int rule_count;
 } SystemHistory;
 
+// Quantile sketches (DDSketch with a collapsing-lowest dense store)
+#define SKETCH_BINS 256
+#define SKETCH_RELATIVE_ACCURACY 0.02
+#define SKETCH_MIN_VALUE 1e-3
+#define SKETCH_MAX_VALUE 1e9
+#define SKETCH_PERIOD_BUCKETS 60
+#define SKETCH_FILE_VERSION 2
+
+// Sketch of every sample in one period; bins count values whose log-gamma index is offset + i
+typedef struct {
+    int64_t period_start;
+    uint32_t count;
+    uint32_t zero_count;
+    int32_t offset;
+    int32_t reserved;
+    double sum;
+    float min;
+    float max;
+    uint32_t bins[SKETCH_BINS];
+} QuantileSketch;
+
+// Sketch file header
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t used;
+    uint64_t padding[5];
+} SketchFileHeader;
+
+// Where a series' sketch rings live in the sketch file, and their shape per rollup level
+typedef struct {
+    uint64_t offset;
+    uint32_t level_count;
+    uint32_t reserved;
+    struct {
+        int32_t period;
+        int32_t slots;
+    } levels[HISTORY_MAX_LEVELS];
+} SketchDirectoryEntry;
+
+// Alert rules
+#define ALERT_TEXT_SIZE 128
+
+// Comparison of a compiled alert rule: fires when value <op> threshold
+typedef enum {
+    ALERT_ABOVE,
+    ALERT_AT_LEAST,
+    ALERT_BELOW,
+    ALERT_AT_MOST
+} AlertOp;
+
+typedef enum {
+    ALERT_OK,
+    ALERT_PENDING,
+    ALERT_FIRING
+} AlertState;
+
+// One compiled rule, e.g. "cpu_temp > 85 for 30s clear 80 cooldown 5m"
+typedef struct {
+    char pattern[HISTORY_NAME_SIZE];
+    char text[ALERT_TEXT_SIZE];
+    AlertOp op;
+    float threshold;
+    float clear;
+    int for_seconds;
+    int cooldown;
+} AlertRule;
+
+// Evaluation state of one rule on one series; bindings of a series form a linked list
+typedef struct {
+    int rule;
+    int series;
+    int next;
+    AlertState state;
+    time_t since;
+    time_t resolved;
+} AlertBinding;
+
+// Rule table plus the per-series bindings it was compiled into
+typedef struct {
+    AlertRule *rules;
+    int rule_count;
+    int rule_capacity;
+    AlertBinding *bindings;
+    int binding_count;
+    int binding_capacity;
+    FILE *event_log;
+} AlertEngine;
+
+// Memory-mapped history files: the index (series names + block index), the data blocks and the sketches
+typedef struct {
+    int index_fd;
+    int data_fd;
+    int writable;
+    uint8_t *index_map;
+    size_t index_size;
+    uint8_t *data_map;
+    size_t data_size;
+    int sketch_fd;
+    uint8_t *sketch_map;
+    size_t sketch_size;
+} HistoryFile;
+
+#define HISTORY_FILE_INIT {-1, -1, 0, NULL, 0, NULL, 0, -1, NULL, 0}
+
 struct cpu_stats {
     unsigned long long utime;
     unsigned long long stime;
@@ -144,2101 +426,11153 @@ struct cpu_stats {
 StorageDevice *storage_devices = NULL;
 int storage_device_count = 0;
 CPUData cpu_data;
+DiskIOData disk_io_data;
 SystemHistory system_history;
-void init_history_buffer(HistoryBuffer *buffer) {
-    memset(buffer->values, 0, sizeof(buffer->values));
-    buffer->index = 0;
-    buffer->count = 0;
-}
-void add_to_history(HistoryBuffer *buffer, float value) {
-    buffer->values[buffer->index] = value;
-    buffer->index = (buffer->index + 1) % HISTORY_SIZE;
-    if (buffer->count < HISTORY_SIZE) {
-        buffer->count++;
-    }
-}
+HistoryFile history_file = HISTORY_FILE_INIT;
+AlertEngine alert_engine;
 
-float get_history_average(HistoryBuffer *buffer) {
-    if (buffer->count == 0) return 0.0;
-    
-    float sum = 0.0;
-    for (int i = 0; i < buffer->count; i++) {
-        sum += buffer->values[i];
+/**
+ * Builds a per-user path such as ~/.config/system-monitor/<file>
+ * Uses the given XDG variable when set, otherwise $HOME/<fallback>
+ */
+int build_user_path(const char *xdg_env, const char *fallback, const char *file, char *out, size_t size) {
+    const char *base = getenv(xdg_env);
+    int written;
+
+    if (base && base[0] == '/') {
+        written = snprintf(out, size, "%s/system-monitor/%s", base, file);
+    } else {
+        const char *home = getenv("HOME");
+        if (!home) {
+            struct passwd *pw = getpwuid(getuid());
+            if (pw) home = pw->pw_dir;
+        }
+        if (!home) return -1;
+        written = snprintf(out, size, "%s/%s/system-monitor/%s", home, fallback, file);
     }
-    return sum / buffer->count;
+    return (written < 0 || (size_t)written >= size) ? -1 : 0;
 }
 
 /**
- * Initializes all history buffers in the system history structure
- * Sets up tracking for all monitored system metrics
+ * Creates every missing directory leading up to the file at path
  */
-void init_system_history() {
-    init_history_buffer(&system_history.cpu_usage);
-    init_history_buffer(&system_history.load_1min);
-    init_history_buffer(&system_history.load_5min);
-    init_history_buffer(&system_history.load_15min);
-    init_history_buffer(&system_history.cpu_temp);
-    init_history_buffer(&system_history.gpu_temp);
-    init_history_buffer(&system_history.vrm_temp);
-    init_history_buffer(&system_history.chipset_temp);
-    init_history_buffer(&system_history.motherboard_temp);
-    init_history_buffer(&system_history.psu_temp);
-    init_history_buffer(&system_history.case_temp);
-    init_history_buffer(&system_history.total_processes);
-    
-    for (int i = 0; i < MAX_CORES; i++) {
-        init_history_buffer(&system_history.core_usage[i]);
-    }
-    
-    for (int i = 0; i < 16; i++) {
-        init_history_buffer(&system_history.storage_temps[i]);
+int ensure_parent_directory(const char *path) {
+    char dir[1024];
+    snprintf(dir, sizeof(dir), "%s", path);
+
+    for (char *p = dir + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(dir, 0755) != 0 && errno != EEXIST) return -1;
+        *p = '/';
     }
-    
-    system_history.storage_count = 0;
+    return 0;
 }
 
 /**
- * Reads temperature from a file and converts from millidegrees to degrees Celsius
- * Returns -1.0 if file cannot be read or parsed
+ * Parses a duration such as "30s", "10m", "6h" or "7d" into seconds
+ * A bare number is taken as seconds, returns -1 if the text is not a duration
  */
-float read_temperature_file(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        return -1.0;
+long parse_duration(const char *text) {
+    char *end;
+    long value = strtol(text, &end, 10);
+    if (end == text || value < 0) return -1;
+
+    switch (*end) {
+        case '\0': case 's': break;
+        case 'm': value *= 60; break;
+        case 'h': value *= 3600; break;
+        case 'd': value *= 86400; break;
+        case 'w': value *= 7 * 86400; break;
+        default: return -1;
     }
-    
-    int temp;
-    if (fscanf(file, "%d", &temp) != 1) {
-        fclose(file);
-        return -1.0;
-    }
-    
-    fclose(file);
-    return temp / 1000.0;
+    if (*end != '\0' && end[1] != '\0') return -1;
+    return value;
 }
 
 /**
- * Reads and returns the system load averages from /proc/loadavg
- * Returns structure with -1.0 values if unable to read
+ * Parses a query time: "now", an offset into the past such as "-24h", or Unix seconds
+ * Returns -1 if the text is not a time
  */
-LoadAverage get_load_average() {
-    LoadAverage load = {-1.0, -1.0, -1.0};
-    FILE *file = fopen("/proc/loadavg", "r");
-    if (file == NULL) {
-        printf("Error: could not open /proc/loadavg\n");
-        return load;
-    }
-    
-    if (fscanf(file, "%f %f %f", &load.load_1min, &load.load_5min, &load.load_15min) != 3) {
-        fclose(file);
-        printf("Error: could not parse load averages\n");
-        load.load_1min = load.load_5min = load.load_15min = -1.0;
-        return load;
+int64_t parse_time_argument(const char *text, time_t now) {
+    if (strcmp(text, "now") == 0) return now;
+    if (text[0] == '-') {
+        long offset = parse_duration(text + 1);
+        return offset < 0 ? -1 : (int64_t)now - offset;
     }
-    
-    fclose(file);
 
-    // Display the data directly here
-    printf("System Load Average:\n");
-    printf("---------------------\n");
-    printf("  1 minute : %.2f\n", load.load_1min);
-    printf("  5 minutes: %.2f\n", load.load_5min);
-    printf(" 15 minutes: %.2f\n", load.load_15min);
-    printf("---------------------\n");
-
-    return load;
+    char *end;
+    long long value = strtoll(text, &end, 10);
+    return (end == text || *end != '\0' || value < 0) ? -1 : value;
 }
 
 /**
- * Counts the number of CPU cores by parsing /proc/stat
- * Returns -1 on error, excludes the aggregate 'cpu' line
+ * Parses a retention spec such as "1s:10m,10s:6h,1m:7d" (step:span per level)
+ * Returns the number of levels, or -1 if the spec is malformed
  */
-int get_core_count() {
-    FILE *file = fopen("/proc/stat", "r");
-    if (!file) {
-        printf("Error: could not open /proc/stat\n");
-        return -1;
+int parse_retention_spec(const char *spec, HistoryRetention *levels) {
+    char copy[256];
+    snprintf(copy, sizeof(copy), "%s", spec);
+
+    int count = 0;
+    char *saveptr;
+    for (char *item = strtok_r(copy, ",", &saveptr); item; item = strtok_r(NULL, ",", &saveptr)) {
+        char *colon = strchr(item, ':');
+        if (!colon || count == HISTORY_MAX_LEVELS) return -1;
+        *colon = '\0';
+
+        long step = parse_duration(item);
+        long span = parse_duration(colon + 1);
+        if (step <= 0 || span < step) return -1;
+
+        levels[count].step = (int)step;
+        levels[count].capacity = (int)(span / step);
+        count++;
     }
+    return count > 0 ? count : -1;
+}
 
-    char line[256];
-    int count = -1; // Start at -1 to exclude the total 'cpu' line
+static void slot_deque_pop_front(SlotDeque *deque, int capacity) {
+    deque->first = (deque->first + 1) % capacity;
+    deque->len--;
+}
 
-    while (fgets(line, sizeof(line), file)) {
-        if (strncmp(line, "cpu", 3) == 0) {
-            count++;
-        }
-    }
+static int slot_deque_back(const SlotDeque *deque, int capacity) {
+    return deque->slots[(deque->first + deque->len - 1) % capacity];
+}
 
-    fclose(file);
+static void slot_deque_push(SlotDeque *deque, int capacity, int slot) {
+    deque->slots[(deque->first + deque->len) % capacity] = slot;
+    deque->len++;
+}
 
-    if (count < 1) {
-        printf("Error: could not determine CPU core count\n");
+int init_history_level(HistoryLevel *level, int step, int capacity) {
+    memset(level, 0, sizeof(*level));
+    level->step = step;
+    level->capacity = capacity;
+    level->buckets = calloc(capacity, sizeof(HistoryBucket));
+    level->min_deque.slots = malloc(capacity * sizeof(int));
+    level->max_deque.slots = malloc(capacity * sizeof(int));
+    if (!level->buckets || !level->min_deque.slots || !level->max_deque.slots) {
+        free(level->buckets);
+        free(level->min_deque.slots);
+        free(level->max_deque.slots);
         return -1;
     }
+    return 0;
+}
 
-    // Display the result
-    printf("\nCPU Core Information:\n");
-    printf("---------------------\n");
-    printf(" Total cores: %d\n", count);
-    printf("---------------------\n");
-
-    return count;
+static void reset_history_level(HistoryLevel *level, time_t start) {
+    level->head = 0;
+    level->count = 1;
+    level->head_start = start;
+    level->window_sum = 0.0;
+    level->window_samples = 0;
+    level->min_deque.len = 0;
+    level->max_deque.len = 0;
+    memset(&level->buckets[0], 0, sizeof(HistoryBucket));
 }
 
 /**
- * Reads CPU statistics for all cores from /proc/stat
- * Stores current statistics and preserves previous for delta calculations
+ * Moves the head to the bucket starting at start, evicting buckets that fall out of retention
+ * Evicted buckets are subtracted from the running window and dropped from the min/max deques
  */
-void read_cpu_stats() {
-    FILE *file = fopen("/proc/stat", "r");
-    if (!file) {
-        perror("fopen");
+static void advance_history_level(HistoryLevel *level, time_t start) {
+    long gap = (long)((start - level->head_start) / level->step);
+    if (gap >= level->capacity) {
+        reset_history_level(level, start);
         return;
     }
 
-    char line[256];
-
-    while (fgets(line, sizeof(line), file)) {
-        if (strncmp(line, "cpu", 3) == 0) {
-            CPUStats stats;
-            char cpu_label[16];
-            
-            int matched = sscanf(line,
-                "%15s %lu %lu %lu %lu %lu %lu %lu %lu",
-                cpu_label,
-                &stats.user, &stats.nice, &stats.system, &stats.idle,
-                &stats.iowait, &stats.irq, &stats.softirq,
-                &stats.steal);
+    while (gap-- > 0) {
+        level->head = (level->head + 1) % level->capacity;
+        HistoryBucket *bucket = &level->buckets[level->head];
 
-            if (matched >= 4) {
-                printf("%s: user=%lu nice=%lu system=%lu idle=%lu iowait=%lu irq=%lu softirq=%lu steal=%lu\n",
-                       cpu_label, stats.user, stats.nice, stats.system, stats.idle,
-                       stats.iowait, stats.irq, stats.softirq, stats.steal);
+        if (level->count == level->capacity) {
+            level->window_sum -= bucket->sum;
+            level->window_samples -= bucket->count;
+            if (level->min_deque.len > 0 && level->min_deque.slots[level->min_deque.first] == level->head) {
+                slot_deque_pop_front(&level->min_deque, level->capacity);
             }
+            if (level->max_deque.len > 0 && level->max_deque.slots[level->max_deque.first] == level->head) {
+                slot_deque_pop_front(&level->max_deque, level->capacity);
+            }
+        } else {
+            level->count++;
         }
-    }
 
-    fclose(file);
+        memset(bucket, 0, sizeof(*bucket));
+        level->head_start += level->step;
+    }
 }
 
 /**
- * Calculates CPU usage percentages for all cores based on delta between readings
- * Uses the formula: usage = (total_time - idle_time) / total_time * 100%
+ * Adds one sample to a rollup level in O(1) amortized time
  */
-void calculate_cpu_usage() {
-    static int first_run = 1;
-    static unsigned long prev_user = 0, prev_nice = 0, prev_system = 0;
-    static unsigned long prev_idle = 0, prev_iowait = 0, prev_irq = 0;
-    static unsigned long prev_softirq = 0, prev_steal = 0;
-
-    for (int i = 0; i < 2; i++) {
-        if (!first_run) {
-            sleep(1);
-        }
+void add_to_history_level(HistoryLevel *level, time_t now, float value) {
+    time_t start = now - now % level->step;
+
+    if (level->count == 0) {
+        reset_history_level(level, start);
+    } else if (start > level->head_start) {
+        advance_history_level(level, start);
+    } else if (start < level->head_start) {
+        // Clock stepped backwards: drop the sample rather than rewrite older buckets
+        return;
+    }
 
-        FILE *file = fopen("/proc/stat", "r");
-        if (!file) {
-            printf("Error: Cannot open /proc/stat\n");
-            return;
-        }
+    HistoryBucket *bucket = &level->buckets[level->head];
+    if (bucket->count == 0 || value < bucket->min) bucket->min = value;
+    if (bucket->count == 0 || value > bucket->max) bucket->max = value;
+    bucket->sum += value;
+    bucket->count++;
+
+    level->window_sum += value;
+    level->window_samples++;
+
+    // The head bucket's min only falls and its max only rises, so re-pushing it keeps the deques monotonic
+    SlotDeque *deque = &level->min_deque;
+    if (deque->len > 0 && slot_deque_back(deque, level->capacity) == level->head) deque->len--;
+    while (deque->len > 0 && level->buckets[slot_deque_back(deque, level->capacity)].min >= bucket->min) deque->len--;
+    slot_deque_push(deque, level->capacity, level->head);
+
+    deque = &level->max_deque;
+    if (deque->len > 0 && slot_deque_back(deque, level->capacity) == level->head) deque->len--;
+    while (deque->len > 0 && level->buckets[slot_deque_back(deque, level->capacity)].max <= bucket->max) deque->len--;
+    slot_deque_push(deque, level->capacity, level->head);
+}
 
-        char line[256];
-        unsigned long user, nice, system, idle, iowait, irq, softirq, steal;
-        
-        if (fgets(line, sizeof(line), file)) {
-            if (sscanf(line, "cpu %lu %lu %lu %lu %lu %lu %lu %lu",
-                      &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal) < 4) {
-                fclose(file);
-                printf("Error: Cannot parse /proc/stat\n");
-                return;
-            }
-        }
-        fclose(file);
+/**
+ * Returns count, average, min and max over the whole retention window of a level in O(1)
+ */
+HistoryStats get_history_level_stats(const HistoryLevel *level) {
+    HistoryStats stats = {0, 0.0, 0.0, 0.0};
+    if (level->window_samples == 0) return stats;
+
+    stats.count = level->window_samples;
+    stats.average = level->window_sum / level->window_samples;
+    stats.min = level->buckets[level->min_deque.slots[level->min_deque.first]].min;
+    stats.max = level->buckets[level->max_deque.slots[level->max_deque.first]].max;
+    return stats;
+}
 
-        if (first_run) {
-            prev_user = user;
-            prev_nice = nice;
-            prev_system = system;
-            prev_idle = idle;
-            prev_iowait = iowait;
-            prev_irq = irq;
-            prev_softirq = softirq;
-            prev_steal = steal;
-            first_run = 0;
-            printf("CPU Usage: 0.00%% (first measurement)\n");
-            continue;
-        }
+#define HISTORY_ENTRIES_OFFSET (sizeof(HistoryIndexHeader) + HISTORY_MAX_SERIES * sizeof(HistorySeriesSlot))
 
-        unsigned long total_diff = (user - prev_user) + (nice - prev_nice) + 
-                                  (system - prev_system) + (idle - prev_idle) +
-                                  (iowait - prev_iowait) + (irq - prev_irq) +
-                                  (softirq - prev_softirq) + (steal - prev_steal);
+static HistoryIndexHeader *history_index_header(const HistoryFile *hf) {
+    return (HistoryIndexHeader *)hf->index_map;
+}
 
-        unsigned long idle_diff = (idle - prev_idle) + (iowait - prev_iowait);
+static HistorySeriesSlot *history_series_slots(const HistoryFile *hf) {
+    return (HistorySeriesSlot *)(hf->index_map + sizeof(HistoryIndexHeader));
+}
 
-        prev_user = user;
-        prev_nice = nice;
-        prev_system = system;
-        prev_idle = idle;
-        prev_iowait = iowait;
-        prev_irq = irq;
-        prev_softirq = softirq;
-        prev_steal = steal;
+static HistoryIndexEntry *history_index_entries(const HistoryFile *hf) {
+    return (HistoryIndexEntry *)(hf->index_map + HISTORY_ENTRIES_OFFSET);
+}
 
-        if (total_diff > 0) {
-            float usage = 100.0 * (total_diff - idle_diff) / total_diff;
-            
-            if (usage < 0.0) usage = 0.0;
-            if (usage > 100.0) usage = 100.0;
-            
-            printf("CPU Usage: %.2f%%\n", usage);
-        }
-    }
+static HistoryBlockHeader *history_block(const HistoryFile *hf, uint32_t block) {
+    return (HistoryBlockHeader *)(hf->data_map + (size_t)block * HISTORY_BLOCK_SIZE);
 }
 
 /**
- * Attempts to read CPU temperature from various known thermal zone locations
- * Returns -1.0 if no temperature sensor can be found
+ * Extends a file to wanted bytes and maps (or remaps) the whole of it shared
  */
-float get_cpu_temperature() {
-    const char *thermal_files[] = {
-        "/sys/class/thermal/thermal_zone0/temp",
-        "/sys/class/thermal/thermal_zone1/temp",
-        "/sys/class/hwmon/hwmon0/temp1_input",
-        "/sys/class/hwmon/hwmon1/temp1_input",
-        "/sys/class/hwmon/hwmon2/temp1_input",
-        NULL
-    };
-    
-    for (int i = 0; thermal_files[i] != NULL; i++) {
-        float temp = read_temperature_file(thermal_files[i]);
-        if (temp >= 0) {
-            printf("CPU Temperature: %.2f°C\n", temp);  // assuming millidegrees
-            return temp;
-        }
-    }
-    
-    printf("CPU Temperature: Not available\n");
-    return -1.0;
+static int grow_history_map(int fd, uint8_t **map, size_t *size, size_t wanted) {
+    if (ftruncate(fd, wanted) != 0) return -1;
+
+    void *mapped = *map ? mremap(*map, *size, wanted, MREMAP_MAYMOVE)
+                        : mmap(NULL, wanted, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) return -1;
+
+    *map = mapped;
+    *size = wanted;
+    return 0;
+}
+
+static int map_history_file(int fd, int writable, uint8_t **map, size_t *size) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) return -1;
+
+    void *mapped = mmap(NULL, st.st_size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) return -1;
+
+    *map = mapped;
+    *size = st.st_size;
+    return 0;
+}
+
+void close_history_file(HistoryFile *hf) {
+    if (hf->index_map) munmap(hf->index_map, hf->index_size);
+    if (hf->data_map) munmap(hf->data_map, hf->data_size);
+    if (hf->sketch_map) munmap(hf->sketch_map, hf->sketch_size);
+    if (hf->index_fd >= 0) close(hf->index_fd);
+    if (hf->data_fd >= 0) close(hf->data_fd);
+    if (hf->sketch_fd >= 0) close(hf->sketch_fd);
+    hf->index_map = hf->data_map = hf->sketch_map = NULL;
+    hf->index_size = hf->data_size = hf->sketch_size = 0;
+    hf->index_fd = hf->data_fd = hf->sketch_fd = -1;
+    hf->writable = 0;
 }
 
+static int open_sketch_file(HistoryFile *hf, int writable);
+
 /**
- * Attempts to read GPU temperature from various known graphics card locations
- * Returns -1.0 if no GPU temperature sensor can be found
+ * Opens (and when writable, creates) history.idx and history.dat in the user data directory
+ * Only one writer is allowed at a time; readers map the files read-only and never parse them
+ * Returns 0 on success, -1 on error
  */
-float get_gpu_temperature() {
-    const char *gpu_files[] = {
-        "/sys/class/drm/card0/device/hwmon/hwmon0/temp1_input",
-        "/sys/class/drm/card0/device/hwmon/hwmon1/temp1_input",
-        "/sys/class/drm/card1/device/hwmon/hwmon0/temp1_input",
-        "/sys/class/drm/card1/device/hwmon/hwmon1/temp1_input",
-        "/sys/class/drm/card0/device/hwmon/hwmon2/temp1_input",
-        "/sys/class/drm/card0/device/hwmon/hwmon3/temp1_input",
-        "/sys/class/drm/card1/device/hwmon/hwmon2/temp1_input",
-        "/sys/class/drm/card1/device/hwmon/hwmon3/temp1_input",
-        "/sys/class/hwmon/hwmon3/temp1_input",
-        "/sys/class/hwmon/hwmon4/temp1_input",
-        NULL
-    };
-    
-    for (int i = 0; gpu_files[i] != NULL; i++) {
-        float temp = read_temperature_file(gpu_files[i]);
-        if (temp >= 0) {
-            printf("GPU Temperature: %.2f°C\n", temp);
-            return temp;
+int open_history_file(HistoryFile *hf, int writable) {
+    char index_path[512], data_path[512];
+    if (build_user_path("XDG_DATA_HOME", ".local/share", "history.idx", index_path, sizeof(index_path)) != 0 ||
+        build_user_path("XDG_DATA_HOME", ".local/share", "history.dat", data_path, sizeof(data_path)) != 0) {
+        return -1;
+    }
+    if (writable && ensure_parent_directory(index_path) != 0) return -1;
+
+    int flags = (writable ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC;
+    hf->index_fd = open(index_path, flags, 0644);
+    hf->data_fd = open(data_path, flags, 0644);
+    if (hf->index_fd < 0 || hf->data_fd < 0) {
+        close_history_file(hf);
+        return -1;
+    }
+
+    if (writable && flock(hf->data_fd, LOCK_EX | LOCK_NB) != 0) {
+        fprintf(stderr, "Error: history is already being recorded by another process\n");
+        close_history_file(hf);
+        return -1;
+    }
+
+    struct stat st;
+    if (writable && fstat(hf->index_fd, &st) == 0 && st.st_size == 0) {
+        size_t index_size = HISTORY_ENTRIES_OFFSET + HISTORY_GROW_ENTRIES * sizeof(HistoryIndexEntry);
+        if (grow_history_map(hf->index_fd, &hf->index_map, &hf->index_size, index_size) != 0 ||
+            grow_history_map(hf->data_fd, &hf->data_map, &hf->data_size,
+                             (size_t)HISTORY_GROW_BLOCKS * HISTORY_BLOCK_SIZE) != 0) {
+            close_history_file(hf);
+            return -1;
         }
+
+        // Block 0 only carries the data file magic, so block number 0 can mean "no block"
+        memcpy(hf->data_map, "SMHDAT01", 8);
+        HistoryIndexHeader *header = history_index_header(hf);
+        header->version = 1;
+        header->block_size = HISTORY_BLOCK_SIZE;
+        header->block_count = 1;
+        memcpy(header->magic, "SMHIDX01", 8);
+    } else if (map_history_file(hf->index_fd, writable, &hf->index_map, &hf->index_size) != 0 ||
+               map_history_file(hf->data_fd, writable, &hf->data_map, &hf->data_size) != 0) {
+        close_history_file(hf);
+        return -1;
     }
 
-    printf("GPU Temperature: Not available\n");
-    return -1.0;
+    HistoryIndexHeader *header = history_index_header(hf);
+    if (hf->index_size < HISTORY_ENTRIES_OFFSET || memcmp(header->magic, "SMHIDX01", 8) != 0 ||
+        header->version != 1 || header->block_size != HISTORY_BLOCK_SIZE) {
+        fprintf(stderr, "Error: unrecognised history file %s\n", index_path);
+        close_history_file(hf);
+        return -1;
+    }
+    if (hf->data_size < HISTORY_BLOCK_SIZE || memcmp(hf->data_map, "SMHDAT01", 8) != 0) {
+        fprintf(stderr, "Error: unrecognised history file %s\n", data_path);
+        close_history_file(hf);
+        return -1;
+    }
+
+    if (open_sketch_file(hf, writable) != 0 && writable) {
+        fprintf(stderr, "Warning: sketch file unavailable, percentile queries will be empty\n");
+    }
+
+    hf->writable = writable;
+    return 0;
 }
 
 /**
- * Attempts to read VRM (Voltage Regulator Module) temperature from known locations
- * Returns -1.0 if no VRM temperature sensor can be found
+ * Looks up the id of a series in the history file, registering it when create is set
+ * Returns -1 if the series is unknown (or the series table is full)
  */
-float get_vrm_temperature() {
-    const char *vrm_files[] = {
-        "/sys/class/hwmon/hwmon0/temp2_input",
-        "/sys/class/hwmon/hwmon1/temp2_input",
-        "/sys/class/hwmon/hwmon2/temp2_input",
-        "/sys/class/hwmon/hwmon3/temp2_input",
-        "/sys/class/hwmon/hwmon0/temp3_input",
-        "/sys/class/hwmon/hwmon1/temp3_input",
-        "/sys/class/hwmon/hwmon2/temp3_input",
-        "/sys/class/hwmon/hwmon3/temp3_input",
-        "/sys/class/hwmon/hwmon0/in0_input",
-        "/sys/class/hwmon/hwmon1/in0_input",
-        "/sys/devices/platform/coretemp.0/hwmon/hwmon*/temp2_input",
-        "/sys/class/thermal/thermal_zone2/temp",
-        "/sys/class/thermal/thermal_zone3/temp",
-        NULL
-    };
+int history_file_series_id(HistoryFile *hf, const char *name, int create) {
+    HistoryIndexHeader *header = history_index_header(hf);
+    HistorySeriesSlot *slots = history_series_slots(hf);
+    uint32_t count = __atomic_load_n(&header->series_count, __ATOMIC_ACQUIRE);
 
-    for (int i = 0; vrm_files[i] != NULL; i++) {
-        float temp = read_temperature_file(vrm_files[i]);
-        if (temp >= 0) {
-            printf("VRM Temperature: %.2f°C\n", temp);
-            return temp;
+    for (uint32_t i = 0; i < count && i < HISTORY_MAX_SERIES; i++) {
+        if (strncmp(slots[i].name, name, HISTORY_NAME_SIZE) == 0) return (int)i;
+    }
+    if (!create || !hf->writable || count >= HISTORY_MAX_SERIES) return -1;
+
+    snprintf(slots[count].name, HISTORY_NAME_SIZE, "%s", name);
+    __atomic_store_n(&header->series_count, count + 1, __ATOMIC_RELEASE);
+    return (int)count;
+}
+
+static void put_bits(uint8_t *buf, uint64_t *pos, uint64_t value, int nbits) {
+    while (nbits > 0) {
+        int offset = *pos & 7;
+        int take = 8 - offset < nbits ? 8 - offset : nbits;
+        uint8_t chunk = (value >> (nbits - take)) & ((1u << take) - 1);
+        buf[*pos >> 3] |= chunk << (8 - offset - take);
+        *pos += take;
+        nbits -= take;
+    }
+}
+
+static uint64_t get_bits(const uint8_t *buf, uint64_t *pos, int nbits) {
+    uint64_t value = 0;
+    while (nbits > 0) {
+        int offset = *pos & 7;
+        int take = 8 - offset < nbits ? 8 - offset : nbits;
+        uint8_t chunk = (buf[*pos >> 3] >> (8 - offset - take)) & ((1u << take) - 1);
+        value = (value << take) | chunk;
+        *pos += take;
+        nbits -= take;
+    }
+    return value;
+}
+
+/**
+ * Allocates a new block (and index entry) for a series and stores its first sample uncompressed
+ */
+static int start_history_block(HistoryFile *hf, TimeSeries *series, int64_t time, double value) {
+    HistoryIndexHeader *header = history_index_header(hf);
+    uint32_t block = header->block_count;
+    uint32_t entry = header->entry_count;
+
+    if ((size_t)(block + 1) * HISTORY_BLOCK_SIZE > hf->data_size &&
+        grow_history_map(hf->data_fd, &hf->data_map, &hf->data_size,
+                         hf->data_size + (size_t)HISTORY_GROW_BLOCKS * HISTORY_BLOCK_SIZE) != 0) {
+        return -1;
+    }
+    if (HISTORY_ENTRIES_OFFSET + (size_t)(entry + 1) * sizeof(HistoryIndexEntry) > hf->index_size) {
+        if (grow_history_map(hf->index_fd, &hf->index_map, &hf->index_size,
+                             hf->index_size + HISTORY_GROW_ENTRIES * sizeof(HistoryIndexEntry)) != 0) {
+            return -1;
         }
+        header = history_index_header(hf);
     }
 
-    printf("VRM Temperature: Not available\n");
-    return -1.0;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    HistoryBlockHeader *data = history_block(hf, block);
+    data->magic = HISTORY_BLOCK_MAGIC;
+    data->series_id = series->file_series;
+    data->first_time = data->last_time = time;
+    data->min = data->max = value;
+    uint64_t pos = 0;
+    put_bits((uint8_t *)(data + 1), &pos, bits, 64);
+    data->bit_length = pos;
+    __atomic_store_n(&data->count, 1, __ATOMIC_RELEASE);
+
+    // Entries stay sorted only while the clock moves forward; queries stop trusting the order once it did not
+    HistoryIndexEntry *index = &history_index_entries(hf)[entry];
+    if (entry > 0 && time < index[-1].first_time) __atomic_store_n(&header->unsorted, 1, __ATOMIC_RELEASE);
+    index->series_id = series->file_series;
+    index->block = block;
+    index->first_time = index->last_time = time;
+    __atomic_store_n(&index->count, 1, __ATOMIC_RELEASE);
+
+    __atomic_store_n(&header->block_count, block + 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&header->entry_count, entry + 1, __ATOMIC_RELEASE);
+
+    HistoryWriter *writer = &series->writer;
+    writer->block = block;
+    writer->entry = entry;
+    writer->bit_pos = pos;
+    writer->prev_time = time;
+    writer->prev_delta = 0;
+    writer->prev_bits = bits;
+    writer->prev_leading = -1;
+    writer->prev_trailing = 0;
+    return 0;
 }
 
 /**
- * Attempts to read chipset temperature from various known locations
- * Returns -1.0 if no chipset temperature sensor can be found
+ * Appends one sample to the series' open block using Gorilla compression:
+ * delta-of-delta timestamps and XOR-encoded values, starting a new block when full
+ * Returns 0 on success, -1 on error
  */
-float get_chipset_temperature() {
-    const char *chipset_files[] = {
-        "/sys/class/hwmon/hwmon0/temp4_input",
-        "/sys/class/hwmon/hwmon1/temp4_input",
-        "/sys/class/hwmon/hwmon2/temp4_input",
-        "/sys/class/hwmon/hwmon3/temp4_input",
-        "/sys/class/hwmon/hwmon0/temp5_input",
-        "/sys/class/hwmon/hwmon1/temp5_input",
-        "/sys/class/hwmon/hwmon2/temp5_input",
-        "/sys/class/hwmon/hwmon3/temp5_input",
-        "/sys/class/thermal/thermal_zone4/temp",
-        "/sys/class/thermal/thermal_zone5/temp",
-        "/sys/class/thermal/thermal_zone6/temp",
-        "/sys/class/thermal/thermal_zone7/temp",
-        NULL
-    };
+int append_history_sample(HistoryFile *hf, TimeSeries *series, int64_t time, double value) {
+    if (series->file_series < 0) {
+        series->file_series = history_file_series_id(hf, series->name, 1);
+        if (series->file_series < 0) return -1;
+    }
 
-    for (int i = 0; chipset_files[i] != NULL; i++) {
-        float temp = read_temperature_file(chipset_files[i]);
-        if (temp >= 0) {
-            printf("Chipset Temperature: %.2f°C\n", temp);
-            return temp;
+    HistoryWriter *writer = &series->writer;
+    int64_t delta = time - writer->prev_time;
+    int64_t dod = delta - writer->prev_delta;
+    // Clock stepped backwards: drop the sample so index entries stay ordered by first_time
+    if (writer->block != 0 && delta < 0) return 0;
+    if (writer->block == 0 || dod < INT32_MIN || dod > INT32_MAX ||
+        writer->bit_pos + HISTORY_MAX_SAMPLE_BITS > HISTORY_PAYLOAD_BITS) {
+        return start_history_block(hf, series, time, value);
+    }
+
+    HistoryBlockHeader *block = history_block(hf, writer->block);
+    uint8_t *payload = (uint8_t *)(block + 1);
+    uint64_t pos = writer->bit_pos;
+
+    if (dod == 0) {
+        put_bits(payload, &pos, 0, 1);
+    } else if (dod >= -63 && dod <= 64) {
+        put_bits(payload, &pos, 0x2, 2);
+        put_bits(payload, &pos, dod + 63, 7);
+    } else if (dod >= -255 && dod <= 256) {
+        put_bits(payload, &pos, 0x6, 3);
+        put_bits(payload, &pos, dod + 255, 9);
+    } else if (dod >= -2047 && dod <= 2048) {
+        put_bits(payload, &pos, 0xe, 4);
+        put_bits(payload, &pos, dod + 2047, 12);
+    } else {
+        put_bits(payload, &pos, 0xf, 4);
+        put_bits(payload, &pos, (uint32_t)dod, 32);
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint64_t xor = bits ^ writer->prev_bits;
+    if (xor == 0) {
+        put_bits(payload, &pos, 0, 1);
+    } else {
+        int leading = __builtin_clzll(xor);
+        int trailing = __builtin_ctzll(xor);
+        if (leading > 31) leading = 31;
+
+        if (writer->prev_leading >= 0 && leading >= writer->prev_leading && trailing >= writer->prev_trailing) {
+            // Meaningful bits fit inside the previous window: reuse it
+            put_bits(payload, &pos, 0x2, 2);
+            put_bits(payload, &pos, xor >> writer->prev_trailing, 64 - writer->prev_leading - writer->prev_trailing);
+        } else {
+            int length = 64 - leading - trailing;
+            put_bits(payload, &pos, 0x3, 2);
+            put_bits(payload, &pos, leading, 5);
+            put_bits(payload, &pos, length & 63, 6); // 64 is stored as 0
+            put_bits(payload, &pos, xor >> trailing, length);
+            writer->prev_leading = leading;
+            writer->prev_trailing = trailing;
         }
     }
 
-    printf("Chipset Temperature: Not avaliable");
-    return -1.0;
+    block->last_time = time;
+    if (value < block->min) block->min = value;
+    if (value > block->max) block->max = value;
+    block->bit_length = pos;
+    __atomic_store_n(&block->count, block->count + 1, __ATOMIC_RELEASE);
+
+    HistoryIndexEntry *index = &history_index_entries(hf)[writer->entry];
+    index->last_time = time;
+    __atomic_store_n(&index->count, index->count + 1, __ATOMIC_RELEASE);
+
+    writer->bit_pos = pos;
+    writer->prev_time = time;
+    writer->prev_delta = delta;
+    writer->prev_bits = bits;
+    return 0;
 }
 
+typedef void (*HistorySampleFn)(int64_t time, double value, void *context);
+
 /**
- * Attempts to read motherboard temperature from various known locations
- * Returns -1.0 if no motherboard temperature sensor can be found
+ * Decodes the first count samples of a block, calling fn for each in time order
  */
-float get_motherboard_temperature() {
-    const char *motherboard_files[] = {
-        "/sys/class/hwmon/hwmon0/temp3_input",
-        "/sys/class/hwmon/hwmon1/temp3_input",
-        "/sys/class/hwmon/hwmon2/temp3_input",
-        "/sys/class/hwmon/hwmon3/temp3_input",
-        "/sys/class/hwmon/hwmon0/temp6_input",
-        "/sys/class/hwmon/hwmon1/temp6_input",
-        "/sys/class/hwmon/hwmon2/temp6_input",
-        "/sys/class/hwmon/hwmon3/temp6_input",
-        "/sys/class/hwmon/hwmon0/temp7_input",
-        "/sys/class/hwmon/hwmon1/temp7_input",
-        "/sys/class/hwmon/hwmon2/temp7_input",
-        "/sys/class/hwmon/hwmon3/temp7_input",
-        "/sys/class/thermal/thermal_zone8/temp",
-        "/sys/class/thermal/thermal_zone9/temp",
-        "/sys/class/thermal/thermal_zone10/temp",
-        NULL
-    };
+static void decode_history_block(const HistoryBlockHeader *block, uint32_t count, HistorySampleFn fn, void *context) {
+    const uint8_t *payload = (const uint8_t *)(block + 1);
+    uint64_t pos = 0;
+    int64_t time = block->first_time;
+    int64_t delta = 0;
+    int leading = 0, trailing = 0;
+    double value;
+
+    uint64_t bits = get_bits(payload, &pos, 64);
+    memcpy(&value, &bits, sizeof(value));
+    fn(time, value, context);
+
+    for (uint32_t i = 1; i < count && pos + HISTORY_MAX_SAMPLE_BITS <= HISTORY_PAYLOAD_BITS; i++) {
+        int64_t dod;
+        if (get_bits(payload, &pos, 1) == 0) {
+            dod = 0;
+        } else if (get_bits(payload, &pos, 1) == 0) {
+            dod = (int64_t)get_bits(payload, &pos, 7) - 63;
+        } else if (get_bits(payload, &pos, 1) == 0) {
+            dod = (int64_t)get_bits(payload, &pos, 9) - 255;
+        } else if (get_bits(payload, &pos, 1) == 0) {
+            dod = (int64_t)get_bits(payload, &pos, 12) - 2047;
+        } else {
+            dod = (int32_t)get_bits(payload, &pos, 32);
+        }
+        delta += dod;
+        time += delta;
+
+        if (get_bits(payload, &pos, 1) == 1) {
+            if (get_bits(payload, &pos, 1) == 1) {
+                leading = get_bits(payload, &pos, 5);
+                int length = get_bits(payload, &pos, 6);
+                trailing = 64 - leading - (length ? length : 64);
+            }
+            bits ^= get_bits(payload, &pos, 64 - leading - trailing) << trailing;
+            memcpy(&value, &bits, sizeof(value));
+        }
+        fn(time, value, context);
+    }
+}
 
-    for (int i = 0; motherboard_files[i] != NULL; i++) {
-        float temp = read_temperature_file(motherboard_files[i]);
-        if (temp >= 0) {
-            printf("Motherboard Temperature: %.2f°C\n", temp);
-            return temp;
+typedef struct {
+    int64_t from;
+    int64_t to;
+    HistorySampleFn fn;
+    void *context;
+    long emitted;
+} HistoryRangeFilter;
+
+static void filter_history_sample(int64_t time, double value, void *context) {
+    HistoryRangeFilter *filter = context;
+    if (time < filter->from || time > filter->to) return;
+    filter->fn(time, value, filter->context);
+    filter->emitted++;
+}
+
+// Decodes the block behind one index entry when it belongs to the series and overlaps the range
+static void query_history_entry(const HistoryFile *hf, const HistoryIndexEntry *entry, int series_id,
+                                uint32_t mapped_blocks, HistoryRangeFilter *filter) {
+    if ((int)entry->series_id != series_id || entry->block >= mapped_blocks) return;
+
+    uint32_t count = __atomic_load_n(&entry->count, __ATOMIC_ACQUIRE);
+    if (count == 0 || entry->last_time < filter->from || entry->first_time > filter->to) return;
+
+    const HistoryBlockHeader *block = history_block(hf, entry->block);
+    if (block->magic != HISTORY_BLOCK_MAGIC) return;
+    decode_history_block(block, count, filter_history_sample, filter);
+}
+
+/**
+ * Streams every stored sample of a series within [from, to] to fn
+ * Entries are appended in time order, so a binary search finds the first block starting after
+ * from; only the series' block open at from and the blocks starting up to to are touched
+ * An index marked unsorted is scanned in full instead
+ * Returns the number of samples emitted
+ */
+long query_history_file(const HistoryFile *hf, int series_id, int64_t from, int64_t to,
+                        HistorySampleFn fn, void *context) {
+    HistoryRangeFilter filter = {from, to, fn, context, 0};
+    const HistoryIndexHeader *header = history_index_header(hf);
+    const HistoryIndexEntry *entries = history_index_entries(hf);
+
+    // A reader's mapping may predate growth by the writer, so clamp to what is mapped
+    uint32_t entry_count = __atomic_load_n(&header->entry_count, __ATOMIC_ACQUIRE);
+    uint32_t mapped_entries = (hf->index_size - HISTORY_ENTRIES_OFFSET) / sizeof(HistoryIndexEntry);
+    uint32_t mapped_blocks = hf->data_size / HISTORY_BLOCK_SIZE;
+    if (entry_count > mapped_entries) entry_count = mapped_entries;
+
+    if (__atomic_load_n(&header->unsorted, __ATOMIC_ACQUIRE)) {
+        for (uint32_t i = 0; i < entry_count; i++) {
+            query_history_entry(hf, &entries[i], series_id, mapped_blocks, &filter);
         }
+        return filter.emitted;
     }
 
-    printf("Motherboard Temperature: Not avaliable");
-    return -1.0;
+    uint32_t low = 0, high = entry_count;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (entries[middle].first_time <= from) low = middle + 1;
+        else high = middle;
+    }
+
+    // The series' blocks do not overlap, so only its last block starting at or before from can reach it
+    for (uint32_t i = low; i-- > 0;) {
+        if ((int)entries[i].series_id != series_id) continue;
+        query_history_entry(hf, &entries[i], series_id, mapped_blocks, &filter);
+        break;
+    }
+    for (uint32_t i = low; i < entry_count && entries[i].first_time <= to; i++) {
+        query_history_entry(hf, &entries[i], series_id, mapped_blocks, &filter);
+    }
+    return filter.emitted;
 }
 
+// Growable array of decoded samples
+typedef struct {
+    int64_t *times;
+    double *values;
+    size_t count;
+    size_t capacity;
+    int failed;                 // Set when memory ran out; later samples are not collected
+} SampleBuffer;
+
 /**
- * Attempts to read PSU (Power Supply Unit) temperature from various locations
- * Searches through hwmon devices and power supply directories
- * Returns -1.0 if no PSU temperature sensor can be found
+ * Grows both arrays to capacity samples
+ * The capacity only changes once both allocations succeeded, so the arrays always agree
  */
-float get_psu_temperature() {    
-    DIR *dir = opendir("/sys/class/hwmon");
-    if (dir) {
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            if (strncmp(entry->d_name, "hwmon", 5) != 0) continue;
+static int reserve_sample_buffer(SampleBuffer *buffer, size_t capacity) {
+    int64_t *times = realloc(buffer->times, capacity * sizeof(int64_t));
+    if (!times) return -1;
+    buffer->times = times;
+    double *values = realloc(buffer->values, capacity * sizeof(double));
+    if (!values) return -1;
+    buffer->values = values;
+    buffer->capacity = capacity;
+    return 0;
+}
 
-            char name_path[256];
-            snprintf(name_path, sizeof(name_path), "/sys/class/hwmon/%s/name", entry->d_name);
+static void collect_history_sample(int64_t time, double value, void *context) {
+    SampleBuffer *buffer = context;
+    if (buffer->failed) return;
+    if (buffer->count == buffer->capacity &&
+        reserve_sample_buffer(buffer, buffer->capacity ? buffer->capacity * 2 : 4096) != 0) {
+        buffer->failed = 1;
+        return;
+    }
+    buffer->times[buffer->count] = time;
+    buffer->values[buffer->count] = value;
+    buffer->count++;
+}
 
-            FILE *f = fopen(name_path, "r");
-            if (!f) continue;
+void free_sample_buffer(SampleBuffer *buffer) {
+    free(buffer->times);
+    free(buffer->values);
+    memset(buffer, 0, sizeof(*buffer));
+}
 
-            char devname[64];
-            if (fscanf(f, "%63s", devname) == 1) {
-                // Check if this might be a PSU monitoring device
-                if (strstr(devname, "psu") || strstr(devname, "PSU") || 
-                    strstr(devname, "corsair") || strstr(devname, "Corsair") ||
-                    strstr(devname, "seasonic") || strstr(devname, "Seasonic") ||
-                    strstr(devname, "evga") || strstr(devname, "EVGA") ||
-                    strstr(devname, "bequiet") || strstr(devname, "BeQuiet") ||
-                    strstr(devname, "rm850x") || strstr(devname, "RM850x") ||
-                    strstr(devname, "hx1000") || strstr(devname, "HX1000")) {
-                    
-                    // Try to find temperature sensors
-                    for (int i = 1; i <= 5; i++) {
-                        char temp_path[256];
-                        snprintf(temp_path, sizeof(temp_path), 
-                                "/sys/class/hwmon/%s/temp%d_input", entry->d_name, i);
-                        
-                        float temp = read_temperature_file(temp_path);
-                        if (temp >= 0) {
-                            printf("PSU Temperature: %.2f°C\n", temp);
-                            fclose(f);
-                            closedir(dir);
-                            return temp;
-                        }
-                    }
-                }
+/**
+ * Largest-Triangle-Three-Buckets downsampling, in place
+ * Keeps the first and last samples and, from each of the threshold - 2 buckets between them,
+ * the sample forming the largest triangle with the previously kept sample and the next bucket's average
+ */
+void downsample_lttb(SampleBuffer *buffer, size_t threshold) {
+    size_t count = buffer->count;
+    if (threshold >= count || threshold < 3) {
+        if (threshold < 3 && count > threshold) {
+            // Not enough points for buckets: keep the endpoints only
+            if (threshold == 2) {
+                buffer->times[1] = buffer->times[count - 1];
+                buffer->values[1] = buffer->values[count - 1];
             }
-            fclose(f);
+            buffer->count = threshold;
         }
-        closedir(dir);
+        return;
     }
-    
-    const char *psu_files[] = {
-        "/sys/class/hwmon/hwmon*/temp1_input",
-        "/sys/class/hwmon/hwmon*/temp2_input",
-        "/sys/class/hwmon/hwmon*/temp3_input",
-        "/sys/class/hwmon/hwmon*/temp4_input",
-        "/sys/class/hwmon/hwmon*/temp5_input",
-        "/sys/class/hwmon/hwmon*/power*/temp1_input",
-        "/sys/class/hwmon/hwmon*/power*/temp2_input",
-        NULL
-    };
-    
-    for (int i = 0; psu_files[i] != NULL; i++) {
-        glob_t glob_result;
-        if (glob(psu_files[i], GLOB_NOSORT, NULL, &glob_result) == 0) {
-            for (size_t j = 0; j < glob_result.gl_pathc; j++) {
-                float temp = read_temperature_file(glob_result.gl_pathv[j]);
-                if (temp >= 0) {
-                    printf("PSU Temperature: %.2f°C\n", temp);
-                    globfree(&glob_result);
-                    return temp;
-                }
+
+    int64_t *times = buffer->times;
+    double *values = buffer->values;
+    double bucket_size = (double)(count - 2) / (threshold - 2);
+    size_t kept = 1;
+    size_t previous = 0;
+
+    for (size_t bucket = 0; bucket < threshold - 2; bucket++) {
+        size_t start = (size_t)(bucket * bucket_size) + 1;
+        size_t end = (size_t)((bucket + 1) * bucket_size) + 1;
+        size_t next_end = (size_t)((bucket + 2) * bucket_size) + 1;
+        if (next_end > count) next_end = count;
+
+        // Average of the following bucket (or the last sample for the final bucket)
+        double average_time = 0.0, average_value = 0.0;
+        size_t next_count = next_end > end ? next_end - end : 1;
+        if (next_end > end) {
+            for (size_t i = end; i < next_end; i++) {
+                average_time += times[i];
+                average_value += values[i];
             }
-            globfree(&glob_result);
+            average_time /= next_count;
+            average_value /= next_count;
+        } else {
+            average_time = times[count - 1];
+            average_value = values[count - 1];
         }
-    }
-    
-    dir = opendir("/sys/class/power_supply");
-    if (dir) {
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            if (entry->d_name[0] == '.') continue;
-            
-            char temp_path[256];
-            snprintf(temp_path, sizeof(temp_path), 
-                    "/sys/class/power_supply/%s/temp", entry->d_name);
-            
-            float temp = read_temperature_file(temp_path);
-            if (temp >= 0) {
-                closedir(dir);
-                return temp;
-            }
-            
-            // Check for temperature in hwmon subdirectory
-            char hwmon_path[256];
-            snprintf(hwmon_path, sizeof(hwmon_path), 
-                    "/sys/class/power_supply/%s/hwmon*/temp1_input", entry->d_name);
-            
-            glob_t glob_result;
-            if (glob(hwmon_path, GLOB_NOSORT, NULL, &glob_result) == 0) {
-                for (size_t j = 0; j < glob_result.gl_pathc; j++) {
-                    temp = read_temperature_file(glob_result.gl_pathv[j]);
-                    if (temp >= 0) {
-                        globfree(&glob_result);
-                        closedir(dir);
-                        return temp;
-                    }
-                }
-                globfree(&glob_result);
+
+        double anchor_time = times[previous], anchor_value = values[previous];
+        double best_area = -1.0;
+        size_t best = start;
+        for (size_t i = start; i < end; i++) {
+            double area = fabs((anchor_time - average_time) * (values[i] - anchor_value) -
+                               (anchor_time - times[i]) * (average_value - anchor_value));
+            if (area > best_area) {
+                best_area = area;
+                best = i;
             }
         }
-        closedir(dir);
+
+        // best >= kept always holds, so compacting in place never overwrites an unread sample
+        times[kept] = times[best];
+        values[kept] = values[best];
+        previous = kept;
+        kept++;
     }
-    
-    printf("PSU Temperature: Not available\n");
-    return -1.0;
+
+    times[kept] = times[count - 1];
+    values[kept] = values[count - 1];
+    buffer->count = kept + 1;
 }
 
 /**
- * Attempts to read case/ambient temperature from various known locations
- * Searches for sensors labeled as case, ambient, or similar
- * Returns -1.0 if no case temperature sensor can be found
+ * Min/max-per-bucket downsampling, in place: each of threshold / 2 buckets keeps its lowest
+ * and highest sample in time order, so spikes always survive
  */
-float get_case_temperature() {
-    const char *case_files[] = {
-        "/sys/class/hwmon/hwmon*/temp3_input",
-        "/sys/class/hwmon/hwmon*/temp4_input",
-        "/sys/class/hwmon/hwmon*/temp5_input",
-        "/sys/class/hwmon/hwmon*/temp6_input",
-        "/sys/class/hwmon/hwmon*/temp7_input",
-        "/sys/class/hwmon/hwmon*/temp8_input",
-        "/sys/class/hwmon/hwmon*/temp9_input",
-        "/sys/class/hwmon/hwmon*/temp10_input",
-        "/sys/class/thermal/thermal_zone*/temp",
-        "/sys/devices/platform/nct6775.*/hwmon/hwmon*/temp*_input",
-        "/sys/devices/platform/it87.*/hwmon/hwmon*/temp*_input",
-        "/sys/devices/platform/f71882fg.*/hwmon/hwmon*/temp*_input",
-        NULL
-    };
-
-    DIR *dir = opendir("/sys/class/hwmon");
-    if (dir) {
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            if (strncmp(entry->d_name, "hwmon", 5) != 0) continue;
+void downsample_min_max(SampleBuffer *buffer, size_t threshold) {
+    size_t count = buffer->count;
+    size_t buckets = threshold / 2;
+    if (threshold >= count) return;
+    if (buckets == 0) {
+        buffer->count = threshold;
+        return;
+    }
 
-            for (int i = 1; i <= 10; i++) {
-                char label_path[256];
-                snprintf(label_path, sizeof(label_path), 
-                        "/sys/class/hwmon/%s/temp%d_label", entry->d_name, i);
-                
-                FILE *f = fopen(label_path, "r");
-                if (f) {
-                    char label[64];
-                    if (fscanf(f, "%63s", label) == 1) {
-                        if (strstr(label, "case") || strstr(label, "Case") || 
-                            strstr(label, "CASE") || strstr(label, "ambient") ||
-                            strstr(label, "Ambient") || strstr(label, "AMBIENT")) {
-                            
-                            char temp_path[256];
-                            snprintf(temp_path, sizeof(temp_path), 
-                                    "/sys/class/hwmon/%s/temp%d_input", entry->d_name, i);
-                            
-                            float temp = read_temperature_file(temp_path);
-                            fclose(f);
-                            if (temp >= 0) {
-                                printf("Case Temperature: %.2f°C\n", temp);
-                                closedir(dir);
-                                return temp;
-                            }
-                        }
-                    }
-                    fclose(f);
-                }
-            }
+    int64_t *times = buffer->times;
+    double *values = buffer->values;
+    size_t kept = 0;
+
+    for (size_t bucket = 0; bucket < buckets; bucket++) {
+        size_t start = bucket * count / buckets;
+        size_t end = (bucket + 1) * count / buckets;
+        size_t low = start, high = start;
+        for (size_t i = start + 1; i < end; i++) {
+            if (values[i] < values[low]) low = i;
+            if (values[i] > values[high]) high = i;
         }
-        closedir(dir);
-    }
 
-    for (int i = 0; case_files[i] != NULL; i++) {
-        glob_t glob_result;
-        if (glob(case_files[i], GLOB_NOSORT, NULL, &glob_result) == 0) {
-            for (size_t j = 0; j < glob_result.gl_pathc; j++) {
-                float temp = read_temperature_file(glob_result.gl_pathv[j]);
-                if (temp >= 0) {
-                    printf("Case Temperature: %.2f°C\n", temp);
-                    globfree(&glob_result);
-                    return temp;
-                }
-            }
-            globfree(&glob_result);
+        size_t first = low < high ? low : high;
+        size_t second = low < high ? high : low;
+        int64_t second_time = times[second];
+        double second_value = values[second];
+        times[kept] = times[first];
+        values[kept] = values[first];
+        kept++;
+        if (second != first) {
+            times[kept] = second_time;
+            values[kept] = second_value;
+            kept++;
         }
     }
+    buffer->count = kept;
+}
 
-    printf("Case Temperature: Not available\n");
-    return -1.0;
+#define SKETCH_REGIONS_OFFSET (sizeof(SketchFileHeader) + HISTORY_MAX_SERIES * sizeof(SketchDirectoryEntry))
+#define SKETCH_GROW_BYTES (1 << 20)
+#define SKETCH_INDEX_SPAN 1024
+
+static SketchDirectoryEntry *sketch_directory(const HistoryFile *hf) {
+    return (SketchDirectoryEntry *)(hf->sketch_map + sizeof(SketchFileHeader));
+}
+
+static double sketch_gamma() {
+    return (1.0 + SKETCH_RELATIVE_ACCURACY) / (1.0 - SKETCH_RELATIVE_ACCURACY);
+}
+
+// Log-gamma bucket of a positive value: every value in a bucket is within the relative accuracy of its midpoint
+static int sketch_index(double value) {
+    static double log_gamma = 0.0;
+    if (log_gamma == 0.0) log_gamma = log(sketch_gamma());
+    if (value > SKETCH_MAX_VALUE) value = SKETCH_MAX_VALUE;
+    return (int)ceil(log(value) / log_gamma);
+}
+
+static double sketch_value(int index) {
+    double gamma = sketch_gamma();
+    return 2.0 * pow(gamma, index) / (gamma + 1.0);
 }
 
 /**
- * Scans /sys/class/hwmon for storage devices (NVMe, SATA, SSD)
- * Populates the global storage_devices array with found devices
+ * Moves the dense window of a sketch so bins[0] is new_offset, folding anything below it into bins[0]
+ * Callers never move the window below the highest populated bin, so no high bins are lost
  */
-void find_storage_devices_with_temperature_reporting() {
-    DIR *dir = opendir("/sys/class/hwmon");
-    if (!dir) return;
-
-    struct dirent *entry;
-    while ((entry = readdir(dir)) != NULL) {
-        if (strncmp(entry->d_name, "hwmon", 5) != 0) continue;
+static void rebase_sketch(QuantileSketch *sketch, int new_offset) {
+    uint32_t bins[SKETCH_BINS] = {0};
+    for (int i = 0; i < SKETCH_BINS; i++) {
+        if (!sketch->bins[i]) continue;
+        int target = sketch->offset + i - new_offset;
+        if (target < 0) target = 0;
+        uint64_t sum = (uint64_t)bins[target] + sketch->bins[i];
+        bins[target] = sum > UINT32_MAX ? UINT32_MAX : sum;
+    }
+    memcpy(sketch->bins, bins, sizeof(bins));
+    sketch->offset = new_offset;
+}
 
-        char name_path[256];
-        snprintf(name_path, sizeof(name_path), "/sys/class/hwmon/%s/name", entry->d_name);
+/**
+ * Adds a value to a sketch; values at or below SKETCH_MIN_VALUE, negatives included, are counted
+ * in the zero bucket and read back as 0 clamped to [min, max]. The tracked metrics are never
+ * negative, and min still records the true lowest value
+ * When the value range exceeds SKETCH_BINS buckets the lowest buckets collapse, keeping high quantiles exact
+ */
+void add_to_sketch(QuantileSketch *sketch, double value) {
+    if (sketch->count == 0 || value < sketch->min) sketch->min = value;
+    if (sketch->count == 0 || value > sketch->max) sketch->max = value;
+    sketch->count++;
+    sketch->sum += value;
+
+    if (value <= SKETCH_MIN_VALUE) {
+        sketch->zero_count++;
+        return;
+    }
 
-        FILE *f = fopen(name_path, "r");
-        if (!f) continue;
+    int index = sketch_index(value);
+    if (sketch->count - sketch->zero_count == 1) {
+        memset(sketch->bins, 0, sizeof(sketch->bins));
+        sketch->offset = index - SKETCH_BINS / 2;
+    } else if (index < sketch->offset) {
+        int highest = sketch->offset + SKETCH_BINS - 1;
+        while (highest > sketch->offset && sketch->bins[highest - sketch->offset] == 0) highest--;
+        int lowest_allowed = highest - SKETCH_BINS + 1;
+        rebase_sketch(sketch, index > lowest_allowed ? index : lowest_allowed);
+        if (index < sketch->offset) index = sketch->offset;
+    } else if (index >= sketch->offset + SKETCH_BINS) {
+        rebase_sketch(sketch, index - SKETCH_BINS + 1);
+    }
 
-        char devname[64];
-        if (fscanf(f, "%63s", devname) == 1) {
-            if (strstr(devname, "nvme") || strstr(devname, "drivetemp") || 
-                strstr(devname, "sata") || strstr(devname, "SATA") ||
-                strstr(devname, "ssd") || strstr(devname, "SSD")) {
-                // Try to get the parent device name (e.g., nvme0)
-                char device_path[256];
-                snprintf(device_path, sizeof(device_path), "/sys/class/hwmon/%s/device", entry->d_name);
+    uint32_t *bin = &sketch->bins[index - sketch->offset];
+    if (*bin < UINT32_MAX) (*bin)++;
+}
 
-                char real_device[256];
-                ssize_t len = readlink(device_path, real_device, sizeof(real_device)-1);
-                if (len != -1) {
-                    real_device[len] = '\0';
-                    // Extract just the last part (like nvme0)
-                    char *base = strrchr(real_device, '/');
-                    if (base) base++; else base = real_device;
+// Whether the start of a sketch file carries the current magic and version
+static int sketch_header_valid(int fd) {
+    SketchFileHeader header;
+    return pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+           memcmp(header.magic, "SMHSKT01", 8) == 0 && header.version == SKETCH_FILE_VERSION;
+}
 
-                    // Find first temp*_input
-                    for (int i = 1; i < 10; i++) {
-                        char temp_path[256];
-                        snprintf(temp_path, sizeof(temp_path), "/sys/class/hwmon/%s/temp%d_input", entry->d_name, i);
-                        FILE *tf = fopen(temp_path, "r");
-                        if (tf) {
-                            fclose(tf);
-                            
-                            // Allocate or reallocate storage devices array
-                            StorageDevice *temp = realloc(storage_devices, (storage_device_count + 1) * sizeof(StorageDevice));
-                            if (temp == NULL) {
-                                fclose(f);
-                                closedir(dir);
-                                return;
-                            }
-                            storage_devices = temp;
-                            
-                            strncpy(storage_devices[storage_device_count].name, base, sizeof(storage_devices[0].name)-1);
-                            strncpy(storage_devices[storage_device_count].path, temp_path, sizeof(storage_devices[0].path)-1);
-                            storage_device_count++;
+/**
+ * Opens history.sketch next to the other history files, creating it when writable
+ * A writer starts the file over when it was written with another sketch layout
+ * A missing sketch file only disables percentile queries, so failure is not fatal for readers
+ */
+static int open_sketch_file(HistoryFile *hf, int writable) {
+    char path[512];
+    if (build_user_path("XDG_DATA_HOME", ".local/share", "history.sketch", path, sizeof(path)) != 0) return -1;
 
-                            float temp_val = read_temperature_file(temp_path);
-                            if (temp_val >= 0) {
-                                printf("Storage Device Name: %s Temperature: %.2f°C\n", base, temp_val / 1000.0);
-                            } else {
-                                printf("Storage Device Name: %s Temperature: Not available\n", base);
-                            }
+    hf->sketch_fd = open(path, (writable ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC, 0644);
+    if (hf->sketch_fd < 0) return -1;
 
-                            break;
-                        }
-                    }
-                }
-            }
+    struct stat st;
+    if (writable && !sketch_header_valid(hf->sketch_fd) && ftruncate(hf->sketch_fd, 0) != 0) return -1;
+    if (writable && fstat(hf->sketch_fd, &st) == 0 && st.st_size == 0) {
+        if (grow_history_map(hf->sketch_fd, &hf->sketch_map, &hf->sketch_size,
+                             SKETCH_REGIONS_OFFSET + SKETCH_GROW_BYTES) != 0) {
+            return -1;
         }
-        fclose(f);
+        SketchFileHeader *header = (SketchFileHeader *)hf->sketch_map;
+        header->version = SKETCH_FILE_VERSION;
+        header->used = SKETCH_REGIONS_OFFSET;
+        memcpy(header->magic, "SMHSKT01", 8);
+    } else if (map_history_file(hf->sketch_fd, writable, &hf->sketch_map, &hf->sketch_size) != 0) {
+        return -1;
     }
-    closedir(dir);
+
+    SketchFileHeader *header = (SketchFileHeader *)hf->sketch_map;
+    if (hf->sketch_size < SKETCH_REGIONS_OFFSET || memcmp(header->magic, "SMHSKT01", 8) != 0 ||
+        header->version != SKETCH_FILE_VERSION) {
+        munmap(hf->sketch_map, hf->sketch_size);
+        hf->sketch_map = NULL;
+        hf->sketch_size = 0;
+        return -1;
+    }
+    return 0;
 }
 
-// Read total CPU jiffies from /proc/stat
-unsigned long long get_total_cpu_time() {
-    FILE *fp = fopen("/proc/stat", "r");
-    if (!fp) {
-        printf("Error: Cannot open /proc/stat\n");
-        return 0;
+/**
+ * Reserves the sketch rings of a series: one sketch per SKETCH_PERIOD_BUCKETS buckets of each rollup level
+ */
+static int allocate_sketch_region(HistoryFile *hf, const TimeSeries *series) {
+    SketchDirectoryEntry layout = {0};
+    size_t bytes = 0;
+    for (int i = 0; i < series->level_count; i++) {
+        const HistoryLevel *level = &series->levels[i];
+        layout.levels[i].period = level->step * SKETCH_PERIOD_BUCKETS;
+        layout.levels[i].slots = (level->capacity + SKETCH_PERIOD_BUCKETS - 1) / SKETCH_PERIOD_BUCKETS;
+        bytes += (size_t)layout.levels[i].slots * sizeof(QuantileSketch);
     }
+    layout.level_count = series->level_count;
 
-    char buffer[1024];
-    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
-    
-    // Read the first line which contains aggregate CPU statistics
-    if (fgets(buffer, sizeof(buffer), fp)) {
-        int matched = sscanf(buffer, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
-               &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
-        
-        if (matched >= 4) {
-            // Calculate total CPU time
-            unsigned long long total_time = user + nice + system + idle + iowait + irq + softirq + steal;
-            
-            // Display the detailed breakdown
-            printf("\n=== CPU Time Statistics ===\n");
-            printf("Component Breakdown (in jiffies):\n");
-            printf("----------------------------\n");
-            printf("User mode:      %llu\n", user);
-            printf("Nice mode:      %llu\n", nice);
-            printf("System mode:    %llu\n", system);
-            printf("Idle time:      %llu\n", idle);
-            
-            if (matched >= 5) printf("I/O wait:       %llu\n", iowait);
-            if (matched >= 6) printf("IRQ time:       %llu\n", irq);
-            if (matched >= 7) printf("Soft IRQ:       %llu\n", softirq);
-            if (matched >= 8) printf("Steal time:     %llu\n", steal);
-            
-            printf("----------------------------\n");
-            printf("Total CPU time: %llu jiffies\n", total_time);
-            printf("============================\n\n");
-            
-            fclose(fp);
-            return total_time;
-        } else {
-            printf("Error: Failed to parse /proc/stat. Only %d fields matched.\n", matched);
-            fclose(fp);
-            return 0;
+    SketchFileHeader *header = (SketchFileHeader *)hf->sketch_map;
+    if (header->used + bytes > hf->sketch_size) {
+        size_t grow = bytes > SKETCH_GROW_BYTES ? bytes : SKETCH_GROW_BYTES;
+        if (grow_history_map(hf->sketch_fd, &hf->sketch_map, &hf->sketch_size, hf->sketch_size + grow) != 0) {
+            return -1;
         }
-    } else {
-        printf("Error: Cannot read from /proc/stat\n");
-        fclose(fp);
-        return 0;
+        header = (SketchFileHeader *)hf->sketch_map;
     }
+
+    layout.offset = header->used;
+    header->used += bytes;
+
+    // Publish the offset last so readers never follow a half-written entry
+    SketchDirectoryEntry *entry = &sketch_directory(hf)[series->file_series];
+    uint64_t offset = layout.offset;
+    layout.offset = 0;
+    *entry = layout;
+    __atomic_store_n(&entry->offset, offset, __ATOMIC_RELEASE);
+    return 0;
 }
 
 /**
- * Counts the number of running processes by scanning /proc directory
- * Returns -1 if /proc cannot be accessed
+ * Adds a sample to the current-period sketch of every rollup level of a series
  */
-int display_running_processes() {
-    DIR *dir = opendir("/proc");
-    if (!dir) {
-        printf("Error: Cannot open /proc directory\n");
+int update_history_sketches(HistoryFile *hf, TimeSeries *series, int64_t time, double value) {
+    if (!hf->sketch_map || series->file_series < 0) return -1;
+
+    if (sketch_directory(hf)[series->file_series].offset == 0 && allocate_sketch_region(hf, series) != 0) {
         return -1;
     }
 
-    struct ProcInfo {
-        char pid[32];
-        char ppid[32];
-        char name[256];
-        char state[32];
-        long ram_kb;
-        double ram_percent;
-        double cpu_percent;
-        int level;
-        int file_count;
-        int socket_count;
-        char network_connections[1024]; // Store brief network info
-    } processes[4096];
-
-    int proc_count = 0;
-    struct dirent *entry;
-    memset(processes, 0, sizeof(processes));
+    const SketchDirectoryEntry *entry = &sketch_directory(hf)[series->file_series];
+    QuantileSketch *sketches = (QuantileSketch *)(hf->sketch_map + entry->offset);
+    for (uint32_t i = 0; i < entry->level_count; i++) {
+        int period = entry->levels[i].period;
+        int64_t start = time - time % period;
+        QuantileSketch *sketch = &sketches[(start / period) % entry->levels[i].slots];
 
-    // Read total system memory
-    long total_mem_kb = 0;
-    FILE *meminfo = fopen("/proc/meminfo", "r");
-    if(meminfo) {
-        char line[256];
-        while(fgets(line, sizeof(line), meminfo)) {
-            if(strncmp(line, "MemTotal:", 9) == 0) {
-                sscanf(line + 9, "%ld", &total_mem_kb);
-                break;
-            }
+        if (sketch->period_start != start) {
+            memset(sketch, 0, sizeof(*sketch));
+            sketch->period_start = start;
         }
-        fclose(meminfo);
+        add_to_sketch(sketch, value);
+        sketches += entry->levels[i].slots;
     }
+    return 0;
+}
 
-    // Read all numeric directories in /proc
-    while ((entry = readdir(dir)) != NULL && proc_count < 4096) {
-        if(entry->d_name[0] >= '0' && entry->d_name[0] <= '9') {
+// Several sketches merged over a query window, with bins indexed from the lowest possible index
+typedef struct {
+    uint64_t count;
+    uint64_t zero_count;
+    double sum;
+    float min;
+    float max;
+    int sketches;
+    int period;
+    uint64_t bins[SKETCH_INDEX_SPAN];
+} SketchSummary;
+
+static void merge_sketch(SketchSummary *summary, const QuantileSketch *sketch) {
+    int min_index = sketch_index(SKETCH_MIN_VALUE);
+    if (summary->count == 0 || sketch->min < summary->min) summary->min = sketch->min;
+    if (summary->count == 0 || sketch->max > summary->max) summary->max = sketch->max;
+    summary->count += sketch->count;
+    summary->zero_count += sketch->zero_count;
+    summary->sum += sketch->sum;
+    summary->sketches++;
+
+    for (int i = 0; i < SKETCH_BINS; i++) {
+        if (!sketch->bins[i]) continue;
+        int slot = sketch->offset + i - min_index;
+        if (slot < 0) slot = 0;
+        if (slot >= SKETCH_INDEX_SPAN) slot = SKETCH_INDEX_SPAN - 1;
+        summary->bins[slot] += sketch->bins[i];
+    }
+}
+
+/**
+ * Returns the q-quantile (0..1) of a merged summary, accurate to SKETCH_RELATIVE_ACCURACY
+ */
+double sketch_summary_quantile(const SketchSummary *summary, double q) {
+    if (summary->count == 0) return 0.0;
+    if (q <= 0.0) return summary->min;
+    if (q >= 1.0) return summary->max;
+
+    double rank = q * (summary->count - 1);
+    uint64_t seen = summary->zero_count;
+    double value = summary->max;
+    if (rank < seen) {
+        value = 0.0;
+    } else {
+        int min_index = sketch_index(SKETCH_MIN_VALUE);
+        for (int i = 0; i < SKETCH_INDEX_SPAN; i++) {
+            seen += summary->bins[i];
+            if (seen > rank) {
+                value = sketch_value(min_index + i);
+                break;
+            }
+        }
+    }
+
+    if (value < summary->min) value = summary->min;
+    if (value > summary->max) value = summary->max;
+    return value;
+}
+
+/**
+ * Merges the sketches of a series that overlap [from, to] into summary
+ * Uses the finest rollup level whose ring spans back to from, so whole periods at the window
+ * edges are included; no raw samples are read
+ * A ring spans slots periods ending at its newest sketch. Older sketches are leftovers whose
+ * neighbours have since been overwritten, so they are never merged or counted as coverage
+ * Returns 0 on success, -1 if the series has no sketches
+ */
+int summarize_history_sketches(const HistoryFile *hf, int series_id, int64_t from, int64_t to, SketchSummary *summary) {
+    memset(summary, 0, sizeof(*summary));
+    if (!hf->sketch_map || series_id < 0 || series_id >= HISTORY_MAX_SERIES) return -1;
+
+    const SketchDirectoryEntry *entry = &sketch_directory(hf)[series_id];
+    uint64_t offset = __atomic_load_n(&entry->offset, __ATOMIC_ACQUIRE);
+    if (offset == 0) return -1;
+
+    const QuantileSketch *chosen = NULL;
+    int chosen_level = 0;
+    int64_t span_start = 0;
+
+    for (uint32_t i = 0; i < entry->level_count && i < HISTORY_MAX_LEVELS; i++) {
+        // A stale or short mapping must not be read past its end
+        size_t ring_bytes = (size_t)entry->levels[i].slots * sizeof(QuantileSketch);
+        if (entry->levels[i].slots <= 0 || offset > hf->sketch_size || ring_bytes > hf->sketch_size - offset) return -1;
+        const QuantileSketch *ring = (const QuantileSketch *)(hf->sketch_map + offset);
+
+        int64_t newest = INT64_MIN;
+        for (int j = 0; j < entry->levels[i].slots; j++) {
+            if (ring[j].count > 0 && ring[j].period_start > newest) newest = ring[j].period_start;
+        }
+
+        chosen = ring;
+        chosen_level = i;
+        span_start = newest == INT64_MIN ? INT64_MAX
+                                         : newest - (int64_t)(entry->levels[i].slots - 1) * entry->levels[i].period;
+        if (span_start <= from) break;
+        offset += ring_bytes;
+    }
+    if (!chosen) return -1;
+
+    int period = entry->levels[chosen_level].period;
+    summary->period = period;
+    for (int j = 0; j < entry->levels[chosen_level].slots; j++) {
+        const QuantileSketch *sketch = &chosen[j];
+        if (sketch->count == 0 || sketch->period_start < span_start) continue;
+        if (sketch->period_start + period <= from || sketch->period_start > to) continue;
+        merge_sketch(summary, sketch);
+    }
+    return 0;
+}
+
+static double parse_alert_expression(const char **cursor, int *error);
+
+static void skip_spaces(const char **cursor) {
+    while (isspace((unsigned char)**cursor)) (*cursor)++;
+}
+
+// factor := number | "cores" | "(" expression ")"
+static double parse_alert_factor(const char **cursor, int *error) {
+    skip_spaces(cursor);
+    if (**cursor == '(') {
+        (*cursor)++;
+        double value = parse_alert_expression(cursor, error);
+        skip_spaces(cursor);
+        if (**cursor != ')') *error = 1; else (*cursor)++;
+        return value;
+    }
+    if (strncmp(*cursor, "cores", 5) == 0) {
+        *cursor += 5;
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        return cores > 0 ? cores : 1;
+    }
+
+    char *end;
+    double value = strtod(*cursor, &end);
+    if (end == *cursor) *error = 1;
+    *cursor = end;
+    return value;
+}
+
+// term := factor (("*" | "/") factor)*
+static double parse_alert_term(const char **cursor, int *error) {
+    double value = parse_alert_factor(cursor, error);
+    for (;;) {
+        skip_spaces(cursor);
+        char op = **cursor;
+        if (op != '*' && op != '/') return value;
+        (*cursor)++;
+        double rhs = parse_alert_factor(cursor, error);
+        if (op == '*') value *= rhs;
+        else if (rhs != 0.0) value /= rhs;
+        else *error = 1;
+    }
+}
+
+// expression := term (("+" | "-") term)*
+static double parse_alert_expression(const char **cursor, int *error) {
+    double value = parse_alert_term(cursor, error);
+    for (;;) {
+        skip_spaces(cursor);
+        char op = **cursor;
+        if (op != '+' && op != '-') return value;
+        (*cursor)++;
+        double rhs = parse_alert_term(cursor, error);
+        value = op == '+' ? value + rhs : value - rhs;
+    }
+}
+
+/**
+ * Compiles "<series pattern> <op> <expression> [for <dur>] [clear <value>] [cooldown <dur>]"
+ * The threshold expression may use "cores" and is evaluated once here, not per sample
+ * Without an explicit clear level the alert resolves 5% on the safe side of the threshold
+ * Returns 0 on success, -1 if the rule is malformed
+ */
+int compile_alert_rule(const char *text, AlertRule *rule) {
+    memset(rule, 0, sizeof(*rule));
+    snprintf(rule->text, sizeof(rule->text), "%s", text);
+    rule->text[strcspn(rule->text, "\r\n")] = '\0';
+    rule->cooldown = 60;
+
+    char pattern[HISTORY_NAME_SIZE];
+    int consumed = 0;
+    if (sscanf(text, " %63[^<> \t] %n", pattern, &consumed) != 1) return -1;
+    snprintf(rule->pattern, sizeof(rule->pattern), "%s", pattern);
+
+    const char *cursor = text + consumed;
+    if (strncmp(cursor, ">=", 2) == 0) { rule->op = ALERT_AT_LEAST; cursor += 2; }
+    else if (strncmp(cursor, "<=", 2) == 0) { rule->op = ALERT_AT_MOST; cursor += 2; }
+    else if (*cursor == '>') { rule->op = ALERT_ABOVE; cursor++; }
+    else if (*cursor == '<') { rule->op = ALERT_BELOW; cursor++; }
+    else return -1;
+
+    int error = 0;
+    rule->threshold = parse_alert_expression(&cursor, &error);
+    if (error) return -1;
+
+    float margin = fabsf(rule->threshold) * 0.05f;
+    int above = rule->op == ALERT_ABOVE || rule->op == ALERT_AT_LEAST;
+    rule->clear = above ? rule->threshold - margin : rule->threshold + margin;
+
+    char keyword[16], argument[32];
+    int length;
+    skip_spaces(&cursor);
+    while (*cursor && sscanf(cursor, "%15s %31s%n", keyword, argument, &length) == 2) {
+        cursor += length;
+        skip_spaces(&cursor);
+        if (strcmp(keyword, "for") == 0) {
+            rule->for_seconds = parse_duration(argument);
+            if (rule->for_seconds < 0) return -1;
+        } else if (strcmp(keyword, "cooldown") == 0) {
+            rule->cooldown = parse_duration(argument);
+            if (rule->cooldown < 0) return -1;
+        } else if (strcmp(keyword, "clear") == 0) {
+            char *end;
+            rule->clear = strtof(argument, &end);
+            if (*end != '\0') return -1;
+        } else {
+            return -1;
+        }
+    }
+    return *cursor == '\0' ? 0 : -1;
+}
+
+/**
+ * Adds a compiled rule to the table and binds it to every existing series it matches
+ */
+int add_alert_rule(const char *text) {
+    if (alert_engine.rule_count == alert_engine.rule_capacity) {
+        int capacity = alert_engine.rule_capacity ? alert_engine.rule_capacity * 2 : 16;
+        AlertRule *grown = realloc(alert_engine.rules, capacity * sizeof(AlertRule));
+        if (!grown) return -1;
+        alert_engine.rules = grown;
+        alert_engine.rule_capacity = capacity;
+    }
+    if (compile_alert_rule(text, &alert_engine.rules[alert_engine.rule_count]) != 0) return -1;
+    alert_engine.rule_count++;
+    return 0;
+}
+
+/**
+ * Links every rule whose pattern matches the series into the series' binding list
+ */
+void bind_alert_rules(TimeSeries *series) {
+    series->alert_head = -1;
+    for (int i = alert_engine.rule_count - 1; i >= 0; i--) {
+        if (fnmatch(alert_engine.rules[i].pattern, series->name, 0) != 0) continue;
+
+        if (alert_engine.binding_count == alert_engine.binding_capacity) {
+            int capacity = alert_engine.binding_capacity ? alert_engine.binding_capacity * 2 : 32;
+            AlertBinding *grown = realloc(alert_engine.bindings, capacity * sizeof(AlertBinding));
+            if (!grown) return;
+            alert_engine.bindings = grown;
+            alert_engine.binding_capacity = capacity;
+        }
+
+        AlertBinding *binding = &alert_engine.bindings[alert_engine.binding_count];
+        memset(binding, 0, sizeof(*binding));
+        binding->rule = i;
+        binding->series = series->id;
+        binding->state = ALERT_OK;
+        binding->next = series->alert_head;
+        series->alert_head = alert_engine.binding_count++;
+    }
+}
+
+/**
+ * Loads alerts.conf from the user config directory, or the built-in defaults when it is absent
+ * Returns the number of rules loaded
+ */
+int load_alert_rules() {
+    static const char *defaults[] = {
+        "cpu_temp > 85 for 30s",
+        "gpu_temp > 90 for 30s",
+        "cpu_usage > 95 for 2m",
+        "load_1min > cores*2 for 1m",
+        "storage_temp/* > 60 for 1m",
+        NULL
+    };
+
+    alert_engine.rule_count = 0;
+    alert_engine.binding_count = 0;
+
+    char path[512];
+    FILE *fp = NULL;
+    if (build_user_path("XDG_CONFIG_HOME", ".config", "alerts.conf", path, sizeof(path)) == 0) {
+        fp = fopen(path, "r");
+    }
+
+    if (fp) {
+        char line[256];
+        int line_no = 0;
+        while (fgets(line, sizeof(line), fp)) {
+            line_no++;
+            line[strcspn(line, "\r\n")] = '\0';
+            const char *start = line;
+            skip_spaces(&start);
+            if (*start == '\0' || *start == '#') continue;
+            if (add_alert_rule(start) != 0) {
+                fprintf(stderr, "%s:%d: invalid alert rule: %s\n", path, line_no, start);
+            }
+        }
+        fclose(fp);
+    } else {
+        for (int i = 0; defaults[i] != NULL; i++) add_alert_rule(defaults[i]);
+    }
+
+    for (int i = 0; i < system_history.count; i++) {
+        bind_alert_rules(system_history.series[i]);
+    }
+    return alert_engine.rule_count;
+}
+
+/**
+ * Opens alerts.log in the user data directory for appending state transitions
+ */
+int open_alert_log() {
+    char path[512];
+    if (build_user_path("XDG_DATA_HOME", ".local/share", "alerts.log", path, sizeof(path)) != 0 ||
+        ensure_parent_directory(path) != 0) {
+        return -1;
+    }
+    alert_engine.event_log = fopen(path, "a");
+    return alert_engine.event_log ? 0 : -1;
+}
+
+static void emit_alert_event(const AlertRule *rule, const TimeSeries *series, const char *state, float value, time_t now) {
+    char line[512];
+    snprintf(line, sizeof(line), "%lld ALERT %s series=%s value=%.2f rule=\"%s\"\n",
+             (long long)now, state, series->name, value, rule->text);
+    fputs(line, stdout);
+    fflush(stdout);
+    if (alert_engine.event_log) {
+        fputs(line, alert_engine.event_log);
+        fflush(alert_engine.event_log);
+    }
+}
+
+/**
+ * Evaluates the rules bound to a series against its newest sample
+ * Only transitions to FIRING and back to OK are emitted; pending and steady states are silent
+ */
+void evaluate_alerts(TimeSeries *series, time_t now, float value) {
+    for (int i = series->alert_head; i >= 0; i = alert_engine.bindings[i].next) {
+        AlertBinding *binding = &alert_engine.bindings[i];
+        const AlertRule *rule = &alert_engine.rules[binding->rule];
+
+        int triggered, cleared;
+        switch (rule->op) {
+            case ALERT_ABOVE: triggered = value > rule->threshold; cleared = value < rule->clear; break;
+            case ALERT_AT_LEAST: triggered = value >= rule->threshold; cleared = value < rule->clear; break;
+            case ALERT_BELOW: triggered = value < rule->threshold; cleared = value > rule->clear; break;
+            default: triggered = value <= rule->threshold; cleared = value > rule->clear; break;
+        }
+
+        switch (binding->state) {
+            case ALERT_OK:
+                if (!triggered || (binding->resolved && now - binding->resolved < rule->cooldown)) break;
+                binding->state = ALERT_PENDING;
+                binding->since = now;
+                // A rule without "for" fires on the first matching sample
+                /* fall through */
+            case ALERT_PENDING:
+                if (!triggered) {
+                    binding->state = ALERT_OK;
+                } else if (now - binding->since >= rule->for_seconds) {
+                    binding->state = ALERT_FIRING;
+                    emit_alert_event(rule, series, "FIRING", value, now);
+                }
+                break;
+            case ALERT_FIRING:
+                if (cleared) {
+                    binding->state = ALERT_OK;
+                    binding->resolved = now;
+                    emit_alert_event(rule, series, "RESOLVED", value, now);
+                }
+                break;
+        }
+    }
+}
+
+void add_to_history(TimeSeries *series, time_t now, float value) {
+    for (int i = 0; i < series->level_count; i++) {
+        add_to_history_level(&series->levels[i], now, value);
+    }
+    if (history_file.writable && append_history_sample(&history_file, series, now, value) == 0) {
+        update_history_sketches(&history_file, series, now, value);
+    }
+    series->last_value = value;
+    series->last_time = now;
+    evaluate_alerts(series, now, value);
+}
+
+float get_history_average(TimeSeries *series) {
+    if (series->level_count == 0) return 0.0;
+    return get_history_level_stats(&series->levels[0]).average;
+}
+
+/**
+ * Picks the retention for a new series: the first matching rule, else the defaults
+ */
+static int history_retention_for(const char *name, HistoryRetention *levels) {
+    static const HistoryRetention defaults[] = { {1, 600}, {10, 2160}, {60, 10080} };
+
+    for (int i = 0; i < system_history.rule_count; i++) {
+        HistoryRetentionRule *rule = &system_history.rules[i];
+        if (fnmatch(rule->pattern, name, 0) == 0) {
+            memcpy(levels, rule->levels, rule->level_count * sizeof(HistoryRetention));
+            return rule->level_count;
+        }
+    }
+
+    memcpy(levels, defaults, sizeof(defaults));
+    return sizeof(defaults) / sizeof(defaults[0]);
+}
+
+/**
+ * Adds a retention rule; rules added first take precedence
+ */
+int add_history_retention_rule(const char *pattern, const char *spec) {
+    if (system_history.rule_count == HISTORY_MAX_RULES) return -1;
+
+    HistoryRetentionRule *rule = &system_history.rules[system_history.rule_count];
+    rule->level_count = parse_retention_spec(spec, rule->levels);
+    if (rule->level_count < 0) return -1;
+
+    snprintf(rule->pattern, sizeof(rule->pattern), "%s", pattern);
+    system_history.rule_count++;
+    return 0;
+}
+
+TimeSeries *find_history_series(const char *name) {
+    for (int i = 0; i < system_history.count; i++) {
+        if (strcmp(system_history.series[i]->name, name) == 0) return system_history.series[i];
+    }
+    return NULL;
+}
+
+/**
+ * Returns the series with the given name, creating it with its configured retention if needed
+ * Returns NULL if memory cannot be allocated
+ */
+TimeSeries *history_series(const char *name) {
+    TimeSeries *series = find_history_series(name);
+    if (series) return series;
+
+    if (system_history.count == system_history.capacity) {
+        int capacity = system_history.capacity ? system_history.capacity * 2 : 32;
+        TimeSeries **grown = realloc(system_history.series, capacity * sizeof(TimeSeries *));
+        if (!grown) return NULL;
+        system_history.series = grown;
+        system_history.capacity = capacity;
+    }
+
+    series = calloc(1, sizeof(TimeSeries));
+    if (!series) return NULL;
+
+    HistoryRetention levels[HISTORY_MAX_LEVELS];
+    int level_count = history_retention_for(name, levels);
+    for (int i = 0; i < level_count; i++) {
+        if (init_history_level(&series->levels[i], levels[i].step, levels[i].capacity) != 0) {
+            while (--i >= 0) {
+                free(series->levels[i].buckets);
+                free(series->levels[i].min_deque.slots);
+                free(series->levels[i].max_deque.slots);
+            }
+            free(series);
+            return NULL;
+        }
+    }
+
+    series->level_count = level_count;
+    series->file_series = -1;
+    series->id = system_history.count;
+    snprintf(series->name, sizeof(series->name), "%s", name);
+    bind_alert_rules(series);
+    system_history.series[system_history.count++] = series;
+    return series;
+}
+
+/**
+ * Loads per-metric retention rules from history.conf in the user config directory
+ * Each line is "<name pattern> <spec>", e.g. "storage_temp/nvme* 10s:1d,5m:30d"
+ */
+void load_history_config() {
+    char path[512];
+    if (build_user_path("XDG_CONFIG_HOME", ".config", "history.conf", path, sizeof(path)) != 0) return;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return;
+
+    char line[512];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+        char pattern[HISTORY_NAME_SIZE], spec[256];
+        if (line[0] == '#' || sscanf(line, "%63s %255s", pattern, spec) != 2) continue;
+        if (add_history_retention_rule(pattern, spec) != 0) {
+            fprintf(stderr, "%s:%d: invalid retention rule\n", path, line_no);
+        }
+    }
+    fclose(fp);
+}
+
+/**
+ * Initializes the system history store
+ * Per-core series default to a shorter retention so many-core hosts stay small
+ */
+void init_system_history() {
+    memset(&system_history, 0, sizeof(system_history));
+    load_history_config();
+    add_history_retention_rule("core_usage/*", "1s:10m,1m:1d");
+}
+
+/**
+ * Reads temperature from a file and converts from millidegrees to degrees Celsius
+ * Returns -1.0 if file cannot be read or parsed
+ */
+float read_temperature_file(const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if (file == NULL) {
+        return -1.0;
+    }
+    
+    int temp;
+    if (fscanf(file, "%d", &temp) != 1) {
+        fclose(file);
+        return -1.0;
+    }
+    
+    fclose(file);
+    return temp / 1000.0;
+}
+
+/**
+ * Reads the 1, 5 and 15 minute load averages from /proc/loadavg without printing
+ * Returns 0 on success, -1 if the file cannot be opened, -2 if it cannot be parsed
+ */
+int read_load_average(LoadAverage *load) {
+    FILE *file = fopen("/proc/loadavg", "r");
+    if (file == NULL) {
+        return -1;
+    }
+
+    if (fscanf(file, "%f %f %f", &load->load_1min, &load->load_5min, &load->load_15min) != 3) {
+        fclose(file);
+        load->load_1min = load->load_5min = load->load_15min = -1.0;
+        return -2;
+    }
+
+    fclose(file);
+    return 0;
+}
+
+/**
+ * Reads and returns the system load averages from /proc/loadavg
+ * Returns structure with -1.0 values if unable to read
+ */
+LoadAverage get_load_average() {
+    LoadAverage load = {-1.0, -1.0, -1.0};
+    int result = read_load_average(&load);
+    if (result == -1) {
+        printf("Error: could not open /proc/loadavg\n");
+        return load;
+    }
+    if (result == -2) {
+        printf("Error: could not parse load averages\n");
+        return load;
+    }
+
+    // Display the data directly here
+    printf("System Load Average:\n");
+    printf("---------------------\n");
+    printf("  1 minute : %.2f\n", load.load_1min);
+    printf("  5 minutes: %.2f\n", load.load_5min);
+    printf(" 15 minutes: %.2f\n", load.load_15min);
+    printf("---------------------\n");
+
+    return load;
+}
+
+/**
+ * Counts the number of CPU cores by parsing /proc/stat
+ * Returns -1 on error, excludes the aggregate 'cpu' line
+ */
+int get_core_count() {
+    FILE *file = fopen("/proc/stat", "r");
+    if (!file) {
+        printf("Error: could not open /proc/stat\n");
+        return -1;
+    }
+
+    char line[256];
+    int count = -1; // Start at -1 to exclude the total 'cpu' line
+
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "cpu", 3) == 0) {
+            count++;
+        }
+    }
+
+    fclose(file);
+
+    if (count < 1) {
+        printf("Error: could not determine CPU core count\n");
+        return -1;
+    }
+
+    // Display the result
+    printf("\nCPU Core Information:\n");
+    printf("---------------------\n");
+    printf(" Total cores: %d\n", count);
+    printf("---------------------\n");
+
+    return count;
+}
+
+/**
+ * Reads CPU statistics for all cores from /proc/stat
+ * Stores current statistics and preserves previous for delta calculations
+ */
+void read_cpu_stats() {
+    FILE *file = fopen("/proc/stat", "r");
+    if (!file) {
+        perror("fopen");
+        return;
+    }
+
+    char line[256];
+
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "cpu", 3) == 0) {
+            CPUStats stats;
+            char cpu_label[16];
+            
+            int matched = sscanf(line,
+                "%15s %lu %lu %lu %lu %lu %lu %lu %lu",
+                cpu_label,
+                &stats.user, &stats.nice, &stats.system, &stats.idle,
+                &stats.iowait, &stats.irq, &stats.softirq,
+                &stats.steal);
+
+            if (matched >= 4) {
+                printf("%s: user=%lu nice=%lu system=%lu idle=%lu iowait=%lu irq=%lu softirq=%lu steal=%lu\n",
+                       cpu_label, stats.user, stats.nice, stats.system, stats.idle,
+                       stats.iowait, stats.irq, stats.softirq, stats.steal);
+            }
+        }
+    }
+
+    fclose(file);
+}
+
+/**
+ * Calculates CPU usage percentages for all cores based on delta between readings
+ * Uses the formula: usage = (total_time - idle_time) / total_time * 100%
+ */
+void calculate_cpu_usage() {
+    static int first_run = 1;
+    static unsigned long prev_user = 0, prev_nice = 0, prev_system = 0;
+    static unsigned long prev_idle = 0, prev_iowait = 0, prev_irq = 0;
+    static unsigned long prev_softirq = 0, prev_steal = 0;
+
+    for (int i = 0; i < 2; i++) {
+        if (!first_run) {
+            sleep(1);
+        }
+
+        FILE *file = fopen("/proc/stat", "r");
+        if (!file) {
+            printf("Error: Cannot open /proc/stat\n");
+            return;
+        }
+
+        char line[256];
+        unsigned long user, nice, system, idle, iowait, irq, softirq, steal;
+        
+        if (fgets(line, sizeof(line), file)) {
+            if (sscanf(line, "cpu %lu %lu %lu %lu %lu %lu %lu %lu",
+                      &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal) < 4) {
+                fclose(file);
+                printf("Error: Cannot parse /proc/stat\n");
+                return;
+            }
+        }
+        fclose(file);
+
+        if (first_run) {
+            prev_user = user;
+            prev_nice = nice;
+            prev_system = system;
+            prev_idle = idle;
+            prev_iowait = iowait;
+            prev_irq = irq;
+            prev_softirq = softirq;
+            prev_steal = steal;
+            first_run = 0;
+            printf("CPU Usage: 0.00%% (first measurement)\n");
+            continue;
+        }
+
+        unsigned long total_diff = (user - prev_user) + (nice - prev_nice) + 
+                                  (system - prev_system) + (idle - prev_idle) +
+                                  (iowait - prev_iowait) + (irq - prev_irq) +
+                                  (softirq - prev_softirq) + (steal - prev_steal);
+
+        unsigned long idle_diff = (idle - prev_idle) + (iowait - prev_iowait);
+
+        prev_user = user;
+        prev_nice = nice;
+        prev_system = system;
+        prev_idle = idle;
+        prev_iowait = iowait;
+        prev_irq = irq;
+        prev_softirq = softirq;
+        prev_steal = steal;
+
+        if (total_diff > 0) {
+            float usage = 100.0 * (total_diff - idle_diff) / total_diff;
+            
+            if (usage < 0.0) usage = 0.0;
+            if (usage > 100.0) usage = 100.0;
+            
+            printf("CPU Usage: %.2f%%\n", usage);
+        }
+    }
+}
+
+// Difference between two monotonically increasing kernel counters; a decrease is treated as a reset
+unsigned long long counter_delta(unsigned long long current, unsigned long long previous) {
+    return current >= previous ? current - previous : 0;
+}
+
+static unsigned long long cpu_stats_total(const CPUStats *stats) {
+    return (unsigned long long)stats->user + stats->nice + stats->system + stats->idle +
+           stats->iowait + stats->irq + stats->softirq + stats->steal;
+}
+
+/**
+ * Calculates the busy percentage between two /proc/stat samples of the same CPU
+ */
+double cpu_stats_usage(const CPUStats *current, const CPUStats *previous) {
+    unsigned long long total = counter_delta(cpu_stats_total(current), cpu_stats_total(previous));
+    unsigned long long idle = counter_delta((unsigned long long)current->idle + current->iowait,
+                                            (unsigned long long)previous->idle + previous->iowait);
+    if (total == 0) return 0.0;
+
+    double usage = 100.0 * (double)(total - (idle < total ? idle : total)) / total;
+    return usage > 100.0 ? 100.0 : usage;
+}
+
+/**
+ * Reads every cpu line of /proc/stat into cpu_data and updates overall and per-core usage
+ * Usage is the delta against the previous call, so the first call only primes the counters
+ * Returns 0 on success, -1 if /proc/stat cannot be read
+ */
+int update_cpu_data() {
+    FILE *file = fopen("/proc/stat", "r");
+    if (!file) {
+        return -1;
+    }
+
+    char line[256];
+    int core = 0;
+
+    while (fgets(line, sizeof(line), file)) {
+        if (strncmp(line, "cpu", 3) != 0) break; // cpu lines always come first
+
+        char label[16];
+        CPUStats stats = {0};
+        if (sscanf(line, "%15s %lu %lu %lu %lu %lu %lu %lu %lu", label,
+                   &stats.user, &stats.nice, &stats.system, &stats.idle,
+                   &stats.iowait, &stats.irq, &stats.softirq, &stats.steal) < 5) {
+            continue;
+        }
+
+        CoreData *data = &cpu_data.overall;
+        if (strcmp(label, "cpu") != 0) {
+            if (core == cpu_data.capacity) {
+                int capacity = cpu_data.capacity ? cpu_data.capacity * 2 : 16;
+                CoreData *grown = realloc(cpu_data.cores, capacity * sizeof(CoreData));
+                if (!grown) break;
+                memset(grown + cpu_data.capacity, 0, (capacity - cpu_data.capacity) * sizeof(CoreData));
+                cpu_data.cores = grown;
+                cpu_data.capacity = capacity;
+            }
+            data = &cpu_data.cores[core++];
+        }
+
+        // A core seen for the first time (or after hotplug reordering) starts with a zero delta
+        if (strcmp(data->cpu_name, label) != 0) {
+            snprintf(data->cpu_name, sizeof(data->cpu_name), "%s", label);
+            data->stats = stats;
+        }
+        data->prev_stats = data->stats;
+        data->stats = stats;
+        data->usage = cpu_stats_usage(&data->stats, &data->prev_stats);
+    }
+
+    fclose(file);
+    cpu_data.total_cores = core;
+    cpu_data.overall_usage = cpu_data.overall.usage;
+    cpu_data.samples++;
+    return 0;
+}
+
+// Partitions share their disk's request queue and are already counted in its line of /proc/diskstats
+static int is_block_partition(const char *name) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/class/block/%s/partition", name);
+    return access(path, F_OK) == 0;
+}
+
+static DiskData *find_disk_data(const char *name, int hint) {
+    if (hint < disk_io_data.count && strcmp(disk_io_data.disks[hint].name, name) == 0) {
+        return &disk_io_data.disks[hint];
+    }
+    for (int i = 0; i < disk_io_data.count; i++) {
+        if (strcmp(disk_io_data.disks[i].name, name) == 0) return &disk_io_data.disks[i];
+    }
+
+    if (disk_io_data.count == disk_io_data.capacity) {
+        int capacity = disk_io_data.capacity ? disk_io_data.capacity * 2 : 16;
+        DiskData *grown = realloc(disk_io_data.disks, capacity * sizeof(DiskData));
+        if (!grown) return NULL;
+        disk_io_data.disks = grown;
+        disk_io_data.capacity = capacity;
+    }
+    DiskData *disk = &disk_io_data.disks[disk_io_data.count++];
+    memset(disk, 0, sizeof(*disk));
+    snprintf(disk->name, sizeof(disk->name), "%s", name);
+    disk->partition = is_block_partition(name);
+    return disk;
+}
+
+/**
+ * Derives per-second rates, average latency, queue depth and busy percentage between two samples
+ */
+static void update_disk_rates(DiskData *disk, double elapsed) {
+    const DiskStats *cur = &disk->stats, *prev = &disk->prev_stats;
+    unsigned long long reads = counter_delta(cur->reads, prev->reads);
+    unsigned long long writes = counter_delta(cur->writes, prev->writes);
+    unsigned long long io_wait = counter_delta(cur->read_ms, prev->read_ms) + counter_delta(cur->write_ms, prev->write_ms);
+
+    // Sectors in /proc/diskstats are always 512 bytes, whatever the device's block size
+    disk->read_bytes = counter_delta(cur->read_sectors, prev->read_sectors) * 512.0 / elapsed;
+    disk->write_bytes = counter_delta(cur->write_sectors, prev->write_sectors) * 512.0 / elapsed;
+    disk->read_iops = reads / elapsed;
+    disk->write_iops = writes / elapsed;
+    disk->await_ms = reads + writes ? (double)io_wait / (reads + writes) : 0.0;
+    disk->queue_depth = counter_delta(cur->queue_ms, prev->queue_ms) / (elapsed * 1000.0);
+    disk->utilization = counter_delta(cur->io_ms, prev->io_ms) / (elapsed * 10.0);
+    if (disk->utilization > 100.0) disk->utilization = 100.0;
+}
+
+/**
+ * Reads /proc/diskstats in one pass and updates every device's counters and rates
+ * Rates are the delta against the previous call, so the first call only primes the counters
+ * Returns 0 on success, -1 if /proc/diskstats cannot be read
+ */
+int update_disk_io_data() {
+    FILE *file = fopen("/proc/diskstats", "r");
+    if (!file) {
+        return -1;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    double now = ts.tv_sec + ts.tv_nsec / 1e9;
+    double elapsed = now - disk_io_data.sample_time;
+
+    for (int i = 0; i < disk_io_data.count; i++) disk_io_data.disks[i].seen = 0;
+
+    char line[512];
+    int index = 0;
+    while (fgets(line, sizeof(line), file)) {
+        char name[32];
+        DiskStats stats = {0};
+        if (sscanf(line, "%*u %*u %31s %llu %*u %llu %llu %llu %*u %llu %llu %llu %llu %llu", name,
+                   &stats.reads, &stats.read_sectors, &stats.read_ms,
+                   &stats.writes, &stats.write_sectors, &stats.write_ms,
+                   &stats.in_flight, &stats.io_ms, &stats.queue_ms) != 10) {
+            continue;
+        }
+
+        DiskData *disk = find_disk_data(name, index++);
+        if (!disk) break;
+
+        // A device seen for the first time (or re-added after hotplug) starts with a zero delta
+        disk->prev_stats = disk->samples ? disk->stats : stats;
+        disk->stats = stats;
+        disk->seen = 1;
+        if (disk->samples++ > 0 && elapsed > 0) update_disk_rates(disk, elapsed);
+    }
+    fclose(file);
+
+    // Forget devices that went away so a later device with the same name starts fresh
+    int kept = 0;
+    for (int i = 0; i < disk_io_data.count; i++) {
+        if (disk_io_data.disks[i].seen) disk_io_data.disks[kept++] = disk_io_data.disks[i];
+    }
+    disk_io_data.count = kept;
+    disk_io_data.sample_time = now;
+    disk_io_data.samples++;
+    return 0;
+}
+
+/**
+ * Prints throughput, IOPS, latency, queue depth and utilization of every disk over one second
+ * Partitions are folded into their disk; devices that never did any I/O are left out
+ */
+void print_disk_io() {
+    if (update_disk_io_data() != 0) {
+        printf("Error: Cannot open /proc/diskstats\n");
+        return;
+    }
+    sleep(1);
+    update_disk_io_data();
+
+    for (int i = 0; i < disk_io_data.count; i++) {
+        DiskData *disk = &disk_io_data.disks[i];
+        if (disk->partition || (disk->stats.reads == 0 && disk->stats.writes == 0)) continue;
+        printf("Disk I/O %s: read=%.1f KB/s write=%.1f KB/s read_iops=%.1f write_iops=%.1f "
+               "await=%.2f ms queue=%.2f util=%.1f%%\n",
+               disk->name, disk->read_bytes / 1024.0, disk->write_bytes / 1024.0,
+               disk->read_iops, disk->write_iops, disk->await_ms, disk->queue_depth, disk->utilization);
+    }
+}
+
+/**
+ * Attempts to read CPU temperature from various known thermal zone locations
+ * Returns -1.0 if no temperature sensor can be found
+ */
+float read_cpu_temperature() {
+    const char *thermal_files[] = {
+        "/sys/class/thermal/thermal_zone0/temp",
+        "/sys/class/thermal/thermal_zone1/temp",
+        "/sys/class/hwmon/hwmon0/temp1_input",
+        "/sys/class/hwmon/hwmon1/temp1_input",
+        "/sys/class/hwmon/hwmon2/temp1_input",
+        NULL
+    };
+    
+    for (int i = 0; thermal_files[i] != NULL; i++) {
+        float temp = read_temperature_file(thermal_files[i]);
+        if (temp >= 0) {
+            return temp;
+        }
+    }
+    
+    return -1.0;
+}
+
+// Prints the CPU temperature in the format the frontend parses
+float get_cpu_temperature() {
+    float temp = read_cpu_temperature();
+    if (temp >= 0) {
+        printf("CPU Temperature: %.2f°C\n", temp);
+    } else {
+        printf("CPU Temperature: Not available\n");
+    }
+    return temp;
+}
+
+/**
+ * Attempts to read GPU temperature from various known graphics card locations
+ * Returns -1.0 if no GPU temperature sensor can be found
+ */
+float read_gpu_temperature() {
+    const char *gpu_files[] = {
+        "/sys/class/drm/card0/device/hwmon/hwmon0/temp1_input",
+        "/sys/class/drm/card0/device/hwmon/hwmon1/temp1_input",
+        "/sys/class/drm/card1/device/hwmon/hwmon0/temp1_input",
+        "/sys/class/drm/card1/device/hwmon/hwmon1/temp1_input",
+        "/sys/class/drm/card0/device/hwmon/hwmon2/temp1_input",
+        "/sys/class/drm/card0/device/hwmon/hwmon3/temp1_input",
+        "/sys/class/drm/card1/device/hwmon/hwmon2/temp1_input",
+        "/sys/class/drm/card1/device/hwmon/hwmon3/temp1_input",
+        "/sys/class/hwmon/hwmon3/temp1_input",
+        "/sys/class/hwmon/hwmon4/temp1_input",
+        NULL
+    };
+    
+    for (int i = 0; gpu_files[i] != NULL; i++) {
+        float temp = read_temperature_file(gpu_files[i]);
+        if (temp >= 0) {
+            return temp;
+        }
+    }
+
+    return -1.0;
+}
+
+// Prints the GPU temperature in the format the frontend parses
+float get_gpu_temperature() {
+    float temp = read_gpu_temperature();
+    if (temp >= 0) {
+        printf("GPU Temperature: %.2f°C\n", temp);
+    } else {
+        printf("GPU Temperature: Not available\n");
+    }
+    return temp;
+}
+
+/**
+ * Attempts to read VRM (Voltage Regulator Module) temperature from known locations
+ * Returns -1.0 if no VRM temperature sensor can be found
+ */
+float read_vrm_temperature() {
+    const char *vrm_files[] = {
+        "/sys/class/hwmon/hwmon0/temp2_input",
+        "/sys/class/hwmon/hwmon1/temp2_input",
+        "/sys/class/hwmon/hwmon2/temp2_input",
+        "/sys/class/hwmon/hwmon3/temp2_input",
+        "/sys/class/hwmon/hwmon0/temp3_input",
+        "/sys/class/hwmon/hwmon1/temp3_input",
+        "/sys/class/hwmon/hwmon2/temp3_input",
+        "/sys/class/hwmon/hwmon3/temp3_input",
+        "/sys/class/hwmon/hwmon0/in0_input",
+        "/sys/class/hwmon/hwmon1/in0_input",
+        "/sys/devices/platform/coretemp.0/hwmon/hwmon*/temp2_input",
+        "/sys/class/thermal/thermal_zone2/temp",
+        "/sys/class/thermal/thermal_zone3/temp",
+        NULL
+    };
+
+    for (int i = 0; vrm_files[i] != NULL; i++) {
+        float temp = read_temperature_file(vrm_files[i]);
+        if (temp >= 0) {
+            return temp;
+        }
+    }
+
+    return -1.0;
+}
+
+// Prints the VRM temperature in the format the frontend parses
+float get_vrm_temperature() {
+    float temp = read_vrm_temperature();
+    if (temp >= 0) {
+        printf("VRM Temperature: %.2f°C\n", temp);
+    } else {
+        printf("VRM Temperature: Not available\n");
+    }
+    return temp;
+}
+
+/**
+ * Attempts to read chipset temperature from various known locations
+ * Returns -1.0 if no chipset temperature sensor can be found
+ */
+float read_chipset_temperature() {
+    const char *chipset_files[] = {
+        "/sys/class/hwmon/hwmon0/temp4_input",
+        "/sys/class/hwmon/hwmon1/temp4_input",
+        "/sys/class/hwmon/hwmon2/temp4_input",
+        "/sys/class/hwmon/hwmon3/temp4_input",
+        "/sys/class/hwmon/hwmon0/temp5_input",
+        "/sys/class/hwmon/hwmon1/temp5_input",
+        "/sys/class/hwmon/hwmon2/temp5_input",
+        "/sys/class/hwmon/hwmon3/temp5_input",
+        "/sys/class/thermal/thermal_zone4/temp",
+        "/sys/class/thermal/thermal_zone5/temp",
+        "/sys/class/thermal/thermal_zone6/temp",
+        "/sys/class/thermal/thermal_zone7/temp",
+        NULL
+    };
+
+    for (int i = 0; chipset_files[i] != NULL; i++) {
+        float temp = read_temperature_file(chipset_files[i]);
+        if (temp >= 0) {
+            return temp;
+        }
+    }
+
+    return -1.0;
+}
+
+// Prints the Chipset temperature in the format the frontend parses
+float get_chipset_temperature() {
+    float temp = read_chipset_temperature();
+    if (temp >= 0) {
+        printf("Chipset Temperature: %.2f°C\n", temp);
+    } else {
+        printf("Chipset Temperature: Not avaliable");
+    }
+    return temp;
+}
+
+/**
+ * Attempts to read motherboard temperature from various known locations
+ * Returns -1.0 if no motherboard temperature sensor can be found
+ */
+float read_motherboard_temperature() {
+    const char *motherboard_files[] = {
+        "/sys/class/hwmon/hwmon0/temp3_input",
+        "/sys/class/hwmon/hwmon1/temp3_input",
+        "/sys/class/hwmon/hwmon2/temp3_input",
+        "/sys/class/hwmon/hwmon3/temp3_input",
+        "/sys/class/hwmon/hwmon0/temp6_input",
+        "/sys/class/hwmon/hwmon1/temp6_input",
+        "/sys/class/hwmon/hwmon2/temp6_input",
+        "/sys/class/hwmon/hwmon3/temp6_input",
+        "/sys/class/hwmon/hwmon0/temp7_input",
+        "/sys/class/hwmon/hwmon1/temp7_input",
+        "/sys/class/hwmon/hwmon2/temp7_input",
+        "/sys/class/hwmon/hwmon3/temp7_input",
+        "/sys/class/thermal/thermal_zone8/temp",
+        "/sys/class/thermal/thermal_zone9/temp",
+        "/sys/class/thermal/thermal_zone10/temp",
+        NULL
+    };
+
+    for (int i = 0; motherboard_files[i] != NULL; i++) {
+        float temp = read_temperature_file(motherboard_files[i]);
+        if (temp >= 0) {
+            return temp;
+        }
+    }
+
+    return -1.0;
+}
+
+// Prints the Motherboard temperature in the format the frontend parses
+float get_motherboard_temperature() {
+    float temp = read_motherboard_temperature();
+    if (temp >= 0) {
+        printf("Motherboard Temperature: %.2f°C\n", temp);
+    } else {
+        printf("Motherboard Temperature: Not avaliable");
+    }
+    return temp;
+}
+
+/**
+ * Attempts to read PSU (Power Supply Unit) temperature from various locations
+ * Searches through hwmon devices and power supply directories
+ * Returns -1.0 if no PSU temperature sensor can be found
+ */
+float read_psu_temperature() {
+    DIR *dir = opendir("/sys/class/hwmon");
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, "hwmon", 5) != 0) continue;
+
+            char name_path[256];
+            snprintf(name_path, sizeof(name_path), "/sys/class/hwmon/%s/name", entry->d_name);
+
+            FILE *f = fopen(name_path, "r");
+            if (!f) continue;
+
+            char devname[64];
+            if (fscanf(f, "%63s", devname) == 1) {
+                // Check if this might be a PSU monitoring device
+                if (strstr(devname, "psu") || strstr(devname, "PSU") || 
+                    strstr(devname, "corsair") || strstr(devname, "Corsair") ||
+                    strstr(devname, "seasonic") || strstr(devname, "Seasonic") ||
+                    strstr(devname, "evga") || strstr(devname, "EVGA") ||
+                    strstr(devname, "bequiet") || strstr(devname, "BeQuiet") ||
+                    strstr(devname, "rm850x") || strstr(devname, "RM850x") ||
+                    strstr(devname, "hx1000") || strstr(devname, "HX1000")) {
+                    
+                    // Try to find temperature sensors
+                    for (int i = 1; i <= 5; i++) {
+                        char temp_path[256];
+                        snprintf(temp_path, sizeof(temp_path), 
+                                "/sys/class/hwmon/%s/temp%d_input", entry->d_name, i);
+                        
+                        float temp = read_temperature_file(temp_path);
+                        if (temp >= 0) {
+                            fclose(f);
+                            closedir(dir);
+                            return temp;
+                        }
+                    }
+                }
+            }
+            fclose(f);
+        }
+        closedir(dir);
+    }
+    
+    const char *psu_files[] = {
+        "/sys/class/hwmon/hwmon*/temp1_input",
+        "/sys/class/hwmon/hwmon*/temp2_input",
+        "/sys/class/hwmon/hwmon*/temp3_input",
+        "/sys/class/hwmon/hwmon*/temp4_input",
+        "/sys/class/hwmon/hwmon*/temp5_input",
+        "/sys/class/hwmon/hwmon*/power*/temp1_input",
+        "/sys/class/hwmon/hwmon*/power*/temp2_input",
+        NULL
+    };
+    
+    for (int i = 0; psu_files[i] != NULL; i++) {
+        glob_t glob_result;
+        if (glob(psu_files[i], GLOB_NOSORT, NULL, &glob_result) == 0) {
+            for (size_t j = 0; j < glob_result.gl_pathc; j++) {
+                float temp = read_temperature_file(glob_result.gl_pathv[j]);
+                if (temp >= 0) {
+                    globfree(&glob_result);
+                    return temp;
+                }
+            }
+            globfree(&glob_result);
+        }
+    }
+    
+    dir = opendir("/sys/class/power_supply");
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] == '.') continue;
+            
+            char temp_path[256];
+            snprintf(temp_path, sizeof(temp_path), 
+                    "/sys/class/power_supply/%s/temp", entry->d_name);
+            
+            float temp = read_temperature_file(temp_path);
+            if (temp >= 0) {
+                closedir(dir);
+                return temp;
+            }
+            
+            // Check for temperature in hwmon subdirectory
+            char hwmon_path[256];
+            snprintf(hwmon_path, sizeof(hwmon_path), 
+                    "/sys/class/power_supply/%s/hwmon*/temp1_input", entry->d_name);
+            
+            glob_t glob_result;
+            if (glob(hwmon_path, GLOB_NOSORT, NULL, &glob_result) == 0) {
+                for (size_t j = 0; j < glob_result.gl_pathc; j++) {
+                    temp = read_temperature_file(glob_result.gl_pathv[j]);
+                    if (temp >= 0) {
+                        globfree(&glob_result);
+                        closedir(dir);
+                        return temp;
+                    }
+                }
+                globfree(&glob_result);
+            }
+        }
+        closedir(dir);
+    }
+    
+    return -1.0;
+}
+
+// Prints the PSU temperature in the format the frontend parses
+float get_psu_temperature() {
+    float temp = read_psu_temperature();
+    if (temp >= 0) {
+        printf("PSU Temperature: %.2f°C\n", temp);
+    } else {
+        printf("PSU Temperature: Not available\n");
+    }
+    return temp;
+}
+
+/**
+ * Attempts to read case/ambient temperature from various known locations
+ * Searches for sensors labeled as case, ambient, or similar
+ * Returns -1.0 if no case temperature sensor can be found
+ */
+float read_case_temperature() {
+    const char *case_files[] = {
+        "/sys/class/hwmon/hwmon*/temp3_input",
+        "/sys/class/hwmon/hwmon*/temp4_input",
+        "/sys/class/hwmon/hwmon*/temp5_input",
+        "/sys/class/hwmon/hwmon*/temp6_input",
+        "/sys/class/hwmon/hwmon*/temp7_input",
+        "/sys/class/hwmon/hwmon*/temp8_input",
+        "/sys/class/hwmon/hwmon*/temp9_input",
+        "/sys/class/hwmon/hwmon*/temp10_input",
+        "/sys/class/thermal/thermal_zone*/temp",
+        "/sys/devices/platform/nct6775.*/hwmon/hwmon*/temp*_input",
+        "/sys/devices/platform/it87.*/hwmon/hwmon*/temp*_input",
+        "/sys/devices/platform/f71882fg.*/hwmon/hwmon*/temp*_input",
+        NULL
+    };
+
+    DIR *dir = opendir("/sys/class/hwmon");
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, "hwmon", 5) != 0) continue;
+
+            for (int i = 1; i <= 10; i++) {
+                char label_path[256];
+                snprintf(label_path, sizeof(label_path), 
+                        "/sys/class/hwmon/%s/temp%d_label", entry->d_name, i);
+                
+                FILE *f = fopen(label_path, "r");
+                if (f) {
+                    char label[64];
+                    if (fscanf(f, "%63s", label) == 1) {
+                        if (strstr(label, "case") || strstr(label, "Case") || 
+                            strstr(label, "CASE") || strstr(label, "ambient") ||
+                            strstr(label, "Ambient") || strstr(label, "AMBIENT")) {
+                            
+                            char temp_path[256];
+                            snprintf(temp_path, sizeof(temp_path), 
+                                    "/sys/class/hwmon/%s/temp%d_input", entry->d_name, i);
+                            
+                            float temp = read_temperature_file(temp_path);
+                            fclose(f);
+                            if (temp >= 0) {
+                                closedir(dir);
+                                return temp;
+                            }
+                        }
+                    }
+                    fclose(f);
+                }
+            }
+        }
+        closedir(dir);
+    }
+
+    for (int i = 0; case_files[i] != NULL; i++) {
+        glob_t glob_result;
+        if (glob(case_files[i], GLOB_NOSORT, NULL, &glob_result) == 0) {
+            for (size_t j = 0; j < glob_result.gl_pathc; j++) {
+                float temp = read_temperature_file(glob_result.gl_pathv[j]);
+                if (temp >= 0) {
+                    globfree(&glob_result);
+                    return temp;
+                }
+            }
+            globfree(&glob_result);
+        }
+    }
+
+    return -1.0;
+}
+
+// Prints the Case temperature in the format the frontend parses
+float get_case_temperature() {
+    float temp = read_case_temperature();
+    if (temp >= 0) {
+        printf("Case Temperature: %.2f°C\n", temp);
+    } else {
+        printf("Case Temperature: Not available\n");
+    }
+    return temp;
+}
+
+/**
+ * Scans /sys/class/hwmon for storage devices (NVMe, SATA, SSD)
+ * Populates the global storage_devices array with found devices
+ */
+void discover_storage_temperature_sensors() {
+    DIR *dir = opendir("/sys/class/hwmon");
+    if (!dir) return;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "hwmon", 5) != 0) continue;
+
+        char name_path[256];
+        snprintf(name_path, sizeof(name_path), "/sys/class/hwmon/%s/name", entry->d_name);
+
+        FILE *f = fopen(name_path, "r");
+        if (!f) continue;
+
+        char devname[64];
+        if (fscanf(f, "%63s", devname) == 1) {
+            if (strstr(devname, "nvme") || strstr(devname, "drivetemp") || 
+                strstr(devname, "sata") || strstr(devname, "SATA") ||
+                strstr(devname, "ssd") || strstr(devname, "SSD")) {
+                // Try to get the parent device name (e.g., nvme0)
+                char device_path[256];
+                snprintf(device_path, sizeof(device_path), "/sys/class/hwmon/%s/device", entry->d_name);
+
+                char real_device[256];
+                ssize_t len = readlink(device_path, real_device, sizeof(real_device)-1);
+                if (len != -1) {
+                    real_device[len] = '\0';
+                    // Extract just the last part (like nvme0)
+                    char *base = strrchr(real_device, '/');
+                    if (base) base++; else base = real_device;
+
+                    // Find first temp*_input
+                    for (int i = 1; i < 10; i++) {
+                        char temp_path[256];
+                        snprintf(temp_path, sizeof(temp_path), "/sys/class/hwmon/%s/temp%d_input", entry->d_name, i);
+                        FILE *tf = fopen(temp_path, "r");
+                        if (tf) {
+                            fclose(tf);
+                            
+                            // Allocate or reallocate storage devices array
+                            StorageDevice *temp = realloc(storage_devices, (storage_device_count + 1) * sizeof(StorageDevice));
+                            if (temp == NULL) {
+                                fclose(f);
+                                closedir(dir);
+                                return;
+                            }
+                            storage_devices = temp;
+                            
+                            memset(&storage_devices[storage_device_count], 0, sizeof(StorageDevice));
+                            strncpy(storage_devices[storage_device_count].name, base, sizeof(storage_devices[0].name)-1);
+                            strncpy(storage_devices[storage_device_count].path, temp_path, sizeof(storage_devices[0].path)-1);
+                            storage_device_count++;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        fclose(f);
+    }
+    closedir(dir);
+}
+
+// Prints every storage device that reports a temperature
+void find_storage_devices_with_temperature_reporting() {
+    discover_storage_temperature_sensors();
+
+    for (int i = 0; i < storage_device_count; i++) {
+        float temp_val = read_temperature_file(storage_devices[i].path);
+        if (temp_val >= 0) {
+            printf("Storage Device Name: %s Temperature: %.2f°C\n", storage_devices[i].name, temp_val);
+        } else {
+            printf("Storage Device Name: %s Temperature: Not available\n", storage_devices[i].name);
+        }
+    }
+}
+
+// Read total CPU jiffies from /proc/stat
+unsigned long long get_total_cpu_time() {
+    FILE *fp = fopen("/proc/stat", "r");
+    if (!fp) {
+        printf("Error: Cannot open /proc/stat\n");
+        return 0;
+    }
+
+    char buffer[1024];
+    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
+    
+    // Read the first line which contains aggregate CPU statistics
+    if (fgets(buffer, sizeof(buffer), fp)) {
+        int matched = sscanf(buffer, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+               &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
+        
+        if (matched >= 4) {
+            // Calculate total CPU time
+            unsigned long long total_time = user + nice + system + idle + iowait + irq + softirq + steal;
+            
+            // Display the detailed breakdown
+            printf("\n=== CPU Time Statistics ===\n");
+            printf("Component Breakdown (in jiffies):\n");
+            printf("----------------------------\n");
+            printf("User mode:      %llu\n", user);
+            printf("Nice mode:      %llu\n", nice);
+            printf("System mode:    %llu\n", system);
+            printf("Idle time:      %llu\n", idle);
+            
+            if (matched >= 5) printf("I/O wait:       %llu\n", iowait);
+            if (matched >= 6) printf("IRQ time:       %llu\n", irq);
+            if (matched >= 7) printf("Soft IRQ:       %llu\n", softirq);
+            if (matched >= 8) printf("Steal time:     %llu\n", steal);
+            
+            printf("----------------------------\n");
+            printf("Total CPU time: %llu jiffies\n", total_time);
+            printf("============================\n\n");
+            
+            fclose(fp);
+            return total_time;
+        } else {
+            printf("Error: Failed to parse /proc/stat. Only %d fields matched.\n", matched);
+            fclose(fp);
+            return 0;
+        }
+    } else {
+        printf("Error: Cannot read from /proc/stat\n");
+        fclose(fp);
+        return 0;
+    }
+}
+
+/**
+ * Counts the number of running processes by scanning /proc directory
+ * Returns -1 if /proc cannot be accessed
+ */
+int display_running_processes() {
+    DIR *dir = opendir("/proc");
+    if (!dir) {
+        printf("Error: Cannot open /proc directory\n");
+        return -1;
+    }
+
+    struct ProcInfo {
+        char pid[32];
+        char ppid[32];
+        char name[256];
+        char state[32];
+        long ram_kb;
+        double ram_percent;
+        double cpu_percent;
+        int level;
+        int file_count;
+        int socket_count;
+        char network_connections[1024]; // Store brief network info
+    } processes[4096];
+
+    int proc_count = 0;
+    struct dirent *entry;
+    memset(processes, 0, sizeof(processes));
+
+    // Read total system memory
+    long total_mem_kb = 0;
+    FILE *meminfo = fopen("/proc/meminfo", "r");
+    if(meminfo) {
+        char line[256];
+        while(fgets(line, sizeof(line), meminfo)) {
+            if(strncmp(line, "MemTotal:", 9) == 0) {
+                sscanf(line + 9, "%ld", &total_mem_kb);
+                break;
+            }
+        }
+        fclose(meminfo);
+    }
+
+    // Read all numeric directories in /proc
+    while ((entry = readdir(dir)) != NULL && proc_count < 4096) {
+        if(entry->d_name[0] >= '0' && entry->d_name[0] <= '9') {
             char path[512];
             FILE *fp;
 
-            // Initialize process
-            strncpy(processes[proc_count].pid, entry->d_name, sizeof(processes[proc_count].pid)-1);
-            strcpy(processes[proc_count].ppid, "0");
-            strcpy(processes[proc_count].name, "Unknown");
-            strcpy(processes[proc_count].state, "Unknown");
-            processes[proc_count].ram_kb = 0;
-            processes[proc_count].ram_percent = 0.0;
-            processes[proc_count].cpu_percent = 0.0;
-            processes[proc_count].level = -1;
-            processes[proc_count].file_count = 0;
-            processes[proc_count].socket_count = 0;
-            strcpy(processes[proc_count].network_connections, "");
+            // Initialize process
+            strncpy(processes[proc_count].pid, entry->d_name, sizeof(processes[proc_count].pid)-1);
+            strcpy(processes[proc_count].ppid, "0");
+            strcpy(processes[proc_count].name, "Unknown");
+            strcpy(processes[proc_count].state, "Unknown");
+            processes[proc_count].ram_kb = 0;
+            processes[proc_count].ram_percent = 0.0;
+            processes[proc_count].cpu_percent = 0.0;
+            processes[proc_count].level = -1;
+            processes[proc_count].file_count = 0;
+            processes[proc_count].socket_count = 0;
+            strcpy(processes[proc_count].network_connections, "");
+
+            // Read /proc/[pid]/status
+            snprintf(path, sizeof(path), "/proc/%s/status", entry->d_name);
+            fp = fopen(path, "r");
+            if(fp) {
+                char buffer[1024];
+                while(fgets(buffer, sizeof(buffer), fp)) {
+                    if(strncmp(buffer, "Name:", 5) == 0) {
+                        char *name_start = buffer + 5;
+                        while(*name_start == ' ' || *name_start == '\t') name_start++;
+                        strncpy(processes[proc_count].name, name_start, sizeof(processes[proc_count].name)-1);
+                        processes[proc_count].name[strcspn(processes[proc_count].name, "\n")] = 0;
+                    } else if(strncmp(buffer, "State:", 6) == 0) {
+                        char *state_start = buffer + 6;
+                        while(*state_start == ' ' || *state_start == '\t') state_start++;
+                        strncpy(processes[proc_count].state, state_start, sizeof(processes[proc_count].state)-1);
+                        processes[proc_count].state[strcspn(processes[proc_count].state, "\n")] = 0;
+                    } else if(strncmp(buffer, "Pid:", 4) == 0) {
+                        char *pid_start = buffer + 4;
+                        while(*pid_start == ' ' || *pid_start == '\t') pid_start++;
+                        strncpy(processes[proc_count].pid, pid_start, sizeof(processes[proc_count].pid)-1);
+                        processes[proc_count].pid[strcspn(processes[proc_count].pid, "\n")] = 0;
+                    } else if(strncmp(buffer, "PPid:", 5) == 0) {
+                        char *ppid_start = buffer + 5;
+                        while(*ppid_start == ' ' || *ppid_start == '\t') ppid_start++;
+                        strncpy(processes[proc_count].ppid, ppid_start, sizeof(processes[proc_count].ppid)-1);
+                        processes[proc_count].ppid[strcspn(processes[proc_count].ppid, "\n")] = 0;
+                    } else if(strncmp(buffer, "VmRSS:", 6) == 0) {
+                        char *rss_start = buffer + 6;
+                        while(*rss_start == ' ' || *rss_start == '\t') rss_start++;
+                        sscanf(rss_start, "%ld", &processes[proc_count].ram_kb);
+                    }
+                }
+                fclose(fp);
+            }
+
+            // Calculate RAM percentage
+            if(total_mem_kb > 0)
+                processes[proc_count].ram_percent = (double)processes[proc_count].ram_kb / total_mem_kb * 100.0;
+
+            // Calculate CPU percentage
+            snprintf(path, sizeof(path), "/proc/%s/stat", processes[proc_count].pid);
+            fp = fopen(path, "r");
+            if(fp) {
+                char buffer[1024];
+                if(fgets(buffer, sizeof(buffer), fp)) {
+                    long utime, stime, cutime, cstime, starttime;
+                    sscanf(buffer,
+                        "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %ld %ld %ld %ld %*d %*d %*d %*d %*d %ld",
+                        &utime, &stime, &cutime, &cstime, &starttime);
+                    long total_time = utime + stime + cutime + cstime;
+
+                    FILE *uptime_fp = fopen("/proc/uptime", "r");
+                    double uptime = 0.0;
+                    if(uptime_fp) {
+                        fscanf(uptime_fp, "%lf", &uptime);
+                        fclose(uptime_fp);
+                    }
+
+                    long clk_tck = sysconf(_SC_CLK_TCK);
+                    if(uptime > 0)
+                        processes[proc_count].cpu_percent = 100.0 * ((double)total_time / clk_tck) / uptime;
+                }
+                fclose(fp);
+            }
+
+            // Count open files and sockets
+            snprintf(path, sizeof(path), "/proc/%s/fd", processes[proc_count].pid);
+            DIR *fd_dir = opendir(path);
+            if(fd_dir) {
+                struct dirent *fd_entry;
+                char fd_path[512];
+                char link_target[1024];
+                
+                while((fd_entry = readdir(fd_dir)) != NULL) {
+                    if(fd_entry->d_name[0] == '.') continue;
+                    
+                    processes[proc_count].file_count++;
+                    
+                    // Check if it's a socket
+                    snprintf(fd_path, sizeof(fd_path), "/proc/%s/fd/%s", 
+                             processes[proc_count].pid, fd_entry->d_name);
+                    
+                    ssize_t len = readlink(fd_path, link_target, sizeof(link_target)-1);
+                    if(len != -1) {
+                        link_target[len] = '\0';
+                        if(strncmp(link_target, "socket:", 7) == 0) {
+                            processes[proc_count].socket_count++;
+                        }
+                    }
+                }
+                closedir(fd_dir);
+            }
+
+            // Get network connection details from /proc/net/tcp and /proc/net/udp
+            processes[proc_count].file_count = processes[proc_count].file_count;
+            proc_count++;
+        }
+    }
+
+    closedir(dir);
+
+    // Calculate hierarchy levels iteratively
+    int changed;
+    do {
+        changed = 0;
+        for(int i=0;i<proc_count;i++){
+            if(processes[i].level == -1){
+                if(strcmp(processes[i].ppid,"0")==0){
+                    processes[i].level = 0;
+                    changed = 1;
+                } else {
+                    for(int j=0;j<proc_count;j++){
+                        if(strcmp(processes[j].pid,processes[i].ppid)==0 && processes[j].level!=-1){
+                            processes[i].level = processes[j].level + 1;
+                            changed = 1;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+    } while(changed);
+
+    // Set any orphaned processes to root
+    for(int i=0;i<proc_count;i++){
+        if(processes[i].level == -1) processes[i].level = 0;
+    }
+
+    // Bubble sort by level then PID
+    for(int i=0;i<proc_count-1;i++){
+        for(int j=0;j<proc_count-i-1;j++){
+            if(processes[j].level>processes[j+1].level || 
+               (processes[j].level==processes[j+1].level && atoi(processes[j].pid)>atoi(processes[j+1].pid))){
+                struct ProcInfo temp = processes[j];
+                processes[j] = processes[j+1];
+                processes[j+1] = temp;
+            }
+        }
+    }
+
+    // Display header
+    printf("\nPROCESS TREE HIERARCHY WITH FILE/SOCKET INFO:\n");
+    printf("PID (PPID)  CPU%%    RAM%%     RAM(KB)   FILES  SOCKS  STATE     COMMAND\n");
+    printf("-------------------------------------------------------------------------\n");
+
+    // Display tree
+    for(int i=0;i<proc_count;i++){
+        for(int j=0;j<processes[i].level;j++){
+            if(j == processes[i].level - 1) printf("└── ");
+            else printf("    ");
+        }
+        printf("%-5s (%-5s) %6.2f%% %6.2f%% %9ld %6d %6d %-8s %s\n",
+            processes[i].pid,
+            processes[i].ppid,
+            processes[i].cpu_percent,
+            processes[i].ram_percent,
+            processes[i].ram_kb,
+            processes[i].file_count,
+            processes[i].socket_count,
+            processes[i].state,
+            processes[i].name);
+    }
+
+    printf("\nTotal processes: %d\n", proc_count);
+    
+    printf("\n=== DETAILED FILE AND NETWORK INFO FOR HIGH-RESOURCE PROCESSES ===\n");
+    for(int i=0;i<proc_count;i++){
+            
+            printf("\n--- PID %s: %s (CPU: %.2f%%, RAM: %.2f%%, Files: %d, Sockets: %d) ---\n",
+                   processes[i].pid, processes[i].name, 
+                   processes[i].cpu_percent, processes[i].ram_percent,
+                   processes[i].file_count, processes[i].socket_count);
+            
+            // Show open files (first 10)
+            char path[512];
+            snprintf(path, sizeof(path), "/proc/%s/fd", processes[i].pid);
+            DIR *fd_dir = opendir(path);
+            if(fd_dir) {
+                printf("Open files (first 10):\n");
+                struct dirent *fd_entry;
+                char fd_path[512];
+                char link_target[1024];
+                int file_count = 0;
+                
+                while((fd_entry = readdir(fd_dir)) != NULL) {
+                    if(fd_entry->d_name[0] == '.') continue;
+                    
+                    snprintf(fd_path, sizeof(fd_path), "/proc/%s/fd/%s", 
+                             processes[i].pid, fd_entry->d_name);
+                    
+                    ssize_t len = readlink(fd_path, link_target, sizeof(link_target)-1);
+                    if(len != -1) {
+                        link_target[len] = '\0';
+                        printf("  FD %s -> %s\n", fd_entry->d_name, link_target);
+                        file_count++;
+                    }
+                }
+                closedir(fd_dir);
+            }
+            
+            // Show network connections from /proc/net/tcp
+            printf("Network connections:\n");
+            FILE *tcp_file = fopen("/proc/net/tcp", "r");
+            if(tcp_file) {
+                char line[1024];
+                fgets(line, sizeof(line), tcp_file); // Skip header
+                while(fgets(line, sizeof(line), tcp_file)) {
+                    // Basic parsing - you can enhance this to show more details
+                    char local_addr[64], remote_addr[64], state[16];
+                    int uid, inode;
+                    if(sscanf(line, "%*d: %63s %63s %15s %*x:%*x %*x:%*x %*x %d %*d %d",
+                             local_addr, remote_addr, state, &uid, &inode) >= 5) {
+                        
+                        // Check if this inode matches any of the process's socket inodes
+                        char socket_path[64];
+                        snprintf(socket_path, sizeof(socket_path), "socket:[%d]", inode);
+                        
+                        // Check if this socket belongs to our process
+                        snprintf(path, sizeof(path), "/proc/%s/fd", processes[i].pid);
+                        DIR *check_dir = opendir(path);
+                        if(check_dir) {
+                            struct dirent *check_entry;
+                            char check_path[512];
+                            char check_link[1024];
+                            
+                            while((check_entry = readdir(check_dir)) != NULL) {
+                                if(check_entry->d_name[0] == '.') continue;
+                                
+                                snprintf(check_path, sizeof(check_path), "/proc/%s/fd/%s", 
+                                         processes[i].pid, check_entry->d_name);
+                                
+                                ssize_t len = readlink(check_path, check_link, sizeof(check_link)-1);
+                                if(len != -1) {
+                                    check_link[len] = '\0';
+                                    if(strcmp(check_link, socket_path) == 0) {
+                                        printf("  TCP %s -> %s (%s)\n", local_addr, remote_addr, state);
+                                        break;
+                                    }
+                                }
+                            }
+                            closedir(check_dir);
+                        }
+                    }
+                }
+                fclose(tcp_file);
+            }
+    }
+    
+    return proc_count;
+}
+
+/**
+ * Growable heap string: appends are amortised O(1) and never truncate
+ * The data field is NUL-terminated once anything has been appended
+ */
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;
+} StringBuffer;
+
+/**
+ * Makes room for at least extra more bytes plus the terminator
+ * Doubles the capacity so repeated appends stay linear
+ */
+int reserve_string_buffer(StringBuffer *sb, size_t extra) {
+    size_t needed = sb->length + extra + 1;
+    if (needed <= sb->capacity) return 0;
+
+    size_t capacity = sb->capacity ? sb->capacity : 4096;
+    while (capacity < needed) capacity *= 2;
+
+    char *data = realloc(sb->data, capacity);
+    if (!data) return -1;
+    sb->data = data;
+    sb->capacity = capacity;
+    return 0;
+}
+
+int append_string_buffer(StringBuffer *sb, const char *text, size_t length) {
+    if (reserve_string_buffer(sb, length) != 0) return -1;
+    memcpy(sb->data + sb->length, text, length);
+    sb->length += length;
+    sb->data[sb->length] = '\0';
+    return 0;
+}
+
+int append_string(StringBuffer *sb, const char *text) {
+    return append_string_buffer(sb, text, strlen(text));
+}
+
+int append_format(StringBuffer *sb, const char *format, ...) {
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+    if (length < 0 || reserve_string_buffer(sb, length) != 0) return -1;
+
+    va_start(args, format);
+    vsnprintf(sb->data + sb->length, length + 1, format, args);
+    va_end(args);
+    sb->length += length;
+    return 0;
+}
+
+void free_string_buffer(StringBuffer *sb) {
+    free(sb->data);
+    sb->data = NULL;
+    sb->length = sb->capacity = 0;
+}
+
+/**
+ * Keeps only the first count lines of a captured output, like "| head -n count"
+ */
+void keep_first_lines(StringBuffer *sb, int count) {
+    size_t at = 0;
+    for (int line = 0; line < count && at < sb->length; line++) {
+        const char *newline = memchr(sb->data + at, '\n', sb->length - at);
+        at = newline ? (size_t)(newline - sb->data) + 1 : sb->length;
+    }
+    if (at < sb->length) {
+        sb->length = at;
+        sb->data[at] = '\0';
+    }
+}
+
+/**
+ * Keeps only the last count lines of a captured output, like "| tail -n count"
+ */
+void keep_last_lines(StringBuffer *sb, int count) {
+    if (sb->length == 0) return;
+
+    // A trailing newline ends the last line rather than starting an empty one
+    size_t at = sb->length - (sb->data[sb->length - 1] == '\n');
+    int lines = 0;
+    while (at > 0) {
+        if (sb->data[at - 1] == '\n' && ++lines == count) break;
+        at--;
+    }
+    if (at > 0) {
+        memmove(sb->data, sb->data + at, sb->length - at + 1);
+        sb->length -= at;
+    }
+}
+
+#define PATH_CACHE_SIZE 32
+
+// Resolved PATH lookups, dropped whenever $PATH itself changes
+static struct {
+    char name[64];
+    char path[256];
+    int found;
+} path_cache[PATH_CACHE_SIZE];
+static int path_cache_count;
+static char *path_cache_env;
+
+/**
+ * Resolves a command name against $PATH the way execvp would, without forking "which"
+ * Returns NULL when it is not installed; both outcomes are cached
+ */
+const char *find_executable(const char *name) {
+    if (strchr(name, '/')) return access(name, X_OK) == 0 ? name : NULL;
+
+    const char *path = getenv("PATH");
+    if (!path) path = "/usr/local/bin:/usr/bin:/bin";
+    if (!path_cache_env || strcmp(path_cache_env, path) != 0) {
+        free(path_cache_env);
+        path_cache_env = strdup(path);
+        path_cache_count = 0;
+    }
+
+    for (int i = 0; i < path_cache_count; i++) {
+        if (strcmp(path_cache[i].name, name) == 0) return path_cache[i].found ? path_cache[i].path : NULL;
+    }
+
+    char candidate[256];
+    int found = 0;
+    for (const char *dir = path; !found; ) {
+        size_t len = strcspn(dir, ":");
+        // An empty entry means the current directory
+        int written = len ? snprintf(candidate, sizeof(candidate), "%.*s/%s", (int)len, dir, name)
+                          : snprintf(candidate, sizeof(candidate), "./%s", name);
+        struct stat st;
+        if (written > 0 && (size_t)written < sizeof(candidate) &&
+            stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0) {
+            found = 1;
+        }
+        if (dir[len] == '\0') break;
+        dir += len + 1;
+    }
+
+    if (path_cache_count < PATH_CACHE_SIZE && strlen(name) < sizeof(path_cache[0].name)) {
+        int slot = path_cache_count++;
+        snprintf(path_cache[slot].name, sizeof(path_cache[slot].name), "%s", name);
+        snprintf(path_cache[slot].path, sizeof(path_cache[slot].path), "%s", found ? candidate : "");
+        path_cache[slot].found = found;
+        return found ? path_cache[slot].path : NULL;
+    }
+    // Cache full: fall back to a static copy of this one result
+    static char uncached[256];
+    snprintf(uncached, sizeof(uncached), "%s", candidate);
+    return found ? uncached : NULL;
+}
+
+#define SPAWN_MAX_PARALLEL 8
+#define SPAWN_DEFAULT_TIMEOUT_MS 10000
+#define SPAWN_TERM_GRACE_MS 500
+
+typedef enum {
+    SPAWN_STDERR_DISCARD,   // Like 2>/dev/null
+    SPAWN_STDERR_CAPTURE,   // Into err, polled alongside stdout
+    SPAWN_STDERR_MERGE,     // Into out, like 2>&1
+    SPAWN_STDERR_INHERIT    // Straight to our own stderr
+} SpawnStderr;
+
+/**
+ * A child started from an argv array without a shell
+ * Set argv, timeout_ms and stderr_mode, the rest is filled in by run_spawned_commands
+ */
+typedef struct {
+    const char *const *argv;
+    int timeout_ms;             // 0 means SPAWN_DEFAULT_TIMEOUT_MS
+    SpawnStderr stderr_mode;
+    StringBuffer out;
+    StringBuffer err;
+    int status;                 // Wait status once reaped, -1 if it never ran
+    int error;                  // errno from the spawn when status is -1
+    int timed_out;
+    pid_t pid;
+    int out_fd;
+    int err_fd;
+    int signal_sent;            // Last escalation step: 0, SIGTERM or SIGKILL
+    long long deadline_ms;
+} SpawnedCommand;
+
+static long long monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Spawns the command in its own process group with stdout (and optionally stderr) on non-blocking pipes
+ * Returns -1 with cmd->error set if the program is missing or could not be started
+ */
+static int start_spawned_command(SpawnedCommand *cmd) {
+    int out_pipe[2] = {-1, -1}, err_pipe[2] = {-1, -1};
+
+    cmd->pid = -1;
+    cmd->out_fd = cmd->err_fd = -1;
+    cmd->status = -1;
+    cmd->timed_out = cmd->signal_sent = 0;
+
+    const char *path = find_executable(cmd->argv[0]);
+    if (!path) {
+        cmd->error = ENOENT;
+        return -1;
+    }
+    if (pipe2(out_pipe, O_CLOEXEC) != 0 ||
+        (cmd->stderr_mode == SPAWN_STDERR_CAPTURE && pipe2(err_pipe, O_CLOEXEC) != 0)) {
+        cmd->error = errno;
+        if (out_pipe[0] >= 0) {
+            close(out_pipe[0]);
+            close(out_pipe[1]);
+        }
+        return -1;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+    if (cmd->stderr_mode == SPAWN_STDERR_DISCARD) {
+        posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    } else if (cmd->stderr_mode == SPAWN_STDERR_CAPTURE) {
+        posix_spawn_file_actions_adddup2(&actions, err_pipe[1], STDERR_FILENO);
+    } else if (cmd->stderr_mode == SPAWN_STDERR_MERGE) {
+        posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDERR_FILENO);
+    }
+
+    // Own process group so a timeout reaches the whole tree, with default signal handling
+    posix_spawnattr_t attr;
+    sigset_t defaults, mask;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    sigaddset(&defaults, SIGINT);
+    sigaddset(&defaults, SIGTERM);
+    sigemptyset(&mask);
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setpgroup(&attr, 0);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+    pid_t pid;
+    int rc = posix_spawn(&pid, path, &actions, &attr, (char *const *)cmd->argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    close(out_pipe[1]);
+    if (err_pipe[1] >= 0) close(err_pipe[1]);
+    if (rc != 0) {
+        close(out_pipe[0]);
+        if (err_pipe[0] >= 0) close(err_pipe[0]);
+        cmd->error = rc;
+        return -1;
+    }
+
+    fcntl(out_pipe[0], F_SETFL, fcntl(out_pipe[0], F_GETFL) | O_NONBLOCK);
+    if (err_pipe[0] >= 0) fcntl(err_pipe[0], F_SETFL, fcntl(err_pipe[0], F_GETFL) | O_NONBLOCK);
+    cmd->pid = pid;
+    cmd->out_fd = out_pipe[0];
+    cmd->err_fd = err_pipe[0];
+    cmd->deadline_ms = monotonic_ms() + (cmd->timeout_ms > 0 ? cmd->timeout_ms : SPAWN_DEFAULT_TIMEOUT_MS);
+    return 0;
+}
+
+/**
+ * Drains whatever is readable from one pipe
+ * Returns 1 once the pipe hits EOF or fails
+ */
+static int read_spawned_pipe(int fd, StringBuffer *sb) {
+    for (;;) {
+        if (reserve_string_buffer(sb, 4096) != 0) return 1;
+        ssize_t n = read(fd, sb->data + sb->length, sb->capacity - sb->length - 1);
+        if (n > 0) {
+            sb->length += n;
+            sb->data[sb->length] = '\0';
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        return 1;
+    }
+}
+
+static void close_spawned_pipes(SpawnedCommand *cmd) {
+    if (cmd->out_fd >= 0) close(cmd->out_fd);
+    if (cmd->err_fd >= 0) close(cmd->err_fd);
+    cmd->out_fd = cmd->err_fd = -1;
+}
+
+static void *reap_spawned_child(void *arg) {
+    waitpid((pid_t)(intptr_t)arg, NULL, 0);
+    return NULL;
+}
+
+/**
+ * Gives up on a command that is still running after SIGKILL
+ * The kill stays pending, so a detached thread waits for the exit and no zombie is left behind
+ */
+static void abandon_spawned_command(SpawnedCommand *cmd) {
+    kill(-cmd->pid, SIGKILL);
+    close_spawned_pipes(cmd);
+    if (waitpid(cmd->pid, NULL, WNOHANG) != cmd->pid) {
+        pthread_t thread;
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        pthread_create(&thread, &attr, reap_spawned_child, (void *)(intptr_t)cmd->pid);
+        pthread_attr_destroy(&attr);
+    }
+    cmd->status = -1;
+    cmd->pid = -1;
+}
+
+/**
+ * Runs the commands with at most max_parallel alive at once, polling every stdout and stderr pipe together
+ * A command past its timeout gets SIGTERM, then SIGKILL after a grace period, sent to its whole group
+ */
+void run_spawned_commands(SpawnedCommand **cmds, int count, int max_parallel) {
+    struct pollfd fds[SPAWN_MAX_PARALLEL * 2];
+    SpawnedCommand *owners[SPAWN_MAX_PARALLEL * 2];
+    StringBuffer *sinks[SPAWN_MAX_PARALLEL * 2];
+    int next = 0, running = 0;
+
+    if (max_parallel < 1) max_parallel = 1;
+    if (max_parallel > SPAWN_MAX_PARALLEL) max_parallel = SPAWN_MAX_PARALLEL;
+    for (int i = 0; i < count; i++) {
+        cmds[i]->pid = -1;
+        cmds[i]->out_fd = cmds[i]->err_fd = -1;
+    }
+
+    while (next < count || running > 0) {
+        // Keep the pool full
+        while (next < count && running < max_parallel) {
+            if (start_spawned_command(cmds[next++]) == 0) running++;
+        }
+
+        int nfds = 0;
+        long long now = monotonic_ms(), wait_ms = SPAWN_DEFAULT_TIMEOUT_MS;
+        for (int i = 0; i < next; i++) {
+            SpawnedCommand *cmd = cmds[i];
+            if (cmd->pid < 0) continue;
+
+            long long remaining = cmd->deadline_ms - now;
+            if (remaining < wait_ms) wait_ms = remaining < 0 ? 0 : remaining;
+            if (cmd->out_fd >= 0) {
+                fds[nfds] = (struct pollfd){cmd->out_fd, POLLIN, 0};
+                owners[nfds] = cmd;
+                sinks[nfds++] = &cmd->out;
+            }
+            if (cmd->err_fd >= 0) {
+                fds[nfds] = (struct pollfd){cmd->err_fd, POLLIN, 0};
+                owners[nfds] = cmd;
+                sinks[nfds++] = &cmd->err;
+            }
+            // Output closed but not yet exited; check back shortly
+            if (cmd->out_fd < 0 && cmd->err_fd < 0 && wait_ms > 10) wait_ms = 10;
+        }
+
+        if (poll(fds, nfds, (int)wait_ms) < 0 && errno != EINTR) {
+            for (int i = 0; i < next; i++) {
+                if (cmds[i]->pid >= 0) abandon_spawned_command(cmds[i]);
+            }
+            break;
+        }
+
+        for (int j = 0; j < nfds; j++) {
+            if (!fds[j].revents || !read_spawned_pipe(fds[j].fd, sinks[j])) continue;
+            close(fds[j].fd);
+            if (owners[j]->out_fd == fds[j].fd) owners[j]->out_fd = -1;
+            else owners[j]->err_fd = -1;
+        }
+
+        now = monotonic_ms();
+        for (int i = 0; i < next; i++) {
+            SpawnedCommand *cmd = cmds[i];
+            if (cmd->pid < 0) continue;
+
+            if (cmd->out_fd < 0 && cmd->err_fd < 0 && waitpid(cmd->pid, &cmd->status, WNOHANG) == cmd->pid) {
+                cmd->pid = -1;
+                running--;
+            } else if (now >= cmd->deadline_ms) {
+                if (cmd->signal_sent == 0) {
+                    cmd->timed_out = 1;
+                    cmd->signal_sent = SIGTERM;
+                    kill(-cmd->pid, SIGTERM);
+                    cmd->deadline_ms = now + SPAWN_TERM_GRACE_MS;
+                } else if (cmd->signal_sent == SIGTERM) {
+                    cmd->signal_sent = SIGKILL;
+                    kill(-cmd->pid, SIGKILL);
+                    close_spawned_pipes(cmd);
+                    cmd->deadline_ms = now + SPAWN_TERM_GRACE_MS;
+                } else {
+                    // Unkillable for now (e.g. stuck in the kernel); stop waiting for it
+                    abandon_spawned_command(cmd);
+                    running--;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Runs one command to completion, appending its stdout to out
+ * Returns the exit code, or -1 if it could not be run, was killed or timed out
+ */
+int run_command(const char *const *argv, int timeout_ms, SpawnStderr stderr_mode, StringBuffer *out) {
+    SpawnedCommand cmd;
+    SpawnedCommand *list[1] = {&cmd};
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.argv = argv;
+    cmd.timeout_ms = timeout_ms;
+    cmd.stderr_mode = stderr_mode;
+    cmd.out = *out;
+
+    run_spawned_commands(list, 1, 1);
+    *out = cmd.out;
+    free_string_buffer(&cmd.err);
+
+    if (cmd.timed_out || cmd.status == -1 || !WIFEXITED(cmd.status)) return -1;
+    return WEXITSTATUS(cmd.status);
+}
+
+#define CMD_BUFFER_SIZE 1024
+
+/**
+ * Find the full path of the smartctl binary for querying S.M.A.R.T. data from drives
+ */
+const char *find_smartctl_path() {
+    const char *path = find_executable("smartctl");
+    if (path) return path;
+    
+    // sbin directories are often missing from a desktop user's PATH
+    const char *common_paths[] = {
+        "/usr/sbin/smartctl",
+        "/usr/bin/smartctl",
+        "/sbin/smartctl",
+        "/usr/local/sbin/smartctl",
+        "/usr/local/bin/smartctl",
+        NULL
+    };
+    
+    for (int i = 0; common_paths[i] != NULL; i++) {
+        if (access(common_paths[i], X_OK) == 0) {
+            return common_paths[i];
+        }
+    }
+    
+    return NULL;
+}
+
+/**
+ * Reads a one-line sysfs/procfs attribute without its trailing newline
+ * Returns -1 if the file is missing, unreadable or empty
+ */
+int read_sysfs_string(const char *path, char *buf, size_t size) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    if (!fgets(buf, size, fp)) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    buf[strcspn(buf, "\n")] = '\0';
+    return buf[0] ? 0 : -1;
+}
+
+// One block device from /sys/block, or a partition of one
+typedef struct {
+    char name[32];
+    char type[8];               // disk, part, lvm, mpath, crypt, dm, md, loop, zram, ...
+    char parent[32];            // Disk a partition belongs to
+    char label[64];             // Device-mapper name or md RAID level
+    unsigned long long size_bytes;
+    int rotational;
+    int removable;
+    int read_only;
+    char model[64];
+    char serial[64];
+    char wwid[96];              // World wide id, where the transport reports one
+    char scheduler[32];
+    int queue_depth;
+    char partitions[512];       // Comma-separated names
+    char holders[512];          // Devices stacked on top of this one
+    char slaves[512];           // Devices this one is stacked on
+} BlockDevice;
+
+// Every block device and partition, in /sys/block order with partitions after their disk
+typedef struct {
+    BlockDevice *devices;
+    int count;
+    int capacity;
+} BlockTopology;
+
+static int skip_dot_entries(const struct dirent *entry) {
+    return entry->d_name[0] != '.';
+}
+
+// Reads the named attribute file of a block device's sysfs directory
+static int read_block_attribute(const char *sys_path, const char *name, char *buf, size_t size) {
+    char path[PATH_MAX];
+    if (snprintf(path, sizeof(path), "%s/%s", sys_path, name) >= (int)sizeof(path)) return -1;
+    return read_sysfs_string(path, buf, size);
+}
+
+// Joins the entry names of a sysfs subdirectory such as holders/ with commas
+static void list_sysfs_directory(const char *sys_path, const char *name, char *out, size_t size) {
+    struct dirent **entries;
+    char path[PATH_MAX];
+    size_t used = 0;
+
+    out[0] = '\0';
+    if (snprintf(path, sizeof(path), "%s/%s", sys_path, name) >= (int)sizeof(path)) return;
+    int count = scandir(path, &entries, skip_dot_entries, alphasort);
+    for (int i = 0; i < count; i++) {
+        if (used < size) used += snprintf(out + used, size - used, "%s%s", used ? "," : "", entries[i]->d_name);
+        free(entries[i]);
+    }
+    if (count >= 0) free(entries);
+}
+
+static BlockDevice *add_block_device(BlockTopology *topology, const char *name) {
+    if (topology->count == topology->capacity) {
+        int capacity = topology->capacity ? topology->capacity * 2 : 32;
+        BlockDevice *grown = realloc(topology->devices, capacity * sizeof(BlockDevice));
+        if (!grown) return NULL;
+        topology->devices = grown;
+        topology->capacity = capacity;
+    }
+    BlockDevice *device = &topology->devices[topology->count++];
+    memset(device, 0, sizeof(*device));
+    snprintf(device->name, sizeof(device->name), "%s", name);
+    return device;
+}
+
+// Attributes shared by disks and partitions: size, read-only flag and the stacking links
+static void read_block_links(BlockDevice *device, const char *sys_path) {
+    char value[64];
+
+    if (read_block_attribute(sys_path, "size", value, sizeof(value)) == 0) device->size_bytes = strtoull(value, NULL, 10) * 512;
+    if (read_block_attribute(sys_path, "ro", value, sizeof(value)) == 0) device->read_only = atoi(value);
+    list_sysfs_directory(sys_path, "holders", device->holders, sizeof(device->holders));
+    list_sysfs_directory(sys_path, "slaves", device->slaves, sizeof(device->slaves));
+}
+
+// Names the kind of device from its device-mapper uuid prefix, md directory or kernel name
+static void classify_block_device(BlockDevice *device, const char *sys_path) {
+    static const struct {
+        const char *prefix;
+        const char *type;
+    } name_types[] = {
+        {"loop", "loop"}, {"zram", "zram"}, {"nbd", "nbd"}, {"ram", "ram"}, {"sr", "rom"}, {"md", "md"},
+    };
+    char value[128];
+
+    if (read_block_attribute(sys_path, "dm/name", device->label, sizeof(device->label)) == 0) {
+        const char *type = "dm";
+        if (read_block_attribute(sys_path, "dm/uuid", value, sizeof(value)) == 0) {
+            if (strncmp(value, "LVM-", 4) == 0) type = "lvm";
+            else if (strncmp(value, "mpath-", 6) == 0) type = "mpath";
+            else if (strncmp(value, "CRYPT-", 6) == 0) type = "crypt";
+        }
+        snprintf(device->type, sizeof(device->type), "%s", type);
+        return;
+    }
+
+    read_block_attribute(sys_path, "md/level", device->label, sizeof(device->label));
+
+    snprintf(device->type, sizeof(device->type), "disk");
+    for (size_t i = 0; i < sizeof(name_types) / sizeof(name_types[0]); i++) {
+        if (strncmp(device->name, name_types[i].prefix, strlen(name_types[i].prefix)) == 0) {
+            snprintf(device->type, sizeof(device->type), "%s", name_types[i].type);
+            break;
+        }
+    }
+}
+
+// Model, serial and request queue settings of a whole device
+static void read_block_queue(BlockDevice *device, const char *sys_path) {
+    char value[256];
+
+    if (read_block_attribute(sys_path, "queue/rotational", value, sizeof(value)) == 0) device->rotational = atoi(value);
+    if (read_block_attribute(sys_path, "removable", value, sizeof(value)) == 0) device->removable = atoi(value);
+
+    // SCSI and NVMe expose model, MMC exposes name; serial sits on the disk (virtio, NVMe) or its device
+    if (read_block_attribute(sys_path, "device/model", device->model, sizeof(device->model)) != 0) {
+        read_block_attribute(sys_path, "device/name", device->model, sizeof(device->model));
+    }
+    if (read_block_attribute(sys_path, "serial", device->serial, sizeof(device->serial)) != 0) {
+        read_block_attribute(sys_path, "device/serial", device->serial, sizeof(device->serial));
+    }
+    if (read_block_attribute(sys_path, "wwid", device->wwid, sizeof(device->wwid)) != 0) {
+        read_block_attribute(sys_path, "device/wwid", device->wwid, sizeof(device->wwid));
+    }
+    // sysfs pads both with spaces
+    for (char *field = device->model; field; field = field == device->model ? device->serial : NULL) {
+        size_t len = strlen(field);
+        while (len > 0 && field[len - 1] == ' ') field[--len] = '\0';
+    }
+
+    // "mq-deadline [none]" marks the active scheduler in brackets
+    if (read_block_attribute(sys_path, "queue/scheduler", value, sizeof(value)) == 0) {
+        char *open = strchr(value, '['), *close = open ? strchr(open, ']') : NULL;
+        if (open && close) {
+            *close = '\0';
+            snprintf(device->scheduler, sizeof(device->scheduler), "%.31s", open + 1);
+        } else {
+            snprintf(device->scheduler, sizeof(device->scheduler), "%.31s", value);
+        }
+    }
+
+    // The device's own tag depth where the driver reports one, else the block layer's request limit
+    if (read_block_attribute(sys_path, "device/queue_depth", value, sizeof(value)) != 0 &&
+        read_block_attribute(sys_path, "queue/nr_requests", value, sizeof(value)) != 0) {
+        value[0] = '\0';
+    }
+    device->queue_depth = atoi(value);
+}
+
+/**
+ * Builds the device list and dm/LVM/md stacking graph from /sys/block and each device's holders/slaves
+ * Returns the number of devices, or -1 if /sys/block cannot be read
+ */
+int build_block_topology(BlockTopology *topology) {
+    struct dirent **disks;
+    int count = scandir("/sys/block", &disks, skip_dot_entries, alphasort);
+    memset(topology, 0, sizeof(*topology));
+    if (count < 0) return -1;
+
+    for (int i = 0; i < count; i++) {
+        char sys_path[PATH_MAX];
+        snprintf(sys_path, sizeof(sys_path), "/sys/block/%s", disks[i]->d_name);
+
+        BlockDevice *disk = add_block_device(topology, disks[i]->d_name);
+        if (disk) {
+            read_block_links(disk, sys_path);
+            classify_block_device(disk, sys_path);
+            read_block_queue(disk, sys_path);
+        }
+
+        // Partitions are subdirectories of their disk that carry a partition number
+        struct dirent **children;
+        int child_count = scandir(sys_path, &children, skip_dot_entries, alphasort);
+        for (int j = 0; j < child_count; j++) {
+            char part_path[PATH_MAX], number[16];
+            int written = snprintf(part_path, sizeof(part_path), "%s/%s", sys_path, children[j]->d_name);
+            if (disk && written < (int)sizeof(part_path) &&
+                read_block_attribute(part_path, "partition", number, sizeof(number)) == 0) {
+                int disk_index = disk - topology->devices;
+                BlockDevice *part = add_block_device(topology, children[j]->d_name);
+                disk = &topology->devices[disk_index];
+                if (part) {
+                    read_block_links(part, part_path);
+                    snprintf(part->type, sizeof(part->type), "part");
+                    snprintf(part->parent, sizeof(part->parent), "%s", disk->name);
+                    size_t used = strlen(disk->partitions);
+                    if (used < sizeof(disk->partitions)) {
+                        snprintf(disk->partitions + used, sizeof(disk->partitions) - used, "%s%s",
+                                 used ? "," : "", part->name);
+                    }
+                }
+            }
+            free(children[j]);
+        }
+        if (child_count >= 0) free(children);
+        free(disks[i]);
+    }
+    free(disks);
+    return topology->count;
+}
+
+void free_block_topology(BlockTopology *topology) {
+    free(topology->devices);
+    memset(topology, 0, sizeof(*topology));
+}
+
+static const BlockDevice *find_block_device(const BlockTopology *topology, const char *name) {
+    for (int i = 0; i < topology->count; i++) {
+        if (strcmp(topology->devices[i].name, name) == 0) return &topology->devices[i];
+    }
+    return NULL;
+}
+
+/**
+ * Lists whole devices with a medium, including dm, md, loop and zram devices
+ */
+void detect_all_storage_devices(FILE *out) {
+    BlockTopology topology;
+    if (build_block_topology(&topology) < 0) {
+        fprintf(out, "Error: Cannot read /sys/block\n");
+        return;
+    }
+
+    for (int i = 0; i < topology.count; i++) {
+        const BlockDevice *device = &topology.devices[i];
+        if (strcmp(device->type, "part") == 0 || device->size_bytes == 0) continue;
+        fprintf(out, "Detected storage device: /dev/%s\n", device->name);
+    }
+    free_block_topology(&topology);
+}
+
+// Prints a device and, indented below it, its partitions and every device stacked on it
+static void print_block_stack(FILE *out, const BlockTopology *topology, const BlockDevice *device, int depth) {
+    char children[1024], *saveptr;
+
+    fprintf(out, "%*s%s", depth * 2, "", device->name);
+    if (device->label[0]) fprintf(out, " (%s)", device->label);
+    fprintf(out, " [%s]\n", device->type);
+    if (depth >= 16) return;  // Guards against a malformed holders loop
+
+    snprintf(children, sizeof(children), "%s%s%s", device->partitions,
+             device->partitions[0] && device->holders[0] ? "," : "", device->holders);
+    for (char *name = strtok_r(children, ",", &saveptr); name; name = strtok_r(NULL, ",", &saveptr)) {
+        const BlockDevice *child = find_block_device(topology, name);
+        if (child) print_block_stack(out, topology, child, depth + 1);
+    }
+}
+
+/**
+ * Prints every block device's attributes, one line each, followed by the stacking graph
+ */
+void print_block_topology(FILE *out) {
+    BlockTopology topology;
+    if (build_block_topology(&topology) < 0) {
+        fprintf(out, "Error: Cannot read /sys/block\n");
+        return;
+    }
+
+    for (int i = 0; i < topology.count; i++) {
+        const BlockDevice *device = &topology.devices[i];
+        fprintf(out, "Block device %s: type=%s size=%llu ro=%d", device->name, device->type, device->size_bytes, device->read_only);
+        if (strcmp(device->type, "part") == 0) {
+            fprintf(out, " parent=%s", device->parent);
+        } else {
+            fprintf(out, " rotational=%d removable=%d model=\"%s\" serial=\"%s\" scheduler=%s queue_depth=%d partitions=%s",
+                   device->rotational, device->removable, device->model, device->serial,
+                   device->scheduler[0] ? device->scheduler : "-", device->queue_depth, device->partitions);
+        }
+        if (device->label[0]) fprintf(out, " label=%s", device->label);
+        fprintf(out, " holders=%s slaves=%s\n", device->holders, device->slaves);
+    }
+
+    // The graph starts from devices that sit on nothing else; unused loop and zram devices are left out
+    fprintf(out, "\n=== Device Stacking ===\n");
+    for (int i = 0; i < topology.count; i++) {
+        const BlockDevice *device = &topology.devices[i];
+        if (strcmp(device->type, "part") == 0 || device->slaves[0] || device->size_bytes == 0) continue;
+        print_block_stack(out, &topology, device, 0);
+    }
+    free_block_topology(&topology);
+}
+
+#define SMART_IO_TIMEOUT_MS 10000
+#define SMART_MAX_DEVICES 256
+
+// A disk to query, and the identity its SMART cache is filed under
+typedef struct {
+    char path[64];
+    char key[96];
+} SmartDevice;
+
+/**
+ * Names a drive by its world wide id, else model and serial, so a cached report follows the
+ * drive when kernel names are handed out in another order; the kernel name is the last resort
+ */
+static void smart_device_key(const BlockDevice *device, char *key, size_t size) {
+    char identity[192];
+    if (device->wwid[0]) snprintf(identity, sizeof(identity), "%s", device->wwid);
+    else if (device->serial[0]) snprintf(identity, sizeof(identity), "%s%s%s", device->model, device->model[0] ? "-" : "", device->serial);
+    else snprintf(identity, sizeof(identity), "%s", device->name);
+
+    // Only characters that are safe in a file name; a long identity keeps a hash of the whole
+    size_t length = 0;
+    for (const char *c = identity; *c && length < size - 1; c++) {
+        key[length++] = isalnum((unsigned char)*c) || *c == '.' || *c == '-' ? *c : '_';
+    }
+    key[length] = '\0';
+    if (strlen(identity) <= length) return;
+
+    uint32_t hash = 2166136261u;
+    for (const char *c = identity; *c; c++) hash = (hash ^ (unsigned char)*c) * 16777619u;
+    char suffix[16];
+    int suffix_length = snprintf(suffix, sizeof(suffix), "~%08x", hash);
+    memcpy(key + size - 1 - suffix_length, suffix, suffix_length + 1);
+}
+
+/**
+ * Lists whole physical disks that may answer SMART queries
+ * Returns the number of disks written to devices
+ */
+int list_smart_devices(SmartDevice *devices, int max) {
+    BlockTopology topology;
+    int count = 0;
+    if (build_block_topology(&topology) < 0) return 0;
+
+    for (int i = 0; i < topology.count && count < max; i++) {
+        const BlockDevice *device = &topology.devices[i];
+        if (strcmp(device->type, "disk") != 0 || device->size_bytes == 0) continue;
+        snprintf(devices[count].path, sizeof(devices[count].path), "/dev/%s", device->name);
+        smart_device_key(device, devices[count].key, sizeof(devices[count].key));
+        count++;
+    }
+    free_block_topology(&topology);
+    return count;
+}
+
+/**
+ * Sends one ATA command through SCSI ATA PASS-THROUGH (16)
+ * With a buffer it reads sectors of data; without one the result registers are returned in regs
+ */
+static int ata_pass_through(int fd, uint8_t command, uint8_t feature, uint8_t count,
+                            uint8_t *buf, int sectors, uint8_t regs[7]) {
+    uint8_t cdb[16] = {0}, sense[32] = {0};
+    sg_io_hdr_t io;
+
+    cdb[0] = 0x85;
+    if (sectors) {
+        cdb[1] = 4 << 1;        // PIO data-in
+        cdb[2] = 0x0E;          // Length in sector count, in blocks, from device
+    } else {
+        cdb[1] = 3 << 1;        // Non-data
+        cdb[2] = 0x20;          // CK_COND: always return the result registers
+    }
+    cdb[4] = feature;
+    cdb[6] = sectors ? sectors : count;
+    cdb[8] = 0;
+    cdb[10] = 0x4F;             // SMART signature in LBA mid/high, ignored by other commands
+    cdb[12] = 0xC2;
+    cdb[14] = command;
+
+    memset(&io, 0, sizeof(io));
+    io.interface_id = 'S';
+    io.cmd_len = sizeof(cdb);
+    io.cmdp = cdb;
+    io.mx_sb_len = sizeof(sense);
+    io.sbp = sense;
+    io.dxfer_direction = sectors ? SG_DXFER_FROM_DEV : SG_DXFER_NONE;
+    io.dxfer_len = sectors * 512;
+    io.dxferp = buf;
+    io.timeout = SMART_IO_TIMEOUT_MS;
+
+    if (ioctl(fd, SG_IO, &io) != 0) return -1;
+    if (io.host_status || (io.driver_status & ~0x08)) {   // 0x08 is DRIVER_SENSE
+        errno = EIO;
+        return -1;
+    }
+
+    // Descriptor sense with the ATA Status Return descriptor carries the registers
+    const uint8_t *desc = sense + 8;
+    int has_registers = io.sb_len_wr >= 22 && (sense[0] & 0x7F) == 0x72 && desc[0] == 0x09;
+    if (has_registers && (desc[13] & 0x01)) {   // ERR bit in the status register
+        errno = EIO;
+        return -1;
+    }
+    if (!has_registers && io.status && io.status != 0x02) {
+        errno = EIO;
+        return -1;
+    }
+    if (regs) {
+        if (!has_registers) {
+            errno = ENOTSUP;
+            return -1;
+        }
+        // error, count, lba low, lba mid, lba high, device, status
+        regs[0] = desc[3];
+        regs[1] = desc[5];
+        regs[2] = desc[7];
+        regs[3] = desc[9];
+        regs[4] = desc[11];
+        regs[5] = desc[12];
+        regs[6] = desc[13];
+    }
+    return 0;
+}
+
+// IDENTIFY strings are byte-swapped within each 16-bit word and space padded
+static void ata_identify_string(const uint8_t *identify, int first_word, int words, char *out) {
+    int len = 0;
+    for (int w = 0; w < words; w++) {
+        out[len++] = identify[(first_word + w) * 2 + 1];
+        out[len++] = identify[(first_word + w) * 2];
+    }
+    while (len > 0 && out[len - 1] == ' ') len--;
+    out[len] = '\0';
+
+    int start = strspn(out, " ");
+    memmove(out, out + start, len - start + 1);
+}
+
+static const struct {
+    uint8_t id;
+    const char *name;
+} ata_attribute_names[] = {
+    {1, "Raw_Read_Error_Rate"}, {2, "Throughput_Performance"}, {3, "Spin_Up_Time"},
+    {4, "Start_Stop_Count"}, {5, "Reallocated_Sector_Ct"}, {7, "Seek_Error_Rate"},
+    {8, "Seek_Time_Performance"}, {9, "Power_On_Hours"}, {10, "Spin_Retry_Count"},
+    {11, "Calibration_Retry_Count"}, {12, "Power_Cycle_Count"}, {170, "Available_Reservd_Space"},
+    {171, "Program_Fail_Count"}, {172, "Erase_Fail_Count"}, {173, "Wear_Leveling_Count"},
+    {174, "Unexpect_Power_Loss_Ct"}, {177, "Wear_Leveling_Count"}, {179, "Used_Rsvd_Blk_Cnt_Tot"},
+    {181, "Program_Fail_Cnt_Total"}, {182, "Erase_Fail_Count_Total"}, {183, "Runtime_Bad_Block"},
+    {184, "End-to-End_Error"}, {187, "Reported_Uncorrect"}, {188, "Command_Timeout"},
+    {189, "High_Fly_Writes"}, {190, "Airflow_Temperature_Cel"}, {191, "G-Sense_Error_Rate"},
+    {192, "Power-Off_Retract_Count"}, {193, "Load_Cycle_Count"}, {194, "Temperature_Celsius"},
+    {195, "Hardware_ECC_Recovered"}, {196, "Reallocated_Event_Count"}, {197, "Current_Pending_Sector"},
+    {198, "Offline_Uncorrectable"}, {199, "UDMA_CRC_Error_Count"}, {200, "Multi_Zone_Error_Rate"},
+    {231, "SSD_Life_Left"}, {233, "Media_Wearout_Indicator"}, {240, "Head_Flying_Hours"},
+    {241, "Total_LBAs_Written"}, {242, "Total_LBAs_Read"},
+};
+
+static const char *ata_attribute_name(uint8_t id) {
+    for (size_t i = 0; i < sizeof(ata_attribute_names) / sizeof(ata_attribute_names[0]); i++) {
+        if (ata_attribute_names[i].id == id) return ata_attribute_names[i].name;
+    }
+    return "Unknown_Attribute";
+}
+
+/**
+ * Formats IDENTIFY DEVICE, SMART READ DATA and READ THRESHOLDS sectors as smartctl-style sections
+ * Each attribute becomes one "Name: value=.. worst=.. thresh=.. raw=.." line; thresholds may be NULL
+ */
+void format_ata_smart(const uint8_t *identify, const uint8_t *data, const uint8_t *thresholds,
+                      int health, StringBuffer *out) {
+    char text[48];
+
+    append_string(out, "=== START OF INFORMATION SECTION ===\n");
+    ata_identify_string(identify, 27, 20, text);
+    append_format(out, "Device Model: %s\n", text);
+    ata_identify_string(identify, 10, 10, text);
+    append_format(out, "Serial Number: %s\n", text);
+    ata_identify_string(identify, 23, 4, text);
+    append_format(out, "Firmware Version: %s\n", text);
+
+    // Words 100-103 hold the 48-bit sector count
+    uint64_t sectors = 0;
+    for (int w = 3; w >= 0; w--) sectors = sectors << 16 | (identify[(100 + w) * 2] | identify[(100 + w) * 2 + 1] << 8);
+    if (sectors) append_format(out, "User Capacity: %llu bytes\n", (unsigned long long)sectors * 512);
+
+    append_string(out, "\n=== START OF SMART DATA SECTION ===\n");
+    append_format(out, "SMART overall-health self-assessment test result: %s\n",
+                  health > 0 ? "PASSED" : health == 0 ? "FAILED!" : "UNKNOWN");
+
+    // Prefer attribute 194 for the temperature line, falling back to 190
+    uint8_t temperature_id = 190;
+    for (int i = 0; i < 30; i++) {
+        if (data[2 + i * 12] == 194) temperature_id = 194;
+    }
+
+    for (int i = 0; i < 30; i++) {
+        const uint8_t *attr = data + 2 + i * 12;
+        if (attr[0] == 0) continue;
+
+        uint64_t raw = 0;
+        for (int b = 5; b >= 0; b--) raw = raw << 8 | attr[5 + b];
+        int threshold = -1;
+        for (int t = 0; thresholds && t < 30; t++) {
+            if (thresholds[2 + t * 12] == attr[0]) threshold = thresholds[3 + t * 12];
+        }
+
+        append_format(out, "%s: id=%u value=%u worst=%u", ata_attribute_name(attr[0]), attr[0], attr[3], attr[4]);
+        if (threshold >= 0) append_format(out, " thresh=%d", threshold);
+        append_format(out, " raw=%llu\n", (unsigned long long)raw);
+
+        // The low byte of the temperature attributes is degrees Celsius
+        if (attr[0] == temperature_id) {
+            append_format(out, "Temperature: %u Celsius\n", attr[5]);
+        }
+    }
+}
+
+/**
+ * Reads SMART from a SATA/PATA disk through SG_IO
+ * Returns -1 with errno set if the device does not speak ATA pass-through
+ */
+int read_ata_smart(int fd, StringBuffer *out) {
+    uint8_t identify[512], data[512], thresholds[512], regs[7];
+
+    if (ata_pass_through(fd, 0xEC, 0, 0, identify, 1, NULL) != 0) return -1;
+    if (ata_pass_through(fd, 0xB0, 0xD0, 0, data, 1, NULL) != 0) return -1;
+    int have_thresholds = ata_pass_through(fd, 0xB0, 0xD1, 0, thresholds, 1, NULL) == 0;
+
+    // SMART RETURN STATUS flips LBA mid/high to F4/2C when a threshold is exceeded
+    int health = -1;
+    if (ata_pass_through(fd, 0xB0, 0xDA, 0, NULL, 0, regs) == 0) {
+        if (regs[3] == 0x4F && regs[4] == 0xC2) health = 1;
+        else if (regs[3] == 0xF4 && regs[4] == 0x2C) health = 0;
+    }
+
+    format_ata_smart(identify, data, have_thresholds ? thresholds : NULL, health, out);
+    return 0;
+}
+
+static int nvme_admin(int fd, uint8_t opcode, uint32_t nsid, uint32_t cdw10, void *buf, uint32_t length) {
+    struct nvme_admin_cmd cmd;
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.opcode = opcode;
+    cmd.nsid = nsid;
+    cmd.addr = (uint64_t)(uintptr_t)buf;
+    cmd.data_len = length;
+    cmd.cdw10 = cdw10;
+    cmd.timeout_ms = SMART_IO_TIMEOUT_MS;
+
+    int rc = ioctl(fd, NVME_IOCTL_ADMIN_CMD, &cmd);
+    if (rc > 0) {
+        // Positive values are NVMe status codes
+        errno = EIO;
+        return -1;
+    }
+    return rc;
+}
+
+static uint64_t le_bytes(const uint8_t *p, int count) {
+    uint64_t value = 0;
+    for (int i = count - 1; i >= 0; i--) value = value << 8 | p[i];
+    return value;
+}
+
+// 128-bit little-endian counters from the health log, as decimal text
+static void nvme_counter(const uint8_t *p, char *out, size_t size) {
+    uint64_t low = le_bytes(p, 8), high = le_bytes(p + 8, 8);
+    if (high == 0) snprintf(out, size, "%llu", (unsigned long long)low);
+    else snprintf(out, size, "%.0Lf", (long double)high * 18446744073709551616.0L + low);
+}
+
+static void nvme_string(const uint8_t *p, int length, char *out) {
+    memcpy(out, p, length);
+    while (length > 0 && (out[length - 1] == ' ' || out[length - 1] == '\0')) length--;
+    out[length] = '\0';
+}
+
+/**
+ * Formats an Identify Controller page (may be NULL) and the SMART / Health Information log page
+ * Labels follow smartctl so the existing storage page parser keeps working
+ */
+void format_nvme_smart(const uint8_t *identify, const uint8_t *log, StringBuffer *out) {
+    char text[48];
+
+    append_string(out, "=== START OF INFORMATION SECTION ===\n");
+    if (identify) {
+        nvme_string(identify + 24, 40, text);
+        append_format(out, "Model Number: %s\n", text);
+        nvme_string(identify + 4, 20, text);
+        append_format(out, "Serial Number: %s\n", text);
+        nvme_string(identify + 64, 8, text);
+        append_format(out, "Firmware Version: %s\n", text);
+    }
+
+    append_string(out, "\n=== START OF SMART DATA SECTION ===\n");
+    append_format(out, "SMART overall-health self-assessment test result: %s\n", log[0] ? "FAILED!" : "PASSED");
+    append_format(out, "Critical Warning: 0x%02x\n", log[0]);
+    append_format(out, "Temperature: %d Celsius\n", (int)le_bytes(log + 1, 2) - 273);
+    append_format(out, "Available Spare: %u%%\n", log[3]);
+    append_format(out, "Available Spare Threshold: %u%%\n", log[4]);
+    append_format(out, "Percentage Used: %u%%\n", log[5]);
+
+    // Data units are thousands of 512-byte blocks
+    static const struct {
+        int offset;
+        const char *label;
+    } counters[] = {
+        {32, "Data Units Read"}, {48, "Data Units Written"}, {64, "Host Read Commands"},
+        {80, "Host Write Commands"}, {96, "Controller Busy Time"}, {112, "Power Cycles"},
+        {128, "Power On Hours"}, {144, "Unsafe Shutdowns"}, {160, "Media and Data Integrity Errors"},
+        {176, "Error Information Log Entries"},
+    };
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++) {
+        nvme_counter(log + counters[i].offset, text, sizeof(text));
+        if (counters[i].offset == 32 || counters[i].offset == 48) {
+            double gb = (double)le_bytes(log + counters[i].offset, 8) * 512000.0 / 1e9;
+            append_format(out, "%s: %s [%.1f GB]\n", counters[i].label, text, gb);
+        } else {
+            append_format(out, "%s: %s\n", counters[i].label, text);
+        }
+    }
+
+    append_format(out, "Warning  Comp. Temperature Time: %u\n", (unsigned)le_bytes(log + 192, 4));
+    append_format(out, "Critical Comp. Temperature Time: %u\n", (unsigned)le_bytes(log + 196, 4));
+    for (int i = 0; i < 8; i++) {
+        int kelvin = le_bytes(log + 200 + i * 2, 2);
+        if (kelvin) append_format(out, "Temperature Sensor %d: %d Celsius\n", i + 1, kelvin - 273);
+    }
+}
+
+/**
+ * Reads the SMART / Health log page (0x02) through the NVMe admin passthrough
+ */
+int read_nvme_smart(int fd, StringBuffer *out) {
+    uint8_t *identify = malloc(4096);
+    uint8_t log[512];
+
+    // Get Log Page: NUMDL is a zero-based dword count
+    uint32_t cdw10 = 0x02 | ((sizeof(log) / 4 - 1) << 16);
+    if (nvme_admin(fd, 0x02, 0xFFFFFFFF, cdw10, log, sizeof(log)) != 0) {
+        free(identify);
+        return -1;
+    }
+    // Identify Controller (CNS 1) only adds the model strings, so a failure is not fatal
+    int have_identify = identify && nvme_admin(fd, 0x06, 0, 1, identify, 4096) == 0;
+
+    format_nvme_smart(have_identify ? identify : NULL, log, out);
+    free(identify);
+    return 0;
+}
+
+/**
+ * Asks an ATA drive for its power mode without waking it (CHECK POWER MODE, as hdparm -C does)
+ * Returns 1 in standby, 0 when spinning or idle, -1 if the drive cannot tell
+ */
+int ata_in_standby(int fd) {
+    uint8_t regs[7];
+    if (ata_pass_through(fd, 0xE5, 0, 0, NULL, 0, regs) != 0) return -1;
+    // Count register: 0x00 Standby_z, 0x01 Standby_y, 0x80-0x83 idle, 0xFF active or idle
+    return regs[1] == 0x00 || regs[1] == 0x01;
+}
+
+#define SMART_DEFAULT_TTL 600
+
+// Directory holding the SMART caches, with a trailing slash
+static int smart_cache_directory(char *directory, size_t size) {
+    return build_user_path("XDG_CACHE_HOME", ".cache", "", directory, size);
+}
+
+// An empty directory means the cache location could not be worked out
+static int smart_cache_path(const char *directory, const char *key, char *path, size_t size) {
+    if (!directory[0]) return -1;
+    int written = snprintf(path, size, "%ssmart-%s.cache", directory, key);
+    return written < 0 || (size_t)written >= size ? -1 : 0;
+}
+
+/**
+ * Summary kept in the first line of a SMART cache file so health can be read without the report
+ */
+typedef struct {
+    time_t time;
+    char health[16];
+    int temperature;
+} SmartCacheHeader;
+
+static int read_smart_cache_header(FILE *fp, SmartCacheHeader *header) {
+    long long time;
+    if (fscanf(fp, "SMART1 %lld %15s %d\n", &time, header->health, &header->temperature) != 3) return -1;
+    header->time = (time_t)time;
+    return 0;
+}
+
+/**
+ * Loads the cached report of the drive with the given key into out
+ * Returns 0 and fills header if a cache exists
+ */
+int load_smart_cache(const char *directory, const char *key, SmartCacheHeader *header, StringBuffer *out) {
+    char path[512], chunk[4096];
+    size_t n;
+    if (smart_cache_path(directory, key, path, sizeof(path)) != 0) return -1;
+
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    if (read_smart_cache_header(fp, header) != 0) {
+        fclose(fp);
+        return -1;
+    }
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) append_string_buffer(out, chunk, n);
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * Stores a fresh report, with the health verdict and temperature pulled out for the summary
+ */
+void save_smart_cache(const char *directory, const char *key, const StringBuffer *report, time_t now) {
+    char path[512], temp[520], health[16] = "UNKNOWN";
+    int temperature = -1;
+    const char *p;
+
+    if (!report->data || smart_cache_path(directory, key, path, sizeof(path)) != 0 || ensure_parent_directory(path) != 0) return;
+    if ((p = strstr(report->data, "test result: ")) != NULL) sscanf(p + 13, "%15s", health);
+    if ((p = strstr(report->data, "\nTemperature: ")) != NULL) sscanf(p + 14, "%d", &temperature);
+
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid());
+    FILE *fp = fopen(temp, "w");
+    if (!fp) return;
+    fprintf(fp, "SMART1 %lld %s %d\n", (long long)now, health, temperature);
+    fwrite(report->data, 1, report->length, fp);
+    if (fclose(fp) != 0 || rename(temp, path) != 0) unlink(temp);
+}
+
+/**
+ * One drive's SMART report and where it came from
+ */
+typedef struct {
+    char device[64];
+    char key[96];           // Identity the cache is filed under
+    long ttl;               // Seconds a cached report is served without touching the drive
+    const char *smartctl;   // Resolved before the threads start; NULL when not installed
+    const char *cache_directory;
+    StringBuffer report;
+    long age;               // Age of the report when it came from the cache, else -1
+    int standby;
+    int error;              // errno of the failed query, reported by the main thread
+    pthread_t thread;
+    int started;
+} SmartJob;
+
+static int query_smart_device(SmartJob *job, int fd) {
+    if (strstr(job->device, "/nvme")) return read_nvme_smart(fd, &job->report);
+
+    // A spun-down disk is left asleep and answered from the cache
+    if (ata_in_standby(fd) == 1) {
+        job->standby = 1;
+        errno = EAGAIN;
+        return -1;
+    }
+    return read_ata_smart(fd, &job->report);
+}
+
+/**
+ * One drive's SMART query, run on its own thread
+ */
+static void *run_smart_job(void *arg) {
+    SmartJob *job = arg;
+    SmartCacheHeader cached;
+    StringBuffer cached_report = {0};
+    time_t now = time(NULL);
+    int have_cache = load_smart_cache(job->cache_directory, job->key, &cached, &cached_report) == 0;
+
+    job->age = -1;
+    if (have_cache && now - cached.time >= 0 && now - cached.time < job->ttl) {
+        job->report = cached_report;
+        job->age = now - cached.time;
+        return NULL;
+    }
+
+    int fd = open(job->device, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    int rc = fd >= 0 ? query_smart_device(job, fd) : -1;
+    int error = errno;
+    if (fd >= 0) close(fd);
+
+    if (rc == 0) {
+        save_smart_cache(job->cache_directory, job->key, &job->report, now);
+        free_string_buffer(&cached_report);
+        return NULL;
+    }
+    if (have_cache) {
+        // Stale but better than nothing, and the caller is told how old it is
+        job->report = cached_report;
+        job->age = now - cached.time;
+        return NULL;
+    }
+    free_string_buffer(&cached_report);
+
+    if (job->standby) {
+        append_string(&job->report, "SMART data unavailable: drive is in standby and has no cached report\n");
+        return NULL;
+    }
+
+    // Devices that speak neither protocol natively (USB bridges, SAS, virtio) fall back to smartctl,
+    // which is no better off than the ioctls when the device could not be opened
+    if (job->smartctl && fd >= 0 && error != EACCES && error != EPERM) {
+        const char *argv[] = {job->smartctl, "-a", job->device, NULL};
+        job->report.length = 0;
+        if (job->report.data) job->report.data[0] = '\0';
+        int status = run_command(argv, 30000, SPAWN_STDERR_DISCARD, &job->report);
+        // smartctl's exit status is a bit mask: bits 0-2 mean no data was read, the higher bits
+        // only report what the drive said about itself. Output of a failed run is shown, not cached
+        if (status >= 0 && (status & 0x07) == 0) {
+            save_smart_cache(job->cache_directory, job->key, &job->report, now);
+            return NULL;
+        }
+        if (job->report.length) return NULL;
+    }
+    job->error = error ? error : EIO;
+    return NULL;
+}
+
+/**
+ * Queries every drive's SMART data natively, one thread per drive, and prints the reports in device order
+ * Reports younger than ttl seconds, and those of drives in standby, come from the cache filed under the drive's identity
+ */
+void print_smart_data(long ttl) {
+    static SmartDevice devices[SMART_MAX_DEVICES];
+    int count = list_smart_devices(devices, SMART_MAX_DEVICES);
+    SmartJob *jobs = calloc(count ? count : 1, sizeof(SmartJob));
+    if (!jobs) return;
+
+    // The PATH lookup keeps a static cache and getpwuid a static result, so both are done here
+    // rather than in the threads
+    const char *smartctl = find_smartctl_path();
+    char cache_directory[512];
+    if (smart_cache_directory(cache_directory, sizeof(cache_directory)) != 0) cache_directory[0] = '\0';
+    for (int i = 0; i < count; i++) {
+        memcpy(jobs[i].device, devices[i].path, sizeof(jobs[i].device));
+        memcpy(jobs[i].key, devices[i].key, sizeof(jobs[i].key));
+        jobs[i].ttl = ttl;
+        jobs[i].smartctl = smartctl;
+        jobs[i].cache_directory = cache_directory;
+        jobs[i].started = pthread_create(&jobs[i].thread, NULL, run_smart_job, &jobs[i]) == 0;
+        if (!jobs[i].started) run_smart_job(&jobs[i]);
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (jobs[i].started) pthread_join(jobs[i].thread, NULL);
+        printf("\n === S.M.A.R.T. Data for %s ===\n", jobs[i].device);
+        if (jobs[i].standby) printf("Power Mode: STANDBY\n");
+        if (jobs[i].age >= 0) printf("Cache Age: %ld s\n", jobs[i].age);
+        if (jobs[i].report.length) fwrite(jobs[i].report.data, 1, jobs[i].report.length, stdout);
+        if (jobs[i].error) printf("SMART data unavailable: %s\n", strerror(jobs[i].error));
+        free_string_buffer(&jobs[i].report);
+    }
+    free(jobs);
+}
+
+/**
+ * Prints one health line per drive straight from the SMART cache, never touching the drives
+ */
+void print_smart_health_summary() {
+    static SmartDevice devices[SMART_MAX_DEVICES];
+    int count = list_smart_devices(devices, SMART_MAX_DEVICES);
+    time_t now = time(NULL);
+    char cache_directory[512];
+    int have_directory = smart_cache_directory(cache_directory, sizeof(cache_directory)) == 0;
+
+    for (int i = 0; i < count; i++) {
+        char path[512];
+        SmartCacheHeader header;
+        FILE *fp = have_directory && smart_cache_path(cache_directory, devices[i].key, path, sizeof(path)) == 0 ? fopen(path, "r") : NULL;
+
+        if (fp && read_smart_cache_header(fp, &header) == 0) {
+            printf("device=%s health=%s temperature=%d age=%ld\n",
+                   devices[i].path, header.health, header.temperature, (long)(now - header.time));
+        } else {
+            printf("device=%s health=UNKNOWN temperature=-1 age=-1\n", devices[i].path);
+        }
+        if (fp) fclose(fp);
+    }
+}
+
+void print_uname_info() {
+    struct utsname info;
+    if (uname(&info) == 0) {
+        printf("\n=== System Information (uname) ===\n");
+        printf("OS: %s\n", info.sysname);
+        printf("Hostname: %s\n", info.nodename);
+        printf("Kernel Release: %s\n", info.release);
+        printf("Kernel Version: %s\n", info.version);
+        printf("Architecture: %s\n", info.machine);
+    } else {
+        perror("uname failed");
+    }
+}
+
+void print_detailed_os_info(FILE *out) {
+    fprintf(out, "\n=== Detailed OS Information ===\n");
+    
+    const char *release_files[] = {
+        "/etc/os-release",
+        "/usr/lib/os-release",
+        "/etc/lsb-release",
+        "/etc/debian_version",
+        "/etc/redhat-release",
+        "/etc/centos-release",
+        "/etc/fedora-release",
+        "/etc/SuSE-release",
+        "/etc/arch-release",
+        NULL
+    };
+    
+    for (int i = 0; release_files[i] != NULL; i++) {
+        FILE *fp = fopen(release_files[i], "r");
+        if (fp) {
+            fprintf(out, "--- %s ---\n", release_files[i]);
+            char line[256];
+            while (fgets(line, sizeof(line), fp)) {
+                fprintf(out, "%s", line);
+            }
+            fclose(fp);
+            fprintf(out, "\n");
+        }
+    }
+}
+
+void print_kernel_details(FILE *out) {
+    fprintf(out, "\n=== Kernel Details ===\n");
+    
+    FILE *fp = fopen("/proc/version", "r");
+    if (fp) {
+        char version[256];
+        if (fgets(version, sizeof(version), fp)) {
+            fprintf(out, "Full Kernel Version: %s", version);
+        }
+        fclose(fp);
+    }
+    
+    fp = fopen("/proc/version_signature", "r");
+    if (fp) {
+        char sig[256];
+        if (fgets(sig, sizeof(sig), fp)) {
+            fprintf(out, "Kernel Signature: %s", sig);
+        }
+        fclose(fp);
+    }
+    
+    fp = fopen("/proc/cmdline", "r");
+    if (fp) {
+        char cmdline[1024];
+        if (fgets(cmdline, sizeof(cmdline), fp)) {
+            fprintf(out, "Kernel Command Line: %s\n", cmdline);
+        }
+        fclose(fp);
+    }
+    
+    fprintf(out, "Kernel Architecture: ");
+    #if defined(__x86_64__)
+    fprintf(out, "x86_64\n");
+    #elif defined(__i386__)
+    fprintf(out, "i386\n");
+    #elif defined(__aarch64__)
+    fprintf(out, "ARM64\n");
+    #elif defined(__arm__)
+    fprintf(out, "ARM\n");
+    #elif defined(__powerpc64__)
+    fprintf(out, "PPC64\n");
+    #elif defined(__mips__)
+    fprintf(out, "MIPS\n");
+    #else
+    fprintf(out, "Unknown\n");
+    #endif
+}
+
+void print_distribution_info(FILE *out) {
+    const char *package_managers[] = {
+        "/etc/apt/sources.list",
+        "/etc/yum.repos.d/",
+        "/etc/dnf/dnf.conf",
+        "/etc/zypp/zypp.conf",
+        "/etc/pacman.conf",
+        "/etc/portage/make.conf",
+        "/etc/emerge/",
+        NULL
+    };
+    
+    const char *pm_names[] = {
+        "APT (Debian/Ubuntu)",
+        "YUM (RedHat/CentOS)",
+        "DNF (Fedora/RHEL8+)",
+        "Zypper (openSUSE)",
+        "Pacman (Arch)",
+        "Portage (Gentoo)",
+        "Emerge (Gentoo)"
+    };
+    
+    // Package Manager
+    for (int i = 0; package_managers[i] != NULL; i++) {
+        FILE *fp = fopen(package_managers[i], "r");
+        if (fp) {
+            fprintf(out, "%s\n", pm_names[i]);
+            fclose(fp);
+            break;
+        }
+        if (strstr(package_managers[i], "/etc/yum.repos.d/") || 
+            strstr(package_managers[i], "/etc/emerge/")) {
+            DIR *dir = opendir(package_managers[i]);
+            if (dir) {
+                fprintf(out, "%s\n", pm_names[i]);
+                closedir(dir);
+                break;
+            }
+        }
+    }
+    
+    // Init System
+    FILE *fp = fopen("/proc/1/comm", "r");
+    if (fp) {
+        char init_system[32];
+        if (fgets(init_system, sizeof(init_system), fp)) {
+            init_system[strcspn(init_system, "\n")] = 0;
+            fprintf(out, "%s\n", init_system);
+        }
+        fclose(fp);
+    } else {
+        static const char *const ps_argv[] = {"ps", "-p", "1", "-o", "comm=", NULL};
+        StringBuffer init_system = {0};
+        if (run_command(ps_argv, SPAWN_DEFAULT_TIMEOUT_MS, SPAWN_STDERR_DISCARD, &init_system) != -1 && init_system.length) {
+            keep_first_lines(&init_system, 1);
+            fprintf(out, "%s", init_system.data);
+            if (init_system.data[init_system.length - 1] != '\n') fprintf(out, "\n");
+            free_string_buffer(&init_system);
+        } else {
+            free_string_buffer(&init_system);
+            char init_path[256];
+            ssize_t len = readlink("/sbin/init", init_path, sizeof(init_path)-1);
+            if (len != -1) {
+                init_path[len] = '\0';
+                char *basename = strrchr(init_path, '/');
+                fprintf(out, "%s\n", basename ? basename + 1 : init_path);
+            } else {
+                fprintf(out, "Unknown\n");
+            }
+        }
+    }
+
+    // Distribution version
+    const char *version_files[] = {
+        "/etc/debian_version",
+        "/etc/redhat-release",
+        "/etc/centos-release", 
+        "/etc/fedora-release",
+        "/etc/SuSE-release",
+        "/etc/arch-release",
+        "/etc/slackware-version",
+        "/etc/gentoo-release",
+        NULL
+    };
+    
+    for (int i = 0; version_files[i] != NULL; i++) {
+        fp = fopen(version_files[i], "r");
+        if (fp) {
+            char version[128];
+            if (fgets(version, sizeof(version), fp)) {
+                version[strcspn(version, "\n")] = 0;
+                fprintf(out, "%s\n", version);
+            }
+            fclose(fp);
+            break;
+        }
+    }
+    
+    // Systemd version
+    fp = fopen("/proc/1/comm", "r");
+    if (fp) {
+        char init_system[32];
+        if (fgets(init_system, sizeof(init_system), fp)) {
+            init_system[strcspn(init_system, "\n")] = 0;
+            if (strcmp(init_system, "systemd") == 0) {
+                // First line is "systemd <version> (<full version>)"
+                static const char *const version_argv[] = {"systemctl", "--version", NULL};
+                StringBuffer output = {0};
+                char systemd_version[64];
+                if (run_command(version_argv, SPAWN_DEFAULT_TIMEOUT_MS, SPAWN_STDERR_DISCARD, &output) != -1 &&
+                    output.data && sscanf(output.data, "%*s %63s", systemd_version) == 1) {
+                    fprintf(out, "%s\n", systemd_version);
+                }
+                free_string_buffer(&output);
+            }
+        }
+        fclose(fp);
+    }
+}
+
+void print_library_versions(FILE *out) {
+    fprintf(out, "\n=== Library Versions ===\n");
+    
+    fprintf(out, "GLIBC Version: %s\n", gnu_get_libc_version());
+    fprintf(out, "GLIBC Release: %s\n", gnu_get_libc_release());
+    
+    #ifdef __GLIBC__
+    fprintf(out, "Using GLIBC: %d.%d\n", __GLIBC__, __GLIBC_MINOR__);
+    #endif
+    
+    #ifdef __GNUC__
+    fprintf(out, "GCC Version: %d.%d.%d\n", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
+    #endif
+    
+    #ifdef __STDC_VERSION__
+    fprintf(out, "C Standard: %ld\n", __STDC_VERSION__);
+    #endif
+}
+
+void print_security_info() {
+    printf("\n=== Security & Update Information ===\n");
+    
+    FILE *fp = fopen("/etc/apt/sources.list", "r");
+    if (fp) {
+        char line[256];
+        int security_updates = 0;
+        while (fgets(line, sizeof(line), fp)) {
+            if (strstr(line, "security") || strstr(line, "updates")) {
+                security_updates = 1;
+                break;
+            }
+        }
+        fclose(fp);
+        printf("Security updates configured: %s\n", security_updates ? "Yes" : "No");
+    }
+    
+    fp = fopen("/var/lib/apt/periodic/update-success-stamp", "r");
+    if (fp) {
+        char timestamp[64];
+        if (fgets(timestamp, sizeof(timestamp), fp)) {
+            printf("Last successful update: %s", timestamp);
+        }
+        fclose(fp);
+    }
+    
+    fp = fopen("/sys/kernel/security/lsm", "r");
+    if (fp) {
+        char lsm[256];
+        if (fgets(lsm, sizeof(lsm), fp)) {
+            printf("Security Modules: %s", lsm);
+        }
+        fclose(fp);
+    }
+    printf("\n");
+}
+
+void print_system_limits() {
+    printf("=== System Limits ===\n");
+    
+    FILE *fp = fopen("/proc/sys/kernel/pid_max", "r");
+    if (fp) {
+        char pid_max[32];
+        if (fgets(pid_max, sizeof(pid_max), fp)) {
+            printf("Maximum PID: %s", pid_max);
+        }
+        fclose(fp);
+    }
+    
+    fp = fopen("/proc/sys/kernel/threads-max", "r");
+    if (fp) {
+        char threads_max[32];
+        if (fgets(threads_max, sizeof(threads_max), fp)) {
+            printf("Maximum threads: %s", threads_max);
+        }
+        fclose(fp);
+    }
+    
+    fp = fopen("/proc/sys/kernel/pty/max", "r");
+    if (fp) {
+        char pty_max[32];
+        if (fgets(pty_max, sizeof(pty_max), fp)) {
+            printf("Maximum PTYs: %s", pty_max);
+        }
+        fclose(fp);
+    }
+}
+
+// Note: To run this function, run the program without root privileges
+void check_startup_directories() {
+    printf("\n=== STARTUP APPLICATIONS ===\n");
+    
+    const char *dirs[] = {
+        "~/.config/autostart",
+        "~/.config/autostart-scripts",
+        "/etc/xdg/autostart",
+        "~/.kde/Autostart",
+        "~/.local/share/autostart",
+        NULL
+    };
+    
+    char expanded_path[512];
+    char *home = getenv("HOME");
+
+    for (int i = 0; dirs[i] != NULL; i++) {
+        // Expand ~ to home directory
+        if (dirs[i][0] == '~' && home != NULL) {
+            snprintf(expanded_path, sizeof(expanded_path), "%s%s", home, dirs[i] + 1);
+        } else {
+            strncpy(expanded_path, dirs[i], sizeof(expanded_path));
+            expanded_path[sizeof(expanded_path)-1] = '\0';
+        }
+
+        printf("\nChecking: %s\n", expanded_path);
+
+        DIR *dir = opendir(expanded_path);
+        if (!dir) {
+            printf("  Directory not found or inaccessible\n");
+            continue;
+        }
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            // Include regular files and symlinks (for .desktop files)
+            if (entry->d_type == DT_REG || entry->d_type == DT_LNK) {
+                const char *ext = strrchr(entry->d_name, '.');
+                if (ext && strcmp(ext, ".desktop") == 0) {
+                    printf("  %s\n", entry->d_name);
+                }
+            }
+        }
+        closedir(dir);
+    }
+}
+
+// Note: To run this function, run the program without root privileges
+void check_systemd_user_services() {
+    printf("\n=== SYSTEMD USER SERVICES (STARTUP) ===\n");
+
+    static const char *const argv[] = {
+        "systemctl", "--user", "list-unit-files", "--type=service", "--state=enabled", NULL
+    };
+    StringBuffer output = {0};
+    run_command(argv, SPAWN_DEFAULT_TIMEOUT_MS, SPAWN_STDERR_INHERIT, &output);
+
+    // Only the unit lines, at most ten of them
+    int shown = 0;
+    for (char *line = output.data; line && *line && shown < 10; ) {
+        char *end = strchr(line, '\n');
+        if (end) *end = '\0';
+        if (strstr(line, "enabled") || strstr(line, "autostart")) {
+            printf("%s\n", line);
+            shown++;
+        }
+        if (!end) break;
+        line = end + 1;
+    }
+    free_string_buffer(&output);
+}
+
+// Opens library and fills each slot from the table; returns 1 when all symbols resolve, -1 otherwise
+static int load_library_symbols(const char *library_name, const char *const *names, void ***slots, int count) {
+    void *library = dlopen(library_name, RTLD_NOW | RTLD_LOCAL);
+    if (!library) return -1;
+    for (int i = 0; i < count; i++) {
+        *slots[i] = dlsym(library, names[i]);
+        if (!*slots[i]) {
+            dlclose(library);
+            return -1;
+        }
+    }
+    return 1;
+}
+
+#define DPKG_STATUS_PATH "/var/lib/dpkg/status"
+#define PACMAN_LOCAL_PATH "/var/lib/pacman/local"
+#define RPMDB_SQLITE_PATH "/var/lib/rpm/rpmdb.sqlite"
+
+// One installed package as recorded by its package manager's database
+typedef struct {
+    const char *name;
+    const char *version;
+    const char *arch;
+    uint64_t size_bytes;        // Installed size, 0 when the database does not record it
+} PackageRecord;
+
+typedef void (*PackageFn)(const PackageRecord *package, void *context);
+
+// Copies a field value of at most size - 1 bytes; values in the databases are not NUL-terminated
+static void copy_package_field(const char *value, size_t length, char *out, size_t size) {
+    if (length >= size) length = size - 1;
+    memcpy(out, value, length);
+    out[length] = '\0';
+}
+
+/**
+ * Reads the installed packages from dpkg's status file, mapped rather than read
+ * Stanzas are separated by blank lines; only "install ok installed" packages are reported
+ * Returns the number of packages, or -1 if the database cannot be read
+ */
+int read_dpkg_packages(PackageFn fn, void *context) {
+    int fd = open(DPKG_STATUS_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return st.st_size == 0 ? 0 : -1;
+    }
+    const char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return -1;
+    madvise((void *)data, st.st_size, MADV_SEQUENTIAL);
+
+    const char *end = data + st.st_size;
+    char name[256] = "", version[256] = "", arch[64] = "";
+    uint64_t size = 0;
+    int installed = 0, count = 0;
+
+    for (const char *line = data; line <= end; ) {
+        const char *line_end = memchr(line, '\n', end - line);
+        if (!line_end) line_end = end;
+
+        if (line_end == line) {
+            // A blank line, or the end of the file, completes the stanza
+            if (installed && name[0]) {
+                PackageRecord package = {name, version, arch, size};
+                fn(&package, context);
+                count++;
+            }
+            name[0] = version[0] = arch[0] = '\0';
+            size = 0;
+            installed = 0;
+        } else if (line[0] != ' ' && line[0] != '\t') {
+            // Continuation lines of multi-line fields (descriptions, conffiles) start with a space
+            const char *colon = memchr(line, ':', line_end - line);
+            if (colon) {
+                size_t key = colon - line;
+                const char *value = colon + 1;
+                while (value < line_end && *value == ' ') value++;
+                size_t length = line_end - value;
+                if (key == 7 && memcmp(line, "Package", 7) == 0) copy_package_field(value, length, name, sizeof(name));
+                else if (key == 7 && memcmp(line, "Version", 7) == 0) copy_package_field(value, length, version, sizeof(version));
+                else if (key == 12 && memcmp(line, "Architecture", 12) == 0) copy_package_field(value, length, arch, sizeof(arch));
+                else if (key == 14 && memcmp(line, "Installed-Size", 14) == 0) size = strtoull(value, NULL, 10) * 1024;
+                else if (key == 6 && memcmp(line, "Status", 6) == 0) {
+                    // "want flag status", e.g. "install ok installed" or "deinstall ok config-files"
+                    installed = length >= 10 && memcmp(line_end - 10, " installed", 10) == 0;
+                }
+            }
+        }
+        // Past the last line, one more empty "line" at end flushes the final stanza
+        if (line_end == end && line == end) break;
+        line = line_end == end ? end : line_end + 1;
+    }
+
+    munmap((void *)data, st.st_size);
+    return count;
+}
+
+/**
+ * Reads the installed packages from pacman's local database, one desc file per package
+ * desc holds "%FIELD%" headers each followed by value lines and a blank line
+ * Returns the number of packages, or -1 if the database cannot be read
+ */
+int read_pacman_packages(PackageFn fn, void *context) {
+    DIR *dir = opendir(PACMAN_LOCAL_PATH);
+    if (!dir) return -1;
+
+    struct dirent *entry;
+    char path[512], data[16384];
+    int count = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s/desc", PACMAN_LOCAL_PATH, entry->d_name);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        // The fields needed come first; descriptions longer than the buffer are cut harmlessly
+        ssize_t n = read(fd, data, sizeof(data) - 1);
+        close(fd);
+        if (n <= 0) continue;
+        data[n] = '\0';
+
+        char name[256] = "", version[256] = "", arch[64] = "";
+        uint64_t size = 0;
+        for (char *line = data, *next; line && *line; line = next) {
+            next = strchr(line, '\n');
+            if (next) *next++ = '\0';
+            if (line[0] != '%' || !next) continue;
+            char *value = next;
+            size_t length = strcspn(value, "\n");
+            if (strcmp(line, "%NAME%") == 0) copy_package_field(value, length, name, sizeof(name));
+            else if (strcmp(line, "%VERSION%") == 0) copy_package_field(value, length, version, sizeof(version));
+            else if (strcmp(line, "%ARCH%") == 0) copy_package_field(value, length, arch, sizeof(arch));
+            else if (strcmp(line, "%SIZE%") == 0) size = strtoull(value, NULL, 10);
+        }
+        if (!name[0]) continue;
+        PackageRecord package = {name, version, arch, size};
+        fn(&package, context);
+        count++;
+    }
+    closedir(dir);
+    return count;
+}
+
+// The sqlite3 calls used to read the rpm database, resolved from libsqlite3 on first use
+static struct {
+    int loaded;
+    int (*open)(const char *path, void **db, int flags, const char *vfs);
+    int (*prepare)(void *db, const char *sql, int length, void **statement, const char **tail);
+    int (*step)(void *statement);
+    const void *(*column_blob)(void *statement, int column);
+    int (*column_bytes)(void *statement, int column);
+    int (*finalize)(void *statement);
+    int (*close)(void *db);
+} sqlite_api;
+
+static int load_sqlite() {
+    if (!sqlite_api.loaded) {
+        const char *names[] = {"sqlite3_open_v2", "sqlite3_prepare_v2", "sqlite3_step", "sqlite3_column_blob",
+                               "sqlite3_column_bytes", "sqlite3_finalize", "sqlite3_close"};
+        void **slots[] = {(void **)&sqlite_api.open, (void **)&sqlite_api.prepare, (void **)&sqlite_api.step,
+                          (void **)&sqlite_api.column_blob, (void **)&sqlite_api.column_bytes,
+                          (void **)&sqlite_api.finalize, (void **)&sqlite_api.close};
+        sqlite_api.loaded = load_library_symbols("libsqlite3.so.0", names, slots, 7);
+    }
+    return sqlite_api.loaded > 0 ? 0 : -1;
+}
+
+static uint32_t read_be32(const uint8_t *bytes) {
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+}
+
+/**
+ * Decodes one rpm header blob: a big-endian index count and data size, then 16-byte
+ * index entries (tag, type, offset, count) pointing into the data area
+ * Returns 0 when the blob names a package, -1 otherwise
+ */
+static int parse_rpm_header(const uint8_t *blob, size_t size, char *name, char *version, char *arch, uint64_t *bytes) {
+    enum { RPM_INT32 = 4, RPM_INT64 = 5, RPM_STRING = 6 };
+    enum { TAG_NAME = 1000, TAG_VERSION = 1001, TAG_RELEASE = 1002, TAG_EPOCH = 1003, TAG_SIZE = 1009,
+           TAG_ARCH = 1022, TAG_LONGSIZE = 5009 };
+    if (size < 8) return -1;
+    uint32_t entries = read_be32(blob), data_size = read_be32(blob + 4);
+    if (entries > 65536 || 8 + (size_t)entries * 16 + data_size > size) return -1;
+    const uint8_t *data = blob + 8 + entries * 16;
+
+    const char *release = "";
+    char plain_version[128] = "";
+    long epoch = -1;
+    name[0] = arch[0] = '\0';
+    *bytes = 0;
+    for (uint32_t i = 0; i < entries; i++) {
+        const uint8_t *index = blob + 8 + i * 16;
+        uint32_t tag = read_be32(index), type = read_be32(index + 4), offset = read_be32(index + 8);
+        if (offset >= data_size) continue;
+        const char *text = (const char *)data + offset;
+        // Strings must end inside the data area
+        if (type == RPM_STRING && !memchr(text, '\0', data_size - offset)) continue;
+
+        if (tag == TAG_NAME && type == RPM_STRING) snprintf(name, 256, "%s", text);
+        else if (tag == TAG_VERSION && type == RPM_STRING) snprintf(plain_version, sizeof(plain_version), "%s", text);
+        else if (tag == TAG_RELEASE && type == RPM_STRING) release = text;
+        else if (tag == TAG_ARCH && type == RPM_STRING) snprintf(arch, 64, "%s", text);
+        else if (tag == TAG_EPOCH && type == RPM_INT32 && offset + 4 <= data_size) epoch = read_be32(data + offset);
+        else if (tag == TAG_SIZE && type == RPM_INT32 && offset + 4 <= data_size && !*bytes) *bytes = read_be32(data + offset);
+        else if (tag == TAG_LONGSIZE && type == RPM_INT64 && offset + 8 <= data_size) {
+            *bytes = (uint64_t)read_be32(data + offset) << 32 | read_be32(data + offset + 4);
+        }
+    }
+    if (!name[0]) return -1;
+    if (epoch >= 0) snprintf(version, 256, "%ld:%s-%s", epoch, plain_version, release);
+    else snprintf(version, 256, "%s-%s", plain_version, release);
+    return 0;
+}
+
+/**
+ * Reads the installed packages from the sqlite rpm database (rpm 4.16 and later)
+ * Older Berkeley DB and ndb databases are not read, and the caller falls back to the command
+ * Returns the number of packages, or -1 if the database cannot be read
+ */
+int read_rpm_packages(PackageFn fn, void *context) {
+    void *db = NULL, *statement = NULL;
+    if (access(RPMDB_SQLITE_PATH, R_OK) != 0 || load_sqlite() != 0) return -1;
+    if (sqlite_api.open(RPMDB_SQLITE_PATH, &db, 1, NULL) != 0) {  // SQLITE_OPEN_READONLY
+        if (db) sqlite_api.close(db);
+        return -1;
+    }
+    if (sqlite_api.prepare(db, "SELECT blob FROM Packages", -1, &statement, NULL) != 0) {
+        sqlite_api.close(db);
+        return -1;
+    }
+
+    char name[256], version[256], arch[64];
+    uint64_t size;
+    int count = 0;
+    while (sqlite_api.step(statement) == 100) {  // SQLITE_ROW
+        const uint8_t *blob = sqlite_api.column_blob(statement, 0);
+        int length = sqlite_api.column_bytes(statement, 0);
+        if (!blob || parse_rpm_header(blob, length, name, version, arch, &size) != 0) continue;
+        // Imported signing keys are stored as pseudo-packages
+        if (strcmp(name, "gpg-pubkey") == 0) continue;
+        PackageRecord package = {name, version, arch, size};
+        fn(&package, context);
+        count++;
+    }
+    sqlite_api.finalize(statement);
+    sqlite_api.close(db);
+    return count;
+}
+
+#define PACKAGE_CACHE_VERSION 1
+#define PACKAGE_CACHE_SOURCES 2
+
+// Files whose mtime and size change whenever a package database is written
+static const char *const dpkg_stamp_sources[] = {DPKG_STATUS_PATH, NULL};
+static const char *const pacman_stamp_sources[] = {PACMAN_LOCAL_PATH, NULL};
+// sqlite writes land in the write-ahead log until it is checkpointed into the database
+static const char *const rpm_stamp_sources[] = {RPMDB_SQLITE_PATH, RPMDB_SQLITE_PATH "-wal", NULL};
+
+// Modification time and size of one database source, all zero when it does not exist
+typedef struct {
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t size;
+} PackageStamp;
+
+/**
+ * Package cache file: this header, count PackageEntry records sorted by name and
+ * architecture, then string_bytes of NUL-terminated strings the entries point into
+ */
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    uint32_t string_bytes;
+    uint32_t reserved;
+    int64_t built;              // When the database was read
+    PackageStamp stamps[PACKAGE_CACHE_SOURCES];
+} PackageCacheHeader;
+
+typedef struct {
+    uint32_t name;              // Offsets into the string area
+    uint32_t version;
+    uint32_t arch;
+    uint32_t reserved;
+    uint64_t size_bytes;
+} PackageEntry;
+
+typedef struct {
+    PackageEntry *entries;
+    size_t count;
+    size_t capacity;
+    StringBuffer strings;
+    PackageCacheHeader header;
+} PackageSet;
+
+static void free_package_set(PackageSet *set) {
+    free(set->entries);
+    free_string_buffer(&set->strings);
+    memset(set, 0, sizeof(*set));
+}
+
+static void read_package_stamps(const char *const *sources, PackageStamp *stamps) {
+    memset(stamps, 0, PACKAGE_CACHE_SOURCES * sizeof(PackageStamp));
+    for (int i = 0; i < PACKAGE_CACHE_SOURCES && sources[i]; i++) {
+        struct stat st;
+        if (stat(sources[i], &st) != 0) continue;
+        stamps[i].mtime_sec = st.st_mtim.tv_sec;
+        stamps[i].mtime_nsec = st.st_mtim.tv_nsec;
+        stamps[i].size = st.st_size;
+    }
+}
+
+static uint32_t add_package_string(PackageSet *set, const char *text) {
+    uint32_t offset = set->strings.length;
+    append_string_buffer(&set->strings, text, strlen(text) + 1);
+    return offset;
+}
+
+static void collect_package(const PackageRecord *package, void *context) {
+    PackageSet *set = context;
+    if (set->count == set->capacity) {
+        size_t capacity = set->capacity ? set->capacity * 2 : 1024;
+        PackageEntry *grown = realloc(set->entries, capacity * sizeof(PackageEntry));
+        if (!grown) return;
+        set->entries = grown;
+        set->capacity = capacity;
+    }
+    PackageEntry *entry = &set->entries[set->count++];
+    entry->name = add_package_string(set, package->name);
+    entry->version = add_package_string(set, package->version);
+    entry->arch = add_package_string(set, package->arch);
+    entry->reserved = 0;
+    entry->size_bytes = package->size_bytes;
+}
+
+static const char *package_string(const PackageSet *set, uint32_t offset) {
+    return set->strings.data + offset;
+}
+
+// Packages are ordered by name, then architecture (multiarch installs list a name per arch)
+static int compare_package_entries(const PackageSet *left, const PackageEntry *a, const PackageSet *right, const PackageEntry *b) {
+    int order = strcmp(package_string(left, a->name), package_string(right, b->name));
+    return order ? order : strcmp(package_string(left, a->arch), package_string(right, b->arch));
+}
+
+static const PackageSet *sorting_package_set;
+
+static int compare_sorted_packages(const void *a, const void *b) {
+    return compare_package_entries(sorting_package_set, a, sorting_package_set, b);
+}
+
+static int package_cache_path(const char *name, char *path, size_t size) {
+    char file[64];
+    snprintf(file, sizeof(file), "packages-%s.cache", name);
+    return build_user_path("XDG_CACHE_HOME", ".cache", file, path, size);
+}
+
+/**
+ * Loads a package cache file into set after checking its layout
+ * Returns 0 on success, -1 when there is no usable cache
+ */
+static int load_package_cache(const char *name, PackageSet *set) {
+    char path[512];
+    memset(set, 0, sizeof(*set));
+    int fd = package_cache_path(name, path, sizeof(path)) == 0 ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+    if (fd < 0) return -1;
+
+    struct stat st;
+    PackageCacheHeader header;
+    int valid = fstat(fd, &st) == 0 && pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+                memcmp(header.magic, "SMPKG01", 8) == 0 && header.version == PACKAGE_CACHE_VERSION &&
+                (uint64_t)st.st_size == sizeof(header) + (uint64_t)header.count * sizeof(PackageEntry) + header.string_bytes;
+    if (valid) {
+        set->entries = malloc((header.count ? header.count : 1) * sizeof(PackageEntry));
+        set->strings.data = malloc(header.string_bytes + 1);
+        valid = set->entries && set->strings.data &&
+                pread(fd, set->entries, header.count * sizeof(PackageEntry), sizeof(header)) == (ssize_t)(header.count * sizeof(PackageEntry)) &&
+                pread(fd, set->strings.data, header.string_bytes, sizeof(header) + header.count * sizeof(PackageEntry)) == (ssize_t)header.string_bytes;
+    }
+    close(fd);
+    if (valid) {
+        set->count = set->capacity = header.count;
+        set->strings.length = set->strings.capacity = header.string_bytes;
+        set->strings.data[header.string_bytes] = '\0';
+        set->header = header;
+        // Offsets are trusted only if they stay inside the string area
+        for (size_t i = 0; i < set->count && valid; i++) {
+            valid = set->entries[i].name < header.string_bytes && set->entries[i].version < header.string_bytes &&
+                    set->entries[i].arch < header.string_bytes;
+        }
+    }
+    if (!valid) {
+        free_package_set(set);
+        return -1;
+    }
+    return 0;
+}
+
+static void save_package_cache(const char *name, PackageSet *set) {
+    char path[512], temp[520];
+    if (package_cache_path(name, path, sizeof(path)) != 0 || ensure_parent_directory(path) != 0) return;
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid());
+
+    memcpy(set->header.magic, "SMPKG01", 8);
+    set->header.version = PACKAGE_CACHE_VERSION;
+    set->header.count = set->count;
+    set->header.string_bytes = set->strings.length;
+    FILE *fp = fopen(temp, "w");
+    if (!fp) return;
+    fwrite(&set->header, sizeof(set->header), 1, fp);
+    fwrite(set->entries, sizeof(PackageEntry), set->count, fp);
+    if (set->strings.length) fwrite(set->strings.data, 1, set->strings.length, fp);
+    if (fclose(fp) != 0 || rename(temp, path) != 0) unlink(temp);
+}
+
+static void print_package_entry(FILE *out, const char *prefix, const PackageSet *set, const PackageEntry *entry) {
+    const char *version = package_string(set, entry->version), *arch = package_string(set, entry->arch);
+    fprintf(out, "  %sname=%s version=%s arch=%s size=%llu\n", prefix, package_string(set, entry->name),
+            version[0] ? version : "-", arch[0] ? arch : "-", (unsigned long long)entry->size_bytes);
+}
+
+typedef struct {
+    int installed;
+    int removed;
+    int changed;
+} PackageChanges;
+
+/**
+ * Merges two sorted package sets, counting what was installed, removed or changed version
+ * Each change is also printed to out unless it is NULL
+ */
+static void diff_package_sets(const PackageSet *old, const PackageSet *current, FILE *out, PackageChanges *changes) {
+    size_t i = 0, j = 0;
+
+    memset(changes, 0, sizeof(*changes));
+    while (i < old->count || j < current->count) {
+        int order = i == old->count ? 1 : j == current->count ? -1
+                  : compare_package_entries(old, &old->entries[i], current, &current->entries[j]);
+        if (order < 0) {
+            if (out) print_package_entry(out, "removed ", old, &old->entries[i]);
+            i++;
+            changes->removed++;
+        } else if (order > 0) {
+            if (out) print_package_entry(out, "installed ", current, &current->entries[j]);
+            j++;
+            changes->installed++;
+        } else {
+            const PackageEntry *before = &old->entries[i++], *after = &current->entries[j++];
+            if (strcmp(package_string(old, before->version), package_string(current, after->version)) != 0) {
+                if (out) {
+                    fprintf(out, "  changed name=%s version=%s->%s arch=%s size=%llu\n", package_string(current, after->name),
+                            package_string(old, before->version), package_string(current, after->version),
+                            package_string(current, after->arch), (unsigned long long)after->size_bytes);
+                }
+                changes->changed++;
+            }
+        }
+    }
+}
+
+/**
+ * Prints a summary of the changes between two sorted package sets, then the changes themselves
+ */
+static void print_package_changes(FILE *out, const char *manager, const PackageSet *old, const PackageSet *current) {
+    PackageChanges changes;
+    char since[32];
+    struct tm tm;
+    time_t built = old->header.built;
+
+    // The summary comes first, so one pass counts and a second prints
+    diff_package_sets(old, current, NULL, &changes);
+    strftime(since, sizeof(since), "%Y-%m-%d %H:%M:%S", localtime_r(&built, &tm));
+    fprintf(out, "Package changes for %s since %s: %d installed, %d removed, %d changed\n", manager, since,
+            changes.installed, changes.removed, changes.changed);
+    diff_package_sets(old, current, out, &changes);
+}
+
+/**
+ * Lists a manager's packages from its database, or from the package cache when the database's
+ * mtime and size match the ones the cache was built from
+ * A rebuilt cache is compared with the previous one and the difference printed
+ * The cache is named after the manager, so yum, dnf and zypper over one rpm database each see the changes
+ * Returns -1 if the database cannot be read, so the caller can run the manager instead
+ */
+static int report_packages(const char *manager, const char *database, const char *const *stamp_sources,
+                           int (*native)(PackageFn fn, void *context)) {
+    PackageStamp stamps[PACKAGE_CACHE_SOURCES];
+    PackageSet cached, current;
+    int have_cache = load_package_cache(manager, &cached) == 0;
+    read_package_stamps(stamp_sources, stamps);
+
+    int fresh = have_cache && memcmp(cached.header.stamps, stamps, sizeof(stamps)) == 0;
+    if (fresh) {
+        current = cached;
+        have_cache = 0;
+    } else {
+        memset(&current, 0, sizeof(current));
+        if (native(collect_package, &current) < 0) {
+            if (have_cache) free_package_set(&cached);
+            free_package_set(&current);
+            return -1;
+        }
+        sorting_package_set = &current;
+        qsort(current.entries, current.count, sizeof(PackageEntry), compare_sorted_packages);
+        memcpy(current.header.stamps, stamps, sizeof(stamps));
+        current.header.built = time(NULL);
+        save_package_cache(manager, &current);
+    }
+
+    // The manager's version is that of its own package
+    const PackageEntry *self = NULL;
+    for (size_t i = 0; i < current.count && !self; i++) {
+        if (strcmp(package_string(&current, current.entries[i].name), manager) == 0) self = &current.entries[i];
+    }
+    if (self) {
+        printf("\n%s detected: %s %s (%s)\n", manager, manager, package_string(&current, self->version),
+               package_string(&current, self->arch));
+    } else {
+        printf("\n%s detected: %s\n", manager, database);
+    }
+    printf("Installed packages for %s: %zu from %s%s\n", manager, current.count, database, fresh ? " (cached)" : "");
+    for (size_t i = 0; i < current.count; i++) print_package_entry(stdout, "", &current, &current.entries[i]);
+    if (have_cache) {
+        print_package_changes(stdout, manager, &cached, &current);
+        free_package_set(&cached);
+    }
+    free_package_set(&current);
+    return 0;
+}
+
+void detect_all_package_managers() {
+    // Managers with a database read natively only run their commands when that fails
+    const struct {
+        const char *name;
+        const char *const *version_argv;
+        const char *const *list_argv;
+        int (*native)(PackageFn fn, void *context);
+        const char *database;
+        const char *const *stamp_sources;
+    } managers[] = {
+        {"apt", (const char *const[]){"apt", "--version", NULL}, (const char *const[]){"apt", "list", "--installed", NULL},
+         read_dpkg_packages, DPKG_STATUS_PATH, dpkg_stamp_sources},
+        {"yum", (const char *const[]){"yum", "--version", NULL}, (const char *const[]){"yum", "list", "installed", NULL},
+         read_rpm_packages, RPMDB_SQLITE_PATH, rpm_stamp_sources},
+        {"dnf", (const char *const[]){"dnf", "--version", NULL}, (const char *const[]){"dnf", "list", "installed", NULL},
+         read_rpm_packages, RPMDB_SQLITE_PATH, rpm_stamp_sources},
+        {"pacman", (const char *const[]){"pacman", "--version", NULL}, (const char *const[]){"pacman", "-Q", NULL},
+         read_pacman_packages, PACMAN_LOCAL_PATH, pacman_stamp_sources},
+        {"zypper", (const char *const[]){"zypper", "--version", NULL}, (const char *const[]){"zypper", "se", "-i", NULL},
+         read_rpm_packages, RPMDB_SQLITE_PATH, rpm_stamp_sources},
+        {"brew", (const char *const[]){"brew", "--version", NULL}, (const char *const[]){"brew", "list", NULL},
+         NULL, NULL, NULL},
+        {"choco", (const char *const[]){"choco", "--version", NULL}, (const char *const[]){"choco", "list", "-l", NULL},
+         NULL, NULL, NULL},
+        {"winget", (const char *const[]){"winget", "--version", NULL}, (const char *const[]){"winget", "list", NULL},
+         NULL, NULL, NULL},
+    };
+
+    int found_any = 0;
+
+    printf("Detecting package managers and listing installed packages:\n");
+
+    for (int i = 0; i < sizeof(managers)/sizeof(managers[0]); i++) {
+        // A PATH lookup replaces trying to run every manager through the shell
+        if (!find_executable(managers[i].name)) continue;
+
+        if (managers[i].native && report_packages(managers[i].name, managers[i].database, managers[i].stamp_sources,
+                                                  managers[i].native) == 0) {
+            found_any = 1;
+            continue;
+        }
+
+        // Check version
+        StringBuffer output = {0};
+        run_command(managers[i].version_argv, SPAWN_DEFAULT_TIMEOUT_MS, SPAWN_STDERR_MERGE, &output);
+        if (output.length == 0) {
+            free_string_buffer(&output);
+            continue;
+        }
+        keep_first_lines(&output, 1);
+        output.data[strcspn(output.data, "\n")] = 0;
+        printf("\n%s detected: %s\n", managers[i].name, output.data);
+        found_any = 1;
+
+        // List installed packages; large package databases can take a while
+        output.length = 0;
+        output.data[0] = '\0';
+        run_command(managers[i].list_argv, 60000, SPAWN_STDERR_MERGE, &output);
+        printf("Installed packages for %s:\n", managers[i].name);
+        for (char *line = output.data; line && *line; ) {
+            char *end = strchr(line, '\n');
+            if (end) *end = 0;
+            printf("  %s\n", line);
+            if (!end) break;
+            line = end + 1;
+        }
+        free_string_buffer(&output);
+    }
+
+    if (!found_any) {
+        printf("No known package managers detected.\n");
+    }
+}
+
+// Formats a byte count the way df -h does: 1024-based, one decimal below 10
+static void format_human_size(unsigned long long bytes, char *out, size_t size) {
+    const char *units = "BKMGTPE";
+    double value = bytes;
+    int unit = 0;
+    while (value >= 1024 && units[unit + 1]) {
+        value /= 1024;
+        unit++;
+    }
+    if (unit == 0) snprintf(out, size, "%llu", bytes);
+    else snprintf(out, size, value < 10 ? "%.1f%c" : "%.0f%c", value, units[unit]);
+}
+
+/**
+ * Parallel directory walker behind scan_directory and disk_usage
+ * Directories are read with getdents64 and entries classified by d_type, so only entries of
+ * unknown type, followed links and (when sizes are wanted) non-directories are stat'ed, always
+ * relative to the open directory. Subtrees are spread over a work-stealing pool: each worker
+ * walks depth-first from its own deque and idle workers steal the oldest task of another
+ */
+#define WALK_MAX_THREADS 16
+#define WALK_DEFAULT_MAX_DEPTH 64
+#define WALK_DEFAULT_MAX_ENTRIES 2000000
+#define WALK_DENTS_BUFFER (64 * 1024)
+#define WALK_OUTPUT_FLUSH (64 * 1024)
+
+// Record layout returned by the getdents64 system call
+struct walk_dirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+typedef struct {
+    int max_depth;
+    long max_entries;
+    int threads;
+    int list;           // print [DIR] / [FILE] lines
+    int sizes;          // stat non-directories and total usage per directory
+    int follow_links;   // descend into symlinked directories
+    int report_depth;   // directories up to this depth keep their path for the report
+    // Called from the workers for every non-directory entry with its DT_* type, so it must be thread-safe
+    void (*visit)(void *context, int dirfd, const char *name, unsigned char type, const char *path);
+    void *context;
+} WalkOptions;
+
+typedef struct {
+    uint32_t parent;
+    int depth;
+    unsigned long long bytes;
+    unsigned long long files;
+    unsigned long long dirs;
+    char *path;
+} WalkNode;
+
+typedef struct {
+    char *path;
+    uint32_t node;
+    int depth;
+} WalkTask;
+
+// Owner pushes and pops at the tail, thieves take from the head
+typedef struct {
+    pthread_mutex_t lock;
+    WalkTask *tasks;
+    size_t head;
+    size_t tail;
+    size_t capacity;
+} WalkDeque;
+
+typedef struct {
+    dev_t dev;
+    ino_t ino;
+} WalkInode;
+
+// Open-addressing set of (device, inode) pairs; inode 0 marks a free slot
+typedef struct {
+    pthread_mutex_t lock;
+    WalkInode *slots;
+    size_t count;
+    size_t capacity;
+} InodeSet;
+
+typedef struct {
+    WalkOptions options;
+    int threads;
+    WalkDeque deques[WALK_MAX_THREADS];
+    InodeSet visited;       // directories already entered, guards against loops
+    InodeSet linked;        // hard-linked files already counted
+    pthread_mutex_t nodes_lock;
+    WalkNode *nodes;
+    size_t node_count;
+    size_t node_capacity;
+    pthread_mutex_t idle_lock;
+    pthread_cond_t idle_cond;
+    pthread_mutex_t output_lock;
+    long pending;           // tasks queued or being walked
+    int following;          // second pass, walking the targets of symlinked directories
+    pthread_mutex_t links_lock;
+    WalkTask *links;        // symlinked directories seen in the first pass
+    size_t link_count;
+    size_t link_capacity;
+    long entries;
+    long errors;
+    int truncated;
+    int depth_limited;
+} Walker;
+
+typedef struct {
+    Walker *walker;
+    int index;
+    char *dents;
+    StringBuffer output;
+    StringBuffer path;
+} WalkWorker;
+
+static void init_inode_set(InodeSet *set) {
+    pthread_mutex_init(&set->lock, NULL);
+    set->slots = NULL;
+    set->count = set->capacity = 0;
+}
+
+static void free_inode_set(InodeSet *set) {
+    free(set->slots);
+    pthread_mutex_destroy(&set->lock);
+}
+
+static size_t inode_slot(const InodeSet *set, dev_t dev, ino_t ino) {
+    uint64_t hash = ((uint64_t)ino ^ ((uint64_t)dev << 32)) * 0x9E3779B97F4A7C15ULL;
+    size_t slot = (size_t)(hash >> 20) & (set->capacity - 1);
+    while (set->slots[slot].ino && (set->slots[slot].ino != ino || set->slots[slot].dev != dev)) {
+        slot = (slot + 1) & (set->capacity - 1);
+    }
+    return slot;
+}
+
+/**
+ * Adds a (device, inode) pair
+ * Returns 1 when it was new, 0 when already present, -1 when out of memory
+ */
+static int insert_inode(InodeSet *set, dev_t dev, ino_t ino) {
+    int result = 1;
+    pthread_mutex_lock(&set->lock);
+    if ((set->count + 1) * 2 > set->capacity) {
+        size_t capacity = set->capacity ? set->capacity * 2 : 1024;
+        WalkInode *old = set->slots;
+        size_t old_capacity = set->capacity;
+        WalkInode *slots = calloc(capacity, sizeof(WalkInode));
+        if (!slots) {
+            pthread_mutex_unlock(&set->lock);
+            return -1;
+        }
+        set->slots = slots;
+        set->capacity = capacity;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i].ino) set->slots[inode_slot(set, old[i].dev, old[i].ino)] = old[i];
+        }
+        free(old);
+    }
+    size_t slot = inode_slot(set, dev, ino);
+    if (set->slots[slot].ino) {
+        result = 0;
+    } else {
+        set->slots[slot].dev = dev;
+        set->slots[slot].ino = ino;
+        set->count++;
+    }
+    pthread_mutex_unlock(&set->lock);
+    return result;
+}
+
+static int push_walk_task(WalkDeque *deque, const WalkTask *task) {
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head > 0 && deque->tail == deque->capacity) {
+        memmove(deque->tasks, deque->tasks + deque->head, (deque->tail - deque->head) * sizeof(WalkTask));
+        deque->tail -= deque->head;
+        deque->head = 0;
+    }
+    if (deque->tail == deque->capacity) {
+        size_t capacity = deque->capacity ? deque->capacity * 2 : 64;
+        WalkTask *tasks = realloc(deque->tasks, capacity * sizeof(WalkTask));
+        if (!tasks) {
+            pthread_mutex_unlock(&deque->lock);
+            return -1;
+        }
+        deque->tasks = tasks;
+        deque->capacity = capacity;
+    }
+    deque->tasks[deque->tail++] = *task;
+    pthread_mutex_unlock(&deque->lock);
+    return 0;
+}
+
+// Takes the newest task (from_head 0) or the oldest one (from_head 1)
+static int take_walk_task(WalkDeque *deque, WalkTask *task, int from_head) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        *task = from_head ? deque->tasks[deque->head++] : deque->tasks[--deque->tail];
+        if (deque->head == deque->tail) deque->head = deque->tail = 0;
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static void flush_walk_output(WalkWorker *worker) {
+    if (worker->output.length == 0) return;
+    pthread_mutex_lock(&worker->walker->output_lock);
+    fwrite(worker->output.data, 1, worker->output.length, stdout);
+    pthread_mutex_unlock(&worker->walker->output_lock);
+    worker->output.length = 0;
+}
+
+// Appends a node for a directory below parent, returning its index
+static long add_walk_node(Walker *walker, uint32_t parent, int depth, const char *path) {
+    long index = -1;
+    pthread_mutex_lock(&walker->nodes_lock);
+    if (walker->node_count == walker->node_capacity) {
+        size_t capacity = walker->node_capacity ? walker->node_capacity * 2 : 256;
+        WalkNode *nodes = realloc(walker->nodes, capacity * sizeof(WalkNode));
+        if (nodes) {
+            walker->nodes = nodes;
+            walker->node_capacity = capacity;
+        }
+    }
+    if (walker->node_count < walker->node_capacity) {
+        WalkNode *node = &walker->nodes[walker->node_count];
+        memset(node, 0, sizeof(*node));
+        node->parent = parent;
+        node->depth = depth;
+        if (depth <= walker->options.report_depth) node->path = strdup(path);
+        index = (long)walker->node_count++;
+    }
+    pthread_mutex_unlock(&walker->nodes_lock);
+    return index;
+}
+
+static void walk_directory(WalkWorker *worker, const WalkTask *task) {
+    Walker *walker = worker->walker;
+    const WalkOptions *options = &walker->options;
+    int flags = O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOCTTY;
+    if (task->depth > 0 && !walker->following) flags |= O_NOFOLLOW;
+
+    int fd = open(task->path, flags);
+    if (fd < 0) {
+        __atomic_add_fetch(&walker->errors, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    // A directory reached twice is a link loop or a second way into a walked subtree
+    struct stat self;
+    if (fstat(fd, &self) != 0 || insert_inode(&walker->visited, self.st_dev, self.st_ino) == 0) {
+        close(fd);
+        return;
+    }
+
+    size_t path_length = strlen(task->path);
+    const char *separator = path_length && task->path[path_length - 1] == '/' ? "" : "/";
+    unsigned long long bytes = options->sizes ? (unsigned long long)self.st_blocks * 512 : 0;
+    unsigned long long files = 0, dirs = 0;
+    long read_bytes = 0;
+
+    while (!stop && !__atomic_load_n(&walker->truncated, __ATOMIC_RELAXED)
+           && (read_bytes = syscall(SYS_getdents64, fd, worker->dents, WALK_DENTS_BUFFER)) > 0) {
+        for (long at = 0; at < read_bytes;) {
+            struct walk_dirent64 *entry = (struct walk_dirent64 *)(worker->dents + at);
+            at += entry->d_reclen;
+            const char *name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+            if (__atomic_add_fetch(&walker->entries, 1, __ATOMIC_RELAXED) > options->max_entries) {
+                __atomic_store_n(&walker->truncated, 1, __ATOMIC_RELAXED);
+                break;
+            }
+
+            unsigned char type = entry->d_type;
+            struct stat info;
+            int have_info = 0;
+            if (type == DT_UNKNOWN) {
+                if (fstatat(fd, name, &info, AT_SYMLINK_NOFOLLOW) != 0) continue;
+                have_info = 1;
+                type = IFTODT(info.st_mode);
+            }
+
+            int is_dir = type == DT_DIR;
+            int is_link = 0;
+            if (type == DT_LNK && options->follow_links) {
+                struct stat target;
+                if (fstatat(fd, name, &target, 0) == 0 && S_ISDIR(target.st_mode)) is_dir = is_link = 1;
+            }
+
+            if (options->list) {
+                append_format(&worker->output, "%s %s%s%s\n", is_dir ? "[DIR]" : "[FILE]",
+                              task->path, separator, name);
+                if (worker->output.length >= WALK_OUTPUT_FLUSH) flush_walk_output(worker);
+            }
+
+            if (!is_dir) {
+                files++;
+                if (options->visit) {
+                    worker->path.length = 0;
+                    if (append_format(&worker->path, "%s%s%s", task->path, separator, name) == 0) {
+                        options->visit(options->context, fd, name, type, worker->path.data);
+                    }
+                }
+                if (!options->sizes) continue;
+                if (!have_info && fstatat(fd, name, &info, AT_SYMLINK_NOFOLLOW) != 0) continue;
+                if (info.st_nlink > 1 && insert_inode(&walker->linked, info.st_dev, info.st_ino) == 0) continue;
+                bytes += (unsigned long long)info.st_blocks * 512;
+                continue;
+            }
+
+            dirs++;
+            if (task->depth + 1 > options->max_depth) {
+                __atomic_store_n(&walker->depth_limited, 1, __ATOMIC_RELAXED);
+                continue;
+            }
+
+            WalkTask child;
+            child.depth = task->depth + 1;
+            child.node = task->node;
+            size_t length = path_length + strlen(separator) + strlen(name) + 1;
+            child.path = malloc(length);
+            if (!child.path) continue;
+            snprintf(child.path, length, "%s%s%s", task->path, separator, name);
+            if (options->sizes) {
+                long node = add_walk_node(walker, task->node, child.depth, child.path);
+                if (node < 0) {
+                    free(child.path);
+                    continue;
+                }
+                child.node = (uint32_t)node;
+            }
+
+            // Links wait for the second pass so every directory is first reached by its real path
+            if (is_link && !walker->following) {
+                pthread_mutex_lock(&walker->links_lock);
+                if (walker->link_count == walker->link_capacity) {
+                    size_t capacity = walker->link_capacity ? walker->link_capacity * 2 : 16;
+                    WalkTask *links = realloc(walker->links, capacity * sizeof(WalkTask));
+                    if (links) {
+                        walker->links = links;
+                        walker->link_capacity = capacity;
+                    }
+                }
+                if (walker->link_count < walker->link_capacity) walker->links[walker->link_count++] = child;
+                else free(child.path);
+                pthread_mutex_unlock(&walker->links_lock);
+                continue;
+            }
+
+            __atomic_add_fetch(&walker->pending, 1, __ATOMIC_ACQ_REL);
+            if (push_walk_task(&walker->deques[worker->index], &child) != 0) {
+                __atomic_sub_fetch(&walker->pending, 1, __ATOMIC_ACQ_REL);
+                free(child.path);
+                continue;
+            }
+            pthread_cond_signal(&walker->idle_cond);
+        }
+    }
+    if (read_bytes < 0) __atomic_add_fetch(&walker->errors, 1, __ATOMIC_RELAXED);
+    close(fd);
+
+    if (options->sizes) {
+        pthread_mutex_lock(&walker->nodes_lock);
+        WalkNode *node = &walker->nodes[task->node];
+        node->bytes += bytes;
+        node->files += files;
+        node->dirs += dirs;
+        pthread_mutex_unlock(&walker->nodes_lock);
+    }
+    if (options->list) flush_walk_output(worker);
+}
+
+static void *run_walk_worker(void *arg) {
+    WalkWorker *worker = arg;
+    Walker *walker = worker->walker;
+
+    for (;;) {
+        WalkTask task;
+        int found = take_walk_task(&walker->deques[worker->index], &task, 0);
+        for (int i = 1; !found && i < walker->threads; i++) {
+            found = take_walk_task(&walker->deques[(worker->index + i) % walker->threads], &task, 1);
+        }
+
+        if (found) {
+            walk_directory(worker, &task);
+            free(task.path);
+            if (__atomic_sub_fetch(&walker->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+                pthread_mutex_lock(&walker->idle_lock);
+                pthread_cond_broadcast(&walker->idle_cond);
+                pthread_mutex_unlock(&walker->idle_lock);
+            }
+            continue;
+        }
+
+        // Nothing to steal; finished once no task is queued or running anywhere
+        pthread_mutex_lock(&walker->idle_lock);
+        if (__atomic_load_n(&walker->pending, __ATOMIC_ACQUIRE) == 0) {
+            pthread_mutex_unlock(&walker->idle_lock);
+            break;
+        }
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&walker->idle_cond, &walker->idle_lock, &deadline);
+        pthread_mutex_unlock(&walker->idle_lock);
+    }
+    return NULL;
+}
+
+void init_walk_options(WalkOptions *options) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    memset(options, 0, sizeof(*options));
+    options->max_depth = WALK_DEFAULT_MAX_DEPTH;
+    options->max_entries = WALK_DEFAULT_MAX_ENTRIES;
+    // Walking is mostly waiting on metadata reads, so use more threads than cores
+    options->threads = cores > 0 ? (int)(cores * 2) : 2;
+    options->report_depth = 1;
+}
+
+void free_walker(Walker *walker) {
+    for (size_t i = 0; i < walker->node_count; i++) free(walker->nodes[i].path);
+    free(walker->nodes);
+    for (size_t i = 0; i < walker->link_count; i++) free(walker->links[i].path);
+    free(walker->links);
+    free_inode_set(&walker->visited);
+    free_inode_set(&walker->linked);
+    for (int i = 0; i < WALK_MAX_THREADS; i++) {
+        free(walker->deques[i].tasks);
+        pthread_mutex_destroy(&walker->deques[i].lock);
+    }
+    pthread_mutex_destroy(&walker->nodes_lock);
+    pthread_mutex_destroy(&walker->idle_lock);
+    pthread_cond_destroy(&walker->idle_cond);
+    pthread_mutex_destroy(&walker->output_lock);
+    pthread_mutex_destroy(&walker->links_lock);
+}
+
+// Runs the pool until every queued task and everything found below it has been walked
+static int run_walk_pool(Walker *walker) {
+    WalkWorker workers[WALK_MAX_THREADS] = { { 0 } };
+    pthread_t threads[WALK_MAX_THREADS];
+    int started[WALK_MAX_THREADS] = { 0 };
+    for (int i = 0; i < walker->threads; i++) {
+        workers[i].walker = walker;
+        workers[i].index = i;
+        workers[i].dents = malloc(WALK_DENTS_BUFFER);
+        memset(&workers[i].output, 0, sizeof(StringBuffer));
+        memset(&workers[i].path, 0, sizeof(StringBuffer));
+    }
+    if (!workers[0].dents) {
+        for (int i = 0; i < walker->threads; i++) free(workers[i].dents);
+        return -1;
+    }
+
+    // The calling thread is worker 0; the others only help when they could be started
+    for (int i = 1; i < walker->threads; i++) {
+        started[i] = workers[i].dents && pthread_create(&threads[i], NULL, run_walk_worker, &workers[i]) == 0;
+    }
+    run_walk_worker(&workers[0]);
+    for (int i = 0; i < walker->threads; i++) {
+        if (started[i]) pthread_join(threads[i], NULL);
+        free(workers[i].dents);
+        free_string_buffer(&workers[i].output);
+        free_string_buffer(&workers[i].path);
+    }
+    return 0;
+}
+
+/**
+ * Walks the tree under root with the given options
+ * With sizes set, walker->nodes[0] is root and every node holds the totals of its subtree
+ * on return; the walker must be released with free_walker
+ */
+int walk_tree(const char *root, const WalkOptions *options, Walker *walker) {
+    memset(walker, 0, sizeof(*walker));
+    walker->options = *options;
+    walker->threads = options->threads < 1 ? 1 : options->threads > WALK_MAX_THREADS ? WALK_MAX_THREADS : options->threads;
+    init_inode_set(&walker->visited);
+    init_inode_set(&walker->linked);
+    for (int i = 0; i < WALK_MAX_THREADS; i++) pthread_mutex_init(&walker->deques[i].lock, NULL);
+    pthread_mutex_init(&walker->nodes_lock, NULL);
+    pthread_mutex_init(&walker->idle_lock, NULL);
+    pthread_cond_init(&walker->idle_cond, NULL);
+    pthread_mutex_init(&walker->output_lock, NULL);
+    pthread_mutex_init(&walker->links_lock, NULL);
+
+    struct stat info;
+    if (stat(root, &info) != 0 || !S_ISDIR(info.st_mode)) return -1;
+
+    WalkTask first = { strdup(root), 0, 0 };
+    if (!first.path || (options->sizes && add_walk_node(walker, 0, 0, root) != 0)) {
+        free(first.path);
+        return -1;
+    }
+    walker->pending = 1;
+    push_walk_task(&walker->deques[0], &first);
+    if (run_walk_pool(walker) != 0) return -1;
+
+    // Directories already walked under their real path are skipped through the visited set
+    if (walker->link_count > 0) {
+        walker->following = 1;
+        for (size_t i = 0; i < walker->link_count; i++) {
+            if (push_walk_task(&walker->deques[i % walker->threads], &walker->links[i]) == 0) walker->pending++;
+            else free(walker->links[i].path);
+        }
+        walker->link_count = 0;
+        run_walk_pool(walker);
+    }
+    fflush(stdout);
+
+    // Children are always added after their parent, so one backwards pass totals every subtree
+    for (size_t i = walker->node_count; i-- > 1;) {
+        WalkNode *node = &walker->nodes[i];
+        WalkNode *parent = &walker->nodes[node->parent];
+        parent->bytes += node->bytes;
+        parent->files += node->files;
+        parent->dirs += node->dirs;
+    }
+    return 0;
+}
+
+static void report_walk_limits(const Walker *walker, FILE *out) {
+    if (walker->truncated) {
+        fprintf(out, "Warning: stopped after %ld entries\n", walker->options.max_entries);
+    }
+    if (walker->depth_limited) {
+        fprintf(out, "Warning: directories below max_depth=%d were not entered\n", walker->options.max_depth);
+    }
+    if (walker->errors) {
+        fprintf(out, "Warning: %ld directories could not be read\n", walker->errors);
+    }
+}
+
+/**
+ * Lists every file and directory below path as [FILE] / [DIR] lines
+ * Symlinked directories are followed once; warnings about limits go to stderr so the
+ * listing itself stays parseable
+ */
+void scan_directory(const char *path) {
+    WalkOptions options;
+    Walker walker;
+
+    init_walk_options(&options);
+    options.list = 1;
+    options.follow_links = 1;
+    if (walk_tree(path, &options, &walker) == 0) report_walk_limits(&walker, stderr);
+    free_walker(&walker);
+}
+
+static int compare_walk_nodes(const void *a, const void *b) {
+    const WalkNode *x = *(const WalkNode *const *)a, *y = *(const WalkNode *const *)b;
+    return x->bytes < y->bytes ? 1 : x->bytes > y->bytes ? -1 : 0;
+}
+
+/**
+ * Totals disk usage below path like du, largest directories first
+ * Options: depth=N (report depth, default 1), max_depth=N, limit=N (entries), threads=N
+ * Hard-linked files are counted once and symlinks are not followed
+ */
+void disk_usage(const char *path, int argc, char **argv) {
+    WalkOptions options;
+    Walker walker;
+
+    init_walk_options(&options);
+    options.sizes = 1;
+    for (int i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "depth=", 6) == 0) options.report_depth = atoi(argv[i] + 6);
+        else if (strncmp(argv[i], "max_depth=", 10) == 0) options.max_depth = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "limit=", 6) == 0) options.max_entries = atol(argv[i] + 6);
+        else if (strncmp(argv[i], "threads=", 8) == 0) options.threads = atoi(argv[i] + 8);
+        else {
+            printf("Error: unknown option %s\n", argv[i]);
+            return;
+        }
+    }
+    if (options.max_depth < 0 || options.max_entries < 1 || options.report_depth < 0) {
+        printf("Error: depth, max_depth and limit must be positive\n");
+        return;
+    }
+
+    if (walk_tree(path, &options, &walker) != 0) {
+        printf("Error: cannot walk %s: %s\n", path, strerror(errno));
+        free_walker(&walker);
+        return;
+    }
+
+    const WalkNode *root = &walker.nodes[0];
+    char human[16];
+    format_human_size(root->bytes, human, sizeof(human));
+    printf("Disk usage of %s: %s (%llu bytes) in %llu files, %llu directories\n", path, human, root->bytes, root->files, root->dirs);
+
+    const WalkNode **shown = malloc((walker.node_count ? walker.node_count : 1) * sizeof(WalkNode *));
+    size_t count = 0;
+    for (size_t i = 1; shown && i < walker.node_count; i++) {
+        if (walker.nodes[i].path) shown[count++] = &walker.nodes[i];
+    }
+    if (shown) qsort(shown, count, sizeof(WalkNode *), compare_walk_nodes);
+    for (size_t i = 0; i < count; i++) {
+        format_human_size(shown[i]->bytes, human, sizeof(human));
+        printf("  size=%llu human=%s files=%llu dirs=%llu path=%s\n",
+               shown[i]->bytes, human, shown[i]->files, shown[i]->dirs, shown[i]->path);
+    }
+    free(shown);
+    report_walk_limits(&walker, stdout);
+    free_walker(&walker);
+}
+
+// Whether path ends in suffix
+static int has_suffix(const char *path, const char *suffix) {
+    size_t length = strlen(path), suffix_length = strlen(suffix);
+    return length >= suffix_length && strcmp(path + length - suffix_length, suffix) == 0;
+}
+
+/**
+ * Classifies the files found by list_manual_installs as ELF binaries, AppImages or scripts
+ * Only the ELF, program and section headers are mapped, never whole files, and results are kept
+ * per (device, inode, mtime, size) in binaries.cache so unchanged files are not opened again
+ */
+#define BINARY_CACHE_MAGIC "BIN1"
+#define BINARY_HEAD_SIZE 4096
+#define BINARY_MAX_RANGES 4
+#define BINARY_MAX_RANGE (4 << 20)     // Fits 65535 64-bit section headers
+
+typedef struct {
+    unsigned long long dev;
+    unsigned long long ino;
+    long long mtime_sec;
+    long mtime_nsec;
+    long long size;
+    char kind[12];          // elf, appimage, script or other
+    char type[12];          // exec, pie, static, shared, object, core; type1 / type2 for AppImages
+    char arch[16];
+    char interp[128];
+    int stripped;           // -1 when unknown or not ELF
+    char *path;
+} BinaryInfo;
+
+typedef struct {
+    BinaryInfo *items;
+    size_t count;
+    size_t capacity;
+} BinaryList;
+
+typedef struct {
+    pthread_mutex_t lock;
+    BinaryList cached;      // loaded from binaries.cache, read-only while walking
+    size_t *index;          // open addressing over cached by (dev, ino); SIZE_MAX is free
+    size_t index_capacity;
+    BinaryList found;       // every file seen in this run
+    int inspected;
+} BinaryScan;
+
+/**
+ * Header bytes of an open file plus any further ranges read on demand
+ * Everything is read with pread rather than mapped, so a file truncated or replaced during the
+ * scan gives a short read instead of SIGBUS
+ */
+typedef struct {
+    int fd;
+    long long size;
+    const unsigned char *head;
+    size_t head_length;
+    unsigned char *ranges[BINARY_MAX_RANGES];
+    int range_count;
+} FileView;
+
+static int append_binary(BinaryList *list, const BinaryInfo *info) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        BinaryInfo *items = realloc(list->items, capacity * sizeof(BinaryInfo));
+        if (!items) return -1;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = *info;
+    return 0;
+}
+
+static void free_binary_list(BinaryList *list) {
+    for (size_t i = 0; i < list->count; i++) free(list->items[i].path);
+    free(list->items);
+    list->items = NULL;
+    list->count = list->capacity = 0;
+}
+
+static size_t binary_slot(const BinaryScan *scan, unsigned long long dev, unsigned long long ino) {
+    uint64_t hash = (ino ^ (dev << 32)) * 0x9E3779B97F4A7C15ULL;
+    size_t slot = (size_t)(hash >> 20) & (scan->index_capacity - 1);
+    while (scan->index[slot] != SIZE_MAX) {
+        const BinaryInfo *item = &scan->cached.items[scan->index[slot]];
+        if (item->dev == dev && item->ino == ino) break;
+        slot = (slot + 1) & (scan->index_capacity - 1);
+    }
+    return slot;
+}
+
+// Cached result for the same file, or NULL when it is new or has changed since
+static const BinaryInfo *find_cached_binary(const BinaryScan *scan, const BinaryInfo *info) {
+    if (!scan->index) return NULL;
+    size_t at = scan->index[binary_slot(scan, info->dev, info->ino)];
+    if (at == SIZE_MAX) return NULL;
+    const BinaryInfo *item = &scan->cached.items[at];
+    if (item->mtime_sec != info->mtime_sec || item->mtime_nsec != info->mtime_nsec || item->size != info->size) return NULL;
+    return item;
+}
+
+static const char *binary_field(const char *value) {
+    return value[0] ? value : "-";
+}
+
+static void copy_binary_field(char *out, size_t size, const char *value) {
+    snprintf(out, size, "%s", strcmp(value, "-") == 0 ? "" : value);
+}
+
+static void load_binary_cache(BinaryScan *scan) {
+    char path[512], line[4096];
+    char kind[12], type[12], arch[16], interp[128];
+    FILE *fp = build_user_path("XDG_CACHE_HOME", ".cache", "binaries.cache", path, sizeof(path)) == 0 ? fopen(path, "r") : NULL;
+    if (!fp) return;
+
+    if (!fgets(line, sizeof(line), fp) || strncmp(line, BINARY_CACHE_MAGIC "\n", 5) != 0) {
+        fclose(fp);
+        return;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        BinaryInfo info;
+        int offset = 0;
+        memset(&info, 0, sizeof(info));
+        line[strcspn(line, "\n")] = '\0';
+        if (sscanf(line, "%llu %llu %lld %ld %lld %11s %11s %15s %127s %d %n", &info.dev, &info.ino, &info.mtime_sec,
+                   &info.mtime_nsec, &info.size, kind, type, arch, interp, &info.stripped, &offset) != 10 || !line[offset]) continue;
+        copy_binary_field(info.kind, sizeof(info.kind), kind);
+        copy_binary_field(info.type, sizeof(info.type), type);
+        copy_binary_field(info.arch, sizeof(info.arch), arch);
+        copy_binary_field(info.interp, sizeof(info.interp), interp);
+        info.path = strdup(line + offset);
+        if (!info.path || append_binary(&scan->cached, &info) != 0) {
+            free(info.path);
+            break;
+        }
+    }
+    fclose(fp);
+
+    size_t capacity = 64;
+    while (capacity < scan->cached.count * 2) capacity *= 2;
+    scan->index = malloc(capacity * sizeof(size_t));
+    if (!scan->index) return;
+    scan->index_capacity = capacity;
+    for (size_t i = 0; i < capacity; i++) scan->index[i] = SIZE_MAX;
+    for (size_t i = 0; i < scan->cached.count; i++) {
+        size_t slot = binary_slot(scan, scan->cached.items[i].dev, scan->cached.items[i].ino);
+        if (scan->index[slot] == SIZE_MAX) scan->index[slot] = i;
+    }
+}
+
+// Rewrites the cache with the files seen in this run, dropping the ones that are gone
+static void save_binary_cache(const BinaryScan *scan) {
+    char path[512], temp[520];
+    if (build_user_path("XDG_CACHE_HOME", ".cache", "binaries.cache", path, sizeof(path)) != 0 || ensure_parent_directory(path) != 0) return;
+
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid());
+    FILE *fp = fopen(temp, "w");
+    if (!fp) return;
+    fprintf(fp, BINARY_CACHE_MAGIC "\n");
+    for (size_t i = 0; i < scan->found.count; i++) {
+        const BinaryInfo *info = &scan->found.items[i];
+        if (strchr(info->path, '\n')) continue;
+        fprintf(fp, "%llu %llu %lld %ld %lld %s %s %s %s %d %s\n", info->dev, info->ino, info->mtime_sec, info->mtime_nsec,
+                info->size, binary_field(info->kind), binary_field(info->type), binary_field(info->arch),
+                binary_field(info->interp), info->stripped, info->path);
+    }
+    if (fclose(fp) != 0 || rename(temp, path) != 0) unlink(temp);
+}
+
+// Bytes [offset, offset + length) of the file, from the header page or a buffer read for just that range
+static const unsigned char *view_range(FileView *view, unsigned long long offset, unsigned long long length) {
+    if (length == 0 || offset > (unsigned long long)view->size || length > (unsigned long long)view->size - offset) return NULL;
+    if (offset + length <= view->head_length) return view->head + offset;
+    if (view->range_count == BINARY_MAX_RANGES || length > BINARY_MAX_RANGE) return NULL;
+
+    unsigned char *buffer = malloc(length);
+    if (!buffer) return NULL;
+    if (pread(view->fd, buffer, length, (off_t)offset) != (ssize_t)length) {
+        free(buffer);
+        return NULL;
+    }
+    view->ranges[view->range_count++] = buffer;
+    return buffer;
+}
+
+static void release_file_view(FileView *view) {
+    for (int i = 0; i < view->range_count; i++) free(view->ranges[i]);
+    view->range_count = 0;
+}
+
+static const char *elf_machine_name(unsigned int machine, int is64) {
+    switch (machine) {
+    case EM_X86_64: return "x86_64";
+    case EM_386: return "i386";
+    case EM_AARCH64: return "aarch64";
+    case EM_ARM: return "arm";
+    case EM_RISCV: return is64 ? "riscv64" : "riscv32";
+    case EM_PPC64: return "ppc64";
+    case EM_PPC: return "ppc";
+    case EM_S390: return is64 ? "s390x" : "s390";
+    case EM_MIPS: return is64 ? "mips64" : "mips";
+    case 258: return "loongarch64";     // EM_LOONGARCH, missing from older elf.h
+    }
+    return NULL;
+}
+
+/**
+ * Reads architecture, file type, interpreter and whether a symbol table is present
+ * Headers in the foreign byte order only yield the architecture
+ */
+static void inspect_elf(FileView *view, BinaryInfo *info) {
+    const unsigned char *head = view->head;
+    int is64 = head[EI_CLASS] == ELFCLASS64;
+    int native = head[EI_DATA] == (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ ? ELFDATA2LSB : ELFDATA2MSB);
+    unsigned long long phoff, shoff;
+    unsigned int type, machine, phentsize, phnum, shentsize, shnum;
+
+    if (is64) {
+        Elf64_Ehdr header;
+        if (view->head_length < sizeof(header)) return;
+        memcpy(&header, head, sizeof(header));
+        type = header.e_type;
+        machine = header.e_machine;
+        phoff = header.e_phoff;
+        phentsize = header.e_phentsize;
+        phnum = header.e_phnum;
+        shoff = header.e_shoff;
+        shentsize = header.e_shentsize;
+        shnum = header.e_shnum;
+    } else {
+        Elf32_Ehdr header;
+        if (view->head_length < sizeof(header)) return;
+        memcpy(&header, head, sizeof(header));
+        type = header.e_type;
+        machine = header.e_machine;
+        phoff = header.e_phoff;
+        phentsize = header.e_phentsize;
+        phnum = header.e_phnum;
+        shoff = header.e_shoff;
+        shentsize = header.e_shentsize;
+        shnum = header.e_shnum;
+    }
+    if (!native) machine = __builtin_bswap16((uint16_t)machine);
+
+    const char *arch = elf_machine_name(machine, is64);
+    if (arch) snprintf(info->arch, sizeof(info->arch), "%s", arch);
+    else snprintf(info->arch, sizeof(info->arch), "em%u", machine);
+    if (!native) return;
+
+    // The interpreter is named by PT_INTERP; without one the binary is static or a library
+    int has_interp = 0;
+    const unsigned char *phdrs = phentsize >= (is64 ? sizeof(Elf64_Phdr) : sizeof(Elf32_Phdr))
+        ? view_range(view, phoff, (unsigned long long)phentsize * phnum) : NULL;
+    for (unsigned int i = 0; phdrs && i < phnum; i++) {
+        unsigned long long offset, length;
+        if (is64) {
+            Elf64_Phdr phdr;
+            memcpy(&phdr, phdrs + (size_t)i * phentsize, sizeof(phdr));
+            if (phdr.p_type != PT_INTERP) continue;
+            offset = phdr.p_offset;
+            length = phdr.p_filesz;
+        } else {
+            Elf32_Phdr phdr;
+            memcpy(&phdr, phdrs + (size_t)i * phentsize, sizeof(phdr));
+            if (phdr.p_type != PT_INTERP) continue;
+            offset = phdr.p_offset;
+            length = phdr.p_filesz;
+        }
+        if (length >= sizeof(info->interp)) length = sizeof(info->interp) - 1;
+        const unsigned char *interp = view_range(view, offset, length);
+        if (interp) {
+            size_t used = strnlen((const char *)interp, length);
+            memcpy(info->interp, interp, used);
+            info->interp[used] = '\0';
+            for (size_t j = 0; j < used; j++) {
+                if (!isgraph((unsigned char)info->interp[j])) info->interp[j] = '_';
+            }
+            has_interp = 1;
+        }
+        break;
+    }
+
+    const char *name = "other";
+    if (type == ET_EXEC) name = has_interp ? "exec" : "static";
+    else if (type == ET_DYN) name = has_interp ? "pie" : "shared";
+    else if (type == ET_REL) name = "object";
+    else if (type == ET_CORE) name = "core";
+    if (!info->type[0]) snprintf(info->type, sizeof(info->type), "%s", name);
+
+    // Stripped files have no SHT_SYMTAB; sstrip removes the section headers altogether
+    info->stripped = 1;
+    const unsigned char *shdrs = shoff && shnum && shentsize >= (is64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr))
+        ? view_range(view, shoff, (unsigned long long)shentsize * shnum) : NULL;
+    for (unsigned int i = 0; shdrs && i < shnum; i++) {
+        uint32_t section_type;
+        // sh_type is the second 32-bit word in both classes
+        memcpy(&section_type, shdrs + (size_t)i * shentsize + 4, sizeof(section_type));
+        if (section_type == SHT_SYMTAB) {
+            info->stripped = 0;
+            break;
+        }
+    }
+}
+
+// The interpreter of a #! line, looking through /usr/bin/env to the program it starts
+static void read_script_interpreter(const unsigned char *head, size_t length, BinaryInfo *info) {
+    const char *line = (const char *)head + 2, *end = (const char *)head + length;
+    const char *newline = memchr(line, '\n', end - line);
+    if (newline) end = newline;
+
+    for (int word = 0; word < 3 && line < end; word++) {
+        while (line < end && (*line == ' ' || *line == '\t')) line++;
+        const char *start = line;
+        while (line < end && !isspace((unsigned char)*line)) line++;
+        if (line == start) break;
+        size_t used = line - start;
+        if (used >= sizeof(info->interp)) used = sizeof(info->interp) - 1;
+        // Options given to env (env -S python3) are skipped
+        if (word > 0 && *start == '-') continue;
+        memcpy(info->interp, start, used);
+        info->interp[used] = '\0';
+        const char *base = strrchr(info->interp, '/');
+        if (strcmp(base ? base + 1 : info->interp, "env") != 0) break;
+    }
+}
+
+static void classify_binary(int fd, BinaryInfo *info) {
+    FileView view;
+    unsigned char head[BINARY_HEAD_SIZE];
+    memset(&view, 0, sizeof(view));
+    view.fd = fd;
+    view.size = info->size;
+    snprintf(info->kind, sizeof(info->kind), "other");
+    info->stripped = -1;
+    if (info->size < 4) return;
+
+    ssize_t length = pread(fd, head, info->size < BINARY_HEAD_SIZE ? (size_t)info->size : BINARY_HEAD_SIZE, 0);
+    if (length < 4) return;
+    view.head = head;
+    view.head_length = length;
+
+    if (memcmp(view.head, ELFMAG, SELFMAG) == 0 && view.head_length > EI_NIDENT) {
+        // AppImages are ELF runtimes marked with "AI" and the format version in the padding bytes
+        if (view.head[8] == 'A' && view.head[9] == 'I' && (view.head[10] == 1 || view.head[10] == 2)) {
+            snprintf(info->kind, sizeof(info->kind), "appimage");
+            snprintf(info->type, sizeof(info->type), "type%d", view.head[10]);
+        } else {
+            snprintf(info->kind, sizeof(info->kind), "elf");
+        }
+        if (view.head[EI_CLASS] == ELFCLASS32 || view.head[EI_CLASS] == ELFCLASS64) inspect_elf(&view, info);
+    } else if (view.head[0] == '#' && view.head[1] == '!') {
+        snprintf(info->kind, sizeof(info->kind), "script");
+        read_script_interpreter(view.head, view.head_length, info);
+    }
+
+    release_file_view(&view);
+}
+
+// Walker callback: classifies one file, reusing the cached result when the file is unchanged
+static void visit_binary(void *context, int dirfd, const char *name, unsigned char type, const char *path) {
+    BinaryScan *scan = context;
+    BinaryInfo info;
+    struct stat st;
+    int inspected = 0;
+
+    // Only regular files are opened: opening a FIFO, socket or device node can have side effects
+    if (type == DT_LNK) {
+        if (fstatat(dirfd, name, &st, 0) != 0 || !S_ISREG(st.st_mode)) return;
+    } else if (type != DT_REG) {
+        return;
+    }
+
+    // Key and size come from the open descriptor, so they describe the file that gets classified;
+    // O_NONBLOCK covers an entry swapped for a FIFO since it was checked
+    int fd = openat(dirfd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0) return;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return;
+    }
+    memset(&info, 0, sizeof(info));
+    info.dev = st.st_dev;
+    info.ino = st.st_ino;
+    info.mtime_sec = st.st_mtim.tv_sec;
+    info.mtime_nsec = st.st_mtim.tv_nsec;
+    info.size = st.st_size;
+
+    const BinaryInfo *cached = find_cached_binary(scan, &info);
+    if (cached) {
+        memcpy(info.kind, cached->kind, sizeof(info.kind));
+        memcpy(info.type, cached->type, sizeof(info.type));
+        memcpy(info.arch, cached->arch, sizeof(info.arch));
+        memcpy(info.interp, cached->interp, sizeof(info.interp));
+        info.stripped = cached->stripped;
+    } else {
+        classify_binary(fd, &info);
+        inspected = 1;
+    }
+    close(fd);
+
+    info.path = strdup(path);
+    if (!info.path) return;
+    pthread_mutex_lock(&scan->lock);
+    if (append_binary(&scan->found, &info) != 0) free(info.path);
+    else scan->inspected += inspected;
+    pthread_mutex_unlock(&scan->lock);
+}
+
+static int compare_binary_paths(const void *a, const void *b) {
+    return strcmp(((const BinaryInfo *)a)->path, ((const BinaryInfo *)b)->path);
+}
+
+static void print_binaries(BinaryScan *scan) {
+    qsort(scan->found.items, scan->found.count, sizeof(BinaryInfo), compare_binary_paths);
+    printf("Binaries: %zu files, %d inspected, %zu from cache\n", scan->found.count, scan->inspected,
+           scan->found.count - scan->inspected);
+    for (size_t i = 0; i < scan->found.count; i++) {
+        const BinaryInfo *info = &scan->found.items[i];
+        if (strcmp(info->kind, "other") == 0) continue;
+        printf("  kind=%s", info->kind);
+        if (info->type[0]) printf(" type=%s", info->type);
+        if (info->arch[0]) printf(" arch=%s", info->arch);
+        if (strcmp(info->kind, "script") == 0 || info->stripped >= 0) printf(" interp=%s", info->interp[0] ? info->interp : "none");
+        if (info->stripped >= 0) printf(" stripped=%s", info->stripped ? "yes" : "no");
+        printf(" path=%s\n", info->path);
+    }
+}
+
+// Value of key= in a keyfile group such as [Application]
+static int read_keyfile_value(const char *path, const char *group, const char *key, char *out, size_t size) {
+    char line[1024];
+    size_t key_length = strlen(key);
+    int in_group = 0;
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '[') {
+            in_group = strncmp(line + 1, group, strlen(group)) == 0 && line[1 + strlen(group)] == ']';
+            continue;
+        }
+        if (in_group && strncmp(line, key, key_length) == 0 && line[key_length] == '=') {
+            // A value too long for out is treated as missing rather than cut short
+            int written = snprintf(out, size, "%s", line + key_length + 1);
+            fclose(fp);
+            if (written >= (int)size) {
+                out[0] = '\0';
+                return -1;
+            }
+            return 0;
+        }
+    }
+    fclose(fp);
+    return -1;
+}
+
+// Version of the newest <release> in an AppStream metainfo file
+static int read_metainfo_version(const char *path, char *out, size_t size) {
+    char text[65536];
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    size_t length = fread(text, 1, sizeof(text) - 1, fp);
+    fclose(fp);
+    text[length] = '\0';
+
+    char *release = strstr(text, "<release ");
+    char *version = release ? strstr(release, "version=\"") : NULL;
+    char *close = version ? strchr(version + 9, '"') : NULL;
+    char *tag_end = release ? strchr(release, '>') : NULL;
+    if (!close || (tag_end && version > tag_end)) return -1;
+    snprintf(out, size, "%.*s", (int)(close - version - 9), version + 9);
+    return 0;
+}
+
+/**
+ * Lists the applications of the system and per-user Flatpak installations
+ * Reads the deployed metadata keyfile, the AppStream release and the origin remote, which is the
+ * first string of the GVariant deploy file
+ */
+static void print_flatpak_apps(const char *home) {
+    char installations[2][512];
+    const char *scopes[2] = { "system", "user" };
+    int count = 0;
+
+    snprintf(installations[0], sizeof(installations[0]), "/var/lib/flatpak/app");
+    snprintf(installations[1], sizeof(installations[1]), "%s/.local/share/flatpak/app", home ? home : "");
+
+    printf("Flatpak applications:\n");
+    for (int i = 0; i < 2; i++) {
+        if (i == 1 && !home) continue;
+        DIR *dir = opendir(installations[i]);
+        if (!dir) continue;
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_name[0] == '.') continue;
+            // path has room for active plus the longest suffix appended to it below
+            char active[1024], current[128], path[sizeof(active) + 320];
+            char version[64] = "", runtime[256] = "", origin[128] = "";
+
+            // current points at <arch>/<branch>
+            snprintf(path, sizeof(path), "%s/%s/current", installations[i], entry->d_name);
+            ssize_t length = readlink(path, current, sizeof(current) - 1);
+            if (length <= 0) continue;
+            current[length] = '\0';
+            char *branch = strchr(current, '/');
+            if (branch) *branch++ = '\0';
+
+            snprintf(active, sizeof(active), "%s/%s/current/active", installations[i], entry->d_name);
+            snprintf(path, sizeof(path), "%s/metadata", active);
+            read_keyfile_value(path, "Application", "runtime", runtime, sizeof(runtime));
+            snprintf(path, sizeof(path), "%s/files/share/metainfo/%s.metainfo.xml", active, entry->d_name);
+            if (read_metainfo_version(path, version, sizeof(version)) != 0) {
+                snprintf(path, sizeof(path), "%s/files/share/appdata/%s.appdata.xml", active, entry->d_name);
+                read_metainfo_version(path, version, sizeof(version));
+            }
+            snprintf(path, sizeof(path), "%s/deploy", active);
+            FILE *fp = fopen(path, "r");
+            if (fp) {
+                size_t used = fread(origin, 1, sizeof(origin) - 1, fp);
+                fclose(fp);
+                origin[used] = '\0';
+                for (char *c = origin; *c; c++) {
+                    if (!isgraph((unsigned char)*c)) {
+                        origin[0] = '\0';
+                        break;
+                    }
+                }
+            }
+
+            printf("  name=%s version=%s arch=%s branch=%s origin=%s runtime=%s scope=%s\n", entry->d_name,
+                   binary_field(version), current, branch ? branch : "-", binary_field(origin),
+                   binary_field(runtime), scopes[i]);
+            count++;
+        }
+        closedir(dir);
+    }
+    if (count == 0) printf("  none\n");
+}
+
+// Minimal scanning of snapd's state.json: values are stepped over, never built into a tree
+static const char *skip_json_space(const char *p, const char *end) {
+    while (p < end && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+static const char *skip_json_string(const char *p, const char *end) {
+    for (p++; p < end; p++) {
+        if (*p == '\\') p++;
+        else if (*p == '"') return p + 1;
+    }
+    return end;
+}
+
+static const char *skip_json_value(const char *p, const char *end) {
+    p = skip_json_space(p, end);
+    if (p >= end) return end;
+    if (*p == '"') return skip_json_string(p, end);
+    if (*p == '{' || *p == '[') {
+        int depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = skip_json_string(p, end);
+                continue;
+            }
+            if (*p == '{' || *p == '[') depth++;
+            else if ((*p == '}' || *p == ']') && --depth == 0) return p + 1;
+            p++;
+        }
+        return end;
+    }
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && !isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+/**
+ * Steps to the next member of an object; *cursor starts just after the opening brace
+ * Returns 1 with the key (unquoted, not unescaped) and the start of its value, 0 at the end
+ */
+static int next_json_member(const char **cursor, const char *end, const char **key, size_t *key_length, const char **value) {
+    const char *p = skip_json_space(*cursor, end);
+    if (p < end && *p == ',') p = skip_json_space(p + 1, end);
+    if (p >= end || *p != '"') return 0;
+
+    *key = p + 1;
+    p = skip_json_string(p, end);
+    *key_length = p - 1 - *key;
+    p = skip_json_space(p, end);
+    if (p >= end || *p != ':') return 0;
+    *value = skip_json_space(p + 1, end);
+    *cursor = skip_json_value(*value, end);
+    return 1;
+}
+
+static const char *find_json_member(const char *object, const char *end, const char *name) {
+    const char *cursor = object + 1, *key, *value;
+    size_t key_length;
+    if (object >= end || *object != '{') return NULL;
+    while (next_json_member(&cursor, end, &key, &key_length, &value)) {
+        if (key_length == strlen(name) && strncmp(key, name, key_length) == 0) return value;
+    }
+    return NULL;
+}
+
+// Copies a string or scalar value; escapes are kept as written
+static void read_json_scalar(const char *value, const char *end, char *out, size_t size) {
+    out[0] = '\0';
+    if (!value || value >= end || *value == '{' || *value == '[') return;
+    const char *stop_at = skip_json_value(value, end);
+    if (*value == '"') {
+        value++;
+        stop_at--;
+    }
+    if (stop_at > value) snprintf(out, size, "%.*s", (int)(stop_at - value), value);
+}
+
+// The version: line of an installed snap's meta/snap.yaml
+static void read_snap_version(const char *name, const char *revision, char *out, size_t size) {
+    const char *mounts[] = { "/snap", "/var/lib/snapd/snap" };
+    char path[512], line[256];
+
+    out[0] = '\0';
+    for (int i = 0; i < 2 && !out[0]; i++) {
+        snprintf(path, sizeof(path), "%s/%s/%s/meta/snap.yaml", mounts[i], name, revision);
+        FILE *fp = fopen(path, "r");
+        if (!fp) continue;
+        while (fgets(line, sizeof(line), fp)) {
+            if (strncmp(line, "version:", 8) != 0) continue;
+            char *value = line + 8;
+            value += strspn(value, " \t'\"");
+            value[strcspn(value, "'\"\r\n")] = '\0';
+            snprintf(out, size, "%s", value);
+            break;
+        }
+        fclose(fp);
+    }
+}
+
+/**
+ * Lists installed snaps from /var/lib/snapd/state.json
+ * The state file is only readable by root; otherwise the revisions come from the .snap files in
+ * /var/lib/snapd/snaps and the current links under /snap
+ */
+static void print_snap_packages(void) {
+    int count = 0;
+    printf("Snap packages:\n");
+
+    int fd = open("/var/lib/snapd/state.json", O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+        char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            const char *end = map + st.st_size;
+            const char *data = find_json_member(skip_json_space(map, end), end, "data");
+            const char *snaps = data ? find_json_member(data, end, "snaps") : NULL;
+            const char *cursor = snaps && *snaps == '{' ? snaps + 1 : end, *key, *value;
+            size_t key_length;
+
+            while (next_json_member(&cursor, end, &key, &key_length, &value)) {
+                char name[128], revision[32], channel[64], type[32], active[8], version[64];
+                snprintf(name, sizeof(name), "%.*s", (int)key_length, key);
+                read_json_scalar(find_json_member(value, end, "current"), end, revision, sizeof(revision));
+                read_json_scalar(find_json_member(value, end, "channel"), end, channel, sizeof(channel));
+                read_json_scalar(find_json_member(value, end, "type"), end, type, sizeof(type));
+                read_json_scalar(find_json_member(value, end, "active"), end, active, sizeof(active));
+                read_snap_version(name, revision, version, sizeof(version));
+                printf("  name=%s version=%s revision=%s channel=%s type=%s active=%s\n", name, binary_field(version),
+                       binary_field(revision), binary_field(channel), binary_field(type),
+                       strcmp(active, "true") == 0 ? "yes" : "no");
+                count++;
+            }
+            munmap(map, st.st_size);
+        }
+        close(fd);
+    } else {
+        if (fd >= 0) close(fd);
+        DIR *dir = opendir("/var/lib/snapd/snaps");
+        struct dirent *entry;
+        while (dir && (entry = readdir(dir)) != NULL) {
+            char name[128], path[512], current[32], version[64];
+            const char *underscore = strrchr(entry->d_name, '_');
+            if (!underscore || !has_suffix(entry->d_name, ".snap")) continue;
+            snprintf(name, sizeof(name), "%.*s", (int)(underscore - entry->d_name), entry->d_name);
+            const char *revision = underscore + 1;
+            int revision_length = (int)(strlen(revision) - 5);
+
+            // Older revisions kept for rollback are not the installed one
+            snprintf(path, sizeof(path), "/snap/%s/current", name);
+            ssize_t length = readlink(path, current, sizeof(current) - 1);
+            if (length > 0) {
+                current[length] = '\0';
+                if ((int)strlen(current) != revision_length || strncmp(current, revision, revision_length) != 0) continue;
+            } else {
+                snprintf(current, sizeof(current), "%.*s", revision_length, revision);
+            }
+            read_snap_version(name, current, version, sizeof(version));
+            printf("  name=%s version=%s revision=%s\n", name, binary_field(version), current);
+            count++;
+        }
+        if (dir) closedir(dir);
+    }
+    if (count == 0) printf("  none\n");
+}
+
+/**
+ * Lists programs installed outside the package manager
+ * The [DIR] / [FILE] listing of /usr/local/bin, /opt and ~/.local/bin comes first, followed by
+ * Flatpak applications, snaps and the classified binaries (AppImages in ~/Applications included)
+ */
+void list_manual_installs() {
+    BinaryScan scan;
+    WalkOptions options;
+    Walker walker;
+    char local_bin[1024] = "", applications[1024] = "";
+
+    const char *home = getenv("HOME");
+    if (!home) {
+        struct passwd *pw = getpwuid(getuid());
+        if (pw) home = pw->pw_dir;
+    }
+    if (home) {
+        snprintf(local_bin, sizeof(local_bin), "%s/.local/bin", home);
+        snprintf(applications, sizeof(applications), "%s/Applications", home);
+    }
+
+    memset(&scan, 0, sizeof(scan));
+    pthread_mutex_init(&scan.lock, NULL);
+    load_binary_cache(&scan);
+
+    init_walk_options(&options);
+    options.follow_links = 1;
+    options.visit = visit_binary;
+    options.context = &scan;
+
+    printf("Manually installed programs/binaries:\n");
+    const char *roots[] = { "/usr/local/bin", "/opt", local_bin, applications };
+    for (int i = 0; i < 4; i++) {
+        if (!roots[i][0]) continue;
+        options.list = i < 3;
+        if (walk_tree(roots[i], &options, &walker) == 0) report_walk_limits(&walker, stderr);
+        free_walker(&walker);
+    }
+
+    print_flatpak_apps(home);
+    print_snap_packages();
+    print_binaries(&scan);
+    save_binary_cache(&scan);
+
+    free_binary_list(&scan.cached);
+    free_binary_list(&scan.found);
+    free(scan.index);
+    pthread_mutex_destroy(&scan.lock);
+}
+
+#define JOURNAL_BACKLOG 300
+#define JOURNAL_MAX_BATCH 5000
+#define JOURNAL_WAIT_USEC 1000000
+#define LOG_MAX_MESSAGE 4096
+
+typedef struct sd_journal sd_journal;
+
+// libsystemd's journal API, resolved at runtime so the monitor still runs where it is absent
+static struct {
+    int loaded;
+    int (*open)(sd_journal **journal, int flags);
+    int (*open_files)(sd_journal **journal, const char **paths, int flags);
+    void (*close)(sd_journal *journal);
+    int (*seek_tail)(sd_journal *journal);
+    int (*seek_cursor)(sd_journal *journal, const char *cursor);
+    int (*test_cursor)(sd_journal *journal, const char *cursor);
+    int (*get_cursor)(sd_journal *journal, char **cursor);
+    int (*next)(sd_journal *journal);
+    int (*previous)(sd_journal *journal);
+    int (*previous_skip)(sd_journal *journal, uint64_t skip);
+    int (*seek_head)(sd_journal *journal);
+    int (*get_realtime_usec)(sd_journal *journal, uint64_t *usec);
+    int (*get_data)(sd_journal *journal, const char *field, const void **data, size_t *length);
+    int (*add_match)(sd_journal *journal, const void *data, size_t size);
+    int (*wait)(sd_journal *journal, uint64_t timeout_usec);
+} sd_journal_api;
+
+/**
+ * Loads libsystemd and resolves the sd-journal calls used here
+ * Returns 0 when all of them are available
+ */
+int load_sd_journal() {
+    if (sd_journal_api.loaded) return sd_journal_api.loaded > 0 ? 0 : -1;
+    sd_journal_api.loaded = -1;
+
+    void *library = dlopen("libsystemd.so.0", RTLD_NOW | RTLD_LOCAL);
+    if (!library) return -1;
+
+    const struct {
+        const char *name;
+        void **slot;
+    } symbols[] = {
+        {"sd_journal_open", (void **)&sd_journal_api.open},
+        {"sd_journal_open_files", (void **)&sd_journal_api.open_files},
+        {"sd_journal_close", (void **)&sd_journal_api.close},
+        {"sd_journal_seek_tail", (void **)&sd_journal_api.seek_tail},
+        {"sd_journal_seek_cursor", (void **)&sd_journal_api.seek_cursor},
+        {"sd_journal_test_cursor", (void **)&sd_journal_api.test_cursor},
+        {"sd_journal_get_cursor", (void **)&sd_journal_api.get_cursor},
+        {"sd_journal_next", (void **)&sd_journal_api.next},
+        {"sd_journal_previous", (void **)&sd_journal_api.previous},
+        {"sd_journal_previous_skip", (void **)&sd_journal_api.previous_skip},
+        {"sd_journal_seek_head", (void **)&sd_journal_api.seek_head},
+        {"sd_journal_get_realtime_usec", (void **)&sd_journal_api.get_realtime_usec},
+        {"sd_journal_get_data", (void **)&sd_journal_api.get_data},
+        {"sd_journal_add_match", (void **)&sd_journal_api.add_match},
+        {"sd_journal_wait", (void **)&sd_journal_api.wait},
+    };
+    for (size_t i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++) {
+        *symbols[i].slot = dlsym(library, symbols[i].name);
+        if (!*symbols[i].slot) {
+            dlclose(library);
+            return -1;
+        }
+    }
+    sd_journal_api.loaded = 1;
+    return 0;
+}
+
+/**
+ * Fields of one journal entry, copied out because sd_journal_get_data reuses its
+ * buffer on the next call
+ */
+typedef struct {
+    uint64_t time;              // Microseconds since the epoch
+    int priority;               // syslog level, 6 (info) when the entry has none
+    char host[64];
+    char ident[64];
+    char unit[64];
+    char pid[16];
+    char message[LOG_MAX_MESSAGE];
+    int message_length;
+} JournalEntry;
+
+typedef void (*JournalEntryFn)(const JournalEntry *entry, void *context);
+
+// Copies one field of the current entry without its "FIELD=" prefix; returns its length or -1
+static int journal_field(sd_journal *journal, const char *field, char *out, size_t size) {
+    const void *data;
+    size_t length, prefix = strlen(field) + 1;
+
+    out[0] = '\0';
+    if (sd_journal_api.get_data(journal, field, &data, &length) < 0 || length < prefix) return -1;
+    length -= prefix;
+    if (length >= size) length = size - 1;
+    memcpy(out, (const char *)data + prefix, length);
+    out[length] = '\0';
+    return (int)length;
+}
+
+static void read_journal_entry(sd_journal *journal, JournalEntry *entry) {
+    char priority[8];
+
+    entry->time = 0;
+    sd_journal_api.get_realtime_usec(journal, &entry->time);
+    entry->priority = journal_field(journal, "PRIORITY", priority, sizeof(priority)) > 0 ? atoi(priority) & 7 : 6;
+    journal_field(journal, "_HOSTNAME", entry->host, sizeof(entry->host));
+    if (journal_field(journal, "SYSLOG_IDENTIFIER", entry->ident, sizeof(entry->ident)) < 0) {
+        journal_field(journal, "_COMM", entry->ident, sizeof(entry->ident));
+    }
+    journal_field(journal, "_SYSTEMD_UNIT", entry->unit, sizeof(entry->unit));
+    journal_field(journal, "_PID", entry->pid, sizeof(entry->pid));
+    entry->message_length = journal_field(journal, "MESSAGE", entry->message, sizeof(entry->message));
+    if (entry->message_length < 0) entry->message_length = 0;
+}
+
+/**
+ * Prints an entry like journalctl's short format, one "Journal: " line per message line
+ */
+static void print_journal_entry(const JournalEntry *entry, void *context) {
+    (void)context;
+    char stamp[32] = "";
+    time_t seconds = entry->time / 1000000;
+    struct tm tm;
+
+    if (entry->time) strftime(stamp, sizeof(stamp), "%b %d %H:%M:%S", localtime_r(&seconds, &tm));
+    printf("Journal: %s %s %s", stamp, entry->host, entry->ident[0] ? entry->ident : "unknown");
+    if (entry->pid[0]) printf("[%s]", entry->pid);
+    printf(": ");
+
+    // Multi-line messages continue on further lines, indented as journalctl does
+    const char *line = entry->message, *end = line + entry->message_length;
+    for (;;) {
+        const char *newline = memchr(line, '\n', end - line);
+        printf("%.*s\n", (int)((newline ? newline : end) - line), line);
+        if (!newline) break;
+        line = newline + 1;
+        printf("Journal:     ");
+    }
+}
+
+// Prints "Cursor: ..." so the client can ask for only what comes after this entry next time
+static void print_journal_cursor(sd_journal *journal) {
+    char *cursor = NULL;
+    if (sd_journal_api.get_cursor(journal, &cursor) >= 0 && cursor) {
+        printf("Cursor: %s\n", cursor);
+        free(cursor);
+    }
+}
+
+// Passes entries from the current read position on to fn; returns how many there were
+static int read_journal_entries(sd_journal *journal, int limit, JournalEntryFn fn, void *context) {
+    JournalEntry entry;
+    int count = 0;
+    while (count < limit && sd_journal_api.next(journal) > 0) {
+        read_journal_entry(journal, &entry);
+        fn(&entry, context);
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Opens the system journal, or one journal file, and positions it so that the next
+ * sd_journal_next returns the first entry after cursor, or the first of the last backlog entries
+ * matches is an optional NULL-terminated list of FIELD=value filters; values of one field are OR'ed
+ * Returns NULL if libsystemd or the journal is unavailable
+ */
+sd_journal *open_journal_at(const char *cursor, const char *file, int backlog, const char *const *matches) {
+    sd_journal *journal = NULL;
+    const char *files[] = {file, NULL};
+
+    if (load_sd_journal() != 0) return NULL;
+    if ((file ? sd_journal_api.open_files(&journal, files, 0) : sd_journal_api.open(&journal, 0)) < 0) return NULL;
+    for (int i = 0; matches && matches[i]; i++) sd_journal_api.add_match(journal, matches[i], 0);
+
+    if (cursor && sd_journal_api.seek_cursor(journal, cursor) >= 0) {
+        // Seeking lands on the cursor's entry, or the nearest one if it has been rotated away;
+        // in the latter case step back so that entry is returned too
+        if (sd_journal_api.next(journal) > 0 && sd_journal_api.test_cursor(journal, cursor) <= 0) {
+            sd_journal_api.previous(journal);
+        }
+    } else {
+        sd_journal_api.seek_tail(journal);
+        if (sd_journal_api.previous_skip(journal, backlog + 1) <= backlog) sd_journal_api.seek_head(journal);
+    }
+    return journal;
+}
+
+/**
+ * Reads the journal through sd-journal: the last entries, or only those after cursor
+ * With follow it then blocks in sd_journal_wait and prints entries as they are written
+ * Returns -1 if libsystemd or the journal is unavailable
+ */
+int read_journal_native(const char *cursor, int follow, const char *file, int backlog) {
+    sd_journal *journal = open_journal_at(cursor, file, backlog, NULL);
+    if (!journal) return -1;
+
+    int printed = read_journal_entries(journal, cursor ? JOURNAL_MAX_BATCH : backlog, print_journal_entry, NULL);
+    if (printed > 0 || cursor) print_journal_cursor(journal);
+    fflush(stdout);
+
+    if (follow) {
+        signal(SIGINT, handle_signal);
+        signal(SIGTERM, handle_signal);
+        while (!stop && sd_journal_api.wait(journal, JOURNAL_WAIT_USEC) >= 0) {
+            while (read_journal_entries(journal, JOURNAL_MAX_BATCH, print_journal_entry, NULL) > 0) {
+                print_journal_cursor(journal);
+                fflush(stdout);
+            }
+        }
+    }
+
+    sd_journal_api.close(journal);
+    return 0;
+}
+
+// Last 30 journal entries for the log viewer
+int print_recent_journal() {
+    return read_journal_native(NULL, 0, NULL, 30);
+}
+
+/**
+ * Journal reader for the logs page: sd-journal when libsystemd is present, journalctl otherwise
+ * A cursor from a previous call limits the output to newer entries; follow keeps tailing
+ */
+void read_journal_logs(const char *cursor, int follow, const char *file) {
+    if (read_journal_native(cursor, follow, file, JOURNAL_BACKLOG) == 0) return;
+    if (follow) {
+        printf("Error: following the journal requires libsystemd\n");
+        return;
+    }
+
+    char after[512];
+    const char *argv[] = {"journalctl", "--no-pager", "--show-cursor", "-n", "300", NULL, NULL, NULL};
+    int argc = 5;
+    if (cursor) {
+        snprintf(after, sizeof(after), "--after-cursor=%s", cursor);
+        argv[3] = after;
+        argc = 4;
+    }
+    if (file) {
+        argv[argc++] = "--file";
+        argv[argc++] = file;
+    }
+    argv[argc] = NULL;
+
+    SpawnedCommand cmd;
+    SpawnedCommand *list[1] = {&cmd};
+
+    memset(&cmd, 0, sizeof(cmd));
+    cmd.argv = argv;
+    cmd.timeout_ms = 30000;
+    cmd.stderr_mode = SPAWN_STDERR_MERGE;
+    run_spawned_commands(list, 1, 1);
+
+    if (cmd.status == -1 && !cmd.timed_out) {
+        printf("Error: Failed to run journalctl command\n");
+        fflush(stdout);
+        return;
+    }
+
+    // Print the output line by line; --show-cursor ends it with "-- cursor: ..."
+    for (char *line = cmd.out.data; line && *line; ) {
+        char *end = strchr(line, '\n');
+        if (end) *end = '\0';
+        if (strncmp(line, "-- cursor: ", 11) == 0) printf("Cursor: %s\n", line + 11);
+        else printf("Journal: %s\n", line);
+        if (!end) break;
+        line = end + 1;
+    }
+
+    // Report how the command ended
+    if (cmd.timed_out) {
+        fprintf(stderr, "Error: journalctl did not finish within %d seconds and was stopped.\n", cmd.timeout_ms / 1000);
+    } else if (WIFSIGNALED(cmd.status)) {
+        fprintf(stderr, "Error: journalctl was killed by signal %d (%s)\n", WTERMSIG(cmd.status), strsignal(WTERMSIG(cmd.status)));
+    } else if (WIFEXITED(cmd.status) && WEXITSTATUS(cmd.status) != 0) {
+        fprintf(stderr, "Error: journalctl command failed with exit status %d\n", WEXITSTATUS(cmd.status));
+        fprintf(stderr, "This may indicate permission issues or journalctl errors.\n");
+    }
+
+    free_string_buffer(&cmd.out);
+    fflush(stdout);
+}
+// Calculate total time computer was on in different states
+long get_total_jiffies() {
+    FILE *f = fopen("/proc/stat", "r");
+    if (!f) {
+        printf("Error: Could not open /proc/stat\n");
+        return -1;
+    }
+    
+    char cpu[16];
+    long user, nice, system, idle, iowait, irq, softirq, steal;
+    
+    int result = fscanf(f, "%s %ld %ld %ld %ld %ld %ld %ld %ld",
+                       cpu, &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
+    
+    fclose(f);
+    
+    if (result != 9) {
+        printf("Error: Failed to parse /proc/stat content\n");
+        return -1;
+    }
+    
+    long total_jiffies = user + nice + system + idle + iowait + irq + softirq + steal;
+    
+    printf("CPU Statistics from /proc/stat:\n");
+    printf("CPU: %s\n", cpu);
+    printf("User: %ld\n", user);
+    printf("Nice: %ld\n", nice);
+    printf("System: %ld\n", system);
+    printf("Idle: %ld\n", idle);
+    printf("IOWait: %ld\n", iowait);
+    printf("IRQ: %ld\n", irq);
+    printf("SoftIRQ: %ld\n", softirq);
+    printf("Steal: %ld\n", steal);
+    printf("Total Jiffies: %ld\n", total_jiffies);
+    printf("------------------------------\n");
+    
+    return total_jiffies;
+}
+
+void show_system_uptime_and_cpu_sleep_time() {
+    FILE *fp = fopen("/proc/uptime", "r");
+    if (!fp) {
+        perror("Error opening /proc/uptime");
+        return;
+    }
+
+    double uptime_seconds, sleep_seconds;
+    if (fscanf(fp, "%lf %lf", &uptime_seconds, &sleep_seconds) != 2) {
+        fprintf(stderr, "Error reading from /proc/uptime\n");
+        fclose(fp);
+        return;
+    }
+
+    fclose(fp);
+
+    printf("System Uptime: %.2f seconds\n", uptime_seconds);
+    printf("CPU Sleep Time: %.2f seconds\n", sleep_seconds);
+}
+
+void display_section_header(const char *title) {
+    printf("\n\033[1;34m%s\033[0m\n", title);
+    printf("\033[1;32m");
+    for (int i = 0; i < strlen(title); i++) printf("=");
+    printf("\033[0m\n");
+}
+
+void display_section(const char *title, const StringBuffer *content) {
+    display_section_header(title);
+
+    if (content->length > 0) {
+        fwrite(content->data, 1, content->length, stdout);
+        printf("\n");
+    } else {
+        printf("Information not available\n");
+    }
+}
+
+#define INVENTORY_CACHE_VERSION 1
+#define INVENTORY_CACHE_SLOTS 8
+
+/**
+ * Boot-scoped cache of static inventory text, kept as named blobs in memory and on disk
+ * Valid while the boot id, the hotplug stamp and its source file mtimes are unchanged
+ */
+typedef struct {
+    char name[32];
+    StringBuffer key;       // Boot id and source stamps the blobs were built from
+    StringBuffer blobs;     // "<name> <length>\n<bytes>\n" records
+    int dirty;
+} InventoryCache;
+
+static InventoryCache inventory_caches[INVENTORY_CACHE_SLOTS];
+
+static void append_source_stamp(StringBuffer *key, const char *path) {
+    struct stat st;
+    if (stat(path, &st) == 0) {
+        append_format(key, "src %s %lld.%09ld %lld\n", path, (long long)st.st_mtim.tv_sec,
+                      st.st_mtim.tv_nsec, (long long)st.st_size);
+    } else {
+        append_format(key, "src %s missing\n", path);
+    }
+}
+
+/**
+ * Builds the validity key for a cache over the given NULL-terminated source list
+ * The hotplug stamp touched by the uevent listener is always part of it
+ */
+static void build_inventory_key(const char *const *sources, StringBuffer *key) {
+    char boot_id[64], stamp[512];
+
+    if (read_sysfs_string("/proc/sys/kernel/random/boot_id", boot_id, sizeof(boot_id)) != 0) {
+        snprintf(boot_id, sizeof(boot_id), "unknown");
+    }
+    append_format(key, "SMINV %d %s\n", INVENTORY_CACHE_VERSION, boot_id);
+
+    if (build_user_path("XDG_CACHE_HOME", ".cache", "inventory.stamp", stamp, sizeof(stamp)) == 0) {
+        append_source_stamp(key, stamp);
+    }
+    for (int i = 0; sources && sources[i]; i++) append_source_stamp(key, sources[i]);
+    append_string(key, "--\n");
+}
+
+static int inventory_cache_path(const char *name, char *path, size_t size) {
+    char file[64];
+    snprintf(file, sizeof(file), "inventory-%s.cache", name);
+    return build_user_path("XDG_CACHE_HOME", ".cache", file, path, size);
+}
+
+/**
+ * Returns the named cache, loading it from disk the first time
+ * Blobs are dropped whenever the freshly computed key differs from the stored one
+ */
+InventoryCache *open_inventory_cache(const char *name, const char *const *sources) {
+    InventoryCache *cache = NULL;
+    for (int i = 0; i < INVENTORY_CACHE_SLOTS && !cache; i++) {
+        if (strcmp(inventory_caches[i].name, name) == 0) cache = &inventory_caches[i];
+    }
+
+    StringBuffer key = {0};
+    build_inventory_key(sources, &key);
+    if (!key.data) return NULL;
+
+    if (cache) {
+        // Already in memory; only a changed source invalidates it
+        if (cache->key.length != key.length || memcmp(cache->key.data, key.data, key.length) != 0) {
+            free_string_buffer(&cache->key);
+            free_string_buffer(&cache->blobs);
+            cache->key = key;
+        } else {
+            free_string_buffer(&key);
+        }
+        return cache;
+    }
+
+    for (int i = 0; i < INVENTORY_CACHE_SLOTS && !cache; i++) {
+        if (!inventory_caches[i].name[0]) cache = &inventory_caches[i];
+    }
+    if (!cache) {
+        free_string_buffer(&key);
+        return NULL;
+    }
+    snprintf(cache->name, sizeof(cache->name), "%s", name);
+    cache->key = key;
+
+    char path[512];
+    FILE *fp = inventory_cache_path(name, path, sizeof(path)) == 0 ? fopen(path, "r") : NULL;
+    if (!fp) return cache;
+
+    StringBuffer file = {0};
+    char chunk[8192];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), fp)) > 0) append_string_buffer(&file, chunk, n);
+    fclose(fp);
+
+    if (file.length >= key.length && memcmp(file.data, key.data, key.length) == 0) {
+        append_string_buffer(&cache->blobs, file.data + key.length, file.length - key.length);
+    }
+    free_string_buffer(&file);
+    return cache;
+}
+
+/**
+ * Walks the blob records, stopping at the named one
+ * Returns its offset and sets *data and *length, or -1 if absent
+ */
+static long find_inventory_blob(const InventoryCache *cache, const char *blob, const char **data, size_t *length) {
+    size_t at = 0;
+    while (at < cache->blobs.length) {
+        const char *record = cache->blobs.data + at;
+        const char *newline = memchr(record, '\n', cache->blobs.length - at);
+        char name[64];
+        size_t size;
+        if (!newline || sscanf(record, "%63s %zu", name, &size) != 2) return -1;
+
+        size_t body = newline + 1 - cache->blobs.data;
+        if (body + size + 1 > cache->blobs.length) return -1;
+        if (strcmp(name, blob) == 0) {
+            *data = cache->blobs.data + body;
+            *length = size;
+            return at;
+        }
+        at = body + size + 1;
+    }
+    return -1;
+}
+
+int get_inventory_blob(const InventoryCache *cache, const char *blob, StringBuffer *out) {
+    const char *data;
+    size_t length;
+    if (!cache || find_inventory_blob(cache, blob, &data, &length) < 0) return -1;
+    return append_string_buffer(out, data, length);
+}
+
+void put_inventory_blob(InventoryCache *cache, const char *blob, const char *data, size_t length) {
+    const char *old;
+    size_t old_length;
+    if (!cache) return;
+
+    long at = find_inventory_blob(cache, blob, &old, &old_length);
+    if (at >= 0) {
+        // Cut the stale record out before appending the new one
+        size_t end = old + old_length + 1 - cache->blobs.data;
+        memmove(cache->blobs.data + at, cache->blobs.data + end, cache->blobs.length - end);
+        cache->blobs.length -= end - at;
+    }
+    append_format(&cache->blobs, "%s %zu\n", blob, length);
+    append_string_buffer(&cache->blobs, data, length);
+    append_string(&cache->blobs, "\n");
+    cache->dirty = 1;
+}
+
+/**
+ * Writes a changed cache to its file through a rename, so readers never see a partial cache
+ */
+int flush_inventory_cache(InventoryCache *cache) {
+    char path[512], temp[520];
+    if (!cache || !cache->dirty) return 0;
+    if (inventory_cache_path(cache->name, path, sizeof(path)) != 0 || ensure_parent_directory(path) != 0) return -1;
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid());
+
+    FILE *fp = fopen(temp, "w");
+    if (!fp) return -1;
+    fwrite(cache->key.data, 1, cache->key.length, fp);
+    if (cache->blobs.length) fwrite(cache->blobs.data, 1, cache->blobs.length, fp);
+    if (fclose(fp) != 0 || rename(temp, path) != 0) {
+        unlink(temp);
+        return -1;
+    }
+    cache->dirty = 0;
+    return 0;
+}
+
+/**
+ * Marks every inventory cache stale after a hotplug event
+ */
+void touch_inventory_stamp() {
+    char path[512];
+    if (build_user_path("XDG_CACHE_HOME", ".cache", "inventory.stamp", path, sizeof(path)) != 0 ||
+        ensure_parent_directory(path) != 0) return;
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    futimens(fd, NULL);
+    close(fd);
+}
+
+/**
+ * Runs a report that only prints static inventory, replaying its cached output when still valid
+ * On a miss the report writes into a memory stream that is then printed and stored
+ */
+void run_cached_report(const char *name, const char *const *sources, void (*report)(FILE *out)) {
+    InventoryCache *cache = open_inventory_cache(name, sources);
+    StringBuffer output = {0};
+
+    if (get_inventory_blob(cache, "output", &output) == 0) {
+        fwrite(output.data, 1, output.length, stdout);
+        free_string_buffer(&output);
+        return;
+    }
+
+    char *text = NULL;
+    size_t length = 0;
+    FILE *capture = cache ? open_memstream(&text, &length) : NULL;
+    if (!capture) {
+        report(stdout);
+        return;
+    }
+
+    report(capture);
+    fclose(capture);
+
+    fwrite(text, 1, length, stdout);
+    put_inventory_blob(cache, "output", text, length);
+    flush_inventory_cache(cache);
+    free(text);
+}
+
+#define DMI_ID_PATH "/sys/class/dmi/id"
+#define SMBIOS_TABLE_PATH "/sys/firmware/dmi/tables/DMI"
+
+// Prints "\tLabel: value" for each readable /sys/class/dmi/id attribute
+static void append_dmi_fields(StringBuffer *out, const char *title, const char *const fields[][2], int count) {
+    char path[PATH_MAX], value[256];
+    int found = 0;
+
+    for (int i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), DMI_ID_PATH "/%s", fields[i][0]);
+        if (read_sysfs_string(path, value, sizeof(value)) != 0) continue;  // Serials are root-only
+        if (!found++) append_format(out, "%s\n", title);
+        append_format(out, "\t%s: %s\n", fields[i][1], value);
+    }
+
+    if (!found) append_format(out, "%s\n\tDMI information not available\n", title);
+}
+
+void collect_baseboard_info(StringBuffer *out) {
+    static const char *const fields[][2] = {
+        {"board_vendor", "Manufacturer"}, {"board_name", "Product Name"},
+        {"board_version", "Version"}, {"board_serial", "Serial Number"},
+        {"board_asset_tag", "Asset Tag"},
+    };
+    append_dmi_fields(out, "Base Board Information", fields, sizeof(fields) / sizeof(fields[0]));
+}
+
+void collect_bios_info(StringBuffer *out) {
+    static const char *const fields[][2] = {
+        {"bios_vendor", "Vendor"}, {"bios_version", "Version"},
+        {"bios_date", "Release Date"}, {"bios_release", "BIOS Revision"},
+        {"ec_firmware_release", "Firmware Revision"},
+    };
+    append_dmi_fields(out, "BIOS Information", fields, sizeof(fields) / sizeof(fields[0]));
+}
+
+// SMBIOS 7.4.1 chassis types, indexed by type code
+static const char *const chassis_types[] = {
+    NULL, "Other", "Unknown", "Desktop", "Low Profile Desktop", "Pizza Box", "Mini Tower",
+    "Tower", "Portable", "Laptop", "Notebook", "Hand Held", "Docking Station", "All In One",
+    "Sub Notebook", "Space-saving", "Lunch Box", "Main Server Chassis", "Expansion Chassis",
+    "Sub Chassis", "Bus Expansion Chassis", "Peripheral Chassis", "RAID Chassis",
+    "Rack Mount Chassis", "Sealed-case PC", "Multi-system", "CompactPCI", "AdvancedTCA",
+    "Blade", "Blade Enclosing", "Tablet", "Convertible", "Detachable", "IoT Gateway",
+    "Embedded PC", "Mini PC", "Stick PC",
+};
+
+void collect_chassis_info(StringBuffer *out) {
+    static const char *const fields[][2] = {
+        {"chassis_vendor", "Manufacturer"}, {"chassis_version", "Version"},
+        {"chassis_serial", "Serial Number"}, {"chassis_asset_tag", "Asset Tag"},
+    };
+    append_dmi_fields(out, "Chassis Information", fields, sizeof(fields) / sizeof(fields[0]));
+
+    char value[32];
+    if (read_sysfs_string(DMI_ID_PATH "/chassis_type", value, sizeof(value)) == 0) {
+        int type = atoi(value) & 0x7F;  // Bit 7 is the lock flag
+        int known = type > 0 && type < (int)(sizeof(chassis_types) / sizeof(chassis_types[0]));
+        append_format(out, "\tType: %s\n", known ? chassis_types[type] : value);
+    }
+}
+
+/**
+ * One structure of the raw SMBIOS table: the formatted area plus its trailing string set
+ */
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+    const uint8_t *data;
+    const char *strings;
+    const char *strings_end;
+} SmbiosStructure;
+
+/**
+ * Steps to the structure at *offset and advances past its strings
+ * Returns 0 at end-of-table or on a malformed entry
+ */
+static int next_smbios_structure(const uint8_t *table, size_t size, size_t *offset, SmbiosStructure *s) {
+    size_t at = *offset;
+    if (at + 4 > size) return 0;
+
+    s->type = table[at];
+    s->length = table[at + 1];
+    if (s->length < 4 || at + s->length > size || s->type == 127) return 0;
+
+    // The string set ends with a double NUL
+    size_t end = at + s->length;
+    while (end + 1 < size && (table[end] != 0 || table[end + 1] != 0)) end++;
+    if (end + 1 >= size) return 0;
+
+    s->data = table + at;
+    s->strings = (const char *)table + at + s->length;
+    s->strings_end = (const char *)table + end + 1;
+    *offset = end + 2;
+    return 1;
+}
+
+static const char *smbios_string(const SmbiosStructure *s, uint8_t index) {
+    if (index == 0) return NULL;
+    const char *p = s->strings;
+    while (--index > 0 && p < s->strings_end) p += strlen(p) + 1;
+    return p < s->strings_end && *p ? p : NULL;
+}
+
+static uint16_t smbios_word(const SmbiosStructure *s, int offset) {
+    return s->data[offset] | s->data[offset + 1] << 8;
+}
+
+static uint32_t smbios_dword(const SmbiosStructure *s, int offset) {
+    return smbios_word(s, offset) | (uint32_t)smbios_word(s, offset + 2) << 16;
+}
+
+// SMBIOS 7.18.2 memory types and 7.18.1 form factors, indexed by code
+static const char *const memory_types[] = {
+    NULL, "Other", "Unknown", "DRAM", "EDRAM", "VRAM", "SRAM", "RAM", "ROM", "Flash",
+    "EEPROM", "FEPROM", "EPROM", "CDRAM", "3DRAM", "SDRAM", "SGRAM", "RDRAM", "DDR",
+    "DDR2", "DDR2 FB-DIMM", NULL, NULL, NULL, "DDR3", "FBD2", "DDR4", "LPDDR", "LPDDR2",
+    "LPDDR3", "LPDDR4", "Logical non-volatile device", "HBM", "HBM2", "DDR5", "LPDDR5", "HBM3",
+};
+
+static const char *const memory_form_factors[] = {
+    NULL, "Other", "Unknown", "SIMM", "SIP", "Chip", "DIP", "ZIP", "Proprietary Card",
+    "DIMM", "TSOP", "Row Of Chips", "RIMM", "SODIMM", "SRIMM", "FB-DIMM", "Die", "CAMM",
+};
+
+static const char *smbios_enum(const char *const *names, size_t count, uint8_t code) {
+    return code < count && names[code] ? names[code] : "Unknown";
+}
+
+static void append_smbios_string(StringBuffer *out, const char *label, const SmbiosStructure *s, int offset) {
+    if (s->length <= offset) return;
+    const char *value = smbios_string(s, s->data[offset]);
+    append_format(out, "\t%s: %s\n", label, value ? value : "Not Specified");
+}
+
+static void append_memory_size(StringBuffer *out, const char *label, uint64_t mb) {
+    if (mb >= 1024 && mb % 1024 == 0) append_format(out, "\t%s: %llu GB\n", label, (unsigned long long)(mb / 1024));
+    else append_format(out, "\t%s: %llu MB\n", label, (unsigned long long)mb);
+}
+
+/**
+ * Formats the memory array (type 16) and DIMM (type 17) structures of a raw SMBIOS table
+ * Output follows the layout of "dmidecode -t memory"
+ */
+void format_smbios_memory(const uint8_t *table, size_t size, StringBuffer *out) {
+    SmbiosStructure s;
+    size_t offset = 0;
+    int devices = 0;
+
+    while (next_smbios_structure(table, size, &offset, &s)) {
+        if (s.type == 16 && s.length >= 0x0F) {
+            uint32_t capacity_kb = smbios_dword(&s, 0x07);
+            uint64_t capacity = capacity_kb;
+            if (capacity_kb == 0x80000000 && s.length >= 0x17) {
+                capacity = (smbios_dword(&s, 0x0F) | (uint64_t)smbios_dword(&s, 0x13) << 32) / 1024;
+            }
+            append_string(out, "Physical Memory Array\n");
+            append_memory_size(out, "Maximum Capacity", capacity / 1024);
+            append_format(out, "\tNumber Of Devices: %u\n\n", smbios_word(&s, 0x0D));
+        } else if (s.type == 17 && s.length >= 0x15) {
+            devices++;
+            append_string(out, "Memory Device\n");
+
+            uint16_t size_field = smbios_word(&s, 0x0C);
+            if (size_field == 0) {
+                append_string(out, "\tSize: No Module Installed\n");
+            } else if (size_field == 0xFFFF) {
+                append_string(out, "\tSize: Unknown\n");
+            } else if (size_field == 0x7FFF && s.length >= 0x20) {
+                append_memory_size(out, "Size", smbios_dword(&s, 0x1C) & 0x7FFFFFFF);
+            } else if (size_field & 0x8000) {
+                append_format(out, "\tSize: %u kB\n", size_field & 0x7FFF);
+            } else {
+                append_memory_size(out, "Size", size_field);
+            }
+
+            append_format(out, "\tForm Factor: %s\n",
+                          smbios_enum(memory_form_factors, sizeof(memory_form_factors) / sizeof(memory_form_factors[0]), s.data[0x0E]));
+            append_smbios_string(out, "Locator", &s, 0x10);
+            append_smbios_string(out, "Bank Locator", &s, 0x11);
+            append_format(out, "\tType: %s\n",
+                          smbios_enum(memory_types, sizeof(memory_types) / sizeof(memory_types[0]), s.data[0x12]));
+
+            if (s.length >= 0x17) {
+                uint32_t speed = smbios_word(&s, 0x15);
+                if (speed == 0xFFFF && s.length >= 0x58) speed = smbios_dword(&s, 0x54);
+                if (speed) append_format(out, "\tSpeed: %u MT/s\n", speed);
+                else append_string(out, "\tSpeed: Unknown\n");
+            }
+            append_smbios_string(out, "Manufacturer", &s, 0x17);
+            append_smbios_string(out, "Serial Number", &s, 0x18);
+            append_smbios_string(out, "Part Number", &s, 0x1A);
+            if (s.length >= 0x22 && smbios_word(&s, 0x20)) {
+                append_format(out, "\tConfigured Memory Speed: %u MT/s\n", smbios_word(&s, 0x20));
+            }
+            append_string(out, "\n");
+        }
+    }
+
+    if (!devices) append_string(out, "No memory devices found in SMBIOS table\n");
+}
+
+void collect_memory_devices(StringBuffer *out) {
+    int fd = open(SMBIOS_TABLE_PATH, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        append_format(out, "SMBIOS table not readable: %s\n", strerror(errno));
+        return;
+    }
+
+    // sysfs reports no useful st_size for the table, so read until EOF
+    StringBuffer table = {0};
+    for (;;) {
+        if (reserve_string_buffer(&table, 4096) != 0) break;
+        ssize_t n = read(fd, table.data + table.length, table.capacity - table.length - 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        table.length += n;
+    }
+    close(fd);
+
+    format_smbios_memory((const uint8_t *)table.data, table.length, out);
+    free_string_buffer(&table);
+}
+
+/**
+ * A PCI or USB id pair to be named from a pci.ids/usb.ids database
+ */
+typedef struct {
+    unsigned vendor;
+    unsigned device;
+    int base_class;     // -1 for USB, which keeps classes per interface
+    int sub_class;
+    char vendor_name[128];
+    char device_name[192];
+    char class_name[96];
+} HardwareId;
+
+static int parse_ids_hex(const char *p, int digits, unsigned *value) {
+    *value = 0;
+    for (int i = 0; i < digits; i++) {
+        if (!isxdigit((unsigned char)p[i])) return -1;
+        *value = *value * 16 + (isdigit((unsigned char)p[i]) ? p[i] - '0' : (tolower((unsigned char)p[i]) - 'a' + 10));
+    }
+    return 0;
+}
+
+/**
+ * Names every entry in one pass over the first ids database found
+ * Entries not in the database keep empty names
+ */
+void resolve_hardware_ids(const char *const *paths, HardwareId *ids, int count) {
+    FILE *fp = NULL;
+    for (int i = 0; paths[i] && !fp; i++) fp = fopen(paths[i], "r");
+    if (!fp) return;
+
+    char *line = NULL;
+    size_t line_size = 0;
+    ssize_t len;
+    long vendor = -1, class_code = -1;
+
+    while ((len = getline(&line, &line_size, fp)) > 0) {
+        line[strcspn(line, "\n")] = '\0';
+        unsigned id;
+
+        if (line[0] == '#' || line[0] == '\0') continue;
+
+        if (line[0] != '\t') {
+            vendor = class_code = -1;
+            if (line[0] == 'C' && line[1] == ' ' && parse_ids_hex(line + 2, 2, &id) == 0) {
+                class_code = id;
+                for (int i = 0; i < count; i++) {
+                    if (ids[i].base_class == (int)id) snprintf(ids[i].class_name, sizeof(ids[i].class_name), "%s", line + 6);
+                }
+            } else if (parse_ids_hex(line, 4, &id) == 0 && line[4] == ' ') {
+                vendor = id;
+                for (int i = 0; i < count; i++) {
+                    if (ids[i].vendor == id) snprintf(ids[i].vendor_name, sizeof(ids[i].vendor_name), "%s", line + 6);
+                }
+            }
+        } else if (line[1] != '\t') {
+            // Device under a vendor, or subclass under a class
+            if (vendor >= 0 && parse_ids_hex(line + 1, 4, &id) == 0) {
+                for (int i = 0; i < count; i++) {
+                    if (ids[i].vendor == vendor && ids[i].device == id) {
+                        snprintf(ids[i].device_name, sizeof(ids[i].device_name), "%s", line + 7);
+                    }
+                }
+            } else if (class_code >= 0 && parse_ids_hex(line + 1, 2, &id) == 0) {
+                for (int i = 0; i < count; i++) {
+                    if (ids[i].base_class == class_code && ids[i].sub_class == (int)id) {
+                        snprintf(ids[i].class_name, sizeof(ids[i].class_name), "%s", line + 5);
+                    }
+                }
+            }
+        }
+    }
+
+    free(line);
+    fclose(fp);
+}
+
+static const char *const pci_ids_paths[] = {
+    "/usr/share/hwdata/pci.ids", "/usr/share/misc/pci.ids", "/usr/share/pci.ids", NULL
+};
+static const char *const usb_ids_paths[] = {
+    "/usr/share/hwdata/usb.ids", "/usr/share/misc/usb.ids", "/var/lib/usbutils/usb.ids", "/usr/share/usb.ids", NULL
+};
+
+static int read_sysfs_hex(const char *dir, const char *name, unsigned *value) {
+    char path[PATH_MAX], text[32];
+    if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path)) return -1;
+    if (read_sysfs_string(path, text, sizeof(text)) != 0) return -1;
+    *value = strtoul(text, NULL, 16);
+    return 0;
+}
+
+/**
+ * Lists /sys/bus/pci/devices in lspci's one-line format
+ */
+void collect_pci_devices(StringBuffer *out) {
+    struct dirent **entries;
+    int n = scandir("/sys/bus/pci/devices", &entries, NULL, alphasort);
+    if (n < 0) {
+        append_string(out, "PCI bus not available\n");
+        return;
+    }
+
+    HardwareId *ids = calloc(n ? n : 1, sizeof(HardwareId));
+    unsigned *revisions = calloc(n ? n : 1, sizeof(unsigned));
+    int count = 0;
+
+    for (int i = 0; i < n; i++) {
+        char dir[PATH_MAX];
+        unsigned class_code;
+        snprintf(dir, sizeof(dir), "/sys/bus/pci/devices/%s", entries[i]->d_name);
+        if (entries[i]->d_name[0] == '.' || !ids || !revisions ||
+            read_sysfs_hex(dir, "class", &class_code) != 0 ||
+            read_sysfs_hex(dir, "vendor", &ids[count].vendor) != 0 ||
+            read_sysfs_hex(dir, "device", &ids[count].device) != 0) {
+            free(entries[i]);
+            entries[i] = NULL;
+            continue;
+        }
+        ids[count].base_class = class_code >> 16 & 0xFF;
+        ids[count].sub_class = class_code >> 8 & 0xFF;
+        read_sysfs_hex(dir, "revision", &revisions[count]);
+        entries[count++] = entries[i];
+    }
+
+    resolve_hardware_ids(pci_ids_paths, ids, count);
+
+    for (int i = 0; i < count; i++) {
+        // lspci hides the domain when it is 0000
+        const char *address = entries[i]->d_name;
+        if (strncmp(address, "0000:", 5) == 0) address += 5;
+
+        append_format(out, "%s ", address);
+        if (ids[i].class_name[0]) append_format(out, "%s: ", ids[i].class_name);
+        else append_format(out, "Class %02x%02x: ", ids[i].base_class, ids[i].sub_class);
+        if (ids[i].vendor_name[0]) append_string(out, ids[i].vendor_name);
+        else append_format(out, "Device %04x", ids[i].vendor);
+        if (ids[i].device_name[0]) append_format(out, " %s", ids[i].device_name);
+        else append_format(out, "%s%04x", ids[i].vendor_name[0] ? " Device " : ":", ids[i].device);
+        if (revisions[i]) append_format(out, " (rev %02x)", revisions[i]);
+        append_string(out, "\n");
+        free(entries[i]);
+    }
+
+    free(entries);
+    free(ids);
+    free(revisions);
+}
+
+typedef struct {
+    unsigned bus;
+    unsigned device;
+    unsigned vendor_id;
+    unsigned product_id;
+    char manufacturer[128];
+    char product[128];
+} UsbDevice;
+
+static int compare_usb_devices(const void *a, const void *b) {
+    const UsbDevice *x = a, *y = b;
+    if (x->bus != y->bus) return x->bus < y->bus ? -1 : 1;
+    return x->device < y->device ? -1 : x->device > y->device;
+}
+
+static void read_usb_attribute(const char *device, const char *name, char *buf, size_t size) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/bus/usb/devices/%s/%s", device, name);
+    if (read_sysfs_string(path, buf, size) != 0) buf[0] = '\0';
+}
+
+/**
+ * Lists /sys/bus/usb/devices in lsusb's one-line format
+ */
+void collect_usb_devices(StringBuffer *out) {
+    DIR *dir = opendir("/sys/bus/usb/devices");
+    if (!dir) {
+        append_string(out, "USB bus not available\n");
+        return;
+    }
+
+    UsbDevice *devices = NULL;
+    int count = 0, capacity = 0;
+    struct dirent *entry;
+
+    while ((entry = readdir(dir)) != NULL) {
+        // Interfaces ("1-1:1.0") sit alongside devices; only devices have ids
+        if (entry->d_name[0] == '.' || strchr(entry->d_name, ':')) continue;
+
+        if (count == capacity) {
+            int grown_capacity = capacity ? capacity * 2 : 32;
+            UsbDevice *grown = realloc(devices, grown_capacity * sizeof(UsbDevice));
+            if (!grown) break;
+            devices = grown;
+            capacity = grown_capacity;
+        }
+
+        UsbDevice *device = &devices[count];
+        char text[32];
+        read_usb_attribute(entry->d_name, "idVendor", text, sizeof(text));
+        if (!text[0]) continue;
+        device->vendor_id = strtoul(text, NULL, 16);
+        read_usb_attribute(entry->d_name, "idProduct", text, sizeof(text));
+        device->product_id = strtoul(text, NULL, 16);
+        read_usb_attribute(entry->d_name, "busnum", text, sizeof(text));
+        device->bus = atoi(text);
+        read_usb_attribute(entry->d_name, "devnum", text, sizeof(text));
+        device->device = atoi(text);
+        read_usb_attribute(entry->d_name, "manufacturer", device->manufacturer, sizeof(device->manufacturer));
+        read_usb_attribute(entry->d_name, "product", device->product, sizeof(device->product));
+        count++;
+    }
+    closedir(dir);
+
+    if (count == 0) {
+        append_string(out, "No USB devices found\n");
+        free(devices);
+        return;
+    }
+
+    qsort(devices, count, sizeof(UsbDevice), compare_usb_devices);
+
+    HardwareId *ids = calloc(count, sizeof(HardwareId));
+    if (ids) {
+        for (int i = 0; i < count; i++) {
+            ids[i].vendor = devices[i].vendor_id;
+            ids[i].device = devices[i].product_id;
+            ids[i].base_class = -1;
+        }
+        resolve_hardware_ids(usb_ids_paths, ids, count);
+    }
+
+    // Database names first, as lsusb does, then the device's own strings
+    for (int i = 0; i < count; i++) {
+        const UsbDevice *d = &devices[i];
+        const char *vendor = ids && ids[i].vendor_name[0] ? ids[i].vendor_name : d->manufacturer;
+        const char *product = ids && ids[i].device_name[0] ? ids[i].device_name : d->product;
+        append_format(out, "Bus %03u Device %03u: ID %04x:%04x %s%s%s\n", d->bus, d->device,
+                      d->vendor_id, d->product_id, vendor, vendor[0] && product[0] ? " " : "", product);
+    }
+
+    free(ids);
+    free(devices);
+}
+
+/**
+ * Formats /proc/modules the way lsmod does
+ */
+void collect_kernel_modules(StringBuffer *out) {
+    FILE *fp = fopen("/proc/modules", "r");
+    if (!fp) {
+        append_format(out, "Kernel modules not available: %s\n", strerror(errno));
+        return;
+    }
+
+    char line[4096], name[64], deps[4000];
+    unsigned long size;
+    int used;
+
+    append_string(out, "Module                  Size  Used by\n");
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%63s %lu %d %3999s", name, &size, &used, deps) != 4) continue;
+        size_t len = strlen(deps);
+        if (strcmp(deps, "-") == 0) deps[0] = '\0';
+        else if (len > 0 && deps[len - 1] == ',') deps[len - 1] = '\0';
+        append_format(out, "%-19s %8lu  %d%s%s\n", name, size, used, deps[0] ? " " : "", deps);
+    }
+
+    fclose(fp);
+}
+
+#define STATVFS_TIMEOUT_MS 2000
+#define FILESYSTEM_SAMPLE_INTERVAL 60
+#define FILL_RATE_WINDOW 86400
+
+// One mounted filesystem from /proc/self/mountinfo with its statvfs numbers
+typedef struct {
+    char source[128];
+    char mountpoint[256];
+    char fstype[32];
+    unsigned long long device;  // major:minor from mountinfo, as major << 32 | minor
+    int read_only;
+    int status;                 // 0 ok, -1 statvfs failed, 1 timed out
+    unsigned long long total_bytes;
+    unsigned long long free_bytes;
+    unsigned long long avail_bytes;
+    unsigned long long total_inodes;
+    unsigned long long free_inodes;
+} FilesystemUsage;
+
+// Kernel interfaces that are mounted like filesystems but hold no user data
+static const char *const pseudo_filesystems[] = {
+    "proc", "sysfs", "cgroup", "cgroup2", "devpts", "securityfs", "pstore", "bpf", "tracefs",
+    "debugfs", "configfs", "fusectl", "mqueue", "hugetlbfs", "autofs", "binfmt_misc", "efivarfs",
+    "rpc_pipefs", "nsfs", "selinuxfs", "ramfs", "fuse.gvfsd-fuse", "fuse.portal", NULL
+};
+
+// Undoes the octal escapes (\040 for a space) the kernel uses in mountinfo fields
+static void unescape_mount_field(char *text) {
+    char *out = text;
+    for (char *in = text; *in; out++) {
+        if (in[0] == '\\' && in[1] >= '0' && in[1] <= '3' && in[2] >= '0' && in[2] <= '7' && in[3] >= '0' && in[3] <= '7') {
+            *out = (char)((in[1] - '0') * 64 + (in[2] - '0') * 8 + (in[3] - '0'));
+            in += 4;
+        } else {
+            *out = *in++;
+        }
+    }
+    *out = '\0';
+}
+
+// True when the mount's root is the btrfs subvolume named in its superblock options
+static int is_subvolume_mount(const char *fstype, const char *root, const char *super_options) {
+    if (strcmp(fstype, "btrfs") != 0) return 0;
+    for (const char *option = super_options; option; option = strchr(option, ',')) {
+        if (*option == ',') option++;
+        if (strncmp(option, "subvol=", 7) == 0) {
+            size_t length = strcspn(option + 7, ",");
+            return strlen(root) == length && strncmp(root, option + 7, length) == 0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Lists the real mounts of this mount namespace, skipping pseudo filesystems and bind mounts
+ * A mount of a device already listed is a bind mount, unless it is the root of another btrfs subvolume
+ * A mountpoint mounted over more than once is listed once, as its topmost mount
+ * Returns the number of entries stored in *mounts (free with free()), or -1 if mountinfo cannot be read
+ */
+int list_filesystems(FilesystemUsage **mounts) {
+    FILE *fp = fopen("/proc/self/mountinfo", "r");
+    if (!fp) return -1;
+
+    FilesystemUsage *list = NULL;
+    int count = 0, capacity = 0;
+    char line[4096], root[1024], mountpoint[1024], options[256], fstype[64], source[256], super_options[1024];
+    unsigned int major, minor;
+
+    while (fgets(line, sizeof(line), fp)) {
+        // "id parent major:minor root mountpoint options [optional fields] - fstype source superoptions"
+        char *separator = strstr(line, " - ");
+        int fields = separator ? sscanf(separator + 3, "%63s %255s %1023s", fstype, source, super_options) : 0;
+        if (fields < 2 || sscanf(line, "%*d %*d %u:%u %1023s %1023s %255s", &major, &minor, root, mountpoint, options) != 5) {
+            continue;
+        }
+        if (fields == 2) super_options[0] = '\0';
+
+        int pseudo = 0;
+        for (int i = 0; pseudo_filesystems[i]; i++) {
+            if (strcmp(fstype, pseudo_filesystems[i]) == 0) pseudo = 1;
+        }
+        if (pseudo) continue;
+
+        unescape_mount_field(root);
+        unescape_mount_field(mountpoint);
+        unescape_mount_field(source);
+        // A cut-off mountpoint would be statvfs'ed as some other path
+        if (strlen(mountpoint) >= sizeof(list->mountpoint)) continue;
+
+        FilesystemUsage *fs = NULL;
+        int bind = 0;
+        unsigned long long device = (unsigned long long)major << 32 | minor;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(list[i].mountpoint, mountpoint) == 0) fs = &list[i];
+            else if (list[i].device == device) bind = 1;
+        }
+        if (bind && !fs && !is_subvolume_mount(fstype, root, super_options)) continue;
+        if (!fs) {
+            if (count == capacity) {
+                int grown_capacity = capacity ? capacity * 2 : 32;
+                FilesystemUsage *grown = realloc(list, grown_capacity * sizeof(FilesystemUsage));
+                if (!grown) break;
+                list = grown;
+                capacity = grown_capacity;
+            }
+            fs = &list[count++];
+        }
+        memset(fs, 0, sizeof(*fs));
+        // Source and type are only displayed, so they may be shortened
+        snprintf(fs->source, sizeof(fs->source), "%.127s", source);
+        memcpy(fs->mountpoint, mountpoint, strlen(mountpoint) + 1);
+        snprintf(fs->fstype, sizeof(fs->fstype), "%.31s", fstype);
+        fs->device = device;
+        fs->read_only = strncmp(options, "ro", 2) == 0 && (options[2] == '\0' || options[2] == ',');
+    }
+
+    fclose(fp);
+    *mounts = list;
+    return count;
+}
+
+/**
+ * A statvfs call on its own thread; whoever drops the last reference frees it, so a
+ * call stuck on a dead network mount can be abandoned without leaking or racing
+ */
+typedef struct StatvfsJob {
+    char path[256];
+    struct statvfs result;
+    int error;
+    int done;
+    int refs;
+    struct StatvfsJob *next;    // In the list of abandoned jobs
+} StatvfsJob;
+
+static pthread_mutex_t statvfs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t statvfs_cond = PTHREAD_COND_INITIALIZER;
+// Jobs that timed out, each holding a reference, so a hung mount gets no second thread until its call returns
+static StatvfsJob *abandoned_statvfs_jobs;
+
+// Called with statvfs_lock held
+static void release_statvfs_job(StatvfsJob *job) {
+    if (--job->refs == 0) free(job);
+}
+
+/**
+ * Drops abandoned jobs that have finished and reports whether path still has one running
+ * Called with statvfs_lock held
+ */
+static int statvfs_job_outstanding(const char *path) {
+    int outstanding = 0;
+    for (StatvfsJob **link = &abandoned_statvfs_jobs; *link; ) {
+        StatvfsJob *job = *link;
+        if (job->done) {
+            *link = job->next;
+            release_statvfs_job(job);
+            continue;
+        }
+        if (strcmp(job->path, path) == 0) outstanding = 1;
+        link = &job->next;
+    }
+    return outstanding;
+}
+
+static void *run_statvfs_job(void *arg) {
+    StatvfsJob *job = arg;
+    struct statvfs result;
+    int error = statvfs(job->path, &result) == 0 ? 0 : errno;
+
+    pthread_mutex_lock(&statvfs_lock);
+    job->result = result;
+    job->error = error;
+    job->done = 1;
+    pthread_cond_broadcast(&statvfs_cond);
+    release_statvfs_job(job);
+    pthread_mutex_unlock(&statvfs_lock);
+    return NULL;
+}
+
+/**
+ * Fills in sizes and inode counts of every mount, all statvfs calls running in parallel
+ * Mounts that have not answered within timeout_ms are marked timed out and left behind; while
+ * such a call is still stuck, later calls mark the mount timed out without trying it again
+ */
+void stat_filesystems(FilesystemUsage *mounts, int count, int timeout_ms) {
+    StatvfsJob **jobs = calloc(count ? count : 1, sizeof(StatvfsJob *));
+    if (!jobs) return;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, 64 * 1024);
+
+    for (int i = 0; i < count; i++) {
+        pthread_t thread;
+        pthread_mutex_lock(&statvfs_lock);
+        int outstanding = statvfs_job_outstanding(mounts[i].mountpoint);
+        pthread_mutex_unlock(&statvfs_lock);
+        if (outstanding) {
+            mounts[i].status = 1;
+            continue;
+        }
+        jobs[i] = calloc(1, sizeof(StatvfsJob));
+        if (!jobs[i]) continue;
+        snprintf(jobs[i]->path, sizeof(jobs[i]->path), "%s", mounts[i].mountpoint);
+        jobs[i]->refs = 2;
+        if (pthread_create(&thread, &attr, run_statvfs_job, jobs[i]) != 0) {
+            jobs[i]->error = EAGAIN;
+            jobs[i]->done = 1;
+            jobs[i]->refs = 1;
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&statvfs_lock);
+    for (;;) {
+        int pending = 0;
+        for (int i = 0; i < count; i++) {
+            if (jobs[i] && !jobs[i]->done) pending++;
+        }
+        if (pending == 0 || pthread_cond_timedwait(&statvfs_cond, &statvfs_lock, &deadline) == ETIMEDOUT) break;
+    }
+
+    for (int i = 0; i < count; i++) {
+        FilesystemUsage *fs = &mounts[i];
+        StatvfsJob *job = jobs[i];
+        if (!job) {
+            if (fs->status != 1) fs->status = -1;
+            continue;
+        }
+        if (!job->done) {
+            // The list keeps this reference until the call returns
+            fs->status = 1;
+            job->next = abandoned_statvfs_jobs;
+            abandoned_statvfs_jobs = job;
+            continue;
+        }
+        if (job->error) {
+            fs->status = -1;
+        } else {
+            const struct statvfs *st = &job->result;
+            fs->total_bytes = (unsigned long long)st->f_blocks * st->f_frsize;
+            fs->free_bytes = (unsigned long long)st->f_bfree * st->f_frsize;
+            fs->avail_bytes = (unsigned long long)st->f_bavail * st->f_frsize;
+            fs->total_inodes = st->f_files;
+            fs->free_inodes = st->f_ffree;
+        }
+        release_statvfs_job(job);
+    }
+    pthread_mutex_unlock(&statvfs_lock);
+    free(jobs);
+}
+
+/**
+ * Names a filesystem's fs_used series after its mountpoint
+ * A mountpoint too long for a series name keeps its start and ends in a hash of the whole path,
+ * so two long mountpoints sharing a prefix do not collide
+ */
+static void filesystem_series_name(const char *mountpoint, char *name, size_t size) {
+    int written = snprintf(name, size, "fs_used%s", mountpoint);
+    if (written >= 0 && (size_t)written < size) return;
+
+    uint32_t hash = 2166136261u;
+    for (const char *c = mountpoint; *c; c++) hash = (hash ^ (unsigned char)*c) * 16777619u;
+    char suffix[16];
+    int suffix_length = snprintf(suffix, sizeof(suffix), "~%08x", hash);
+    memcpy(name + size - 1 - suffix_length, suffix, suffix_length + 1);
+}
+
+// Filesystems whose usage is worth recording: writable and backed by storage
+static int track_filesystem_usage(const FilesystemUsage *fs) {
+    return fs->status == 0 && fs->total_bytes > 0 && !fs->read_only &&
+           strcmp(fs->fstype, "tmpfs") != 0 && strcmp(fs->fstype, "devtmpfs") != 0;
+}
+
+// Least-squares fit of used bytes over time, accumulated one history sample at a time
+typedef struct {
+    int64_t origin;
+    double count;
+    double sum_t;
+    double sum_v;
+    double sum_tt;
+    double sum_tv;
+    int64_t first;
+    int64_t last;
+} UsageTrend;
+
+static void fit_usage_sample(int64_t time, double value, void *context) {
+    UsageTrend *trend = context;
+    double t = (double)(time - trend->origin);
+    if (trend->count == 0) trend->first = time;
+    trend->last = time;
+    trend->count++;
+    trend->sum_t += t;
+    trend->sum_v += value;
+    trend->sum_tt += t * t;
+    trend->sum_tv += t * value;
+}
+
+/**
+ * Estimates the hours until a filesystem is full from the growth of its fs_used series over the last day
+ * Returns -1 when there is under an hour of history or usage is not growing
+ */
+double estimate_hours_until_full(const HistoryFile *hf, const FilesystemUsage *fs, time_t now) {
+    char name[HISTORY_NAME_SIZE];
+    filesystem_series_name(fs->mountpoint, name, sizeof(name));
+    int series_id = history_file_series_id((HistoryFile *)hf, name, 0);
+    if (series_id < 0) return -1;
+
+    UsageTrend trend = {.origin = now - FILL_RATE_WINDOW};
+    query_history_file(hf, series_id, now - FILL_RATE_WINDOW, now, fit_usage_sample, &trend);
+    if (trend.count < 3 || trend.last - trend.first < 3600) return -1;
+
+    double denominator = trend.count * trend.sum_tt - trend.sum_t * trend.sum_t;
+    if (denominator <= 0) return -1;
+    double slope = (trend.count * trend.sum_tv - trend.sum_t * trend.sum_v) / denominator;
+    if (slope <= 0) return -1;
+    return fs->avail_bytes / slope / 3600.0;
+}
+
+// Use% the way df computes it: used over used plus available, rounded up
+static int filesystem_use_percent(const FilesystemUsage *fs) {
+    unsigned long long used = fs->total_bytes - fs->free_bytes;
+    unsigned long long usable = used + fs->avail_bytes;
+    return usable ? (int)((used * 100 + usable - 1) / usable) : 0;
+}
+
+/**
+ * Disk usage table for the storage section, laid out like df -h -T
+ */
+void collect_filesystem_usage(StringBuffer *out) {
+    FilesystemUsage *mounts;
+    int count = list_filesystems(&mounts);
+    if (count < 0) return;
+    stat_filesystems(mounts, count, STATVFS_TIMEOUT_MS);
+
+    append_format(out, "%-20s %-10s %6s %6s %6s %5s %s\n", "Filesystem", "Type", "Size", "Used", "Avail", "Use%", "Mounted on");
+    for (int i = 0; i < count; i++) {
+        const FilesystemUsage *fs = &mounts[i];
+        char size[16], used[16], avail[16];
+        if (fs->status == 1) {
+            append_format(out, "%-20s %-10s %6s %6s %6s %5s %s (not responding)\n", fs->source, fs->fstype, "-", "-", "-", "-", fs->mountpoint);
+            continue;
+        }
+        if (fs->status != 0 || fs->total_bytes == 0) continue;
+        format_human_size(fs->total_bytes, size, sizeof(size));
+        format_human_size(fs->total_bytes - fs->free_bytes, used, sizeof(used));
+        format_human_size(fs->avail_bytes, avail, sizeof(avail));
+        append_format(out, "%-20s %-10s %6s %6s %6s %4d%% %s\n", fs->source, fs->fstype, size, used, avail,
+                      filesystem_use_percent(fs), fs->mountpoint);
+    }
+    free(mounts);
+}
+
+/**
+ * Prints bytes and inodes of every real mount, one line each, with a fill estimate where history allows
+ * A mount that does not answer statvfs in time (e.g. a dead NFS server) is reported instead of hanging
+ */
+void print_filesystem_usage() {
+    FilesystemUsage *mounts;
+    int count = list_filesystems(&mounts);
+    if (count < 0) {
+        printf("Error: Cannot read /proc/self/mountinfo\n");
+        return;
+    }
+    stat_filesystems(mounts, count, STATVFS_TIMEOUT_MS);
+
+    HistoryFile hf = HISTORY_FILE_INIT;
+    int have_history = open_history_file(&hf, 0) == 0;
+    time_t now = time(NULL);
+
+    for (int i = 0; i < count; i++) {
+        const FilesystemUsage *fs = &mounts[i];
+        printf("Filesystem %s: source=%s type=%s", fs->mountpoint, fs->source, fs->fstype);
+        if (fs->status == 1) {
+            printf(" status=timeout\n");
+            continue;
+        }
+        if (fs->status != 0) {
+            printf(" status=error\n");
+            continue;
+        }
+        printf(" bytes_total=%llu bytes_used=%llu bytes_free=%llu bytes_avail=%llu use=%d%%"
+               " inodes_total=%llu inodes_used=%llu inodes_free=%llu",
+               fs->total_bytes, fs->total_bytes - fs->free_bytes, fs->free_bytes, fs->avail_bytes,
+               filesystem_use_percent(fs), fs->total_inodes, fs->total_inodes - fs->free_inodes, fs->free_inodes);
+
+        double hours = have_history && track_filesystem_usage(fs) ? estimate_hours_until_full(&hf, fs, now) : -1;
+        if (hours >= 0) printf(" full_in=%.1f hours", hours);
+        printf("\n");
+    }
+
+    if (have_history) close_history_file(&hf);
+    free(mounts);
+}
+
+#define PROBE_TIMEOUT_MS 10000
+
+/**
+ * One part of the hardware page, read in-process or from a spawned command
+ * Either way the text ends up in command.out
+ */
+typedef struct {
+    const char *label;          // Printed above the output in combined sections, or NULL
+    SpawnedCommand command;     // argv is NULL when the output was filled in-process
+} CommandProbe;
+
+/**
+ * Model, core count and clock lines of /proc/cpuinfo for the processor section
+ */
+void collect_cpuinfo_summary(StringBuffer *out) {
+    FILE *fp = fopen("/proc/cpuinfo", "r");
+    if (!fp) return;
+
+    char line[512];
+    int lines = 0;
+    while (lines < 10 && fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "model name", 10) == 0 || strncmp(line, "cpu cores", 9) == 0 ||
+            strncmp(line, "cpu MHz", 7) == 0) {
+            append_string(out, line);
+            lines++;
+        }
+    }
+    fclose(fp);
+}
+
+/**
+ * First lines of /proc/meminfo for the memory section
+ */
+void collect_meminfo_summary(StringBuffer *out) {
+    FILE *fp = fopen("/proc/meminfo", "r");
+    if (!fp) return;
+
+    char line[256];
+    for (int lines = 0; lines < 15 && fgets(line, sizeof(line), fp); lines++) {
+        append_string(out, line);
+    }
+    fclose(fp);
+}
+
+enum {
+    HW_LSHW, HW_HOSTNAMECTL, HW_LSCPU, HW_CPUINFO, HW_FREE, HW_MEMINFO, HW_DMI_MEMORY,
+    HW_LSBLK, HW_DF, HW_BASEBOARD, HW_CHASSIS, HW_BIOS, HW_LSPCI, HW_LSUSB, HW_IP_LINK,
+    HW_LSMOD, HW_PROBE_COUNT
+};
+
+// Slowest probes first so they overlap with everything else; entries
+// with a collector are read in-process instead of spawning a command, and
+// cached entries are static for the boot and kept in the inventory cache
+static const struct {
+    const char *label;
+    const char *const *argv;
+    int max_lines;
+    void (*collect)(StringBuffer *out);
+    int cached;
+} hardware_probes[HW_PROBE_COUNT] = {
+    [HW_LSHW] = {"System Overview:", (const char *const[]){"sudo", "lshw", "-short", NULL}, 20, NULL, 1},
+    [HW_HOSTNAMECTL] = {"Host Information:", (const char *const[]){"hostnamectl", NULL}, 0, NULL, 1},
+    [HW_LSCPU] = {"CPU Details:", (const char *const[]){"lscpu", NULL}, 0, NULL, 1},
+    [HW_CPUINFO] = {"Processor Information:", NULL, 0, collect_cpuinfo_summary},
+    [HW_FREE] = {"Memory Usage:", (const char *const[]){"free", "-h", NULL}},
+    [HW_MEMINFO] = {"Memory Details:", NULL, 0, collect_meminfo_summary},
+    [HW_DMI_MEMORY] = {"DMI Memory Info:", NULL, 0, collect_memory_devices, 1},
+    [HW_LSBLK] = {"Block Devices:", (const char *const[]){"lsblk", "-o", "NAME,SIZE,TYPE,MOUNTPOINT,FSTYPE,MODEL", NULL}},
+    [HW_DF] = {"Disk Usage:", NULL, 0, collect_filesystem_usage},
+    [HW_BASEBOARD] = {"Motherboard Information:\nBaseboard:", NULL, 0, collect_baseboard_info, 1},
+    [HW_CHASSIS] = {"Chassis:", NULL, 0, collect_chassis_info, 1},
+    [HW_BIOS] = {"BIOS Information:", NULL, 0, collect_bios_info, 1},
+    [HW_LSPCI] = {"PCI Devices:", NULL, 0, collect_pci_devices, 1},
+    [HW_LSUSB] = {"USB Devices:", NULL, 0, collect_usb_devices, 1},
+    [HW_IP_LINK] = {"Network Interfaces:", (const char *const[]){"ip", "link", "show", NULL}},
+    [HW_LSMOD] = {NULL, NULL, 0, collect_kernel_modules},
+};
+
+// Display order of the hardware page and the probes each section combines
+static const struct {
+    const char *title;
+    int count;
+    int probes[3];
+} hardware_sections[] = {
+    {"SYSTEM OVERVIEW", 2, {HW_LSHW, HW_HOSTNAMECTL}},
+    {"PROCESSOR INFORMATION", 2, {HW_LSCPU, HW_CPUINFO}},
+    {"MEMORY INFORMATION", 3, {HW_FREE, HW_MEMINFO, HW_DMI_MEMORY}},
+    {"STORAGE DEVICES", 2, {HW_LSBLK, HW_DF}},
+    {"MOTHERBOARD & BIOS", 3, {HW_BASEBOARD, HW_CHASSIS, HW_BIOS}},
+    {"HARDWARE DEVICES", 3, {HW_LSPCI, HW_LSUSB, HW_IP_LINK}},
+    {"KERNEL INFORMATION", 1, {HW_LSMOD}},
+};
+
+typedef struct {
+    CommandProbe probes[HW_PROBE_COUNT];
+} HardwareData;
+
+// Files whose change invalidates the cached hardware probes; /run/udev/data
+// gains and loses entries as devices come and go
+static const char *const hardware_cache_sources[] = {
+    "/sys/class/dmi/id", "/run/udev/data", "/sys/devices/system/cpu/online",
+    "/etc/hostname", "/etc/os-release", NULL
+};
+
+void collect_hardware_data(HardwareData *data) {
+    // Initialize all buffers
+    memset(data, 0, sizeof(HardwareData));
+
+    InventoryCache *cache = open_inventory_cache("hardware", hardware_cache_sources);
+    SpawnedCommand *spawned[HW_PROBE_COUNT];
+    int from_cache[HW_PROBE_COUNT] = {0};
+    int spawn_count = 0;
+    char blob[16];
+
+    for (int i = 0; i < HW_PROBE_COUNT; i++) {
+        CommandProbe *probe = &data->probes[i];
+        probe->label = hardware_probes[i].label;
+        snprintf(blob, sizeof(blob), "probe%d", i);
+        if (hardware_probes[i].cached && get_inventory_blob(cache, blob, &probe->command.out) == 0) {
+            from_cache[i] = 1;
+        } else if (hardware_probes[i].collect) {
+            hardware_probes[i].collect(&probe->command.out);
+        } else {
+            probe->command.argv = hardware_probes[i].argv;
+            probe->command.timeout_ms = PROBE_TIMEOUT_MS;
+            spawned[spawn_count++] = &probe->command;
+        }
+    }
+
+    run_spawned_commands(spawned, spawn_count, SPAWN_MAX_PARALLEL);
+
+    for (int i = 0; i < HW_PROBE_COUNT; i++) {
+        SpawnedCommand *cmd = &data->probes[i].command;
+        if (!cmd->argv) continue;
+
+        if (hardware_probes[i].max_lines) keep_first_lines(&cmd->out, hardware_probes[i].max_lines);
+        if (cmd->timed_out) {
+            append_format(&cmd->out, "%sCommand timed out after %d s: %s", cmd->out.length ? "\n" : "",
+                          PROBE_TIMEOUT_MS / 1000, cmd->argv[0]);
+        } else if (cmd->status == -1) {
+            append_format(&cmd->out, "Command not available: %s", cmd->argv[0]);
+        }
+    }
+
+    // Only clean results are kept, so a probe that timed out or failed is retried next time
+    for (int i = 0; i < HW_PROBE_COUNT; i++) {
+        const SpawnedCommand *cmd = &data->probes[i].command;
+        if (!hardware_probes[i].cached || from_cache[i]) continue;
+        if (cmd->argv && (cmd->timed_out || cmd->status == -1 || !WIFEXITED(cmd->status) || WEXITSTATUS(cmd->status) != 0)) continue;
+        snprintf(blob, sizeof(blob), "probe%d", i);
+        put_inventory_blob(cache, blob, cmd->out.data ? cmd->out.data : "", cmd->out.length);
+    }
+    flush_inventory_cache(cache);
+}
+
+void free_hardware_data(HardwareData *data) {
+    for (int i = 0; i < HW_PROBE_COUNT; i++) {
+        free_string_buffer(&data->probes[i].command.out);
+        free_string_buffer(&data->probes[i].command.err);
+    }
+}
+
+/**
+ * Prints "label\n<content>" for one part of a combined section
+ * Empty parts say so, like empty sections do
+ */
+static void display_subsection(const char *label, const StringBuffer *content, int first) {
+    printf("%s%s\n", first ? "" : "\n\n", label);
+    if (content->length > 0) fwrite(content->data, 1, content->length, stdout);
+    else printf("Information not available\n");
+}
+
+void display_hardware_info() {
+    HardwareData data;
+    collect_hardware_data(&data);
+    
+    printf("\033[1;35m");
+    printf("================================================================================\n");
+    printf("                         SYSTEM HARDWARE INFORMATION\n");
+    printf("================================================================================\n");
+    printf("\033[0m");
+    
+    for (size_t i = 0; i < sizeof(hardware_sections) / sizeof(hardware_sections[0]); i++) {
+        const CommandProbe *first = &data.probes[hardware_sections[i].probes[0]];
+        if (hardware_sections[i].count == 1 && !first->label) {
+            display_section(hardware_sections[i].title, &first->command.out);
+            continue;
+        }
+
+        // Combined sections are printed part by part rather than copied together
+        display_section_header(hardware_sections[i].title);
+        for (int j = 0; j < hardware_sections[i].count; j++) {
+            const CommandProbe *probe = &data.probes[hardware_sections[i].probes[j]];
+            display_subsection(probe->label, &probe->command.out, j == 0);
+        }
+        printf("\n");
+    }
+    
+    printf("\033[1;35m");
+    printf("================================================================================\n");
+    printf("                         END OF SYSTEM INFORMATION\n");
+    printf("================================================================================\n");
+    printf("\033[0m");
+
+    free_hardware_data(&data);
+}
+
+void monitor_cpu_utilization() {
+    CPUUtilization prev, curr;
+    
+    printf("CPU Utilization Sample\n");
+    printf("=====================\n");
+    
+    // First reading
+    FILE *fp = fopen("/proc/stat", "r");
+    if (!fp) {
+        perror("Error opening /proc/stat");
+        return;
+    }
+    
+    char line[256];
+    if (fgets(line, sizeof(line), fp)) {
+        sscanf(line, "cpu %lu %lu %lu %lu %lu %lu %lu %lu",
+               &prev.user, &prev.nice, &prev.system, &prev.idle,
+               &prev.iowait, &prev.irq, &prev.softirq, &prev.steal);
+    }
+    fclose(fp);
+    
+    sleep(1);
+    
+    // Get current timestamp
+    time_t now = time(NULL);
+    struct tm *tm_info = localtime(&now);
+    char timestamp[20];
+    strftime(timestamp, sizeof(timestamp), "%H:%M:%S", tm_info);
+    
+    // Second reading
+    fp = fopen("/proc/stat", "r");
+    if (!fp) {
+        perror("Error opening /proc/stat");
+        return;
+    }
+    
+    if (fgets(line, sizeof(line), fp)) {
+        sscanf(line, "cpu %lu %lu %lu %lu %lu %lu %lu %lu",
+               &curr.user, &curr.nice, &curr.system, &curr.idle,
+               &curr.iowait, &curr.irq, &curr.softirq, &curr.steal);
+    }
+    fclose(fp);
+    
+    // Calculate percentages
+    unsigned long prev_idle = prev.idle + prev.iowait;
+    unsigned long curr_idle = curr.idle + curr.iowait;
+    
+    unsigned long prev_non_idle = prev.user + prev.nice + prev.system + 
+                                 prev.irq + prev.softirq + prev.steal;
+    unsigned long curr_non_idle = curr.user + curr.nice + curr.system + 
+                                 curr.irq + curr.softirq + curr.steal;
+    
+    unsigned long prev_total = prev_idle + prev_non_idle;
+    unsigned long curr_total = curr_idle + curr_non_idle;
+    
+    unsigned long total_delta = curr_total - prev_total;
+    unsigned long idle_delta = curr_idle - prev_idle;
+    
+    double total_utilization = 0.0;
+    if (total_delta > 0) {
+        total_utilization = ((double)(total_delta - idle_delta) / total_delta) * 100.0;
+    }
+    
+    unsigned long total_prev = (prev.user + prev.nice + prev.system + prev.idle + 
+                              prev.iowait + prev.irq + prev.softirq + prev.steal);
+    unsigned long total_curr = (curr.user + curr.nice + curr.system + curr.idle + 
+                              curr.iowait + curr.irq + curr.softirq + curr.steal);
+    unsigned long total_component_delta = total_curr - total_prev;
+    
+    double user_pct = 0.0;
+    double system_pct = 0.0;
+    double iowait_pct = 0.0;
+    
+    if (total_component_delta > 0) {
+        user_pct = ((double)(curr.user - prev.user) / total_component_delta) * 100;
+        system_pct = ((double)(curr.system - prev.system) / total_component_delta) * 100;
+        iowait_pct = ((double)(curr.iowait - prev.iowait) / total_component_delta) * 100;
+    }
+    
+    printf("Timestamp: %s\n", timestamp);
+    printf("User: %.1f%%\n", user_pct);
+    printf("System: %.1f%%\n", system_pct);
+    printf("IOWait: %.1f%%\n", iowait_pct);
+    printf("Total: %.1f%%\n", total_utilization);
+}
+
+// Number of lines in a command's output, or 0 if it could not run
+static int count_output_lines(const char *const *argv, int limit) {
+    StringBuffer output = {0};
+    int lines = 0;
+
+    run_command(argv, SPAWN_DEFAULT_TIMEOUT_MS, SPAWN_STDERR_DISCARD, &output);
+    for (size_t i = 0; i < output.length && lines < limit; i++) {
+        if (output.data[i] == '\n') lines++;
+    }
+    free_string_buffer(&output);
+    return lines;
+}
+
+void check_firewall() {
+    static const char *const iptables_argv[] = {"iptables", "-L", "-n", NULL};
+    static const char *const nft_argv[] = {"nft", "list", "ruleset", NULL};
+    static const char *const ufw_argv[] = {"ufw", "status", NULL};
+    int iptables_active = 0;
+    int nftables_active = 0;
+    int ufw_active = 0;
+    
+    printf("Firewall Status:\n");
+    
+    // Check iptables
+    iptables_active = count_output_lines(iptables_argv, 10) > 3;
+    printf("iptables: %s\n", iptables_active ? "ACTIVE" : "inactive");
+    
+    // Check nftables
+    nftables_active = count_output_lines(nft_argv, 5) > 1;
+    printf("nftables: %s\n", nftables_active ? "ACTIVE" : "inactive");
+    
+    // Check UFW
+    if (find_executable("ufw")) {
+        StringBuffer status = {0};
+        run_command(ufw_argv, SPAWN_DEFAULT_TIMEOUT_MS, SPAWN_STDERR_DISCARD, &status);
+        // "Status: inactive" also contains "active", so match the whole phrase
+        ufw_active = status.data && strstr(status.data, "Status: active") != NULL;
+        free_string_buffer(&status);
+    }
+    printf("UFW: %s\n", ufw_active ? "ACTIVE" : "inactive");
+    
+    // Overall status
+    int overall_status = iptables_active || nftables_active || ufw_active;
+    printf("\nOverall firewall status: %s\n", overall_status ? "ACTIVE" : "INACTIVE");
+}
+
+void show_logged_in_users() {
+    static const char *const argv[] = {"w", NULL};
+    StringBuffer result = {0};
+    if (run_command(argv, SPAWN_DEFAULT_TIMEOUT_MS, SPAWN_STDERR_DISCARD, &result) != -1) {
+        printf("Logged in users:\n%s\n", result.data ? result.data : "");
+    }
+    else {
+        printf("Failed to get logged in users.\n");
+    }
+    free_string_buffer(&result);
+}
+
+#define LOG_TAIL_LINES 20
+#define LOG_MAX_LINE 65536
+#define LOG_READ_CHUNK 65536
+
+// Plain-text logs followed by tail_log_files; whichever exist on this distribution are used
+static const char *const tailed_log_files[] = {
+    "/var/log/syslog", "/var/log/messages", "/var/log/auth.log", "/var/log/kern.log", NULL
+};
+#define LOG_TAIL_FILES (sizeof(tailed_log_files) / sizeof(tailed_log_files[0]) - 1)
+
+/**
+ * Appends the last count lines of a file to out, reading backwards from the end in chunks
+ * Cost depends on the lines returned, not on the file size
+ * Returns -1 if the file cannot be opened
+ */
+int read_last_lines(const char *path, int count, StringBuffer *out) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    char *buffer = malloc(LOG_READ_CHUNK);
+    off_t start = st.st_size;
+    int newlines = 0;
+    // A trailing newline ends the last line rather than starting an empty one
+    char last;
+    if (start > 0 && pread(fd, &last, 1, start - 1) == 1 && last == '\n') newlines = -1;
+
+    while (buffer && start > 0) {
+        size_t size = start > LOG_READ_CHUNK ? LOG_READ_CHUNK : (size_t)start;
+        ssize_t n = pread(fd, buffer, size, start - size);
+        if (n != (ssize_t)size) break;
+        for (ssize_t i = n - 1; i >= 0; i--) {
+            if (buffer[i] == '\n' && ++newlines == count) {
+                start = start - size + i + 1;
+                goto found;
+            }
+        }
+        start -= size;
+    }
+found:
+    free(buffer);
+
+    char chunk[LOG_READ_CHUNK < 8192 ? LOG_READ_CHUNK : 8192];
+    ssize_t n;
+    while (start < st.st_size && (n = pread(fd, chunk, sizeof(chunk), start)) > 0) {
+        append_string_buffer(out, chunk, n);
+        start += n;
+    }
+    close(fd);
+    return 0;
+}
+
+// Prints the last lines of a log file for the log viewer
+int print_last_lines(const char *path) {
+    StringBuffer lines = {0};
+    if (read_last_lines(path, LOG_TAIL_LINES, &lines) != 0) return -1;
+    if (lines.length) fwrite(lines.data, 1, lines.length, stdout);
+    free_string_buffer(&lines);
+    return 0;
+}
+
+// Receives each complete line read from a followed log file
+typedef void (*LogTextFn)(const char *path, const char *line, int length, void *context);
+
+/**
+ * Read position in one followed log file
+ * The descriptor stays open across rotation so the rest of the old file can still be read
+ */
+typedef struct {
+    const char *path;
+    LogTextFn emit;
+    void *context;
+    int fd;
+    dev_t dev;
+    ino_t ino;
+    off_t offset;               // End of the last complete line printed
+    uint32_t fingerprint;       // Hash of the bytes just before offset, saved with it
+    StringBuffer partial;       // Bytes after offset not yet ended by a newline
+    int watch;
+} LogTail;
+
+#define LOG_FINGERPRINT_BYTES 64
+
+/**
+ * FNV-1a of the bytes just before offset, so a file truncated and refilled past the
+ * saved offset while nobody was watching is not mistaken for the same content
+ */
+static uint32_t log_fingerprint(int fd, off_t offset) {
+    unsigned char bytes[LOG_FINGERPRINT_BYTES];
+    size_t size = offset < LOG_FINGERPRINT_BYTES ? (size_t)offset : LOG_FINGERPRINT_BYTES;
+    uint32_t hash = 2166136261u;
+
+    if (pread(fd, bytes, size, offset - size) != (ssize_t)size) return 0;
+    for (size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+// Restores "path dev ino offset fingerprint" lines written by save_log_offsets
+static void load_log_offsets(const char *state, LogTail *tails, int count) {
+    char path[512], line[1024], file[512];
+    unsigned long long dev, ino;
+    long long offset;
+    unsigned int fingerprint;
+    FILE *fp = build_user_path("XDG_CACHE_HOME", ".cache", state, path, sizeof(path)) == 0 ? fopen(path, "r") : NULL;
+    if (!fp) return;
+
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "%511s %llu %llu %lld %u", file, &dev, &ino, &offset, &fingerprint) != 5) continue;
+        for (int i = 0; i < count; i++) {
+            if (strcmp(tails[i].path, file) != 0) continue;
+            tails[i].dev = dev;
+            tails[i].ino = ino;
+            tails[i].offset = offset;
+            tails[i].fingerprint = fingerprint;
+        }
+    }
+    fclose(fp);
+}
+
+static void save_log_offsets(const char *state, LogTail *tails, int count) {
+    char path[512], temp[520];
+    if (build_user_path("XDG_CACHE_HOME", ".cache", state, path, sizeof(path)) != 0 || ensure_parent_directory(path) != 0) return;
+
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid());
+    FILE *fp = fopen(temp, "w");
+    if (!fp) return;
+    for (int i = 0; i < count; i++) {
+        if (tails[i].ino == 0) continue;
+        if (tails[i].fd >= 0) tails[i].fingerprint = log_fingerprint(tails[i].fd, tails[i].offset);
+        fprintf(fp, "%s %llu %llu %lld %u\n", tails[i].path, (unsigned long long)tails[i].dev,
+                (unsigned long long)tails[i].ino, (long long)tails[i].offset, tails[i].fingerprint);
+    }
+    if (fclose(fp) != 0 || rename(temp, path) != 0) unlink(temp);
+}
+
+static void print_log_text(const char *path, const char *line, int length, void *context) {
+    (void)context;
+    printf("Log %s: %.*s\n", path, length, line);
+}
+
+// Hands each complete line in partial to the tail's consumer and keeps the unterminated remainder
+static void emit_log_lines(LogTail *tail, int flush) {
+    char *line = tail->partial.data, *end = line + tail->partial.length;
+    char *newline;
+
+    while (line < end && (newline = memchr(line, '\n', end - line)) != NULL) {
+        tail->emit(tail->path, line, (int)(newline - line), tail->context);
+        line = newline + 1;
+    }
+    // A runaway line without newlines is cut rather than buffered forever
+    if (line < end && (flush || end - line >= LOG_MAX_LINE)) {
+        tail->emit(tail->path, line, (int)(end - line), tail->context);
+        line = end;
+    }
+
+    size_t consumed = line - tail->partial.data;
+    tail->offset += consumed;
+    memmove(tail->partial.data, line, end - line);
+    tail->partial.length -= consumed;
+}
+
+// Reads everything appended since the last call, O(new bytes)
+static void drain_log_tail(LogTail *tail) {
+    char chunk[LOG_READ_CHUNK < 8192 ? LOG_READ_CHUNK : 8192];
+    ssize_t n;
+    if (tail->fd < 0) return;
+
+    while ((n = pread(tail->fd, chunk, sizeof(chunk), tail->offset + tail->partial.length)) > 0) {
+        append_string_buffer(&tail->partial, chunk, n);
+        emit_log_lines(tail, 0);
+    }
+}
+
+/**
+ * Opens the file now at tail->path and decides where reading starts
+ * The same inode continues at the saved offset, or from 0 if it was truncated since
+ * A new inode starts at 0, after the rest of the rotated file if it is still at path.1
+ * Without any saved position only the last backlog lines are read
+ */
+static void open_log_tail(LogTail *tail, int initial, int backlog) {
+    struct stat st;
+    int fd = open(tail->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        tail->fd = -1;
+        return;
+    }
+
+    if (initial && tail->ino == 0) {
+        StringBuffer lines = {0};
+        read_last_lines(tail->path, backlog, &lines);
+        tail->partial = lines;
+        tail->offset = st.st_size - (off_t)lines.length;
+        emit_log_lines(tail, 0);
+    } else if (initial && (st.st_dev != tail->dev || st.st_ino != tail->ino)) {
+        // Rotated while nobody was watching: finish the old file if logrotate kept it as .1
+        char rotated[512];
+        struct stat old;
+        snprintf(rotated, sizeof(rotated), "%s.1", tail->path);
+        tail->fd = open(rotated, O_RDONLY | O_CLOEXEC);
+        if (tail->fd >= 0 && fstat(tail->fd, &old) == 0 && old.st_dev == tail->dev && old.st_ino == tail->ino) {
+            drain_log_tail(tail);
+            emit_log_lines(tail, 1);
+        }
+        if (tail->fd >= 0) close(tail->fd);
+        tail->partial.length = 0;
+        tail->offset = 0;
+    } else if (!initial || st.st_size < tail->offset || log_fingerprint(fd, tail->offset) != tail->fingerprint) {
+        tail->partial.length = 0;
+        tail->offset = 0;
+    }
+
+    tail->fd = fd;
+    tail->dev = st.st_dev;
+    tail->ino = st.st_ino;
+}
+
+// Notices a file replaced at its path (rotation) or cut shorter than what was read (truncation)
+static int check_log_rotation(LogTail *tail) {
+    struct stat st, current;
+
+    if (tail->fd >= 0 && fstat(tail->fd, &current) == 0 && current.st_size < tail->offset + (off_t)tail->partial.length) {
+        tail->offset = 0;
+        tail->partial.length = 0;
+    }
+    // Until something new appears at the path the old file is still the one being written
+    if (stat(tail->path, &st) != 0) return 0;
+    if (tail->fd >= 0 && st.st_dev == tail->dev && st.st_ino == tail->ino) return 0;
+
+    // Whatever was written to the old file before the switch is still readable through its descriptor
+    if (tail->fd >= 0) {
+        drain_log_tail(tail);
+        emit_log_lines(tail, 1);
+        close(tail->fd);
+    }
+    open_log_tail(tail, 0, 0);
+    return 1;
+}
+
+static void watch_log_tail(int inotify_fd, LogTail *tail) {
+    if (tail->watch >= 0) inotify_rm_watch(inotify_fd, tail->watch);
+    tail->watch = tail->fd >= 0 ? inotify_add_watch(inotify_fd, tail->path, IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF) : -1;
+}
+
+/**
+ * Passes the lines appended to the given log files since the previous call to emit,
+ * tracked by inode and offset in the cache file named state
+ * With follow it keeps going, woken by inotify on append, rotation and re-creation, and idle otherwise
+ */
+void follow_log_files(const char *const *files, const char *state, int backlog, LogTextFn emit, void *context, int follow) {
+    LogTail tails[LOG_TAIL_FILES];
+    int count = 0;
+
+    memset(tails, 0, sizeof(tails));
+    while (count < (int)LOG_TAIL_FILES && files[count]) count++;
+    for (int i = 0; i < count; i++) {
+        tails[i].path = files[i];
+        tails[i].emit = emit;
+        tails[i].context = context;
+        tails[i].watch = -1;
+    }
+    load_log_offsets(state, tails, count);
+
+    for (int i = 0; i < count; i++) {
+        open_log_tail(&tails[i], 1, backlog);
+        drain_log_tail(&tails[i]);
+    }
+    save_log_offsets(state, tails, count);
+    fflush(stdout);
+
+    int inotify_fd = follow ? inotify_init1(IN_NONBLOCK | IN_CLOEXEC) : -1;
+    if (follow && inotify_fd < 0) printf("Error: inotify unavailable, cannot follow logs\n");
+    if (inotify_fd >= 0) {
+        signal(SIGINT, handle_signal);
+        signal(SIGTERM, handle_signal);
+        // The directory watch sees a log re-created after rotation, or one that did not exist yet
+        inotify_add_watch(inotify_fd, "/var/log", IN_CREATE | IN_MOVED_TO);
+        for (int i = 0; i < count; i++) watch_log_tail(inotify_fd, &tails[i]);
+
+        char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        struct pollfd pfd = {inotify_fd, POLLIN, 0};
+        while (!stop) {
+            // No timeout: the process sleeps until a log changes, and poll returns EINTR on a signal
+            if (poll(&pfd, 1, -1) <= 0) continue;
+            while (read(inotify_fd, events, sizeof(events)) > 0) {
+            }
+
+            for (int i = 0; i < count; i++) {
+                if (check_log_rotation(&tails[i])) watch_log_tail(inotify_fd, &tails[i]);
+                drain_log_tail(&tails[i]);
+            }
+            save_log_offsets(state, tails, count);
+            fflush(stdout);
+        }
+        close(inotify_fd);
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (tails[i].fd >= 0) close(tails[i].fd);
+        free_string_buffer(&tails[i].partial);
+    }
+}
+
+/**
+ * Prints the lines appended to the system log files since the previous call
+ */
+void tail_log_files(int follow) {
+    follow_log_files(tailed_log_files, "log-offsets", LOG_TAIL_LINES, print_log_text, NULL, follow);
+}
+
+// Kernel log: structured records read straight from /dev/kmsg
+#define KMSG_RECORD_SIZE 8192
+#define KMSG_RECENT_RECORDS 30
+
+static const char *const kmsg_level_names[] = {
+    "emerg", "alert", "crit", "err", "warn", "notice", "info", "debug"
+};
+
+typedef struct {
+    uint64_t sequence;
+    int priority;
+    int facility;
+    uint64_t uptime;            // Microseconds since boot, as stamped by the kernel
+    int64_t time;               // The same moment in microseconds since the epoch
+    char message[LOG_MAX_MESSAGE];
+    int length;
+} KmsgRecord;
+
+typedef void (*KmsgRecordFn)(const KmsgRecord *record, void *context);
+
+typedef struct {
+    int fd;
+    uint64_t boot;              // Sequence numbers restart at every boot
+    uint64_t next_sequence;     // Records below this were already delivered
+    int64_t clock_offset;       // Wall clock minus the kernel's monotonic clock, in microseconds
+} KmsgReader;
+
+// Hash of the kernel's boot id, so a sequence saved before a reboot is not applied after it
+static uint64_t read_boot_id() {
+    char text[64];
+    uint64_t hash = 1469598103934665603ull;
+    if (read_sysfs_string("/proc/sys/kernel/random/boot_id", text, sizeof(text)) != 0) return 0;
+    for (const char *c = text; *c; c++) hash = (hash ^ (unsigned char)*c) * 1099511628211ull;
+    return hash;
+}
+
+/**
+ * Opens /dev/kmsg without blocking, resuming after a sequence saved in the same boot
+ * With from_end only records logged from now on are delivered
+ * Returns 0 on success, -1 if the kernel log cannot be read (e.g. dmesg_restrict)
+ */
+int open_kmsg_reader(KmsgReader *reader, uint64_t boot, uint64_t next_sequence, int from_end) {
+    struct timespec realtime, monotonic;
+
+    reader->fd = open("/dev/kmsg", O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (reader->fd < 0) return -1;
+    if (from_end) lseek(reader->fd, 0, SEEK_END);
+
+    reader->boot = read_boot_id();
+    reader->next_sequence = (boot == reader->boot) ? next_sequence : 0;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    reader->clock_offset = (int64_t)(realtime.tv_sec - monotonic.tv_sec) * 1000000 + (realtime.tv_nsec - monotonic.tv_nsec) / 1000;
+    return 0;
+}
+
+void close_kmsg_reader(KmsgReader *reader) {
+    if (reader->fd >= 0) close(reader->fd);
+    reader->fd = -1;
+}
+
+/**
+ * Parses one "prival,seq,usec,flags[,...];message\n KEY=value..." record
+ * The message's \xNN escapes are decoded; the KEY=value continuation lines are dropped
+ */
+static int parse_kmsg_record(const char *data, size_t size, KmsgRecord *record) {
+    unsigned long long prival, sequence, uptime;
+    int consumed = 0;
+    if (sscanf(data, "%llu,%llu,%llu,%n", &prival, &sequence, &uptime, &consumed) != 3 || consumed == 0) return -1;
+
+    const char *text = memchr(data, ';', size);
+    if (!text) return -1;
+    text++;
+    const char *end = memchr(text, '\n', data + size - text);
+    if (!end) end = data + size;
+
+    record->sequence = sequence;
+    record->priority = prival & 7;
+    record->facility = prival >> 3;
+    record->uptime = uptime;
+    record->length = 0;
+    while (text < end && record->length < LOG_MAX_MESSAGE - 1) {
+        unsigned int byte;
+        if (text[0] == '\\' && end - text >= 4 && text[1] == 'x' && sscanf(text + 2, "%2x", &byte) == 1) {
+            record->message[record->length++] = byte == '\n' ? ' ' : (char)byte;
+            text += 4;
+        } else {
+            record->message[record->length++] = *text++;
+        }
+    }
+    record->message[record->length] = '\0';
+    return 0;
+}
+
+/**
+ * Delivers every record not seen yet and returns when the buffer is drained, without blocking
+ * Returns the number of records delivered, or -1 on a read error
+ */
+int read_kmsg_records(KmsgReader *reader, KmsgRecordFn fn, void *context) {
+    char data[KMSG_RECORD_SIZE];
+    KmsgRecord record;
+    int delivered = 0;
+    ssize_t n;
+
+    for (;;) {
+        // Each read returns exactly one record
+        n = read(reader->fd, data, sizeof(data) - 1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            // EPIPE: records were overwritten before we got to them; reading resumes at the oldest kept
+            if (errno == EPIPE) continue;
+            return errno == EAGAIN ? delivered : -1;
+        }
+        if (n == 0) return delivered;
+        data[n] = '\0';
+
+        if (parse_kmsg_record(data, n, &record) != 0 || record.sequence < reader->next_sequence) continue;
+        reader->next_sequence = record.sequence + 1;
+        record.time = reader->clock_offset + (int64_t)record.uptime;
+        fn(&record, context);
+        delivered++;
+    }
+}
+
+static void load_kmsg_sequence(const char *state, uint64_t *boot, uint64_t *next_sequence) {
+    char path[512];
+    unsigned long long saved_boot = 0, saved_sequence = 0;
+    FILE *fp = build_user_path("XDG_CACHE_HOME", ".cache", state, path, sizeof(path)) == 0 ? fopen(path, "r") : NULL;
+    if (fp) {
+        if (fscanf(fp, "%llx %llu", &saved_boot, &saved_sequence) != 2) saved_boot = saved_sequence = 0;
+        fclose(fp);
+    }
+    *boot = saved_boot;
+    *next_sequence = saved_sequence;
+}
+
+static void save_kmsg_sequence(const char *state, const KmsgReader *reader) {
+    char path[512], temp[520];
+    if (build_user_path("XDG_CACHE_HOME", ".cache", state, path, sizeof(path)) != 0 || ensure_parent_directory(path) != 0) return;
 
-            // Read /proc/[pid]/status
-            snprintf(path, sizeof(path), "/proc/%s/status", entry->d_name);
-            fp = fopen(path, "r");
-            if(fp) {
-                char buffer[1024];
-                while(fgets(buffer, sizeof(buffer), fp)) {
-                    if(strncmp(buffer, "Name:", 5) == 0) {
-                        char *name_start = buffer + 5;
-                        while(*name_start == ' ' || *name_start == '\t') name_start++;
-                        strncpy(processes[proc_count].name, name_start, sizeof(processes[proc_count].name)-1);
-                        processes[proc_count].name[strcspn(processes[proc_count].name, "\n")] = 0;
-                    } else if(strncmp(buffer, "State:", 6) == 0) {
-                        char *state_start = buffer + 6;
-                        while(*state_start == ' ' || *state_start == '\t') state_start++;
-                        strncpy(processes[proc_count].state, state_start, sizeof(processes[proc_count].state)-1);
-                        processes[proc_count].state[strcspn(processes[proc_count].state, "\n")] = 0;
-                    } else if(strncmp(buffer, "Pid:", 4) == 0) {
-                        char *pid_start = buffer + 4;
-                        while(*pid_start == ' ' || *pid_start == '\t') pid_start++;
-                        strncpy(processes[proc_count].pid, pid_start, sizeof(processes[proc_count].pid)-1);
-                        processes[proc_count].pid[strcspn(processes[proc_count].pid, "\n")] = 0;
-                    } else if(strncmp(buffer, "PPid:", 5) == 0) {
-                        char *ppid_start = buffer + 5;
-                        while(*ppid_start == ' ' || *ppid_start == '\t') ppid_start++;
-                        strncpy(processes[proc_count].ppid, ppid_start, sizeof(processes[proc_count].ppid)-1);
-                        processes[proc_count].ppid[strcspn(processes[proc_count].ppid, "\n")] = 0;
-                    } else if(strncmp(buffer, "VmRSS:", 6) == 0) {
-                        char *rss_start = buffer + 6;
-                        while(*rss_start == ' ' || *rss_start == '\t') rss_start++;
-                        sscanf(rss_start, "%ld", &processes[proc_count].ram_kb);
-                    }
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid());
+    FILE *fp = fopen(temp, "w");
+    if (!fp) return;
+    fprintf(fp, "%llx %llu\n", (unsigned long long)reader->boot, (unsigned long long)reader->next_sequence);
+    if (fclose(fp) != 0 || rename(temp, path) != 0) unlink(temp);
+}
+
+static void print_kmsg_record(const KmsgRecord *record, void *context) {
+    (void)context;
+    printf("Kernel [%5llu.%06llu] %s: %s\n", (unsigned long long)(record->uptime / 1000000),
+           (unsigned long long)(record->uptime % 1000000), kmsg_level_names[record->priority], record->message);
+}
+
+/**
+ * Prints the kernel messages logged since the previous call, then optionally waits for more
+ * The position is saved as a boot id and sequence number in the user cache directory
+ */
+void read_kernel_log(int follow) {
+    KmsgReader reader;
+    uint64_t boot, next_sequence;
+
+    load_kmsg_sequence("kmsg-sequence", &boot, &next_sequence);
+    if (open_kmsg_reader(&reader, boot, next_sequence, 0) != 0) {
+        printf("Error: cannot read /dev/kmsg: %s\n", strerror(errno));
+        return;
+    }
+    if (follow) {
+        signal(SIGINT, handle_signal);
+        signal(SIGTERM, handle_signal);
+    }
+
+    do {
+        if (read_kmsg_records(&reader, print_kmsg_record, NULL) < 0) break;
+        fflush(stdout);
+        save_kmsg_sequence("kmsg-sequence", &reader);
+
+        struct pollfd pfd = { .fd = reader.fd, .events = POLLIN };
+        while (follow && !stop && poll(&pfd, 1, -1) < 0 && errno == EINTR) {
+        }
+    } while (follow && !stop);
+
+    save_kmsg_sequence("kmsg-sequence", &reader);
+    close_kmsg_reader(&reader);
+}
+
+typedef struct {
+    KmsgRecord records[KMSG_RECENT_RECORDS];
+    int count;
+} RecentKmsg;
+
+static void keep_recent_kmsg(const KmsgRecord *record, void *context) {
+    RecentKmsg *recent = context;
+    recent->records[recent->count++ % KMSG_RECENT_RECORDS] = *record;
+}
+
+/**
+ * Prints the last records of the kernel ring buffer, like dmesg | tail -30
+ * Returns -1 if /dev/kmsg cannot be read so the caller can fall back to dmesg
+ */
+int print_recent_kernel_messages() {
+    KmsgReader reader;
+    RecentKmsg *recent = calloc(1, sizeof(RecentKmsg));
+    if (!recent) return -1;
+    if (open_kmsg_reader(&reader, 0, 0, 0) != 0) {
+        free(recent);
+        return -1;
+    }
+
+    int result = read_kmsg_records(&reader, keep_recent_kmsg, recent);
+    close_kmsg_reader(&reader);
+    if (result > 0) {
+        int first = recent->count > KMSG_RECENT_RECORDS ? recent->count - KMSG_RECENT_RECORDS : 0;
+        for (int i = first; i < recent->count; i++) print_kmsg_record(&recent->records[i % KMSG_RECENT_RECORDS], NULL);
+    }
+    free(recent);
+    return result > 0 ? 0 : -1;
+}
+
+// Log store: time-ordered, fixed-size segment files of ingested log lines
+#define LOG_STORE_VERSION 3
+#define LOG_STORE_MAX_UNITS 1024
+#define LOG_UNIT_NAME_SIZE 48
+#define LOG_SEGMENT_LINES 65536
+#define LOG_SEGMENT_TEXT (8 * 1024 * 1024)
+#define LOG_STORE_MAX_SEGMENTS 24
+#define LOG_INGEST_BACKLOG 10000
+#define LOG_SEARCH_LIMIT 200
+#define LOG_SEARCH_MAX_TERMS 8
+
+enum { LOG_SOURCE_JOURNAL, LOG_SOURCE_FILE, LOG_SOURCE_KERNEL };
+
+static const char *const log_priority_names[] = {
+    "emerg", "alert", "crit", "err", "warning", "notice", "info", "debug"
+};
+
+// Store-wide state: the segment range, the unit name table and where journal ingestion stopped
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t first_segment;
+    uint32_t next_segment;      // One past the segment being appended to
+    uint32_t unit_count;
+    char journal_cursor[256];
+    uint64_t kernel_boot;       // Where kernel log ingestion stopped, see KmsgReader
+    uint64_t kernel_sequence;
+    uint32_t reserved[4];
+    char units[LOG_STORE_MAX_UNITS][LOG_UNIT_NAME_SIZE];
+} LogStoreHeader;
+
+// Segment header with the summaries queries use to skip a whole segment
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t line_count;        // Published with a release store once the line is complete
+    uint32_t text_bytes;
+    uint32_t priority_mask;     // Bit p set when some line has priority p
+    int64_t min_time;           // Microseconds since the epoch
+    int64_t max_time;
+    uint64_t unit_bitmap[LOG_STORE_MAX_UNITS / 64];
+} LogSegmentHeader;
+
+// Fixed-size index entry per line; the text itself sits in the segment's text area
+typedef struct {
+    int64_t time;
+    uint32_t offset;
+    uint16_t length;
+    uint16_t unit;
+    uint8_t priority;
+    uint8_t source;
+    uint8_t reserved[6];
+} LogLineEntry;
+
+#define LOG_SEGMENT_ENTRIES_OFFSET sizeof(LogSegmentHeader)
+#define LOG_SEGMENT_TEXT_OFFSET (LOG_SEGMENT_ENTRIES_OFFSET + LOG_SEGMENT_LINES * sizeof(LogLineEntry))
+#define LOG_SEGMENT_SIZE (LOG_SEGMENT_TEXT_OFFSET + LOG_SEGMENT_TEXT)
+
+typedef struct {
+    int index_fd;
+    int writable;
+    LogStoreHeader *header;
+    uint32_t segment;           // Segment mapped for appending, when writable
+    uint8_t *segment_map;
+    int last_unit;              // Cache for consecutive lines from the same program
+    int kernel_direct;          // Kernel lines come from /dev/kmsg, so syslog copies are skipped
+} LogStore;
+
+static int log_store_path(const char *file, char *path, size_t size) {
+    char name[64];
+    snprintf(name, sizeof(name), "logs/%s", file);
+    return build_user_path("XDG_DATA_HOME", ".local/share", name, path, size);
+}
+
+static uint8_t *map_log_segment(uint32_t segment, int writable, int create) {
+    char file[32], path[512];
+    snprintf(file, sizeof(file), "segment-%08u", segment);
+    if (log_store_path(file, path, sizeof(path)) != 0) return NULL;
+
+    int fd = open(path, (writable ? O_RDWR : O_RDONLY) | (create ? O_CREAT | O_TRUNC : 0) | O_CLOEXEC, 0644);
+    if (fd < 0) return NULL;
+
+    // Segments are created at full size; untouched pages stay sparse on disk
+    struct stat st;
+    if ((create && ftruncate(fd, LOG_SEGMENT_SIZE) != 0) || fstat(fd, &st) != 0 || st.st_size != LOG_SEGMENT_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, LOG_SEGMENT_SIZE, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    LogSegmentHeader *header = map;
+    if (create) {
+        memcpy(header->magic, "SMLSEG01", 8);
+        header->version = LOG_STORE_VERSION;
+        header->min_time = INT64_MAX;
+        header->max_time = INT64_MIN;
+    } else if (memcmp(header->magic, "SMLSEG01", 8) != 0) {
+        munmap(map, LOG_SEGMENT_SIZE);
+        return NULL;
+    }
+    return map;
+}
+
+static void unlink_log_segment(uint32_t segment) {
+    char file[32], path[512];
+    snprintf(file, sizeof(file), "segment-%08u", segment);
+    if (log_store_path(file, path, sizeof(path)) == 0) unlink(path);
+}
+
+void close_log_store(LogStore *store) {
+    if (store->segment_map) munmap(store->segment_map, LOG_SEGMENT_SIZE);
+    if (store->header) munmap(store->header, sizeof(LogStoreHeader));
+    if (store->index_fd >= 0) close(store->index_fd);
+    store->segment_map = NULL;
+    store->header = NULL;
+    store->index_fd = -1;
+}
+
+/**
+ * Opens the log store in the user data directory, creating it when writable
+ * There is one writer at a time; a second one fails without waiting
+ * Returns 0 on success, -1 on error
+ */
+int open_log_store(LogStore *store, int writable) {
+    char path[512];
+    memset(store, 0, sizeof(*store));
+    store->index_fd = -1;
+    store->last_unit = -1;
+
+    if (log_store_path("store.idx", path, sizeof(path)) != 0) return -1;
+    if (writable && ensure_parent_directory(path) != 0) return -1;
+
+    store->index_fd = open(path, (writable ? O_RDWR | O_CREAT : O_RDONLY) | O_CLOEXEC, 0644);
+    if (store->index_fd < 0) return -1;
+    if (writable && flock(store->index_fd, LOCK_EX | LOCK_NB) != 0) {
+        close_log_store(store);
+        return -1;
+    }
+
+    struct stat st;
+    int created = writable && fstat(store->index_fd, &st) == 0 && st.st_size == 0;
+    if ((created && ftruncate(store->index_fd, sizeof(LogStoreHeader)) != 0) ||
+        fstat(store->index_fd, &st) != 0 || st.st_size != sizeof(LogStoreHeader)) {
+        close_log_store(store);
+        return -1;
+    }
+
+    void *map = mmap(NULL, sizeof(LogStoreHeader), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, store->index_fd, 0);
+    if (map == MAP_FAILED) {
+        close_log_store(store);
+        return -1;
+    }
+    store->header = map;
+    if (!created && writable && memcmp(store->header->magic, "SMLIDX01", 8) == 0 &&
+        store->header->version != LOG_STORE_VERSION) {
+        // A store from another version is dropped and ingested again; numbering carries on so
+        // no new segment reuses the name of one that could not be removed
+        uint32_t next = store->header->next_segment;
+        if (next - store->header->first_segment <= LOG_STORE_MAX_SEGMENTS) {
+            for (uint32_t segment = store->header->first_segment; segment != next; segment++) unlink_log_segment(segment);
+        }
+        memset(store->header, 0, sizeof(LogStoreHeader));
+        store->header->first_segment = store->header->next_segment = next;
+        created = 1;
+    }
+    if (created) {
+        memcpy(store->header->magic, "SMLIDX01", 8);
+        store->header->version = LOG_STORE_VERSION;
+        // Unit 0 is the unnamed unit, which also takes every program once the table is full
+        store->header->units[0][0] = '\0';
+        store->header->unit_count = 1;
+    } else if (memcmp(store->header->magic, "SMLIDX01", 8) != 0 || store->header->version != LOG_STORE_VERSION) {
+        fprintf(stderr, "Error: unrecognised log store %s\n", path);
+        close_log_store(store);
+        return -1;
+    }
+
+    store->writable = writable;
+    return 0;
+}
+
+// Program names are stored without a ".service" suffix so "sshd" and "sshd.service" are one unit
+static void normalize_unit_name(const char *name, char *out, size_t size) {
+    size_t length = strlen(name);
+    if (length > 8 && strcmp(name + length - 8, ".service") == 0) length -= 8;
+    if (length >= size) length = size - 1;
+    memcpy(out, name, length);
+    out[length] = '\0';
+}
+
+/**
+ * Looks up a unit's id, registering it when create is set
+ * Id 0 is the unnamed unit, reserved when the store is created; returns -1 if the name is
+ * unknown or the table is full
+ */
+static int log_unit_id(LogStore *store, const char *name, int create) {
+    LogStoreHeader *header = store->header;
+    char unit[LOG_UNIT_NAME_SIZE];
+    normalize_unit_name(name, unit, sizeof(unit));
+
+    if (store->last_unit >= 0 && strcmp(header->units[store->last_unit], unit) == 0) return store->last_unit;
+    uint32_t count = __atomic_load_n(&header->unit_count, __ATOMIC_ACQUIRE);
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(header->units[i], unit) == 0) return store->last_unit = i;
+    }
+    if (!create || count >= LOG_STORE_MAX_UNITS) return -1;
+
+    memcpy(header->units[count], unit, sizeof(unit));
+    __atomic_store_n(&header->unit_count, count + 1, __ATOMIC_RELEASE);
+    return store->last_unit = count;
+}
+
+// Maps the segment being appended to, starting a new one (and dropping the oldest) when it is full
+static LogSegmentHeader *writable_log_segment(LogStore *store, size_t length) {
+    LogStoreHeader *header = store->header;
+
+    if (store->segment_map) {
+        LogSegmentHeader *segment = (LogSegmentHeader *)store->segment_map;
+        if (segment->line_count < LOG_SEGMENT_LINES && segment->text_bytes + length + 1 <= LOG_SEGMENT_TEXT) return segment;
+        munmap(store->segment_map, LOG_SEGMENT_SIZE);
+        store->segment_map = NULL;
+    } else if (header->next_segment > header->first_segment) {
+        store->segment = header->next_segment - 1;
+        store->segment_map = map_log_segment(store->segment, 1, 0);
+        if (store->segment_map) return writable_log_segment(store, length);
+    }
+
+    store->segment = header->next_segment;
+    store->segment_map = map_log_segment(store->segment, 1, 1);
+    if (!store->segment_map) return NULL;
+    __atomic_store_n(&header->next_segment, store->segment + 1, __ATOMIC_RELEASE);
+
+    while (header->next_segment - header->first_segment > LOG_STORE_MAX_SEGMENTS) {
+        uint32_t oldest = header->first_segment;
+        __atomic_store_n(&header->first_segment, oldest + 1, __ATOMIC_RELEASE);
+        unlink_log_segment(oldest);
+    }
+    return (LogSegmentHeader *)store->segment_map;
+}
+
+/**
+ * Appends one line to the store; newlines inside the text become spaces
+ * Returns 0 on success, -1 if no segment could be written
+ */
+int append_log_line(LogStore *store, int64_t time, int priority, const char *unit, const char *text, size_t length, int source) {
+    if (length > LOG_MAX_MESSAGE) length = LOG_MAX_MESSAGE;
+    LogSegmentHeader *segment = writable_log_segment(store, length);
+    if (!segment) return -1;
+
+    // Lines of programs past the unit table's capacity are kept as unnamed
+    int unit_id = log_unit_id(store, unit && unit[0] ? unit : "", 1);
+    if (unit_id < 0) unit_id = 0;
+
+    char *out = (char *)store->segment_map + LOG_SEGMENT_TEXT_OFFSET + segment->text_bytes;
+    for (size_t i = 0; i < length; i++) out[i] = text[i] == '\n' ? ' ' : text[i];
+    out[length] = '\n';
+
+    uint32_t line = segment->line_count;
+    LogLineEntry *entry = (LogLineEntry *)(store->segment_map + LOG_SEGMENT_ENTRIES_OFFSET) + line;
+    entry->time = time;
+    entry->offset = segment->text_bytes;
+    entry->length = length;
+    entry->unit = unit_id;
+    entry->priority = priority & 7;
+    entry->source = source;
+
+    segment->text_bytes += length + 1;
+    segment->priority_mask |= 1u << (priority & 7);
+    segment->unit_bitmap[unit_id / 64] |= 1ull << (unit_id % 64);
+    if (time < segment->min_time) segment->min_time = time;
+    if (time > segment->max_time) segment->max_time = time;
+    __atomic_store_n(&segment->line_count, line + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+#if defined(__x86_64__)
+/**
+ * Substring search over a long buffer, 16 positions per step: compares the needle's first and
+ * last bytes at every position at once and only runs memcmp where both match
+ */
+static const char *find_substring_sse2(const char *haystack, size_t length, const char *needle, size_t needle_length) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+    size_t i = 0;
+
+    for (; i + needle_length - 1 + 16 <= length; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(haystack + i + needle_length - 1));
+        unsigned mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2) == 0) return haystack + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return memmem(haystack + i, length - i, needle, needle_length);
+}
+
+// The same scan 32 positions per step, for CPUs with AVX2
+__attribute__((target("avx2")))
+static const char *find_substring_avx2(const char *haystack, size_t length, const char *needle, size_t needle_length) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+    size_t i = 0;
+
+    for (; i + needle_length - 1 + 32 <= length; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(haystack + i + needle_length - 1));
+        unsigned mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            int bit = __builtin_ctz(mask);
+            if (memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2) == 0) return haystack + i + bit;
+            mask &= mask - 1;
+        }
+    }
+    return memmem(haystack + i, length - i, needle, needle_length);
+}
+#endif
+
+/**
+ * Finds the first occurrence of needle in haystack, vectorized with AVX2 or SSE2 where available
+ */
+const char *find_substring(const char *haystack, size_t length, const char *needle, size_t needle_length) {
+    if (needle_length == 0) return haystack;
+    if (needle_length > length) return NULL;
+    if (needle_length == 1) return memchr(haystack, needle[0], length);
+#if defined(__x86_64__)
+    static int use_avx2 = -1;
+    if (use_avx2 < 0) use_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    return use_avx2 ? find_substring_avx2(haystack, length, needle, needle_length)
+                    : find_substring_sse2(haystack, length, needle, needle_length);
+#else
+    return memmem(haystack, length, needle, needle_length);
+#endif
+}
+
+// Parsed form of a query such as: unit=sshd priority<=warning since=-1h "Failed password"
+typedef struct {
+    int unit;                   // -1 for any unit
+    uint32_t priority_mask;
+    int64_t since;              // Microseconds since the epoch
+    int64_t until;
+    const char *terms[LOG_SEARCH_MAX_TERMS];
+    size_t term_lengths[LOG_SEARCH_MAX_TERMS];
+    int term_count;
+    int limit;
+} LogQuery;
+
+static int parse_log_priority(const char *text) {
+    if (isdigit((unsigned char)text[0])) return atoi(text) <= 7 ? atoi(text) : -1;
+    if (strcmp(text, "error") == 0) return 3;
+    if (strcmp(text, "warn") == 0) return 4;
+    for (int i = 0; i < 8; i++) {
+        if (strcmp(text, log_priority_names[i]) == 0) return i;
+    }
+    return -1;
+}
+
+/**
+ * Parses query arguments: unit=NAME, priority<=LEVEL (also <, =, >=, >), since=TIME, until=TIME,
+ * limit=N, and any other argument as a substring every line must contain
+ * Returns 0 on success, -1 with a message on a malformed argument
+ */
+int parse_log_query(LogStore *store, int argc, char **argv, LogQuery *query) {
+    time_t now = time(NULL);
+    memset(query, 0, sizeof(*query));
+    query->unit = -1;
+    query->priority_mask = 0xff;
+    query->since = INT64_MIN;
+    query->until = INT64_MAX;
+    query->limit = LOG_SEARCH_LIMIT;
+
+    for (int i = 0; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "unit=", 5) == 0) {
+            query->unit = log_unit_id(store, arg + 5, 0);
+            if (query->unit < 0) query->priority_mask = 0;  // Unknown unit: nothing can match
+        } else if (strncmp(arg, "priority", 8) == 0 && arg[8] && strchr("<=>", arg[8])) {
+            const char *op = arg + 8;
+            int length = (op[1] == '=') ? 2 : 1;
+            int level = parse_log_priority(op + length);
+            if (level < 0) {
+                printf("Error: unknown priority in %s\n", arg);
+                return -1;
+            }
+            uint32_t mask = 0;
+            for (int p = 0; p < 8; p++) {
+                if ((op[0] == '<' && (p < level || (length == 2 && p == level))) ||
+                    (op[0] == '>' && (p > level || (length == 2 && p == level))) ||
+                    (op[0] == '=' && p == level)) {
+                    mask |= 1u << p;
                 }
-                fclose(fp);
             }
+            query->priority_mask &= mask;
+        } else if (strncmp(arg, "since=", 6) == 0 || strncmp(arg, "until=", 6) == 0) {
+            int64_t seconds = parse_time_argument(arg + 6, now);
+            if (seconds < 0) {
+                printf("Error: invalid time in %s\n", arg);
+                return -1;
+            }
+            if (arg[0] == 's') query->since = seconds * 1000000;
+            else query->until = seconds * 1000000 + 999999;
+        } else if (strncmp(arg, "limit=", 6) == 0) {
+            query->limit = atoi(arg + 6);
+            if (query->limit <= 0) query->limit = LOG_SEARCH_LIMIT;
+        } else if (arg[0] && query->term_count < LOG_SEARCH_MAX_TERMS) {
+            query->terms[query->term_count] = arg;
+            query->term_lengths[query->term_count++] = strlen(arg);
+        }
+    }
+    return 0;
+}
 
-            // Calculate RAM percentage
-            if(total_mem_kb > 0)
-                processes[proc_count].ram_percent = (double)processes[proc_count].ram_kb / total_mem_kb * 100.0;
+// Whether a segment's summaries rule out every line in it
+static int log_segment_excluded(const LogSegmentHeader *header, const LogQuery *query) {
+    if (header->max_time < query->since || header->min_time > query->until) return 1;
+    if (!(header->priority_mask & query->priority_mask)) return 1;
+    return query->unit >= 0 && !(header->unit_bitmap[query->unit / 64] & (1ull << (query->unit % 64)));
+}
 
-            // Calculate CPU percentage
-            snprintf(path, sizeof(path), "/proc/%s/stat", processes[proc_count].pid);
-            fp = fopen(path, "r");
-            if(fp) {
-                char buffer[1024];
-                if(fgets(buffer, sizeof(buffer), fp)) {
-                    long utime, stime, cutime, cstime, starttime;
-                    sscanf(buffer,
-                        "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %ld %ld %ld %ld %*d %*d %*d %*d %*d %ld",
-                        &utime, &stime, &cutime, &cstime, &starttime);
-                    long total_time = utime + stime + cutime + cstime;
+static int log_line_matches(const LogLineEntry *entry, const char *text, const LogQuery *query, int skip_first_term) {
+    if (entry->time < query->since || entry->time > query->until) return 0;
+    if (!(query->priority_mask & (1u << entry->priority))) return 0;
+    if (query->unit >= 0 && entry->unit != query->unit) return 0;
+    for (int i = skip_first_term; i < query->term_count; i++) {
+        if (!find_substring(text + entry->offset, entry->length, query->terms[i], query->term_lengths[i])) return 0;
+    }
+    return 1;
+}
 
-                    FILE *uptime_fp = fopen("/proc/uptime", "r");
-                    double uptime = 0.0;
-                    if(uptime_fp) {
-                        fscanf(uptime_fp, "%lf", &uptime);
-                        fclose(uptime_fp);
-                    }
+/**
+ * Collects the indexes of matching lines of one segment in ascending order
+ * With a substring term the whole text area is scanned for it in one pass and each hit is
+ * mapped back to its line, so lines without the term are never looked at individually
+ */
+static int search_log_segment(const uint8_t *map, const LogQuery *query, uint32_t **matches) {
+    const LogSegmentHeader *header = (const LogSegmentHeader *)map;
+    uint32_t count = __atomic_load_n(&header->line_count, __ATOMIC_ACQUIRE);
+    const LogLineEntry *entries = (const LogLineEntry *)(map + LOG_SEGMENT_ENTRIES_OFFSET);
+    const char *text = (const char *)map + LOG_SEGMENT_TEXT_OFFSET;
+    int found = 0, capacity = 0;
+
+    *matches = NULL;
+    if (count == 0 || log_segment_excluded(header, query)) return 0;
+
+    const char *end = text + entries[count - 1].offset + entries[count - 1].length + 1;
+    const char *position = text;
+    uint32_t line = 0;
+
+    while (line < count) {
+        if (query->term_count > 0) {
+            const char *hit = find_substring(position, end - position, query->terms[0], query->term_lengths[0]);
+            if (!hit) break;
+            // Lines are in text order, so the hit's line is found by binary search from the current one
+            uint32_t low = line, high = count - 1, offset = hit - text;
+            while (low < high) {
+                uint32_t middle = (low + high + 1) / 2;
+                if (entries[middle].offset <= offset) low = middle;
+                else high = middle - 1;
+            }
+            line = low;
+        }
 
-                    long clk_tck = sysconf(_SC_CLK_TCK);
-                    if(uptime > 0)
-                        processes[proc_count].cpu_percent = 100.0 * ((double)total_time / clk_tck) / uptime;
-                }
-                fclose(fp);
+        if (log_line_matches(&entries[line], text, query, query->term_count > 0)) {
+            if (found == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                uint32_t *grown = realloc(*matches, capacity * sizeof(uint32_t));
+                if (!grown) break;
+                *matches = grown;
             }
+            (*matches)[found++] = line;
+        }
+        line++;
+        if (line < count) position = text + entries[line].offset;
+    }
+    return found;
+}
 
-            // Count open files and sockets
-            snprintf(path, sizeof(path), "/proc/%s/fd", processes[proc_count].pid);
-            DIR *fd_dir = opendir(path);
-            if(fd_dir) {
-                struct dirent *fd_entry;
-                char fd_path[512];
-                char link_target[1024];
-                
-                while((fd_entry = readdir(fd_dir)) != NULL) {
-                    if(fd_entry->d_name[0] == '.') continue;
-                    
-                    processes[proc_count].file_count++;
-                    
-                    // Check if it's a socket
-                    snprintf(fd_path, sizeof(fd_path), "/proc/%s/fd/%s", 
-                             processes[proc_count].pid, fd_entry->d_name);
-                    
-                    ssize_t len = readlink(fd_path, link_target, sizeof(link_target)-1);
-                    if(len != -1) {
-                        link_target[len] = '\0';
-                        if(strncmp(link_target, "socket:", 7) == 0) {
-                            processes[proc_count].socket_count++;
-                        }
-                    }
-                }
-                closedir(fd_dir);
+// Prints a stored line as "Log <time> <unit> <priority>: <message>"
+static void print_log_line(const LogStore *store, const uint8_t *map, uint32_t line) {
+    const LogLineEntry *entry = (const LogLineEntry *)(map + LOG_SEGMENT_ENTRIES_OFFSET) + line;
+    const char *text = (const char *)map + LOG_SEGMENT_TEXT_OFFSET + entry->offset;
+    time_t seconds = entry->time / 1000000;
+    char stamp[32];
+    struct tm tm;
+
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime_r(&seconds, &tm));
+    printf("Log %s %s %s: %.*s\n", stamp, store->header->units[entry->unit][0] ? store->header->units[entry->unit] : "-",
+           log_priority_names[entry->priority], entry->length, text);
+}
+
+/**
+ * Prints the most recent lines matching the query, oldest first
+ * Segments are searched newest first and skipped whole when their time range, priority or unit
+ * summaries cannot match; the search stops once limit lines are found
+ */
+void search_log_store(LogStore *store, const LogQuery *query) {
+    uint32_t first = __atomic_load_n(&store->header->first_segment, __ATOMIC_ACQUIRE);
+    uint32_t next = __atomic_load_n(&store->header->next_segment, __ATOMIC_ACQUIRE);
+    int segment_count = next - first;
+    uint8_t **maps = calloc(segment_count ? segment_count : 1, sizeof(uint8_t *));
+    struct { int segment; uint32_t line; } *results = calloc(query->limit, sizeof(*results));
+    int result_count = 0, scanned = 0;
+    struct timespec started, finished;
+
+    if (!maps || !results) {
+        free(maps);
+        free(results);
+        return;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    // Results are filled from the back so they come out in time order
+    for (int i = segment_count - 1; i >= 0 && result_count < query->limit; i--) {
+        maps[i] = map_log_segment(first + i, 0, 0);
+        if (!maps[i]) continue;
+        scanned++;
+
+        uint32_t *matches;
+        int found = search_log_segment(maps[i], query, &matches);
+        for (int j = found - 1; j >= 0 && result_count < query->limit; j--) {
+            results[query->limit - 1 - result_count].segment = i;
+            results[query->limit - 1 - result_count].line = matches[j];
+            result_count++;
+        }
+        free(matches);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+
+    for (int i = query->limit - result_count; i < query->limit; i++) {
+        print_log_line(store, maps[results[i].segment], results[i].line);
+    }
+    printf("Matches: %d%s (searched %d of %d segments in %.1f ms)\n", result_count,
+           result_count == query->limit ? "+" : "", scanned, segment_count,
+           (finished.tv_sec - started.tv_sec) * 1e3 + (finished.tv_nsec - started.tv_nsec) / 1e6);
+
+    for (int i = 0; i < segment_count; i++) {
+        if (maps[i]) munmap(maps[i], LOG_SEGMENT_SIZE);
+    }
+    free(maps);
+    free(results);
+}
+
+static void ingest_journal_entry(const JournalEntry *entry, void *context) {
+    append_log_line(context, entry->time, entry->priority, entry->ident[0] ? entry->ident : entry->unit,
+                    entry->message, entry->message_length, LOG_SOURCE_JOURNAL);
+}
+
+/**
+ * Splits a syslog file line: "Oct 19 01:22:19 host ident[pid]: message", or the same with
+ * an RFC 3339 timestamp; returns the time in microseconds, or now if it cannot be parsed
+ */
+static int64_t parse_syslog_line(const char *line, int length, char *ident, size_t ident_size, const char **message) {
+    char buffer[64];
+    struct tm tm;
+    time_t now = time(NULL), seconds = now;
+    const char *rest = line;
+
+    memset(&tm, 0, sizeof(tm));
+    snprintf(buffer, sizeof(buffer), "%.*s", length < 63 ? length : 63, line);
+    char *end = strptime(buffer, "%Y-%m-%dT%H:%M:%S", &tm);
+    if (end) {
+        // Skip fractional seconds, then apply the zone offset
+        while (*end == '.' || isdigit((unsigned char)*end)) end++;
+        long offset = 0;
+        if ((*end == '+' || *end == '-') && strlen(end) >= 6) {
+            offset = ((end[1] - '0') * 10 + (end[2] - '0')) * 3600 + ((end[4] - '0') * 10 + (end[5] - '0')) * 60;
+            if (*end == '-') offset = -offset;
+            end += 6;
+        } else if (*end == 'Z') {
+            end++;
+        }
+        seconds = timegm(&tm) - offset;
+        rest = line + (end - buffer);
+    } else {
+        struct tm today;
+        localtime_r(&now, &today);
+        tm.tm_year = today.tm_year;
+        end = strptime(buffer, "%b %d %H:%M:%S", &tm);
+        if (end) {
+            tm.tm_isdst = -1;
+            seconds = mktime(&tm);
+            // Classic syslog has no year; a date ahead of now belongs to last year
+            if (seconds > now + 86400) {
+                tm.tm_year--;
+                seconds = mktime(&tm);
             }
+            rest = line + (end - buffer);
+        }
+    }
 
-            // Get network connection details from /proc/net/tcp and /proc/net/udp
-            processes[proc_count].file_count = processes[proc_count].file_count;
-            proc_count++;
+    // Then "host ident[pid]: message"
+    const char *line_end = line + length;
+    while (rest < line_end && *rest == ' ') rest++;
+    const char *host_end = memchr(rest, ' ', line_end - rest);
+    const char *colon = host_end ? memchr(host_end, ':', line_end - host_end) : NULL;
+    ident[0] = '\0';
+    if (!end || !colon) {
+        *message = rest;
+        return (int64_t)seconds * 1000000;
+    }
+    const char *ident_start = host_end + 1, *ident_end = colon;
+    const char *bracket = memchr(ident_start, '[', colon - ident_start);
+    if (bracket) ident_end = bracket;
+    snprintf(ident, ident_size, "%.*s", (int)(ident_end - ident_start), ident_start);
+    *message = colon + 1 < line_end && colon[1] == ' ' ? colon + 2 : colon + 1;
+    return (int64_t)seconds * 1000000;
+}
+
+// Whether word occurs in text, ignoring case, not preceded or followed by a letter
+static int contains_log_keyword(const char *text, size_t length, const char *word) {
+    size_t word_length = strlen(word);
+    for (size_t i = 0; i + word_length <= length; i++) {
+        if (strncasecmp(text + i, word, word_length) != 0) continue;
+        if (i > 0 && isalpha((unsigned char)text[i - 1])) continue;
+        if (i + word_length < length && isalpha((unsigned char)text[i + word_length])) continue;
+        return 1;
+    }
+    return 0;
+}
+
+// Skips a leading "<N>" syslog prival and returns its level, or returns -1 when there is none
+static int strip_log_prival(const char **text, const char *end) {
+    const char *p = *text;
+    int prival = 0, digits = 0;
+    if (p >= end || *p != '<') return -1;
+    while (p + 1 + digits < end && digits < 3 && isdigit((unsigned char)p[1 + digits])) {
+        prival = prival * 10 + p[1 + digits] - '0';
+        digits++;
+    }
+    if (digits == 0 || p + 1 + digits >= end || p[1 + digits] != '>') return -1;
+    *text = p + digits + 2;
+    return prival & 7;
+}
+
+/**
+ * Guesses the syslog level of a text log message from the most severe level word in it,
+ * 6 (info) when there is none
+ */
+static int guess_log_priority(const char *text, const char *end) {
+    static const struct {
+        const char *word;
+        int priority;
+    } keywords[] = {
+        {"emerg", 0}, {"emergency", 0}, {"panic", 0}, {"alert", 1}, {"crit", 2}, {"critical", 2}, {"fatal", 2},
+        {"err", 3}, {"error", 3}, {"failed", 3}, {"failure", 3}, {"warn", 4}, {"warning", 4}, {"notice", 5},
+        {"debug", 7},
+    };
+    int priority = 6;
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+        if (keywords[i].priority < priority && contains_log_keyword(text, end - text, keywords[i].word)) {
+            priority = keywords[i].priority;
         }
     }
+    return priority;
+}
 
-    closedir(dir);
+/**
+ * Stores one syslog file line; the level comes from a "<N>" prefix on the line (RFC 5424
+ * templates) or on the message (sd-daemon style), else from the message's wording
+ */
+static void ingest_log_text(const char *path, const char *line, int length, void *context) {
+    LogStore *store = context;
+    char ident[LOG_UNIT_NAME_SIZE];
+    const char *message, *end = line + length;
+    (void)path;
+
+    int priority = strip_log_prival(&line, end);
+    if (priority >= 0 && end - line >= 2 && line[0] == '1' && line[1] == ' ') line += 2;  // RFC 5424 version
+    int64_t time = parse_syslog_line(line, end - line, ident, sizeof(ident), &message);
+    if (store->kernel_direct && strcmp(ident, "kernel") == 0) return;
+    if (priority < 0) priority = strip_log_prival(&message, end);
+    if (priority < 0) priority = guess_log_priority(message, end);
+    append_log_line(store, time, priority, ident, message, end - message, LOG_SOURCE_FILE);
+}
 
-    // Calculate hierarchy levels iteratively
-    int changed;
-    do {
-        changed = 0;
-        for(int i=0;i<proc_count;i++){
-            if(processes[i].level == -1){
-                if(strcmp(processes[i].ppid,"0")==0){
-                    processes[i].level = 0;
-                    changed = 1;
-                } else {
-                    for(int j=0;j<proc_count;j++){
-                        if(strcmp(processes[j].pid,processes[i].ppid)==0 && processes[j].level!=-1){
-                            processes[i].level = processes[j].level + 1;
-                            changed = 1;
-                            break;
-                        }
-                    }
-                }
-            }
+static void ingest_kmsg_record(const KmsgRecord *record, void *context) {
+    append_log_line(context, record->time, record->priority, "kernel", record->message, record->length, LOG_SOURCE_KERNEL);
+}
+
+/**
+ * Brings the store up to date: journal entries after the stored cursor, or when there is no
+ * journal the new kernel records and the lines appended to the syslog files (rsyslog copies the
+ * journal and journald the kernel log, so never both)
+ * Returns the number of lines added
+ */
+long ingest_logs(LogStore *store) {
+    uint32_t before = 0, after = 0;
+    LogSegmentHeader *segment = writable_log_segment(store, 0);
+    if (!segment) return 0;
+    uint32_t first_segment = store->segment;
+    before = segment->line_count;
+
+    // A journal with no entries (e.g. journald storage disabled) counts as no journal
+    const char *cursor = store->header->journal_cursor[0] ? store->header->journal_cursor : NULL;
+    sd_journal *journal = open_journal_at(cursor, NULL, LOG_INGEST_BACKLOG, NULL);
+    long entries = 0, batch;
+    if (journal) {
+        char *position = NULL;
+        while ((batch = read_journal_entries(journal, JOURNAL_MAX_BATCH, ingest_journal_entry, store)) > 0) {
+            entries += batch;
         }
-    } while(changed);
+        if (entries > 0 && sd_journal_api.get_cursor(journal, &position) >= 0 && position) {
+            snprintf(store->header->journal_cursor, sizeof(store->header->journal_cursor), "%s", position);
+            free(position);
+        }
+        sd_journal_api.close(journal);
+    }
+    if (!cursor && entries == 0) {
+        KmsgReader kmsg;
+        if (open_kmsg_reader(&kmsg, store->header->kernel_boot, store->header->kernel_sequence, 0) == 0) {
+            store->kernel_direct = read_kmsg_records(&kmsg, ingest_kmsg_record, store) >= 0;
+            store->header->kernel_boot = kmsg.boot;
+            store->header->kernel_sequence = kmsg.next_sequence;
+            close_kmsg_reader(&kmsg);
+        }
+        follow_log_files(tailed_log_files, "log-store-offsets", LOG_INGEST_BACKLOG, ingest_log_text, store, 0);
+    }
 
-    // Set any orphaned processes to root
-    for(int i=0;i<proc_count;i++){
-        if(processes[i].level == -1) processes[i].level = 0;
+    // Count across any segments started during ingestion
+    long added = 0;
+    for (uint32_t s = first_segment; s < store->header->next_segment; s++) {
+        uint8_t *map = s == store->segment ? store->segment_map : map_log_segment(s, 0, 0);
+        if (!map) continue;
+        after = ((LogSegmentHeader *)map)->line_count;
+        added += after - (s == first_segment ? before : 0);
+        if (map != store->segment_map) munmap(map, LOG_SEGMENT_SIZE);
     }
+    return added;
+}
 
-    // Bubble sort by level then PID
-    for(int i=0;i<proc_count-1;i++){
-        for(int j=0;j<proc_count-i-1;j++){
-            if(processes[j].level>processes[j+1].level || 
-               (processes[j].level==processes[j+1].level && atoi(processes[j].pid)>atoi(processes[j+1].pid))){
-                struct ProcInfo temp = processes[j];
-                processes[j] = processes[j+1];
-                processes[j+1] = temp;
-            }
-        }
+/**
+ * Command entry for ingest_logs
+ */
+void ingest_logs_command() {
+    LogStore store;
+    if (open_log_store(&store, 1) != 0) {
+        printf("Error: log store unavailable or being written by another process\n");
+        return;
     }
+    printf("Ingested: %ld lines\n", ingest_logs(&store));
+    close_log_store(&store);
+}
 
-    // Display header
-    printf("\nPROCESS TREE HIERARCHY WITH FILE/SOCKET INFO:\n");
-    printf("PID (PPID)  CPU%%    RAM%%     RAM(KB)   FILES  SOCKS  STATE     COMMAND\n");
-    printf("-------------------------------------------------------------------------\n");
+/**
+ * Searches the log store after catching it up with new log lines
+ * When another process is writing the store the search runs on what is there
+ */
+void search_logs(int argc, char **argv) {
+    LogStore store;
+    if (open_log_store(&store, 1) == 0) {
+        ingest_logs(&store);
+        close_log_store(&store);
+    }
+    if (open_log_store(&store, 0) != 0) {
+        printf("Error: no log store (run ingest_logs first)\n");
+        return;
+    }
 
-    // Display tree
-    for(int i=0;i<proc_count;i++){
-        for(int j=0;j<processes[i].level;j++){
-            if(j == processes[i].level - 1) printf("└── ");
-            else printf("    ");
+    LogQuery query;
+    if (parse_log_query(&store, argc, argv, &query) == 0) search_log_store(&store, &query);
+    close_log_store(&store);
+}
+
+// Export: records streamed to a file through fixed-size buffers, optionally compressed
+#define EXPORT_BUFFER_SIZE (64 * 1024)
+#define EXPORT_GZIP_LEVEL 6
+#define EXPORT_ZSTD_LEVEL 3
+
+typedef enum { EXPORT_NDJSON, EXPORT_CSV, EXPORT_TEXT } ExportFormat;
+typedef enum { EXPORT_PLAIN, EXPORT_GZIP, EXPORT_ZSTD } ExportCompression;
+
+// zlib's z_stream, declared here because zlib is only loaded at runtime
+typedef struct {
+    const unsigned char *next_in;
+    unsigned int avail_in;
+    unsigned long total_in;
+    unsigned char *next_out;
+    unsigned int avail_out;
+    unsigned long total_out;
+    const char *msg;
+    void *state;
+    void *zalloc;
+    void *zfree;
+    void *opaque;
+    int data_type;
+    unsigned long adler;
+    unsigned long reserved;
+} ZlibStream;
+
+typedef struct {
+    const void *src;
+    size_t size;
+    size_t pos;
+} ZstdInBuffer;
+
+typedef struct {
+    void *dst;
+    size_t size;
+    size_t pos;
+} ZstdOutBuffer;
+
+// Compression calls resolved from libz and libzstd on first use
+static struct {
+    int zlib_loaded;
+    const char *(*zlib_version)(void);
+    int (*deflate_init)(ZlibStream *stream, int level, int method, int window_bits, int mem_level, int strategy,
+                        const char *version, int stream_size);
+    int (*deflate)(ZlibStream *stream, int flush);
+    int (*deflate_end)(ZlibStream *stream);
+    int zstd_loaded;
+    void *(*zstd_create)(void);
+    size_t (*zstd_free)(void *context);
+    size_t (*zstd_set_parameter)(void *context, int parameter, int value);
+    size_t (*zstd_compress)(void *context, ZstdOutBuffer *output, ZstdInBuffer *input, int end_op);
+    unsigned (*zstd_is_error)(size_t code);
+} compression_api;
+
+/**
+ * Loads the library behind a compression method
+ * Returns 0 when it is available
+ */
+int load_compression(ExportCompression compression) {
+    if (compression == EXPORT_GZIP) {
+        if (!compression_api.zlib_loaded) {
+            const char *names[] = {"zlibVersion", "deflateInit2_", "deflate", "deflateEnd"};
+            void **slots[] = {(void **)&compression_api.zlib_version, (void **)&compression_api.deflate_init,
+                              (void **)&compression_api.deflate, (void **)&compression_api.deflate_end};
+            compression_api.zlib_loaded = load_library_symbols("libz.so.1", names, slots, 4);
         }
-        printf("%-5s (%-5s) %6.2f%% %6.2f%% %9ld %6d %6d %-8s %s\n",
-            processes[i].pid,
-            processes[i].ppid,
-            processes[i].cpu_percent,
-            processes[i].ram_percent,
-            processes[i].ram_kb,
-            processes[i].file_count,
-            processes[i].socket_count,
-            processes[i].state,
-            processes[i].name);
+        return compression_api.zlib_loaded > 0 ? 0 : -1;
+    }
+    if (compression == EXPORT_ZSTD) {
+        if (!compression_api.zstd_loaded) {
+            const char *names[] = {"ZSTD_createCCtx", "ZSTD_freeCCtx", "ZSTD_CCtx_setParameter", "ZSTD_compressStream2", "ZSTD_isError"};
+            void **slots[] = {(void **)&compression_api.zstd_create, (void **)&compression_api.zstd_free,
+                              (void **)&compression_api.zstd_set_parameter, (void **)&compression_api.zstd_compress,
+                              (void **)&compression_api.zstd_is_error};
+            compression_api.zstd_loaded = load_library_symbols("libzstd.so.1", names, slots, 5);
+        }
+        return compression_api.zstd_loaded > 0 ? 0 : -1;
     }
+    return 0;
+}
 
-    printf("\nTotal processes: %d\n", proc_count);
-    
-    printf("\n=== DETAILED FILE AND NETWORK INFO FOR HIGH-RESOURCE PROCESSES ===\n");
-    for(int i=0;i<proc_count;i++){
-            
-            printf("\n--- PID %s: %s (CPU: %.2f%%, RAM: %.2f%%, Files: %d, Sockets: %d) ---\n",
-                   processes[i].pid, processes[i].name, 
-                   processes[i].cpu_percent, processes[i].ram_percent,
-                   processes[i].file_count, processes[i].socket_count);
-            
-            // Show open files (first 10)
-            char path[512];
-            snprintf(path, sizeof(path), "/proc/%s/fd", processes[i].pid);
-            DIR *fd_dir = opendir(path);
-            if(fd_dir) {
-                printf("Open files (first 10):\n");
-                struct dirent *fd_entry;
-                char fd_path[512];
-                char link_target[1024];
-                int file_count = 0;
-                
-                while((fd_entry = readdir(fd_dir)) != NULL) {
-                    if(fd_entry->d_name[0] == '.') continue;
-                    
-                    snprintf(fd_path, sizeof(fd_path), "/proc/%s/fd/%s", 
-                             processes[i].pid, fd_entry->d_name);
-                    
-                    ssize_t len = readlink(fd_path, link_target, sizeof(link_target)-1);
-                    if(len != -1) {
-                        link_target[len] = '\0';
-                        printf("  FD %s -> %s\n", fd_entry->d_name, link_target);
-                        file_count++;
-                    }
-                }
-                closedir(fd_dir);
+typedef struct {
+    int fd;
+    char path[512];             // Final path; records go to path.<pid> until the export completes
+    char temp[520];
+    ExportFormat format;
+    ExportCompression compression;
+    ZlibStream zlib;
+    void *zstd;
+    char text[EXPORT_BUFFER_SIZE];      // Encoded records not yet compressed or written
+    size_t text_length;
+    unsigned char packed[EXPORT_BUFFER_SIZE];
+    int fields;                 // Fields written in the current record
+    uint64_t records;
+    uint64_t raw_bytes;
+    uint64_t written_bytes;
+    int error;
+} ExportWriter;
+
+static void write_export_bytes(ExportWriter *writer, const void *data, size_t length) {
+    const char *cursor = data;
+    while (length > 0 && !writer->error) {
+        ssize_t n = write(writer->fd, cursor, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            writer->error = errno ? errno : EIO;
+            return;
+        }
+        cursor += n;
+        length -= n;
+        writer->written_bytes += n;
+    }
+}
+
+// Pushes the text buffer through the compressor; finish ends the compressed stream
+static void flush_export_text(ExportWriter *writer, int finish) {
+    if (writer->compression == EXPORT_PLAIN) {
+        write_export_bytes(writer, writer->text, writer->text_length);
+    } else if (writer->compression == EXPORT_GZIP) {
+        ZlibStream *zlib = &writer->zlib;
+        int result;
+        zlib->next_in = (const unsigned char *)writer->text;
+        zlib->avail_in = writer->text_length;
+        do {
+            zlib->next_out = writer->packed;
+            zlib->avail_out = sizeof(writer->packed);
+            result = compression_api.deflate(zlib, finish ? 4 : 0);  // Z_FINISH : Z_NO_FLUSH
+            if (result < 0 && result != -5) {                        // Z_BUF_ERROR only means no progress
+                writer->error = EIO;
+                break;
             }
-            
-            // Show network connections from /proc/net/tcp
-            printf("Network connections:\n");
-            FILE *tcp_file = fopen("/proc/net/tcp", "r");
-            if(tcp_file) {
-                char line[1024];
-                fgets(line, sizeof(line), tcp_file); // Skip header
-                while(fgets(line, sizeof(line), tcp_file)) {
-                    // Basic parsing - you can enhance this to show more details
-                    char local_addr[64], remote_addr[64], state[16];
-                    int uid, inode;
-                    if(sscanf(line, "%*d: %63s %63s %15s %*x:%*x %*x:%*x %*x %d %*d %d",
-                             local_addr, remote_addr, state, &uid, &inode) >= 5) {
-                        
-                        // Check if this inode matches any of the process's socket inodes
-                        char socket_path[64];
-                        snprintf(socket_path, sizeof(socket_path), "socket:[%d]", inode);
-                        
-                        // Check if this socket belongs to our process
-                        snprintf(path, sizeof(path), "/proc/%s/fd", processes[i].pid);
-                        DIR *check_dir = opendir(path);
-                        if(check_dir) {
-                            struct dirent *check_entry;
-                            char check_path[512];
-                            char check_link[1024];
-                            
-                            while((check_entry = readdir(check_dir)) != NULL) {
-                                if(check_entry->d_name[0] == '.') continue;
-                                
-                                snprintf(check_path, sizeof(check_path), "/proc/%s/fd/%s", 
-                                         processes[i].pid, check_entry->d_name);
-                                
-                                ssize_t len = readlink(check_path, check_link, sizeof(check_link)-1);
-                                if(len != -1) {
-                                    check_link[len] = '\0';
-                                    if(strcmp(check_link, socket_path) == 0) {
-                                        printf("  TCP %s -> %s (%s)\n", local_addr, remote_addr, state);
-                                        break;
-                                    }
-                                }
-                            }
-                            closedir(check_dir);
-                        }
-                    }
-                }
-                fclose(tcp_file);
+            write_export_bytes(writer, writer->packed, sizeof(writer->packed) - zlib->avail_out);
+        } while (zlib->avail_in > 0 || (finish && result != 1));    // Z_STREAM_END
+    } else {
+        ZstdInBuffer input = {writer->text, writer->text_length, 0};
+        size_t remaining;
+        do {
+            ZstdOutBuffer output = {writer->packed, sizeof(writer->packed), 0};
+            remaining = compression_api.zstd_compress(writer->zstd, &output, &input, finish ? 2 : 0);  // ZSTD_e_end : ZSTD_e_continue
+            if (compression_api.zstd_is_error(remaining)) {
+                writer->error = EIO;
+                break;
             }
+            write_export_bytes(writer, writer->packed, output.pos);
+        } while (input.pos < input.size || (finish && remaining > 0));
     }
-    
-    return proc_count;
+    writer->text_length = 0;
 }
 
-#define CMD_BUFFER_SIZE 1024
+static void append_export_text(ExportWriter *writer, const char *data, size_t length) {
+    writer->raw_bytes += length;
+    while (length > 0) {
+        size_t room = sizeof(writer->text) - writer->text_length;
+        if (room == 0) {
+            flush_export_text(writer, 0);
+            room = sizeof(writer->text);
+        }
+        size_t chunk = length < room ? length : room;
+        memcpy(writer->text + writer->text_length, data, chunk);
+        writer->text_length += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
 
 /**
- * Find the full path of the smartctl binary for querying S.M.A.R.T. data from drives
+ * Creates the export file and, for CSV, writes the header row of column names
+ * path "-" streams to standard output
+ * Returns 0 on success, -1 with a message when the file or compressor is unavailable
  */
-const char *find_smartctl_path() {
-    FILE *pipe;
-    char path_buffer[256];
-    static char smartctl_path[256];
-    
-    pipe = popen("which smartctl 2>/dev/null", "r");
-    if (pipe != NULL) {
-        if (fgets(path_buffer, sizeof(path_buffer), pipe) != NULL) {
-            path_buffer[strcspn(path_buffer, "\n")] = 0;
-            pclose(pipe);
-            if (access(path_buffer, X_OK) == 0) {
-                strncpy(smartctl_path, path_buffer, sizeof(smartctl_path));
-                return smartctl_path;
-            }
+int open_export(ExportWriter *writer, const char *path, ExportFormat format, ExportCompression compression,
+                const char *const *columns) {
+    memset(writer, 0, sizeof(*writer));
+    writer->format = format;
+    writer->compression = compression;
+
+    if (load_compression(compression) != 0) {
+        printf("Error: %s compression is not available (lib%s not found)\n",
+               compression == EXPORT_GZIP ? "gzip" : "zstd", compression == EXPORT_GZIP ? "z" : "zstd");
+        return -1;
+    }
+    if (compression == EXPORT_GZIP) {
+        // Window bits 15 + 16 selects the gzip container
+        if (compression_api.deflate_init(&writer->zlib, EXPORT_GZIP_LEVEL, 8, 15 + 16, 8, 0,
+                                         compression_api.zlib_version(), sizeof(ZlibStream)) != 0) {
+            printf("Error: cannot initialise gzip compression\n");
+            return -1;
         }
-        pclose(pipe);
+    } else if (compression == EXPORT_ZSTD) {
+        writer->zstd = compression_api.zstd_create();
+        if (!writer->zstd) return -1;
+        compression_api.zstd_set_parameter(writer->zstd, 100, EXPORT_ZSTD_LEVEL);  // ZSTD_c_compressionLevel
     }
-    
-    const char *common_paths[] = {
-        "/usr/sbin/smartctl",
-        "/usr/bin/smartctl",
-        "/sbin/smartctl",
-        "/usr/local/sbin/smartctl",
-        "/usr/local/bin/smartctl",
-        NULL
-    };
-    
-    for (int i = 0; common_paths[i] != NULL; i++) {
-        if (access(common_paths[i], X_OK) == 0) {
-            return common_paths[i];
+
+    if (strcmp(path, "-") == 0) {
+        writer->fd = STDOUT_FILENO;
+    } else {
+        snprintf(writer->path, sizeof(writer->path), "%s", path);
+        snprintf(writer->temp, sizeof(writer->temp), "%s.%d", path, (int)getpid());
+        writer->fd = open(writer->temp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (writer->fd < 0) {
+            printf("Error: cannot create %s: %s\n", writer->temp, strerror(errno));
+            if (compression == EXPORT_GZIP) compression_api.deflate_end(&writer->zlib);
+            if (compression == EXPORT_ZSTD) compression_api.zstd_free(writer->zstd);
+            return -1;
         }
     }
-    
-    return NULL;
+
+    if (format == EXPORT_CSV) {
+        for (int i = 0; columns[i]; i++) {
+            if (i) append_export_text(writer, ",", 1);
+            append_export_text(writer, columns[i], strlen(columns[i]));
+        }
+        append_export_text(writer, "\n", 1);
+    }
+    return 0;
+}
+
+/**
+ * Finishes the compressed stream and moves the file into place
+ * An export that failed part way is removed rather than left truncated
+ * Returns 0 on success, -1 on error
+ */
+int close_export(ExportWriter *writer) {
+    flush_export_text(writer, 1);
+    if (writer->compression == EXPORT_GZIP) compression_api.deflate_end(&writer->zlib);
+    if (writer->compression == EXPORT_ZSTD) compression_api.zstd_free(writer->zstd);
+    if (writer->fd == STDOUT_FILENO) return writer->error ? -1 : 0;
+
+    if (close(writer->fd) != 0 && !writer->error) writer->error = errno;
+    if (writer->error || rename(writer->temp, writer->path) != 0) {
+        printf("Error: export to %s failed: %s\n", writer->path, strerror(writer->error ? writer->error : errno));
+        unlink(writer->temp);
+        return -1;
+    }
+    return 0;
+}
+
+void begin_export_record(ExportWriter *writer) {
+    writer->fields = 0;
+    if (writer->format == EXPORT_NDJSON) append_export_text(writer, "{", 1);
+}
+
+void end_export_record(ExportWriter *writer) {
+    if (writer->format == EXPORT_NDJSON) append_export_text(writer, "}", 1);
+    append_export_text(writer, "\n", 1);
+    writer->records++;
+    if (writer->fd == STDOUT_FILENO && writer->compression == EXPORT_PLAIN && writer->text_length > EXPORT_BUFFER_SIZE / 2) {
+        flush_export_text(writer, 0);
+    }
+}
+
+static void append_json_string(ExportWriter *writer, const char *value, size_t length) {
+    const char *start = value, *end = value + length;
+    append_export_text(writer, "\"", 1);
+    for (const char *c = value; c < end; c++) {
+        unsigned char byte = *c;
+        if (byte >= 0x20 && byte != '"' && byte != '\\') continue;
+        append_export_text(writer, start, c - start);
+        char escape[8];
+        if (byte == '"' || byte == '\\') snprintf(escape, sizeof(escape), "\\%c", byte);
+        else if (byte == '\n') snprintf(escape, sizeof(escape), "\\n");
+        else if (byte == '\t') snprintf(escape, sizeof(escape), "\\t");
+        else snprintf(escape, sizeof(escape), "\\u%04x", byte);
+        append_export_text(writer, escape, strlen(escape));
+        start = c + 1;
+    }
+    append_export_text(writer, start, end - start);
+    append_export_text(writer, "\"", 1);
+}
+
+// CSV quoting: fields with separators, quotes or line breaks are quoted with quotes doubled
+static void append_csv_string(ExportWriter *writer, const char *value, size_t length) {
+    if (!memchr(value, ',', length) && !memchr(value, '"', length) && !memchr(value, '\n', length) && !memchr(value, '\r', length)) {
+        append_export_text(writer, value, length);
+        return;
+    }
+    const char *start = value, *end = value + length, *quote;
+    append_export_text(writer, "\"", 1);
+    while ((quote = memchr(start, '"', end - start)) != NULL) {
+        append_export_text(writer, start, quote - start + 1);
+        append_export_text(writer, "\"", 1);
+        start = quote + 1;
+    }
+    append_export_text(writer, start, end - start);
+    append_export_text(writer, "\"", 1);
+}
+
+static void export_field(ExportWriter *writer, const char *name, const char *value, size_t length, int quoted) {
+    if (writer->fields++) append_export_text(writer, writer->format == EXPORT_TEXT ? " " : ",", 1);
+    if (writer->format == EXPORT_NDJSON) {
+        append_json_string(writer, name, strlen(name));
+        append_export_text(writer, ":", 1);
+        if (quoted) append_json_string(writer, value, length);
+        else append_export_text(writer, value, length);
+    } else if (writer->format == EXPORT_CSV) {
+        append_csv_string(writer, value, length);
+    } else {
+        append_export_text(writer, value, length);
+    }
+}
+
+void export_string(ExportWriter *writer, const char *name, const char *value, size_t length) {
+    export_field(writer, name, value, length, 1);
+}
+
+void export_integer(ExportWriter *writer, const char *name, long long value) {
+    char text[32];
+    export_field(writer, name, text, snprintf(text, sizeof(text), "%lld", value), 0);
+}
+
+void export_number(ExportWriter *writer, const char *name, double value) {
+    char text[32];
+    export_field(writer, name, text, snprintf(text, sizeof(text), "%.2f", value), 0);
+}
+
+// Writes an epoch time in microseconds as local ISO 8601 time
+static void export_timestamp(ExportWriter *writer, const char *name, int64_t usec) {
+    time_t seconds = usec / 1000000;
+    struct tm tm;
+    char text[48];
+    size_t length = strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", localtime_r(&seconds, &tm));
+    length += snprintf(text + length, sizeof(text) - length, ".%06d", (int)(usec % 1000000));
+    length += strftime(text + length, sizeof(text) - length, "%z", &tm);
+    export_string(writer, name, text, length);
+}
+
+static const char *const log_export_columns[] = {"time", "unit", "priority", "source", "message", NULL};
+
+/**
+ * Streams every stored log line matching the query, oldest first
+ * Segments are mapped one at a time, so memory stays bounded by a single segment
+ */
+static void export_log_store(ExportWriter *writer, LogStore *store, const LogQuery *query) {
+    static const char *const sources[] = {"journal", "file", "kernel"};
+    uint32_t first = __atomic_load_n(&store->header->first_segment, __ATOMIC_ACQUIRE);
+    uint32_t next = __atomic_load_n(&store->header->next_segment, __ATOMIC_ACQUIRE);
+
+    for (uint32_t segment = first; segment < next && !writer->error && !stop; segment++) {
+        uint8_t *map = map_log_segment(segment, 0, 0);
+        if (!map) continue;
+
+        uint32_t *matches;
+        int found = search_log_segment(map, query, &matches);
+        const LogLineEntry *entries = (const LogLineEntry *)(map + LOG_SEGMENT_ENTRIES_OFFSET);
+        const char *text = (const char *)map + LOG_SEGMENT_TEXT_OFFSET;
+        for (int i = 0; i < found; i++) {
+            const LogLineEntry *entry = &entries[matches[i]];
+            const char *unit = store->header->units[entry->unit];
+            begin_export_record(writer);
+            export_timestamp(writer, "time", entry->time);
+            export_string(writer, "unit", unit[0] ? unit : "-", unit[0] ? strlen(unit) : 1);
+            export_string(writer, "priority", log_priority_names[entry->priority], strlen(log_priority_names[entry->priority]));
+            const char *source = entry->source < 3 ? sources[entry->source] : "unknown";
+            export_string(writer, "source", source, strlen(source));
+            export_string(writer, "message", text + entry->offset, entry->length);
+            end_export_record(writer);
+        }
+        free(matches);
+        // Exported pages are not needed again
+        madvise(map, LOG_SEGMENT_SIZE, MADV_DONTNEED);
+        munmap(map, LOG_SEGMENT_SIZE);
+    }
 }
 
+static const char *const process_export_columns[] = {
+    "pid", "ppid", "name", "state", "threads", "rss_kb", "vsize_kb", "cpu_seconds", "started", "command", NULL
+};
+
 /**
- * Detect all storage devices on the system
+ * Streams one record per process straight from /proc
  */
-void detect_all_storage_devices() {
-    const char *patterns[] = {
-        "/dev/sd*", "/dev/nvme*n*", "/dev/mmcblk*", "/dev/vd*", "/dev/hd*", NULL
-    };
+static void export_processes(ExportWriter *writer) {
+    long ticks = sysconf(_SC_CLK_TCK), page_kb = sysconf(_SC_PAGESIZE) / 1024;
+    struct timespec realtime, boottime;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_BOOTTIME, &boottime);
+    double boot_time = realtime.tv_sec - boottime.tv_sec + (realtime.tv_nsec - boottime.tv_nsec) / 1e9;
 
-    for (int i = 0; patterns[i] != NULL; i++) {
-        glob_t glob_result;
-        if (glob(patterns[i], GLOB_MARK, NULL, &glob_result) != 0) continue;
+    DIR *dir = opendir("/proc");
+    if (!dir) return;
+    struct dirent *entry;
+    char path[64], stat_line[1024], command[4096];
+
+    while ((entry = readdir(dir)) != NULL && !writer->error) {
+        if (entry->d_name[0] < '0' || entry->d_name[0] > '9') continue;
+
+        if (snprintf(path, sizeof(path), "/proc/%s/stat", entry->d_name) >= (int)sizeof(path)) continue;
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) continue;
+        ssize_t n = read(fd, stat_line, sizeof(stat_line) - 1);
+        close(fd);
+        if (n <= 0) continue;
+        stat_line[n] = '\0';
+
+        // The name is in parentheses and may itself contain spaces and parentheses
+        char *open_paren = strchr(stat_line, '('), *close_paren = strrchr(stat_line, ')');
+        if (!open_paren || !close_paren || close_paren < open_paren) continue;
+        char state;
+        int ppid;
+        unsigned long long utime, stime, starttime, vsize;
+        long threads, rss;
+        if (sscanf(close_paren + 2, "%c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu %*d %*d %*d %*d %ld %*d %llu %llu %ld",
+                   &state, &ppid, &utime, &stime, &threads, &starttime, &vsize, &rss) != 8) {
+            continue;
+        }
+
+        // cmdline separates arguments with NULs
+        ssize_t command_length = 0;
+        fd = snprintf(path, sizeof(path), "/proc/%s/cmdline", entry->d_name) < (int)sizeof(path) ? open(path, O_RDONLY | O_CLOEXEC) : -1;
+        if (fd >= 0) {
+            command_length = read(fd, command, sizeof(command));
+            close(fd);
+        }
+        if (command_length < 0) command_length = 0;
+        while (command_length > 0 && command[command_length - 1] == '\0') command_length--;
+        for (ssize_t i = 0; i < command_length; i++) {
+            if (command[i] == '\0') command[i] = ' ';
+        }
 
-        for (size_t j = 0; j < glob_result.gl_pathc; j++) {
-            char *path = glob_result.gl_pathv[j];
+        begin_export_record(writer);
+        export_integer(writer, "pid", atoll(entry->d_name));
+        export_integer(writer, "ppid", ppid);
+        export_string(writer, "name", open_paren + 1, close_paren - open_paren - 1);
+        export_string(writer, "state", &state, 1);
+        export_integer(writer, "threads", threads);
+        export_integer(writer, "rss_kb", rss * page_kb);
+        export_integer(writer, "vsize_kb", vsize / 1024);
+        export_number(writer, "cpu_seconds", (double)(utime + stime) / ticks);
+        export_timestamp(writer, "started", (int64_t)((boot_time + (double)starttime / ticks) * 1e6));
+        export_string(writer, "command", command, command_length);
+        end_export_record(writer);
+    }
+    closedir(dir);
+}
 
-            // skip partitions (like nvme0n1p1) and non-numeric devices
-            char *base = strrchr(path, '/');
-            if (!base) base = path; else base++;
-            if (strchr(base, 'p') || strspn(base, "0123456789") != 0) continue;
+static const char *const hardware_export_columns[] = {"section", "source", "content", NULL};
 
-            struct stat st;
-            if (stat(path, &st) != 0 || !S_ISBLK(st.st_mode)) continue;
+/**
+ * Writes one record per part of the hardware page, using the same probes and cache
+ */
+static void export_hardware(ExportWriter *writer) {
+    HardwareData data;
+    collect_hardware_data(&data);
 
-            printf("Detected storage device: %s\n", path);
+    for (size_t i = 0; i < sizeof(hardware_sections) / sizeof(hardware_sections[0]); i++) {
+        for (int j = 0; j < hardware_sections[i].count; j++) {
+            const CommandProbe *probe = &data.probes[hardware_sections[i].probes[j]];
+            const char *label = probe->label ? probe->label : hardware_sections[i].title;
+            size_t label_length = strlen(label);
+            if (label_length && label[label_length - 1] == ':') label_length--;
+
+            begin_export_record(writer);
+            export_string(writer, "section", hardware_sections[i].title, strlen(hardware_sections[i].title));
+            export_string(writer, "source", label, label_length);
+            export_string(writer, "content", probe->command.out.data ? probe->command.out.data : "", probe->command.out.length);
+            end_export_record(writer);
         }
-        globfree(&glob_result);
     }
+    free_hardware_data(&data);
 }
 
 /**
- * Run SmartCTL and print its report
+ * Exports logs, the process list or the hardware page to a file
+ * Format and compression follow the file name (.csv, .txt, .gz, .zst; NDJSON otherwise) unless
+ * given as format=ndjson|csv|text and compress=none|gzip|zstd; log exports accept the
+ * search_logs filters, and memory use does not grow with the size of the export
  */
-void print_smart_data() {
-    const char *smartctl_path = "/usr/sbin/smartctl";
-    const char *patterns[] = { "/dev/sd*", "/dev/nvme*n*", "/dev/mmcblk*", "/dev/vd*", "/dev/hd*", NULL };
+void export_data(const char *kind, const char *path, int argc, char **argv) {
+    ExportFormat format = EXPORT_NDJSON;
+    ExportCompression compression = EXPORT_PLAIN;
+    char base[512];
+
+    snprintf(base, sizeof(base), "%s", path);
+    if (has_suffix(base, ".gz")) {
+        compression = EXPORT_GZIP;
+        base[strlen(base) - 3] = '\0';
+    } else if (has_suffix(base, ".zst")) {
+        compression = EXPORT_ZSTD;
+        base[strlen(base) - 4] = '\0';
+    }
+    if (has_suffix(base, ".csv")) format = EXPORT_CSV;
+    else if (has_suffix(base, ".txt") || has_suffix(base, ".log")) format = EXPORT_TEXT;
+
+    // Options are taken out of the arguments; what remains is the log query
+    char **filters = calloc(argc + 1, sizeof(char *));
+    int filter_count = 0;
+    if (!filters) return;
+    for (int i = 0; i < argc; i++) {
+        if (strncmp(argv[i], "format=", 7) == 0) {
+            const char *name = argv[i] + 7;
+            if (strcmp(name, "ndjson") == 0 || strcmp(name, "json") == 0) format = EXPORT_NDJSON;
+            else if (strcmp(name, "csv") == 0) format = EXPORT_CSV;
+            else if (strcmp(name, "text") == 0) format = EXPORT_TEXT;
+            else {
+                printf("Error: unknown format %s\n", name);
+                free(filters);
+                return;
+            }
+        } else if (strncmp(argv[i], "compress=", 9) == 0) {
+            const char *name = argv[i] + 9;
+            if (strcmp(name, "none") == 0) compression = EXPORT_PLAIN;
+            else if (strcmp(name, "gzip") == 0) compression = EXPORT_GZIP;
+            else if (strcmp(name, "zstd") == 0) compression = EXPORT_ZSTD;
+            else {
+                printf("Error: unknown compression %s\n", name);
+                free(filters);
+                return;
+            }
+        } else {
+            filters[filter_count++] = argv[i];
+        }
+    }
 
-    // Check if smartctl exists
-    struct stat st;
-    if (stat(smartctl_path, &st) != 0 || !S_ISREG(st.st_mode)) {
-        fprintf(stderr, "smartctl not found at %s\n", smartctl_path);
+    const char *const *columns;
+    if (strcmp(kind, "logs") == 0) columns = log_export_columns;
+    else if (strcmp(kind, "processes") == 0) columns = process_export_columns;
+    else if (strcmp(kind, "hardware") == 0) columns = hardware_export_columns;
+    else {
+        printf("Error: unknown export %s (expected logs, processes or hardware)\n", kind);
+        free(filters);
         return;
     }
 
-    for (int i = 0; patterns[i] != NULL; i++) {
-        glob_t glob_result;
-        if (glob(patterns[i], GLOB_MARK, NULL, &glob_result) != 0) continue;
+    LogStore store;
+    LogQuery query;
+    if (columns == log_export_columns) {
+        if (open_log_store(&store, 1) == 0) {
+            ingest_logs(&store);
+            close_log_store(&store);
+        }
+        if (open_log_store(&store, 0) != 0) {
+            printf("Error: no log store (run ingest_logs first)\n");
+            free(filters);
+            return;
+        }
+        if (parse_log_query(&store, filter_count, filters, &query) != 0) {
+            close_log_store(&store);
+            free(filters);
+            return;
+        }
+    }
+    free(filters);
 
-        for (size_t j = 0; j < glob_result.gl_pathc; j++) {
-            char *device = glob_result.gl_pathv[j];
+    ExportWriter *writer = malloc(sizeof(ExportWriter));
+    if (!writer || open_export(writer, path, format, compression, columns) != 0) {
+        if (columns == log_export_columns) close_log_store(&store);
+        free(writer);
+        return;
+    }
 
-            // Skip partitions like /dev/sda1 or nvme0n1p1
-            char *base = strrchr(device, '/');
-            if (!base) base = device; else base++;
-            if (strchr(base, 'p') || strspn(base, "0123456789") != 0) continue;
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    if (columns == log_export_columns) export_log_store(writer, &store, &query);
+    else if (columns == process_export_columns) export_processes(writer);
+    else export_hardware(writer);
+    if (stop && !writer->error) writer->error = EINTR;
+
+    if (columns == log_export_columns) close_log_store(&store);
+    if (close_export(writer) == 0 && writer->fd != STDOUT_FILENO) {
+        printf("Exported: %llu records, %llu bytes (%llu before compression) to %s\n",
+               (unsigned long long)writer->records, (unsigned long long)writer->written_bytes,
+               (unsigned long long)writer->raw_bytes, path);
+    }
+    free(writer);
+}
 
-            // Only process block devices
-            if (stat(device, &st) != 0 || !S_ISBLK(st.st_mode)) continue;
+// Auth analytics: failed logins and sudo use, aggregated incrementally from the auth log
+#define AUTH_KEY_SIZE 64
+#define AUTH_WINDOW_HOURS 24
+#define AUTH_SUDO_HISTORY 500
+#define AUTH_BACKLOG 100000
+#define AUTH_REPORT_LIMIT 20
 
-            // Build command dynamically
-            size_t cmd_len = strlen("sudo ") + strlen(smartctl_path) + strlen(" -a ") +
-                             strlen(device) + strlen(" 2>/dev/null") + 1;
-            char *command = malloc(cmd_len);
-            if (!command) {
-                perror("malloc failed");
-                continue;
-            }
+// Auth-facility logs when there is no journal; Debian writes auth.log, Red Hat secure
+static const char *const auth_log_files[] = {"/var/log/auth.log", "/var/log/secure", NULL};
 
-            snprintf(command, cmd_len, "sudo %s -a %s 2>/dev/null", smartctl_path, device);
+// Journal entries logged with the auth and authpriv facilities
+static const char *const auth_journal_matches[] = {"SYSLOG_FACILITY=4", "SYSLOG_FACILITY=10", NULL};
 
-            printf("\n === S.M.A.R.T. Data for %s ===\n", device);
-            printf("Executing: %s\n\n", command);
+// Failure counts of one source address or user name, total and per hour over the last day
+typedef struct {
+    char key[AUTH_KEY_SIZE];    // Empty for a free slot
+    uint64_t failures;
+    uint64_t sudo_commands;     // Users only
+    uint32_t hourly[AUTH_WINDOW_HOURS];     // Indexed by hour since the epoch % AUTH_WINDOW_HOURS
+    int64_t hour;               // Hour of the newest bucket
+    time_t first_seen;
+    time_t last_seen;
+    char last_user[AUTH_KEY_SIZE];  // Addresses only: the user name last tried
+} AuthCounter;
+
+// Open-addressing hash table of counters keyed by string, kept at most 3/4 full
+typedef struct {
+    AuthCounter *slots;
+    size_t capacity;            // Power of two
+    size_t count;
+} AuthTable;
 
-            FILE *pipe = popen(command, "r");
-            if (!pipe) {
-                perror("popen failed");
-                free(command);
-                continue;
-            }
+typedef struct {
+    time_t time;
+    int allowed;
+    char user[AUTH_KEY_SIZE];
+    char runas[AUTH_KEY_SIZE];
+    char tty[32];
+    char pwd[256];
+    char command[512];
+} SudoRecord;
 
-            char buffer[256];
-            while (fgets(buffer, sizeof(buffer), pipe) != NULL) {
-                printf("%s", buffer);
-            }
+typedef struct {
+    AuthTable by_address;
+    AuthTable by_user;
+    SudoRecord *sudo;           // Ring of the last AUTH_SUDO_HISTORY commands
+    int sudo_head;
+    int sudo_count;
+    char journal_cursor[256];
+    int changed;                // Something was counted since loading
+} AuthStats;
+
+static uint64_t auth_key_hash(const char *key) {
+    uint64_t hash = 1469598103934665603ull;
+    for (const char *c = key; *c; c++) hash = (hash ^ (unsigned char)*c) * 1099511628211ull;
+    return hash;
+}
 
-            pclose(pipe);
-            free(command);
+/**
+ * Returns the counter for key, adding it when absent
+ * Returns NULL if the table cannot grow
+ */
+static AuthCounter *auth_counter(AuthTable *table, const char *key) {
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 64;
+        AuthCounter *slots = calloc(capacity, sizeof(AuthCounter));
+        if (!slots) return NULL;
+        for (size_t i = 0; i < table->capacity; i++) {
+            if (!table->slots[i].key[0]) continue;
+            size_t j = auth_key_hash(table->slots[i].key) & (capacity - 1);
+            while (slots[j].key[0]) j = (j + 1) & (capacity - 1);
+            slots[j] = table->slots[i];
         }
+        free(table->slots);
+        table->slots = slots;
+        table->capacity = capacity;
+    }
 
-        globfree(&glob_result);
+    size_t i = auth_key_hash(key) & (table->capacity - 1);
+    while (table->slots[i].key[0]) {
+        if (strncmp(table->slots[i].key, key, AUTH_KEY_SIZE - 1) == 0) return &table->slots[i];
+        i = (i + 1) & (table->capacity - 1);
     }
+    snprintf(table->slots[i].key, AUTH_KEY_SIZE, "%s", key);
+    table->count++;
+    return &table->slots[i];
 }
 
-void print_uname_info() {
-    struct utsname info;
-    if (uname(&info) == 0) {
-        printf("\n=== System Information (uname) ===\n");
-        printf("OS: %s\n", info.sysname);
-        printf("Hostname: %s\n", info.nodename);
-        printf("Kernel Release: %s\n", info.release);
-        printf("Kernel Version: %s\n", info.version);
-        printf("Architecture: %s\n", info.machine);
-    } else {
-        perror("uname failed");
+// Moves the hourly window forward to hour, clearing the buckets it passes
+static void advance_auth_window(AuthCounter *counter, int64_t hour) {
+    if (hour <= counter->hour) return;
+    int64_t steps = hour - counter->hour;
+    if (steps > AUTH_WINDOW_HOURS) steps = AUTH_WINDOW_HOURS;
+    for (int64_t h = hour - steps + 1; h <= hour; h++) counter->hourly[h % AUTH_WINDOW_HOURS] = 0;
+    counter->hour = hour;
+}
+
+static void count_auth_failure(AuthCounter *counter, time_t time) {
+    int64_t hour = time / 3600;
+    advance_auth_window(counter, hour);
+    // Lines older than the window still count towards the total
+    if (hour > counter->hour - AUTH_WINDOW_HOURS) counter->hourly[hour % AUTH_WINDOW_HOURS]++;
+    counter->failures++;
+    if (!counter->first_seen || time < counter->first_seen) counter->first_seen = time;
+    if (time > counter->last_seen) counter->last_seen = time;
+}
+
+// Failures in the last day as of now
+static uint64_t recent_auth_failures(const AuthCounter *counter, time_t now) {
+    int64_t hour = now / 3600;
+    uint64_t total = 0;
+    for (int64_t h = hour - AUTH_WINDOW_HOURS + 1; h <= hour; h++) {
+        if (h <= counter->hour && h > counter->hour - AUTH_WINDOW_HOURS) total += counter->hourly[h % AUTH_WINDOW_HOURS];
     }
+    return total;
 }
 
-void print_detailed_os_info() {
-    printf("\n=== Detailed OS Information ===\n");
-    
-    const char *release_files[] = {
-        "/etc/os-release",
-        "/usr/lib/os-release",
-        "/etc/lsb-release",
-        "/etc/debian_version",
-        "/etc/redhat-release",
-        "/etc/centos-release",
-        "/etc/fedora-release",
-        "/etc/SuSE-release",
-        "/etc/arch-release",
-        NULL
-    };
-    
-    for (int i = 0; release_files[i] != NULL; i++) {
-        FILE *fp = fopen(release_files[i], "r");
-        if (fp) {
-            printf("--- %s ---\n", release_files[i]);
-            char line[256];
-            while (fgets(line, sizeof(line), fp)) {
-                printf("%s", line);
-            }
-            fclose(fp);
-            printf("\n");
-        }
+static void record_login_failure(AuthStats *stats, time_t time, const char *address, const char *user) {
+    AuthCounter *counter = auth_counter(&stats->by_address, address[0] ? address : "local");
+    if (counter) {
+        count_auth_failure(counter, time);
+        if (user[0]) snprintf(counter->last_user, AUTH_KEY_SIZE, "%s", user);
     }
+    counter = user[0] ? auth_counter(&stats->by_user, user) : NULL;
+    if (counter) count_auth_failure(counter, time);
 }
 
-void print_kernel_details() {
-    printf("\n=== Kernel Details ===\n");
-    
-    FILE *fp = fopen("/proc/version", "r");
-    if (fp) {
-        char version[256];
-        if (fgets(version, sizeof(version), fp)) {
-            printf("Full Kernel Version: %s", version);
-        }
-        fclose(fp);
+// Copies the word after prefix in text (up to a space or ';') to out; returns 0 if prefix is absent
+static int copy_auth_word(const char *text, const char *prefix, char *out, size_t size) {
+    const char *start = strstr(text, prefix);
+    if (!start) return 0;
+    start += strlen(prefix);
+    size_t length = strcspn(start, " ;");
+    if (length >= size) length = size - 1;
+    memcpy(out, start, length);
+    out[length] = '\0';
+    return 1;
+}
+
+/**
+ * Parses a sudo record: "alice : TTY=pts/0 ; PWD=/home/alice ; USER=root ; COMMAND=/usr/bin/id"
+ * Denials carry a reason before the fields ("3 incorrect password attempts", "user NOT in sudoers")
+ */
+static void parse_sudo_message(AuthStats *stats, time_t time, const char *message) {
+    const char *separator = strstr(message, " : ");
+    const char *command = strstr(message, "COMMAND=");
+    if (!separator || !command) return;
+
+    SudoRecord *record = &stats->sudo[stats->sudo_head];
+    memset(record, 0, sizeof(*record));
+    record->time = time;
+    while (*message == ' ') message++;
+    snprintf(record->user, sizeof(record->user), "%.*s", (int)(separator - message), message);
+    copy_auth_word(separator, "TTY=", record->tty, sizeof(record->tty));
+    copy_auth_word(separator, "USER=", record->runas, sizeof(record->runas));
+    // The working directory and command run to the next " ; " or the end and may contain spaces
+    const char *pwd = strstr(separator, "PWD=");
+    if (pwd) {
+        pwd += 4;
+        const char *end = strstr(pwd, " ; ");
+        snprintf(record->pwd, sizeof(record->pwd), "%.*s", (int)(end ? end - pwd : (long)strlen(pwd)), pwd);
     }
-    
-    fp = fopen("/proc/version_signature", "r");
-    if (fp) {
-        char sig[256];
-        if (fgets(sig, sizeof(sig), fp)) {
-            printf("Kernel Signature: %s", sig);
-        }
-        fclose(fp);
+    snprintf(record->command, sizeof(record->command), "%s", command + 8);
+
+    // A denied command starts with the reason instead of TTY=
+    const char *fields = separator + 3;
+    record->allowed = strncmp(fields, "TTY=", 4) == 0 || strncmp(fields, "HOST=", 5) == 0;
+    if (!record->allowed && strstr(fields, "incorrect password")) record_login_failure(stats, time, "local", record->user);
+
+    AuthCounter *counter = auth_counter(&stats->by_user, record->user);
+    if (counter && record->allowed) counter->sudo_commands++;
+
+    stats->sudo_head = (stats->sudo_head + 1) % AUTH_SUDO_HISTORY;
+    if (stats->sudo_count < AUTH_SUDO_HISTORY) stats->sudo_count++;
+}
+
+/**
+ * Counts one auth log message: sshd failures, PAM authentication failures of other
+ * programs, and sudo records
+ * An invalid user name counts once per connection ("Invalid user"), not again per password
+ */
+static void parse_auth_message(AuthStats *stats, time_t time, const char *ident, const char *message) {
+    char user[AUTH_KEY_SIZE] = "", address[AUTH_KEY_SIZE] = "";
+    stats->changed = 1;
+
+    if (strcmp(ident, "sudo") == 0) {
+        parse_sudo_message(stats, time, message);
+        return;
     }
-    
-    fp = fopen("/proc/cmdline", "r");
-    if (fp) {
-        char cmdline[1024];
-        if (fgets(cmdline, sizeof(cmdline), fp)) {
-            printf("Kernel Command Line: %s\n", cmdline);
+
+    if (strncmp(ident, "sshd", 4) == 0) {
+        const char *rest;
+        if (strncmp(message, "Failed ", 7) == 0 && (rest = strstr(message, " for ")) != NULL) {
+            rest += 5;
+            if (strncmp(rest, "invalid user ", 13) == 0) return;
+            copy_auth_word(rest, "", user, sizeof(user));
+        } else if (strncmp(message, "Invalid user ", 13) == 0) {
+            // The name may be empty: "Invalid user  from 1.2.3.4"
+            copy_auth_word(message, "Invalid user ", user, sizeof(user));
+        } else {
+            return;
         }
-        fclose(fp);
+        copy_auth_word(message, " from ", address, sizeof(address));
+        record_login_failure(stats, time, address, user);
+        return;
+    }
+
+    // pam_unix(login:auth): authentication failure; logname= uid=0 euid=0 tty=tty1 ruser= rhost= user=alice
+    // sshd and sudo log their own line for the same attempt, so theirs are not counted twice
+    if (strstr(message, "authentication failure;")) {
+        if (!copy_auth_word(message, " user=", user, sizeof(user))) copy_auth_word(message, " ruser=", user, sizeof(user));
+        copy_auth_word(message, " rhost=", address, sizeof(address));
+        record_login_failure(stats, time, address, user);
     }
-    
-    printf("Kernel Architecture: ");
-    #if defined(__x86_64__)
-    printf("x86_64\n");
-    #elif defined(__i386__)
-    printf("i386\n");
-    #elif defined(__aarch64__)
-    printf("ARM64\n");
-    #elif defined(__arm__)
-    printf("ARM\n");
-    #elif defined(__powerpc64__)
-    printf("PPC64\n");
-    #elif defined(__mips__)
-    printf("MIPS\n");
-    #else
-    printf("Unknown\n");
-    #endif
 }
 
-void print_distribution_info() {
-    const char *package_managers[] = {
-        "/etc/apt/sources.list",
-        "/etc/yum.repos.d/",
-        "/etc/dnf/dnf.conf",
-        "/etc/zypp/zypp.conf",
-        "/etc/pacman.conf",
-        "/etc/portage/make.conf",
-        "/etc/emerge/",
-        NULL
-    };
-    
-    const char *pm_names[] = {
-        "APT (Debian/Ubuntu)",
-        "YUM (RedHat/CentOS)",
-        "DNF (Fedora/RHEL8+)",
-        "Zypper (openSUSE)",
-        "Pacman (Arch)",
-        "Portage (Gentoo)",
-        "Emerge (Gentoo)"
-    };
-    
-    // Package Manager
-    for (int i = 0; package_managers[i] != NULL; i++) {
-        FILE *fp = fopen(package_managers[i], "r");
-        if (fp) {
-            printf("%s\n", pm_names[i]);
-            fclose(fp);
-            break;
-        }
-        if (strstr(package_managers[i], "/etc/yum.repos.d/") || 
-            strstr(package_managers[i], "/etc/emerge/")) {
-            DIR *dir = opendir(package_managers[i]);
-            if (dir) {
-                printf("%s\n", pm_names[i]);
-                closedir(dir);
-                break;
-            }
-        }
+static void ingest_auth_journal_entry(const JournalEntry *entry, void *context) {
+    parse_auth_message(context, entry->time / 1000000, entry->ident, entry->message);
+}
+
+static void ingest_auth_log_line(const char *path, const char *line, int length, void *context) {
+    char ident[AUTH_KEY_SIZE], message[LOG_MAX_MESSAGE];
+    const char *text;
+    (void)path;
+    int64_t time = parse_syslog_line(line, length, ident, sizeof(ident), &text);
+    snprintf(message, sizeof(message), "%.*s", (int)(line + length - text), text);
+    parse_auth_message(context, time / 1000000, ident, message);
+}
+
+// Whether the journal holds any entries at all, in which case it is the auth source
+static int journal_in_use() {
+    sd_journal *journal = open_journal_at(NULL, NULL, 0, NULL);
+    if (!journal) return 0;
+    sd_journal_api.seek_head(journal);
+    int used = sd_journal_api.next(journal) > 0;
+    sd_journal_api.close(journal);
+    return used;
+}
+
+static void free_auth_stats(AuthStats *stats) {
+    free(stats->by_address.slots);
+    free(stats->by_user.slots);
+    free(stats->sudo);
+    memset(stats, 0, sizeof(*stats));
+}
+
+static void save_auth_counters(FILE *fp, const char *kind, const AuthTable *table) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        const AuthCounter *counter = &table->slots[i];
+        if (!counter->key[0]) continue;
+        fprintf(fp, "%s\t%s\t%llu\t%llu\t%lld\t%lld\t%lld\t", kind, counter->key, (unsigned long long)counter->failures,
+                (unsigned long long)counter->sudo_commands, (long long)counter->first_seen, (long long)counter->last_seen,
+                (long long)counter->hour);
+        for (int h = 0; h < AUTH_WINDOW_HOURS; h++) fprintf(fp, "%s%u", h ? "," : "", counter->hourly[h]);
+        fprintf(fp, "\t%s\n", counter->last_user[0] ? counter->last_user : "-");
     }
-    
-    // Init System
-    FILE *fp = fopen("/proc/1/comm", "r");
-    if (fp) {
-        char init_system[32];
-        if (fgets(init_system, sizeof(init_system), fp)) {
-            init_system[strcspn(init_system, "\n")] = 0;
-            printf("%s\n", init_system);
-        }
+}
+
+/**
+ * Writes the aggregates and the position reached to auth-stats in the user cache directory
+ * Fields are tab-separated so sudo working directories and commands can contain spaces
+ */
+static void save_auth_stats(const AuthStats *stats) {
+    char path[512], temp[520];
+    if (build_user_path("XDG_CACHE_HOME", ".cache", "auth-stats", path, sizeof(path)) != 0 || ensure_parent_directory(path) != 0) return;
+
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int)getpid());
+    FILE *fp = fopen(temp, "w");
+    if (!fp) return;
+    fprintf(fp, "AUTH1\ncursor\t%s\n", stats->journal_cursor[0] ? stats->journal_cursor : "-");
+    save_auth_counters(fp, "address", &stats->by_address);
+    save_auth_counters(fp, "user", &stats->by_user);
+    for (int i = 0; i < stats->sudo_count; i++) {
+        const SudoRecord *record = &stats->sudo[(stats->sudo_head - stats->sudo_count + i + AUTH_SUDO_HISTORY) % AUTH_SUDO_HISTORY];
+        fprintf(fp, "sudo\t%lld\t%d\t%s\t%s\t%s\t%s\t%s\n", (long long)record->time, record->allowed, record->user,
+                record->runas[0] ? record->runas : "-", record->tty[0] ? record->tty : "-",
+                record->pwd[0] ? record->pwd : "-", record->command);
+    }
+    if (fclose(fp) != 0 || rename(temp, path) != 0) unlink(temp);
+}
+
+// Splits a tab-separated line in place; returns the number of fields
+static int split_tabs(char *line, char **fields, int max) {
+    int count = 0;
+    line[strcspn(line, "\n")] = '\0';
+    while (count < max) {
+        fields[count++] = line;
+        char *tab = strchr(line, '\t');
+        if (!tab) break;
+        *tab = '\0';
+        line = tab + 1;
+    }
+    return count;
+}
+
+static const char *auth_field(const char *value) {
+    return strcmp(value, "-") == 0 ? "" : value;
+}
+
+static int load_auth_stats(AuthStats *stats) {
+    char path[512], line[2048], *fields[9];
+    memset(stats, 0, sizeof(*stats));
+    stats->sudo = calloc(AUTH_SUDO_HISTORY, sizeof(SudoRecord));
+    if (!stats->sudo) return -1;
+
+    FILE *fp = build_user_path("XDG_CACHE_HOME", ".cache", "auth-stats", path, sizeof(path)) == 0 ? fopen(path, "r") : NULL;
+    if (!fp) return 0;
+    if (!fgets(line, sizeof(line), fp) || strcmp(line, "AUTH1\n") != 0) {
         fclose(fp);
-    } else {
-        FILE *cmd = popen("ps -p 1 -o comm= 2>/dev/null", "r");
-        if (cmd) {
-            char init_system[32];
-            if (fgets(init_system, sizeof(init_system), cmd)) {
-                init_system[strcspn(init_system, "\n")] = 0;
-                printf("%s\n", init_system);
-            }
-            pclose(cmd);
-        } else {
-            char init_path[256];
-            ssize_t len = readlink("/sbin/init", init_path, sizeof(init_path)-1);
-            if (len != -1) {
-                init_path[len] = '\0';
-                char *basename = strrchr(init_path, '/');
-                printf("%s\n", basename ? basename + 1 : init_path);
-            } else {
-                printf("Unknown\n");
-            }
-        }
+        return 0;
     }
 
-    // Distribution version
-    const char *version_files[] = {
-        "/etc/debian_version",
-        "/etc/redhat-release",
-        "/etc/centos-release", 
-        "/etc/fedora-release",
-        "/etc/SuSE-release",
-        "/etc/arch-release",
-        "/etc/slackware-version",
-        "/etc/gentoo-release",
-        NULL
-    };
-    
-    for (int i = 0; version_files[i] != NULL; i++) {
-        fp = fopen(version_files[i], "r");
-        if (fp) {
-            char version[128];
-            if (fgets(version, sizeof(version), fp)) {
-                version[strcspn(version, "\n")] = 0;
-                printf("%s\n", version);
+    while (fgets(line, sizeof(line), fp)) {
+        int count = split_tabs(line, fields, 9);
+        if (strcmp(fields[0], "cursor") == 0 && count == 2) {
+            snprintf(stats->journal_cursor, sizeof(stats->journal_cursor), "%s", auth_field(fields[1]));
+        } else if ((strcmp(fields[0], "address") == 0 || strcmp(fields[0], "user") == 0) && count == 9) {
+            AuthCounter *counter = auth_counter(fields[0][0] == 'a' ? &stats->by_address : &stats->by_user, fields[1]);
+            if (!counter) break;
+            counter->failures = strtoull(fields[2], NULL, 10);
+            counter->sudo_commands = strtoull(fields[3], NULL, 10);
+            counter->first_seen = strtoll(fields[4], NULL, 10);
+            counter->last_seen = strtoll(fields[5], NULL, 10);
+            counter->hour = strtoll(fields[6], NULL, 10);
+            char *cursor = fields[7];
+            for (int h = 0; h < AUTH_WINDOW_HOURS && *cursor; h++) {
+                counter->hourly[h] = strtoul(cursor, &cursor, 10);
+                if (*cursor == ',') cursor++;
             }
-            fclose(fp);
-            break;
+            snprintf(counter->last_user, AUTH_KEY_SIZE, "%s", auth_field(fields[8]));
+        } else if (strcmp(fields[0], "sudo") == 0 && count == 8) {
+            SudoRecord *record = &stats->sudo[stats->sudo_head];
+            record->time = strtoll(fields[1], NULL, 10);
+            record->allowed = atoi(fields[2]);
+            snprintf(record->user, sizeof(record->user), "%s", fields[3]);
+            snprintf(record->runas, sizeof(record->runas), "%s", auth_field(fields[4]));
+            snprintf(record->tty, sizeof(record->tty), "%s", auth_field(fields[5]));
+            snprintf(record->pwd, sizeof(record->pwd), "%s", auth_field(fields[6]));
+            snprintf(record->command, sizeof(record->command), "%s", fields[7]);
+            stats->sudo_head = (stats->sudo_head + 1) % AUTH_SUDO_HISTORY;
+            if (stats->sudo_count < AUTH_SUDO_HISTORY) stats->sudo_count++;
         }
     }
-    
-    // Systemd version
-    fp = fopen("/proc/1/comm", "r");
-    if (fp) {
-        char init_system[32];
-        if (fgets(init_system, sizeof(init_system), fp)) {
-            init_system[strcspn(init_system, "\n")] = 0;
-            if (strcmp(init_system, "systemd") == 0) {
-                FILE *cmd = popen("systemctl --version 2>/dev/null | head -1 | awk '{print $2}'", "r");
-                if (cmd) {
-                    char systemd_version[64];
-                    if (fgets(systemd_version, sizeof(systemd_version), cmd)) {
-                        systemd_version[strcspn(systemd_version, "\n")] = 0;
-                        printf("%s\n", systemd_version);
-                    }
-                    pclose(cmd);
-                }
+    fclose(fp);
+    return 0;
+}
+
+/**
+ * Loads the saved aggregates and folds in only what was logged since: journal entries after
+ * the saved cursor, or the bytes appended to auth.log/secure since the saved offsets
+ * The first run reads up to AUTH_BACKLOG entries of history
+ * Returns 0 on success, -1 on error
+ */
+int update_auth_stats(AuthStats *stats) {
+    if (load_auth_stats(stats) != 0) return -1;
+
+    if (stats->journal_cursor[0] || journal_in_use()) {
+        sd_journal *journal = open_journal_at(stats->journal_cursor[0] ? stats->journal_cursor : NULL, NULL,
+                                              AUTH_BACKLOG, auth_journal_matches);
+        if (journal) {
+            char *position = NULL;
+            while (read_journal_entries(journal, JOURNAL_MAX_BATCH, ingest_auth_journal_entry, stats) > 0) {
+            }
+            if (sd_journal_api.get_cursor(journal, &position) >= 0 && position) {
+                snprintf(stats->journal_cursor, sizeof(stats->journal_cursor), "%s", position);
+                free(position);
             }
+            sd_journal_api.close(journal);
         }
-        fclose(fp);
+    } else {
+        follow_log_files(auth_log_files, "auth-offsets", AUTH_BACKLOG, ingest_auth_log_line, stats, 0);
     }
+
+    if (stats->changed) save_auth_stats(stats);
+    return 0;
 }
 
-void print_library_versions() {
-    printf("\n=== Library Versions ===\n");
-    
-    printf("GLIBC Version: %s\n", gnu_get_libc_version());
-    printf("GLIBC Release: %s\n", gnu_get_libc_release());
-    
-    #ifdef __GLIBC__
-    printf("Using GLIBC: %d.%d\n", __GLIBC__, __GLIBC_MINOR__);
-    #endif
-    
-    #ifdef __GNUC__
-    printf("GCC Version: %d.%d.%d\n", __GNUC__, __GNUC_MINOR__, __GNUC_PATCHLEVEL__);
-    #endif
-    
-    #ifdef __STDC_VERSION__
-    printf("C Standard: %ld\n", __STDC_VERSION__);
-    #endif
+static time_t auth_report_now;
+
+// Most failures in the last day first, then most failures overall
+static int compare_auth_counters(const void *a, const void *b) {
+    const AuthCounter *left = *(const AuthCounter *const *)a, *right = *(const AuthCounter *const *)b;
+    uint64_t left_recent = recent_auth_failures(left, auth_report_now), right_recent = recent_auth_failures(right, auth_report_now);
+    if (left_recent != right_recent) return left_recent < right_recent ? 1 : -1;
+    if (left->failures != right->failures) return left->failures < right->failures ? 1 : -1;
+    return strcmp(left->key, right->key);
 }
 
-void print_security_info() {
-    printf("\n=== Security & Update Information ===\n");
-    
-    FILE *fp = fopen("/etc/apt/sources.list", "r");
-    if (fp) {
-        char line[256];
-        int security_updates = 0;
-        while (fgets(line, sizeof(line), fp)) {
-            if (strstr(line, "security") || strstr(line, "updates")) {
-                security_updates = 1;
-                break;
-            }
-        }
-        fclose(fp);
-        printf("Security updates configured: %s\n", security_updates ? "Yes" : "No");
+static void print_auth_counters(const char *label, const AuthTable *table, int limit, time_t now) {
+    const AuthCounter **sorted = malloc((table->count ? table->count : 1) * sizeof(AuthCounter *));
+    int count = 0;
+    if (!sorted) return;
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->slots[i].key[0] && table->slots[i].failures) sorted[count++] = &table->slots[i];
     }
-    
-    fp = fopen("/var/lib/apt/periodic/update-success-stamp", "r");
-    if (fp) {
-        char timestamp[64];
-        if (fgets(timestamp, sizeof(timestamp), fp)) {
-            printf("Last successful update: %s", timestamp);
-        }
-        fclose(fp);
+    auth_report_now = now;
+    qsort(sorted, count, sizeof(AuthCounter *), compare_auth_counters);
+
+    for (int i = 0; i < count && i < limit; i++) {
+        char first[32], last[32];
+        struct tm tm;
+        strftime(first, sizeof(first), "%Y-%m-%d %H:%M:%S", localtime_r(&sorted[i]->first_seen, &tm));
+        strftime(last, sizeof(last), "%Y-%m-%d %H:%M:%S", localtime_r(&sorted[i]->last_seen, &tm));
+        printf("%s=%s failures=%llu last_24h=%llu first=\"%s\" last=\"%s\"", label, sorted[i]->key,
+               (unsigned long long)sorted[i]->failures, (unsigned long long)recent_auth_failures(sorted[i], now), first, last);
+        if (sorted[i]->last_user[0]) printf(" user=%s", sorted[i]->last_user);
+        printf("\n");
     }
-    
-    fp = fopen("/sys/kernel/security/lsm", "r");
-    if (fp) {
-        char lsm[256];
-        if (fgets(lsm, sizeof(lsm), fp)) {
-            printf("Security Modules: %s", lsm);
-        }
-        fclose(fp);
+    free(sorted);
+}
+
+/**
+ * Prints failed login attempts by source address and by user, busiest in the last day first
+ */
+void print_failed_logins(int limit) {
+    AuthStats stats;
+    if (update_auth_stats(&stats) != 0) {
+        printf("Error: cannot allocate auth statistics\n");
+        return;
     }
-    printf("\n");
+    time_t now = time(NULL);
+    printf("Failed login attempts by source (%zu sources):\n", stats.by_address.count);
+    print_auth_counters("source", &stats.by_address, limit, now);
+    printf("\nFailed login attempts by user:\n");
+    print_auth_counters("user", &stats.by_user, limit, now);
+    free_auth_stats(&stats);
 }
 
-void print_system_limits() {
-    printf("=== System Limits ===\n");
-    
-    FILE *fp = fopen("/proc/sys/kernel/pid_max", "r");
-    if (fp) {
-        char pid_max[32];
-        if (fgets(pid_max, sizeof(pid_max), fp)) {
-            printf("Maximum PID: %s", pid_max);
-        }
-        fclose(fp);
+/**
+ * Prints the most recent sudo commands, oldest first, with denied attempts marked
+ */
+void print_sudo_history(int limit) {
+    AuthStats stats;
+    if (update_auth_stats(&stats) != 0) {
+        printf("Error: cannot allocate auth statistics\n");
+        return;
     }
-    
-    fp = fopen("/proc/sys/kernel/threads-max", "r");
-    if (fp) {
-        char threads_max[32];
-        if (fgets(threads_max, sizeof(threads_max), fp)) {
-            printf("Maximum threads: %s", threads_max);
-        }
-        fclose(fp);
+    int count = stats.sudo_count < limit ? stats.sudo_count : limit;
+    for (int i = 0; i < count; i++) {
+        const SudoRecord *record = &stats.sudo[(stats.sudo_head - count + i + AUTH_SUDO_HISTORY) % AUTH_SUDO_HISTORY];
+        char stamp[32];
+        struct tm tm;
+        strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", localtime_r(&record->time, &tm));
+        printf("Sudo %s %s -> %s tty=%s pwd=%s%s: %s\n", stamp, record->user, record->runas[0] ? record->runas : "?",
+               record->tty[0] ? record->tty : "-", record->pwd[0] ? record->pwd : "-", record->allowed ? "" : " DENIED",
+               record->command);
     }
-    
-    fp = fopen("/proc/sys/kernel/pty/max", "r");
-    if (fp) {
-        char pty_max[32];
-        if (fgets(pty_max, sizeof(pty_max), fp)) {
-            printf("Maximum PTYs: %s", pty_max);
+    printf("Sudo commands: %d shown", count);
+    for (size_t i = 0; i < stats.by_user.capacity; i++) {
+        if (stats.by_user.slots[i].sudo_commands) {
+            printf(", %s=%llu", stats.by_user.slots[i].key, (unsigned long long)stats.by_user.slots[i].sudo_commands);
         }
-        fclose(fp);
     }
+    printf("\n");
+    free_auth_stats(&stats);
 }
 
-// Note: To run this function, run the program without root privileges
-void check_startup_directories() {
-    printf("\n=== STARTUP APPLICATIONS ===\n");
+int view_system_logs() {
+    printf("System Log Viewer\n");
+    printf("=================\n\n");
     
-    const char *dirs[] = {
-        "~/.config/autostart",
-        "~/.config/autostart-scripts",
-        "/etc/xdg/autostart",
-        "~/.kde/Autostart",
-        "~/.local/share/autostart",
-        NULL
+    printf("Current user UID: %d\n", getuid());
+    printf("Current user GID: %d\n\n", getgid());
+    
+    // Try different methods to read logs; head/tail limits are applied to the captured output,
+    // and sources with a native reader only fall back to their command when it fails
+    const struct {
+        const char *description;
+        const char *command;
+        const char *const *argv;
+        int head;
+        int tail;
+        int (*native)(void);
+        const char *file;       // Read natively from the end instead of through a command
+    } sources[] = {
+        {"System Journal (journalctl):", "journalctl -n 30 --no-pager",
+         (const char *const[]){"journalctl", "-n", "30", "--no-pager", NULL}, 0, 0, print_recent_journal, NULL},
+        {"Kernel Messages (dmesg):", "dmesg | tail -30", (const char *const[]){"dmesg", NULL}, 0, 30,
+         print_recent_kernel_messages, NULL},
+        {"System Log (/var/log/syslog):", "tail -n 20 /var/log/syslog", NULL, 0, 0, NULL, "/var/log/syslog"},
+        {"System Messages (/var/log/messages):", "tail -n 20 /var/log/messages", NULL, 0, 0, NULL, "/var/log/messages"},
+        {"Auth Log (/var/log/auth.log):", "tail -n 20 /var/log/auth.log", NULL, 0, 0, NULL, "/var/log/auth.log"},
+        {"Kernel Log (/var/log/kern.log):", "tail -n 20 /var/log/kern.log", NULL, 0, 0, NULL, "/var/log/kern.log"},
+        {"Log Directory Contents:", "ls -la /var/log/ | head -10", (const char *const[]){"ls", "-la", "/var/log/", NULL}, 10, 0,
+         NULL, NULL},
     };
     
-    char expanded_path[512];
-    char *home = getenv("HOME");
-
-    for (int i = 0; dirs[i] != NULL; i++) {
-        // Expand ~ to home directory
-        if (dirs[i][0] == '~' && home != NULL) {
-            snprintf(expanded_path, sizeof(expanded_path), "%s%s", home, dirs[i] + 1);
-        } else {
-            strncpy(expanded_path, dirs[i], sizeof(expanded_path));
-            expanded_path[sizeof(expanded_path)-1] = '\0';
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        printf("\n=== %s ===\n", sources[i].description);
+        printf("Command: %s\n", sources[i].command);
+        printf("Output:\n");
+        printf("--------\n");
+        
+        if (sources[i].native && sources[i].native() == 0) {
+            printf("\n");
+            continue;
         }
-
-        printf("\nChecking: %s\n", expanded_path);
-
-        DIR *dir = opendir(expanded_path);
-        if (!dir) {
-            printf("  Directory not found or inaccessible\n");
+        if (sources[i].file) {
+            if (print_last_lines(sources[i].file) != 0) printf("Command failed or no output\n");
+            printf("\n");
             continue;
         }
 
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != NULL) {
-            // Include regular files and symlinks (for .desktop files)
-            if (entry->d_type == DT_REG || entry->d_type == DT_LNK) {
-                const char *ext = strrchr(entry->d_name, '.');
-                if (ext && strcmp(ext, ".desktop") == 0) {
-                    printf("  %s\n", entry->d_name);
-                }
-            }
+        StringBuffer output = {0};
+        int result = run_command(sources[i].argv, SPAWN_DEFAULT_TIMEOUT_MS, SPAWN_STDERR_DISCARD, &output);
+        if (sources[i].head) keep_first_lines(&output, sources[i].head);
+        if (sources[i].tail) keep_last_lines(&output, sources[i].tail);
+        if (output.length) fwrite(output.data, 1, output.length, stdout);
+        if (result != 0) {
+            printf("Command failed or no output\n");
         }
-        closedir(dir);
+        free_string_buffer(&output);
+        printf("\n");
     }
+    
+    return 0;
 }
 
-// Note: To run this function, run the program without root privileges
-void check_systemd_user_services() {
-    printf("\n=== SYSTEMD USER SERVICES (STARTUP) ===\n");
-    system("systemctl --user list-unit-files --type=service --state=enabled | grep -E '(enabled|autostart)' | head -10");
-}
+/**
+ * Counts the processes currently listed in /proc
+ * Returns -1 if /proc cannot be opened
+ */
+int count_processes() {
+    DIR *dir = opendir("/proc");
+    if (!dir) return -1;
 
-void detect_all_package_managers() {
-    const char *managers[] = {
-        "apt",
-        "yum",
-        "dnf",
-        "pacman",
-        "zypper",
-        "brew",
-        "choco",
-        "winget"
-    };
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] >= '0' && entry->d_name[0] <= '9') count++;
+    }
+    closedir(dir);
+    return count;
+}
 
-    const char *version_flags[] = {
-        "--version",
-        "--version",
-        "--version",
-        "--version",
-        "--version",
-        "--version",
-        "--version",
-        "--version"
-    };
+static void record_metric(const char *name, time_t now, float value) {
+    TimeSeries *series = history_series(name);
+    if (series) add_to_history(series, now, value);
+}
 
-    const char *list_flags[] = {
-        "list --installed", // apt
-        "list installed",   // yum
-        "list installed",   // dnf
-        "-Q",               // pacman
-        "se -i",            // zypper
-        "list",             // brew
-        "list -l",          // choco
-        "list"              // winget
+/**
+ * Takes one sample of every monitored metric and feeds it into the history store
+ * Sensors that are not present are skipped rather than recorded as -1
+ */
+void sample_system_metrics(time_t now) {
+    static const struct {
+        const char *name;
+        float (*read)(void);
+    } sensors[] = {
+        {"cpu_temp", read_cpu_temperature},
+        {"gpu_temp", read_gpu_temperature},
+        {"vrm_temp", read_vrm_temperature},
+        {"chipset_temp", read_chipset_temperature},
+        {"motherboard_temp", read_motherboard_temperature},
+        {"psu_temp", read_psu_temperature},
+        {"case_temp", read_case_temperature},
     };
+    char name[HISTORY_NAME_SIZE];
 
-    char command[512];
-    char buffer[512];
-    FILE *fp;
-    int found_any = 0;
-
-    printf("Detecting package managers and listing installed packages:\n");
+    if (update_cpu_data() == 0 && cpu_data.samples > 1) {
+        record_metric("cpu_usage", now, cpu_data.overall_usage);
+        for (int i = 0; i < cpu_data.total_cores; i++) {
+            snprintf(name, sizeof(name), "core_usage/%s", cpu_data.cores[i].cpu_name);
+            record_metric(name, now, cpu_data.cores[i].usage);
+        }
+    }
 
-    for (int i = 0; i < sizeof(managers)/sizeof(managers[0]); i++) {
-        // Check version
-        snprintf(command, sizeof(command), "%s %s 2>&1", managers[i], version_flags[i]);
-        fp = popen(command, "r");
-        if (fp) {
-            if (fgets(buffer, sizeof(buffer), fp) != NULL) {
-                buffer[strcspn(buffer, "\n")] = 0;
-                printf("\n%s detected: %s\n", managers[i], buffer);
-                found_any = 1;
-            }
-            pclose(fp);
+    if (update_disk_io_data() == 0) {
+        for (int i = 0; i < disk_io_data.count; i++) {
+            DiskData *disk = &disk_io_data.disks[i];
+            if (disk->partition || disk->samples < 2 || (disk->stats.reads == 0 && disk->stats.writes == 0)) continue;
+            snprintf(name, sizeof(name), "disk_read_bytes/%s", disk->name);
+            record_metric(name, now, disk->read_bytes);
+            snprintf(name, sizeof(name), "disk_write_bytes/%s", disk->name);
+            record_metric(name, now, disk->write_bytes);
+            snprintf(name, sizeof(name), "disk_iops/%s", disk->name);
+            record_metric(name, now, disk->read_iops + disk->write_iops);
+            snprintf(name, sizeof(name), "disk_await/%s", disk->name);
+            record_metric(name, now, disk->await_ms);
+            snprintf(name, sizeof(name), "disk_queue/%s", disk->name);
+            record_metric(name, now, disk->queue_depth);
+            snprintf(name, sizeof(name), "disk_util/%s", disk->name);
+            record_metric(name, now, disk->utilization);
+        }
+    }
 
-            // List installed packages
-            snprintf(command, sizeof(command), "%s %s 2>&1", managers[i], list_flags[i]);
-            fp = popen(command, "r");
-            if (fp) {
-                printf("Installed packages for %s:\n", managers[i]);
-                while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-                    buffer[strcspn(buffer, "\n")] = 0;
-                    printf("  %s\n", buffer);
-                }
-                pclose(fp);
+    // Usage moves slowly and statvfs can block on network mounts, so filesystems are sampled less often
+    static time_t last_filesystem_sample;
+    if (now - last_filesystem_sample >= FILESYSTEM_SAMPLE_INTERVAL) {
+        FilesystemUsage *mounts;
+        int count = list_filesystems(&mounts);
+        last_filesystem_sample = now;
+        if (count > 0) {
+            stat_filesystems(mounts, count, STATVFS_TIMEOUT_MS);
+            for (int i = 0; i < count; i++) {
+                if (!track_filesystem_usage(&mounts[i])) continue;
+                filesystem_series_name(mounts[i].mountpoint, name, sizeof(name));
+                record_metric(name, now, mounts[i].total_bytes - mounts[i].free_bytes);
             }
         }
+        if (count >= 0) free(mounts);
     }
 
-    if (!found_any) {
-        printf("No known package managers detected.\n");
+    LoadAverage load;
+    if (read_load_average(&load) == 0) {
+        record_metric("load_1min", now, load.load_1min);
+        record_metric("load_5min", now, load.load_5min);
+        record_metric("load_15min", now, load.load_15min);
     }
-}
 
-void scan_directory(const char *path) {
-    struct dirent *entry;
-    struct stat info;
-    char fullpath[1024];
+    for (size_t i = 0; i < sizeof(sensors) / sizeof(sensors[0]); i++) {
+        float temp = sensors[i].read();
+        if (temp >= 0) record_metric(sensors[i].name, now, temp);
+    }
 
-    DIR *dir = opendir(path);
-    if (!dir) return;
+    for (int i = 0; i < storage_device_count; i++) {
+        float temp = read_temperature_file(storage_devices[i].path);
+        if (temp < 0) continue;
+        // A cut-off name could collide with another device's series
+        if (snprintf(name, sizeof(name), "storage_temp/%s", storage_devices[i].name) >= (int)sizeof(name)) continue;
+        record_metric(name, now, temp);
+    }
 
-    while ((entry = readdir(dir)) != NULL) {
-        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+    int processes = count_processes();
+    if (processes >= 0) record_metric("total_processes", now, processes);
+}
 
-        snprintf(fullpath, sizeof(fullpath), "%s/%s", path, entry->d_name);
-        if (stat(fullpath, &info) != 0) continue;
+// Records at err or more severe
+static void count_kernel_errors(const KmsgRecord *record, void *context) {
+    if (record->priority <= 3) (*(int *)context)++;
+}
 
-        if (S_ISDIR(info.st_mode)) {
-            printf("[DIR] %s\n", fullpath);
-            scan_directory(fullpath);
-        } else {
-            printf("[FILE] %s\n", fullpath);
+/**
+ * Prints the window aggregates of every rollup level of every recorded series
+ */
+void print_history_summary() {
+    printf("\n=== Metric History ===\n");
+    for (int i = 0; i < system_history.count; i++) {
+        TimeSeries *series = system_history.series[i];
+        for (int j = 0; j < series->level_count; j++) {
+            HistoryLevel *level = &series->levels[j];
+            HistoryStats stats = get_history_level_stats(level);
+            printf("%s: step=%ds window=%lds samples=%lu avg=%.2f min=%.2f max=%.2f\n",
+                   series->name, level->step, (long)level->step * level->capacity,
+                   stats.count, stats.average, stats.min, stats.max);
         }
     }
-
-    closedir(dir);
 }
 
-// List programs installed into standard directories
-void list_manual_installs() {
-    printf("Manually installed programs/binaries:\n");
-
-    // Standard directories
-    scan_directory("/usr/local/bin");
-    scan_directory("/opt");
+/**
+ * Opens a non-blocking listener for kernel hotplug uevents
+ * Returns -1 where netlink is unavailable, e.g. in some containers
+ */
+int open_uevent_socket() {
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) return -1;
+
+    struct sockaddr_nl addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = 1;  // Kernel broadcast group
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
 
-    // User-specific local binaries
-    const char *home = getenv("HOME");
-    if (!home) {
-        struct passwd *pw = getpwuid(getuid());
-        if (pw) home = pw->pw_dir;
+// Whether a uevent payload ("ACTION@devpath\0KEY=value\0...") carries SUBSYSTEM=block
+static int is_block_uevent(const char *message, ssize_t length) {
+    for (const char *field = message; field < message + length; field += strlen(field) + 1) {
+        if (strcmp(field, "SUBSYSTEM=block") == 0) return 1;
     }
+    return 0;
+}
 
-    if (home) {
-        char path[1024];
-        snprintf(path, sizeof(path), "%s/.local/bin", home);
-        scan_directory(path);
+/**
+ * Reads every pending uevent and returns how many added or removed a device
+ * Block device changes count too, since they carry resizes and media changes
+ */
+int drain_uevents(int fd) {
+    char message[8192];
+    int changes = 0;
+    ssize_t n;
+
+    while ((n = recv(fd, message, sizeof(message) - 1, 0)) > 0 || (n < 0 && errno == EINTR)) {
+        if (n <= 0) continue;
+        message[n] = '\0';
+        // The first string is "ACTION@devpath"
+        if (strncmp(message, "add@", 4) == 0 || strncmp(message, "remove@", 7) == 0 ||
+            strncmp(message, "bind@", 5) == 0 || strncmp(message, "unbind@", 7) == 0 ||
+            (strncmp(message, "change@", 7) == 0 && is_block_uevent(message, n))) {
+            changes++;
+        }
     }
+    return changes;
 }
 
-void read_journal_logs() {
-    FILE *fp;
-    char buffer[1024];
-    int read_error = 0;
+/**
+ * Samples every metric once per second into the history store until interrupted
+ * Stops after duration seconds when duration > 0, then prints the rollup summary
+ */
+void record_history(long duration) {
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+    discover_storage_temperature_sensors();
 
-    // Run the journalctl command
-    fp = popen("journalctl --no-pager -n 300 2>&1", "r");
-    if (fp == NULL) {
-        printf("Error: Failed to run journalctl command\n");
-        fflush(stdout);
-        return;
+    if (open_history_file(&history_file, 1) != 0) {
+        fprintf(stderr, "Warning: history file unavailable, recording in memory only\n");
     }
-
-    // Read the output line by line and print it
-    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        printf("Journal: %s", buffer);
+    load_alert_rules();
+    if (open_alert_log() != 0) {
+        fprintf(stderr, "Warning: alert log unavailable, alerts are only printed\n");
     }
 
-    // Check if there was an error during reading
-    if (ferror(fp)) {
-        read_error = 1;
-        perror("Error reading from journalctl output");
-        fprintf(stderr, "Error: Failed to read data from journalctl command.\n");
-    }
+    // The sampler is the long-lived process, so it also watches for hotplug and kernel errors
+    int uevent_fd = open_uevent_socket();
+    KmsgReader kmsg;
+    if (open_kmsg_reader(&kmsg, 0, 0, 1) != 0) kmsg.fd = -1;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    time_t started = time(NULL);
+
+    while (!stop) {
+        time_t now = time(NULL);
+        sample_system_metrics(now);
+        if (uevent_fd >= 0 && drain_uevents(uevent_fd) > 0) touch_inventory_stamp();
+        if (kmsg.fd >= 0) {
+            int errors = 0;
+            read_kmsg_records(&kmsg, count_kernel_errors, &errors);
+            record_metric("kernel_errors", now, errors);
+        }
+        if (duration > 0 && now - started >= duration) break;
 
-    // Close the stream and check for command execution errors
-    int exit_status = pclose(fp);
-    if (exit_status == -1) {
-        perror("Failed to close journalctl process");
-        fprintf(stderr, "Error: Could not properly close the journalctl command.\n");
-    } else if (exit_status != 0) {
-        fprintf(stderr, "Error: journalctl command failed with exit status %d\n", exit_status);
-        fprintf(stderr, "This may indicate permission issues or journalctl errors.\n");
+        // Sleep to an absolute deadline so the tick does not drift with sampling cost
+        next.tv_sec += 1;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR && !stop) {
+        }
     }
 
-    fflush(stdout);
+    print_history_summary();
+    if (uevent_fd >= 0) close(uevent_fd);
+    close_kmsg_reader(&kmsg);
+    close_history_file(&history_file);
+    if (alert_engine.event_log) fclose(alert_engine.event_log);
+    alert_engine.event_log = NULL;
 }
-// Calculate total time computer was on in different states
-long get_total_jiffies() {
-    FILE *f = fopen("/proc/stat", "r");
-    if (!f) {
-        printf("Error: Could not open /proc/stat\n");
-        return -1;
-    }
-    
-    char cpu[16];
-    long user, nice, system, idle, iowait, irq, softirq, steal;
-    
-    int result = fscanf(f, "%s %ld %ld %ld %ld %ld %ld %ld %ld",
-                       cpu, &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
-    
-    fclose(f);
-    
-    if (result != 9) {
-        printf("Error: Failed to parse /proc/stat content\n");
-        return -1;
-    }
-    
-    long total_jiffies = user + nice + system + idle + iowait + irq + softirq + steal;
-    
-    printf("CPU Statistics from /proc/stat:\n");
-    printf("CPU: %s\n", cpu);
-    printf("User: %ld\n", user);
-    printf("Nice: %ld\n", nice);
-    printf("System: %ld\n", system);
-    printf("Idle: %ld\n", idle);
-    printf("IOWait: %ld\n", iowait);
-    printf("IRQ: %ld\n", irq);
-    printf("SoftIRQ: %ld\n", softirq);
-    printf("Steal: %ld\n", steal);
-    printf("Total Jiffies: %ld\n", total_jiffies);
-    printf("------------------------------\n");
-    
-    return total_jiffies;
+
+/**
+ * Compiles the alert rules and prints the resulting rule table
+ */
+void list_alert_rules() {
+    int count = load_alert_rules();
+    static const char *ops[] = {">", ">=", "<", "<="};
+
+    printf("=== Alert Rules ===\n");
+    for (int i = 0; i < count; i++) {
+        const AlertRule *rule = &alert_engine.rules[i];
+        printf("rule %d: series=%s op=%s threshold=%.2f clear=%.2f for=%ds cooldown=%ds\n",
+               i, rule->pattern, ops[rule->op], rule->threshold, rule->clear, rule->for_seconds, rule->cooldown);
+    }
+    printf("Total rules: %d\n", count);
 }
 
-void show_system_uptime_and_cpu_sleep_time() {
-    FILE *fp = fopen("/proc/uptime", "r");
+/**
+ * Prints the alert transitions logged after the given byte offset, then the offset to resume from
+ */
+void show_alert_events(long offset) {
+    char path[512];
+    if (build_user_path("XDG_DATA_HOME", ".local/share", "alerts.log", path, sizeof(path)) != 0) return;
+
+    FILE *fp = fopen(path, "r");
     if (!fp) {
-        perror("Error opening /proc/uptime");
+        printf("Next offset: 0\n");
         return;
     }
 
-    double uptime_seconds, sleep_seconds;
-    if (fscanf(fp, "%lf %lf", &uptime_seconds, &sleep_seconds) != 2) {
-        fprintf(stderr, "Error reading from /proc/uptime\n");
-        fclose(fp);
-        return;
-    }
+    // A log shorter than the offset has been truncated, so start over
+    fseek(fp, 0, SEEK_END);
+    if (ftell(fp) < offset) offset = 0;
+    fseek(fp, offset, SEEK_SET);
 
+    char line[512];
+    while (fgets(line, sizeof(line), fp)) {
+        fputs(line, stdout);
+    }
+    printf("Next offset: %ld\n", ftell(fp));
     fclose(fp);
-
-    printf("System Uptime: %.2f seconds\n", uptime_seconds);
-    printf("CPU Sleep Time: %.2f seconds\n", sleep_seconds);
 }
 
-#define MAX_BUFFER 1024
-#define MAX_OUTPUT_SIZE 65536
-
 typedef struct {
-    char cpu_info[MAX_OUTPUT_SIZE];
-    char memory_info[MAX_OUTPUT_SIZE];
-    char storage_info[MAX_OUTPUT_SIZE];
-    char motherboard_info[MAX_OUTPUT_SIZE];
-    char bios_info[MAX_OUTPUT_SIZE];
-    char pci_info[MAX_OUTPUT_SIZE];
-    char usb_info[MAX_OUTPUT_SIZE];
-    char network_info[MAX_OUTPUT_SIZE];
-    char kernel_info[MAX_OUTPUT_SIZE];
-    char system_info[MAX_OUTPUT_SIZE];
-} HardwareData;
+    uint32_t blocks;
+    uint64_t samples;
+    int64_t first_time;
+    int64_t last_time;
+} HistorySeriesUsage;
 
-char* run_command(const char *command) {
-    static char output[MAX_OUTPUT_SIZE];
-    output[0] = '\0';
-    
-    FILE *fp = popen(command, "r");
-    if (fp == NULL) {
-        snprintf(output, sizeof(output), "Command not available: %s", command);
-        return output;
+/**
+ * Lists every series in the history file with its block count, sample count and time span
+ */
+void list_history_series() {
+    HistoryFile hf = HISTORY_FILE_INIT;
+    if (open_history_file(&hf, 0) != 0) {
+        printf("Error: no recorded history (run record_history first)\n");
+        return;
     }
-    
-    char buffer[MAX_BUFFER];
-    size_t total_size = 0;
-    
-    while (fgets(buffer, sizeof(buffer), fp) != NULL) {
-        size_t buffer_len = strlen(buffer);
-        if (total_size + buffer_len < MAX_OUTPUT_SIZE - 1) {
-            strcat(output, buffer);
-            total_size += buffer_len;
-        }
+
+    const HistoryIndexHeader *header = history_index_header(&hf);
+    uint32_t series_count = __atomic_load_n(&header->series_count, __ATOMIC_ACQUIRE);
+    uint32_t entry_count = __atomic_load_n(&header->entry_count, __ATOMIC_ACQUIRE);
+    uint32_t mapped_entries = (hf.index_size - HISTORY_ENTRIES_OFFSET) / sizeof(HistoryIndexEntry);
+    if (entry_count > mapped_entries) entry_count = mapped_entries;
+    if (series_count > HISTORY_MAX_SERIES) series_count = HISTORY_MAX_SERIES;
+
+    HistorySeriesUsage *usage = calloc(series_count ? series_count : 1, sizeof(HistorySeriesUsage));
+    if (!usage) {
+        close_history_file(&hf);
+        return;
     }
-    
-    pclose(fp);
-    return output;
-}
 
-void display_section(const char *title, const char *content) {
-    printf("\n\033[1;34m%s\033[0m\n", title);
-    printf("\033[1;32m");
-    for (int i = 0; i < strlen(title); i++) printf("=");
-    printf("\033[0m\n");
-    
-    if (content && strlen(content) > 0) {
-        printf("%s\n", content);
-    } else {
-        printf("Information not available\n");
+    const HistoryIndexEntry *entries = history_index_entries(&hf);
+    for (uint32_t i = 0; i < entry_count; i++) {
+        if (entries[i].series_id >= series_count) continue;
+        HistorySeriesUsage *u = &usage[entries[i].series_id];
+        if (u->blocks == 0 || entries[i].first_time < u->first_time) u->first_time = entries[i].first_time;
+        if (u->blocks == 0 || entries[i].last_time > u->last_time) u->last_time = entries[i].last_time;
+        u->blocks++;
+        u->samples += entries[i].count;
     }
-}
 
-void collect_hardware_data(HardwareData *data) {
-    // Initialize all buffers
-    memset(data, 0, sizeof(HardwareData));
-    
-    // CPU Information (combine multiple sources)
-    char *lscpu_output = run_command("lscpu 2>/dev/null");
-    char *cpuinfo_output = run_command("cat /proc/cpuinfo | grep 'model name\\|cpu cores\\|cpu MHz' | head -10 2>/dev/null");
-    snprintf(data->cpu_info, sizeof(data->cpu_info), 
-             "CPU Details:\n%s\n\nProcessor Information:\n%s", 
-             lscpu_output, cpuinfo_output);
-    
-    // Memory Information (combine multiple sources)
-    char *free_output = run_command("free -h 2>/dev/null");
-    char *meminfo_output = run_command("cat /proc/meminfo | head -15 2>/dev/null");
-    char *dmi_memory = run_command("sudo dmidecode -t memory 2>/dev/null | head -30");
-    snprintf(data->memory_info, sizeof(data->memory_info),
-             "Memory Usage:\n%s\n\nMemory Details:\n%s\n\nDMI Memory Info:\n%s",
-             free_output, meminfo_output, dmi_memory);
-    
-    // Storage Information
-    char *lsblk_output = run_command("lsblk -o NAME,SIZE,TYPE,MOUNTPOINT,FSTYPE,MODEL 2>/dev/null");
-    char *df_output = run_command("df -h -T 2>/dev/null");
-    snprintf(data->storage_info, sizeof(data->storage_info),
-             "Block Devices:\n%s\n\nDisk Usage:\n%s",
-             lsblk_output, df_output);
-    
-    // Motherboard Information
-    char *baseboard = run_command("sudo dmidecode -t baseboard 2>/dev/null");
-    char *chassis = run_command("sudo dmidecode -t chassis 2>/dev/null");
-    snprintf(data->motherboard_info, sizeof(data->motherboard_info),
-             "Baseboard:\n%s\n\nChassis:\n%s",
-             baseboard, chassis);
-    
-    // BIOS Information
-    char *bios = run_command("sudo dmidecode -t bios 2>/dev/null");
-    snprintf(data->bios_info, sizeof(data->bios_info), "%s", bios);
-    
-    // PCI Devices
-    char *lspci = run_command("lspci 2>/dev/null");
-    snprintf(data->pci_info, sizeof(data->pci_info), "%s", lspci);
-    
-    // USB Devices
-    char *lsusb = run_command("lsusb 2>/dev/null");
-    snprintf(data->usb_info, sizeof(data->usb_info), "%s", lsusb);
-    
-    // Network Information
-    char *network = run_command("ip link show 2>/dev/null");
-    snprintf(data->network_info, sizeof(data->network_info), "%s", network);
-    
-    // Kernel Information
-    char *lsmod = run_command("lsmod | head -20 2>/dev/null");
-    snprintf(data->kernel_info, sizeof(data->kernel_info), "%s", lsmod);
-    
-    // System Overview
-    char *lshw = run_command("sudo lshw -short 2>/dev/null | head -20");
-    char *hostname = run_command("hostnamectl 2>/dev/null");
-    snprintf(data->system_info, sizeof(data->system_info),
-             "System Overview:\n%s\n\nHost Information:\n%s",
-             lshw, hostname);
+    printf("=== Recorded History ===\n");
+    const HistorySeriesSlot *slots = history_series_slots(&hf);
+    for (uint32_t i = 0; i < series_count; i++) {
+        printf("%.*s: id=%u blocks=%u samples=%llu first=%lld last=%lld\n",
+               HISTORY_NAME_SIZE, slots[i].name, i, usage[i].blocks,
+               (unsigned long long)usage[i].samples, (long long)usage[i].first_time, (long long)usage[i].last_time);
+    }
+    printf("Data size: %zu bytes in %u blocks\n", (size_t)header->block_count * HISTORY_BLOCK_SIZE, header->block_count);
+
+    free(usage);
+    close_history_file(&hf);
 }
 
-void display_hardware_info() {
-    HardwareData data;
-    collect_hardware_data(&data);
-    
-    printf("\033[1;35m");
-    printf("================================================================================\n");
-    printf("                         SYSTEM HARDWARE INFORMATION\n");
-    printf("================================================================================\n");
-    printf("\033[0m");
-    
-    // System Overview
-    display_section("SYSTEM OVERVIEW", data.system_info);
-    
-    // Processor Section
-    display_section("PROCESSOR INFORMATION", data.cpu_info);
-    
-    // Memory Section
-    display_section("MEMORY INFORMATION", data.memory_info);
-    
-    // Storage Section
-    display_section("STORAGE DEVICES", data.storage_info);
-    
-    // Motherboard & BIOS Section
-    char mobo_bios[MAX_OUTPUT_SIZE];
-    snprintf(mobo_bios, sizeof(mobo_bios), 
-             "Motherboard Information:\n%s\n\nBIOS Information:\n%s",
-             data.motherboard_info, data.bios_info);
-    display_section("MOTHERBOARD & BIOS", mobo_bios);
-    
-    // Hardware Devices Section
-    char devices_info[MAX_OUTPUT_SIZE];
-    snprintf(devices_info, sizeof(devices_info),
-             "PCI Devices:\n%s\n\nUSB Devices:\n%s\n\nNetwork Interfaces:\n%s",
-             data.pci_info, data.usb_info, data.network_info);
-    display_section("HARDWARE DEVICES", devices_info);
-    
-    // Kernel Section
-    display_section("KERNEL INFORMATION", data.kernel_info);
-    
-    printf("\033[1;35m");
-    printf("================================================================================\n");
-    printf("                         END OF SYSTEM INFORMATION\n");
-    printf("================================================================================\n");
-    printf("\033[0m");
+static void print_history_sample(int64_t time, double value, void *context) {
+    (void)context;
+    printf("%lld %.3f\n", (long long)time, value);
 }
 
-void monitor_cpu_utilization() {
-    CPUUtilization prev, curr;
-    
-    printf("CPU Utilization Sample\n");
-    printf("=====================\n");
-    
-    // First reading
-    FILE *fp = fopen("/proc/stat", "r");
-    if (!fp) {
-        perror("Error opening /proc/stat");
-        return;
-    }
-    
-    char line[256];
-    if (fgets(line, sizeof(line), fp)) {
-        sscanf(line, "cpu %lu %lu %lu %lu %lu %lu %lu %lu",
-               &prev.user, &prev.nice, &prev.system, &prev.idle,
-               &prev.iowait, &prev.irq, &prev.softirq, &prev.steal);
-    }
-    fclose(fp);
-    
-    sleep(1);
-    
-    // Get current timestamp
+/**
+ * Prints the stored samples of one series between from and to, one "timestamp value" per line
+ * When points > 0 the series is downsampled in the backend (LTTB, or min/max per bucket)
+ * so a chart never receives more points than it asked for
+ */
+void query_history(const char *name, const char *from_text, const char *to_text, long points, int min_max) {
     time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    char timestamp[20];
-    strftime(timestamp, sizeof(timestamp), "%H:%M:%S", tm_info);
-    
-    // Second reading
-    fp = fopen("/proc/stat", "r");
-    if (!fp) {
-        perror("Error opening /proc/stat");
+    int64_t from = parse_time_argument(from_text, now);
+    int64_t to = to_text ? parse_time_argument(to_text, now) : now;
+    if (from < 0 || to < 0) {
+        printf("Error: invalid time range\n");
         return;
     }
-    
-    if (fgets(line, sizeof(line), fp)) {
-        sscanf(line, "cpu %lu %lu %lu %lu %lu %lu %lu %lu",
-               &curr.user, &curr.nice, &curr.system, &curr.idle,
-               &curr.iowait, &curr.irq, &curr.softirq, &curr.steal);
-    }
-    fclose(fp);
-    
-    // Calculate percentages
-    unsigned long prev_idle = prev.idle + prev.iowait;
-    unsigned long curr_idle = curr.idle + curr.iowait;
-    
-    unsigned long prev_non_idle = prev.user + prev.nice + prev.system + 
-                                 prev.irq + prev.softirq + prev.steal;
-    unsigned long curr_non_idle = curr.user + curr.nice + curr.system + 
-                                 curr.irq + curr.softirq + curr.steal;
-    
-    unsigned long prev_total = prev_idle + prev_non_idle;
-    unsigned long curr_total = curr_idle + curr_non_idle;
-    
-    unsigned long total_delta = curr_total - prev_total;
-    unsigned long idle_delta = curr_idle - prev_idle;
-    
-    double total_utilization = 0.0;
-    if (total_delta > 0) {
-        total_utilization = ((double)(total_delta - idle_delta) / total_delta) * 100.0;
-    }
-    
-    unsigned long total_prev = (prev.user + prev.nice + prev.system + prev.idle + 
-                              prev.iowait + prev.irq + prev.softirq + prev.steal);
-    unsigned long total_curr = (curr.user + curr.nice + curr.system + curr.idle + 
-                              curr.iowait + curr.irq + curr.softirq + curr.steal);
-    unsigned long total_component_delta = total_curr - total_prev;
-    
-    double user_pct = 0.0;
-    double system_pct = 0.0;
-    double iowait_pct = 0.0;
-    
-    if (total_component_delta > 0) {
-        user_pct = ((double)(curr.user - prev.user) / total_component_delta) * 100;
-        system_pct = ((double)(curr.system - prev.system) / total_component_delta) * 100;
-        iowait_pct = ((double)(curr.iowait - prev.iowait) / total_component_delta) * 100;
+
+    HistoryFile hf = HISTORY_FILE_INIT;
+    if (open_history_file(&hf, 0) != 0) {
+        printf("Error: no recorded history (run record_history first)\n");
+        return;
     }
-    
-    printf("Timestamp: %s\n", timestamp);
-    printf("User: %.1f%%\n", user_pct);
-    printf("System: %.1f%%\n", system_pct);
-    printf("IOWait: %.1f%%\n", iowait_pct);
-    printf("Total: %.1f%%\n", total_utilization);
-}
 
-void check_firewall() {
-    FILE *fp;
-    char buffer[256];
-    int iptables_active = 0;
-    int nftables_active = 0;
-    int ufw_active = 0;
-    
-    printf("Firewall Status:\n");
-    
-    // Check iptables
-    fp = popen("iptables -L -n 2>/dev/null | head -n 10 | wc -l", "r");
-    if (fp != NULL) {
-        if (fgets(buffer, sizeof(buffer), fp) != NULL) {
-            iptables_active = (atoi(buffer) > 3);
+    int series_id = history_file_series_id(&hf, name, 0);
+    if (series_id < 0) {
+        printf("Error: no history for %s\n", name);
+    } else if (points <= 0) {
+        long count = query_history_file(&hf, series_id, from, to, print_history_sample, NULL);
+        printf("Samples: %ld\n", count);
+    } else {
+        SampleBuffer buffer = {0};
+        query_history_file(&hf, series_id, from, to, collect_history_sample, &buffer);
+        size_t original = buffer.count;
+
+        if (buffer.failed) {
+            printf("Error: out of memory after %zu samples\n", buffer.count);
+            free_sample_buffer(&buffer);
+            close_history_file(&hf);
+            return;
         }
-        pclose(fp);
-    }
-    printf("iptables: %s\n", iptables_active ? "ACTIVE" : "inactive");
-    
-    // Check nftables
-    fp = popen("nft list ruleset 2>/dev/null | head -n 5 | wc -l", "r");
-    if (fp != NULL) {
-        if (fgets(buffer, sizeof(buffer), fp) != NULL) {
-            nftables_active = (atoi(buffer) > 1);
+        if (min_max) {
+            downsample_min_max(&buffer, points);
+        } else {
+            downsample_lttb(&buffer, points);
         }
-        pclose(fp);
-    }
-    printf("nftables: %s\n", nftables_active ? "ACTIVE" : "inactive");
-    
-    // Check UFW
-    fp = popen("which ufw >/dev/null 2>&1 && ufw status 2>/dev/null | grep -q active && echo 1 || echo 0", "r");
-    if (fp != NULL) {
-        if (fgets(buffer, sizeof(buffer), fp) != NULL) {
-            ufw_active = atoi(buffer);
+        for (size_t i = 0; i < buffer.count; i++) {
+            print_history_sample(buffer.times[i], buffer.values[i], NULL);
         }
-        pclose(fp);
+        printf("Samples: %zu (downsampled from %zu)\n", buffer.count, original);
+        free_sample_buffer(&buffer);
     }
-    printf("UFW: %s\n", ufw_active ? "ACTIVE" : "inactive");
-    
-    // Overall status
-    int overall_status = iptables_active || nftables_active || ufw_active;
-    printf("\nOverall firewall status: %s\n", overall_status ? "ACTIVE" : "INACTIVE");
+    close_history_file(&hf);
 }
 
-void show_logged_in_users() {
-    char* result = run_command("w");
-    if (result) {
-        printf("Logged in users:\n%s\n", result);
+/**
+ * Prints count, mean, min, p50, p95, p99 and max over [from, to] for every series matching pattern
+ * Answers come from the persisted quantile sketches, never from raw samples
+ */
+void query_percentiles(const char *pattern, const char *from_text, const char *to_text) {
+    time_t now = time(NULL);
+    int64_t from = parse_time_argument(from_text, now);
+    int64_t to = to_text ? parse_time_argument(to_text, now) : now;
+    if (from < 0 || to < 0) {
+        printf("Error: invalid time range\n");
+        return;
     }
-    else {
-        printf("Failed to get logged in users.\n");
+
+    HistoryFile hf = HISTORY_FILE_INIT;
+    if (open_history_file(&hf, 0) != 0 || !hf.sketch_map) {
+        printf("Error: no recorded history (run record_history first)\n");
+        close_history_file(&hf);
+        return;
     }
-}
 
-int view_system_logs() {
-    printf("System Log Viewer\n");
-    printf("=================\n\n");
-    
-    printf("Current user UID: %d\n", getuid());
-    printf("Current user GID: %d\n\n", getgid());
-    
-    // Try different methods to read logs
-    const char *commands[] = {
-        "journalctl -n 30 --no-pager",
-        "dmesg | tail -30",
-        "cat /var/log/syslog 2>/dev/null | tail -20",
-        "cat /var/log/messages 2>/dev/null | tail -20",
-        "cat /var/log/auth.log 2>/dev/null | tail -20",
-        "cat /var/log/kern.log 2>/dev/null | tail -20",
-        "ls -la /var/log/ 2>/dev/null | head -10",
-        NULL
-    };
-    
-    const char *descriptions[] = {
-        "System Journal (journalctl):",
-        "Kernel Messages (dmesg):",
-        "System Log (/var/log/syslog):",
-        "System Messages (/var/log/messages):",
-        "Auth Log (/var/log/auth.log):",
-        "Kernel Log (/var/log/kern.log):",
-        "Log Directory Contents:",
-        NULL
-    };
-    
-    for (int i = 0; commands[i] != NULL; i++) {
-        printf("\n=== %s ===\n", descriptions[i]);
-        printf("Command: %s\n", commands[i]);
-        printf("Output:\n");
-        printf("--------\n");
-        
-        int result = system(commands[i]);
-        if (result != 0) {
-            printf("Command failed or no output\n");
-        }
-        printf("\n");
+    SketchSummary *summary = malloc(sizeof(SketchSummary));
+    if (!summary) {
+        close_history_file(&hf);
+        return;
     }
-    
-    return 0;
+
+    struct timespec started, finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+
+    const HistoryIndexHeader *header = history_index_header(&hf);
+    const HistorySeriesSlot *slots = history_series_slots(&hf);
+    uint32_t series_count = __atomic_load_n(&header->series_count, __ATOMIC_ACQUIRE);
+    int matched = 0;
+
+    printf("=== Percentiles ===\n");
+    for (uint32_t i = 0; i < series_count && i < HISTORY_MAX_SERIES; i++) {
+        char name[HISTORY_NAME_SIZE + 1];
+        snprintf(name, sizeof(name), "%.*s", HISTORY_NAME_SIZE, slots[i].name);
+        if (fnmatch(pattern, name, 0) != 0) continue;
+        if (summarize_history_sketches(&hf, i, from, to, summary) != 0 || summary->count == 0) continue;
+
+        matched++;
+        printf("%s: period=%ds sketches=%d count=%llu mean=%.2f min=%.2f p50=%.2f p95=%.2f p99=%.2f max=%.2f\n",
+               name, summary->period, summary->sketches, (unsigned long long)summary->count,
+               summary->sum / summary->count, summary->min,
+               sketch_summary_quantile(summary, 0.50), sketch_summary_quantile(summary, 0.95),
+               sketch_summary_quantile(summary, 0.99), summary->max);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    if (matched == 0) {
+        printf("No history matching %s in that range\n", pattern);
+    }
+    printf("Query time: %ld us\n",
+           (long)((finished.tv_sec - started.tv_sec) * 1000000L + (finished.tv_nsec - started.tv_nsec) / 1000));
+
+    free(summary);
+    close_history_file(&hf);
 }
 
+
+// Sources of the cached OS reports; the boot id already covers /proc
+static const char *const os_release_sources[] = {
+    "/etc/os-release", "/usr/lib/os-release", "/etc/lsb-release", "/etc/debian_version",
+    "/etc/redhat-release", "/etc/centos-release", "/etc/fedora-release", "/etc/SuSE-release",
+    "/etc/arch-release", NULL
+};
+static const char *const distribution_sources[] = {
+    "/etc/os-release", "/etc/debian_version", "/etc/redhat-release", "/etc/apt/sources.list",
+    "/etc/yum.repos.d", "/etc/dnf/dnf.conf", "/etc/pacman.conf", "/lib/systemd/systemd",
+    "/usr/lib/systemd/systemd", NULL
+};
+static const char *const library_sources[] = {"/proc/self/exe", NULL};
+// devtmpfs and udev add and remove entries as block devices come and go; resizes only reach
+// the key through the hotplug stamp record_history touches
+static const char *const block_device_sources[] = {"/dev", "/run/udev/data", NULL};
+
 int main(int argc, char *argv[]) {
     // Initialize system components
     init_system_history();
@@ -2259,7 +11593,11 @@ int main(int argc, char *argv[]) {
         printf("get_case_temperature\n");
         printf("find_storage_devices_with_temperature_reporting\n");
         printf("detect_all_storage_devices\n");
-        printf("print_smart_data\n"); // Requires sudo
+        printf("print_block_topology\n");
+        printf("print_disk_io\n");
+        printf("print_filesystem_usage\n");
+        printf("print_smart_data [max_age]\n"); // Requires sudo
+        printf("smart_health_summary\n");
         printf("display_running_processes\n");
         printf("display_hardware_info\n"); // Requires sudo
         printf("print_kernel_details\n");
@@ -2274,13 +11612,27 @@ int main(int argc, char *argv[]) {
         printf("get_total_jiffies\n");
         printf("check_firewall\n");
         printf("show_logged_in_users\n");
+        printf("failed_logins [limit]\n");
+        printf("sudo_history [limit]\n");
         printf("view_system_logs\n");
-        printf("read_journal_logs\n"); // Requires sudo
+        printf("tail_log_files [follow]\n");
+        printf("export_data <logs|processes|hardware> <file|-> [format=ndjson|csv|text] [compress=none|gzip|zstd] [filters...]\n");
+        printf("read_kernel_log [follow]\n");
+        printf("ingest_logs\n");
+        printf("search_logs [unit=NAME] [priority<=LEVEL] [since=TIME] [until=TIME] [limit=N] [text...]\n");
+        printf("read_journal_logs [cursor] [follow] [file.journal]\n"); // Requires sudo
         printf("get_total_cpu_time\n");
         printf("print_uname_info\n");
         printf("print_detailed_os_info\n");
         printf("print_system_limits\n");
         printf("scan_directory directory_name\n");
+        printf("disk_usage <path> [depth=N] [max_depth=N] [limit=N] [threads=N]\n");
+        printf("record_history [seconds]\n");
+        printf("list_history_series\n");
+        printf("query_history series from [to [points [lttb|minmax]]]\n");
+        printf("query_percentiles series_pattern from [to]\n");
+        printf("list_alert_rules\n");
+        printf("alert_events [offset]\n");
         return 0;
     }
     
@@ -2326,10 +11678,31 @@ int main(int argc, char *argv[]) {
             find_storage_devices_with_temperature_reporting();
         }
         else if (strcmp(argv[i], "detect_all_storage_devices") == 0) {
-            detect_all_storage_devices();
+            run_cached_report("storage-devices", block_device_sources, detect_all_storage_devices);
+        }
+        else if (strcmp(argv[i], "print_block_topology") == 0) {
+            run_cached_report("block-topology", block_device_sources, print_block_topology);
+        }
+        else if (strcmp(argv[i], "print_disk_io") == 0) {
+            print_disk_io();
+        }
+        else if (strcmp(argv[i], "print_filesystem_usage") == 0) {
+            print_filesystem_usage();
         }
         else if (strcmp(argv[i], "print_smart_data") == 0) {
-            print_smart_data();
+            long ttl = SMART_DEFAULT_TTL;
+            // Commands start with a letter; anything else is the max age, and must parse as one
+            if (i + 1 < argc && !isalpha((unsigned char)argv[i + 1][0])) {
+                ttl = parse_duration(argv[++i]);
+                if (ttl < 0) {
+                    printf("Usage: %s print_smart_data [max_age]\n", argv[0]);
+                    return 1;
+                }
+            }
+            print_smart_data(ttl);
+        }
+        else if (strcmp(argv[i], "smart_health_summary") == 0) {
+            print_smart_health_summary();
         }
         else if (strcmp(argv[i], "display_running_processes") == 0) {
             display_running_processes();
@@ -2338,13 +11711,14 @@ int main(int argc, char *argv[]) {
             display_hardware_info();
         }
         else if (strcmp(argv[i], "print_kernel_details") == 0) {
-            print_kernel_details();
+            // Nothing the kernel report reads changes before the next boot, so the boot id alone keys it
+            run_cached_report("kernel", NULL, print_kernel_details);
         }
         else if (strcmp(argv[i], "print_distribution_info") == 0) {
-            print_distribution_info();
+            run_cached_report("distribution", distribution_sources, print_distribution_info);
         }
         else if (strcmp(argv[i], "print_library_versions") == 0) {
-            print_library_versions();
+            run_cached_report("libraries", library_sources, print_library_versions);
         }
         else if (strcmp(argv[i], "print_security_info") == 0) {
             print_security_info();
@@ -2373,11 +11747,58 @@ int main(int argc, char *argv[]) {
         else if (strcmp(argv[i], "show_logged_in_users") == 0) {
             show_logged_in_users();
         }
+        else if (strcmp(argv[i], "failed_logins") == 0) {
+            int limit = (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) ? atoi(argv[++i]) : AUTH_REPORT_LIMIT;
+            print_failed_logins(limit);
+        }
+        else if (strcmp(argv[i], "sudo_history") == 0) {
+            int limit = (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) ? atoi(argv[++i]) : AUTH_REPORT_LIMIT;
+            print_sudo_history(limit);
+        }
         else if (strcmp(argv[i], "view_system_logs") == 0) {
             view_system_logs();
         }
+        else if (strcmp(argv[i], "read_kernel_log") == 0) {
+            int follow = (i + 1 < argc && strcmp(argv[i + 1], "follow") == 0);
+            if (follow) i++;
+            read_kernel_log(follow);
+        }
+        else if (strcmp(argv[i], "ingest_logs") == 0) {
+            ingest_logs_command();
+        }
+        else if (strcmp(argv[i], "search_logs") == 0) {
+            // Every remaining argument is part of the query
+            search_logs(argc - i - 1, argv + i + 1);
+            break;
+        }
+        else if (strcmp(argv[i], "export_data") == 0) {
+            if (i + 2 >= argc) {
+                printf("Usage: export_data <logs|processes|hardware> <file|-> [format=...] [compress=...] [filters...]\n");
+                break;
+            }
+            // Every remaining argument is an option or log filter
+            export_data(argv[i + 1], argv[i + 2], argc - i - 3, argv + i + 3);
+            break;
+        }
+        else if (strcmp(argv[i], "tail_log_files") == 0) {
+            int follow = i + 1 < argc && strcmp(argv[i + 1], "follow") == 0;
+            if (follow) i++;
+            tail_log_files(follow);
+        }
         else if (strcmp(argv[i], "read_journal_logs") == 0) {
-            read_journal_logs();
+            // Optional arguments in any order: a cursor ("s=..."), "follow", a .journal file
+            const char *cursor = NULL, *file = NULL;
+            int follow = 0;
+            while (i + 1 < argc) {
+                const char *arg = argv[i + 1];
+                size_t len = strlen(arg);
+                if (strncmp(arg, "s=", 2) == 0) cursor = arg;
+                else if (strcmp(arg, "follow") == 0) follow = 1;
+                else if (len > 8 && strcmp(arg + len - 8, ".journal") == 0) file = arg;
+                else break;
+                i++;
+            }
+            read_journal_logs(cursor, follow, file);
         }
         else if (strcmp(argv[i], "get_total_cpu_time") == 0) {
             get_total_cpu_time();
@@ -2386,7 +11807,7 @@ int main(int argc, char *argv[]) {
             print_uname_info();
         }
         else if (strcmp(argv[i], "print_detailed_os_info") == 0) {
-            print_detailed_os_info();
+            run_cached_report("os-release", os_release_sources, print_detailed_os_info);
         }
         else if (strcmp(argv[i], "print_system_limits") == 0) {
             print_system_limits();
@@ -2399,6 +11820,72 @@ int main(int argc, char *argv[]) {
                 printf("Usage: %s scan_directory <path>\n", argv[0]);
             }
         }
+        else if (strcmp(argv[i], "disk_usage") == 0) {
+            if (i + 1 >= argc) {
+                printf("Usage: disk_usage <path> [depth=N] [max_depth=N] [limit=N] [threads=N]\n");
+                break;
+            }
+            // Every remaining argument is an option
+            disk_usage(argv[i + 1], argc - i - 2, argv + i + 2);
+            break;
+        }
+        else if (strcmp(argv[i], "record_history") == 0) {
+            long duration = 0;
+            if (i + 1 < argc) {
+                duration = parse_duration(argv[i + 1]);
+                if (duration < 0) {
+                    printf("Usage: %s record_history [seconds]\n", argv[0]);
+                    return 1;
+                }
+                i++;
+            }
+            record_history(duration);
+        }
+        else if (strcmp(argv[i], "list_history_series") == 0) {
+            list_history_series();
+        }
+        else if (strcmp(argv[i], "query_history") == 0) {
+            if (i + 2 < argc) {
+                // An optional end time follows unless the next argument is another command
+                const char *name = argv[i + 1];
+                const char *from = argv[i + 2];
+                const char *to = (i + 3 < argc && parse_time_argument(argv[i + 3], time(NULL)) >= 0) ? argv[i + 3] : NULL;
+                long points = 0;
+                int min_max = 0;
+                i += to ? 3 : 2;
+
+                // A point count may follow an explicit end time, optionally with the downsampling mode
+                if (to && i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) {
+                    points = atol(argv[++i]);
+                    if (i + 1 < argc && (strcmp(argv[i + 1], "lttb") == 0 || strcmp(argv[i + 1], "minmax") == 0)) {
+                        min_max = strcmp(argv[++i], "minmax") == 0;
+                    }
+                }
+                query_history(name, from, to, points, min_max);
+            } else {
+                printf("Usage: %s query_history <series> <from> [to [points [lttb|minmax]]]\n", argv[0]);
+            }
+        }
+        else if (strcmp(argv[i], "query_percentiles") == 0) {
+            if (i + 2 < argc) {
+                const char *to = (i + 3 < argc && parse_time_argument(argv[i + 3], time(NULL)) >= 0) ? argv[i + 3] : NULL;
+                query_percentiles(argv[i + 1], argv[i + 2], to);
+                i += to ? 3 : 2;
+            } else {
+                printf("Usage: %s query_percentiles <series pattern> <from> [to]\n", argv[0]);
+            }
+        }
+        else if (strcmp(argv[i], "list_alert_rules") == 0) {
+            list_alert_rules();
+        }
+        else if (strcmp(argv[i], "alert_events") == 0) {
+            long offset = 0;
+            if (i + 1 < argc && isdigit((unsigned char)argv[i + 1][0])) {
+                offset = atol(argv[i + 1]);
+                i++;
+            }
+            show_alert_events(offset);
+        }
         else {
             printf("Unknown command: %s\n", argv[i]);
             printf("Run without arguments to see available commands.\n");
@@ -0,0 +1,254 @@
+/**
+ * Checks for the history codecs: the Gorilla block encoding, DDSketch quantiles and LTTB downsampling
+ * Builds against the monitor's own source, with its main renamed out of the way
+ */
+#define main system_monitor_main
+#include "../system-monitor.c"
+#undef main
+
+static int failures = 0;
+
+#define CHECK(condition, ...) do { \
+    if (!(condition)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * Writes samples through append_history_sample into a scratch history file and decodes them back
+ * Timestamps hit every delta-of-delta width and values every XOR case; enough samples are written
+ * to fill several blocks
+ */
+static void test_gorilla_round_trip() {
+    char directory[] = "/tmp/history-test-XXXXXX";
+    if (!mkdtemp(directory)) {
+        CHECK(0, "cannot create a scratch directory");
+        return;
+    }
+    setenv("XDG_DATA_HOME", directory, 1);
+
+    HistoryFile hf = HISTORY_FILE_INIT;
+    if (open_history_file(&hf, 1) != 0) {
+        CHECK(0, "cannot create a history file in %s", directory);
+        return;
+    }
+    TimeSeries *series = history_series("codec_test");
+
+    const size_t count = 20000;
+    const int64_t steps[] = {1, 1, 1, 30, 2, 200, 1, 1500, 1, 100000, 1, 1, 5000000};
+    int64_t *times = malloc(count * sizeof(int64_t));
+    double *values = malloc(count * sizeof(double));
+    int64_t time = 1700000000;
+    double constant = 42.5;
+    srand(1);
+    for (size_t i = 0; i < count; i++) {
+        time += steps[i % (sizeof(steps) / sizeof(steps[0]))];
+        times[i] = time;
+        switch (i % 6) {
+        case 0: values[i] = constant; break;                                  // Repeats the previous value
+        case 1: values[i] = constant; break;
+        case 2: values[i] = constant + (rand() % 100) / 10.0; break;          // Small change
+        case 3: values[i] = (rand() - RAND_MAX / 2) * 1e-3; break;            // Sign flip and new window
+        case 4: values[i] = i % 12 == 4 ? INFINITY : -0.0; break;
+        default: values[i] = (double)rand() * rand() / 7.0; break;            // Wide mantissa
+        }
+        CHECK(append_history_sample(&hf, series, times[i], values[i]) == 0, "append %zu failed", i);
+    }
+
+    SampleBuffer buffer = {0};
+    long emitted = query_history_file(&hf, series->file_series, INT64_MIN, INT64_MAX, collect_history_sample, &buffer);
+    CHECK(emitted == (long)count && buffer.count == count, "decoded %ld samples, wrote %zu", emitted, count);
+    for (size_t i = 0; i < buffer.count && i < count; i++) {
+        if (buffer.times[i] != times[i] || memcmp(&buffer.values[i], &values[i], sizeof(double)) != 0) {
+            CHECK(0, "sample %zu decoded as (%lld, %.17g), wrote (%lld, %.17g)", i, (long long)buffer.times[i],
+                  buffer.values[i], (long long)times[i], values[i]);
+            break;
+        }
+    }
+    CHECK(history_index_header(&hf)->block_count > 2, "expected the samples to span several blocks");
+
+    // A sub-range returns exactly the samples inside it
+    SampleBuffer range = {0};
+    query_history_file(&hf, series->file_series, times[5000], times[5099], collect_history_sample, &range);
+    CHECK(range.count == 100 && range.count && range.times[0] == times[5000], "range query returned %zu samples", range.count);
+
+    // A later run whose clock stepped back appends a block that starts before the ones above it
+    memset(&series->writer, 0, sizeof(series->writer));
+    for (int64_t t = 0; t < 100; t++) append_history_sample(&hf, series, 1600000000 + t, (double)t);
+    CHECK(history_index_header(&hf)->unsorted, "an out-of-order block left the index marked sorted");
+    SampleBuffer stepped = {0};
+    query_history_file(&hf, series->file_series, 1600000000, 1600000099, collect_history_sample, &stepped);
+    CHECK(stepped.count == 100, "found %zu of the samples written after the clock stepped back", stepped.count);
+    free_sample_buffer(&range);
+    query_history_file(&hf, series->file_series, times[5000], times[5099], collect_history_sample, &range);
+    CHECK(range.count == 100, "range query on an unsorted index returned %zu samples", range.count);
+
+    free_sample_buffer(&stepped);
+    free_sample_buffer(&range);
+    free_sample_buffer(&buffer);
+    free(times);
+    free(values);
+    close_history_file(&hf);
+
+    char command[128];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    if (system(command) != 0) printf("Warning: could not remove %s\n", directory);
+}
+
+/**
+ * Every quantile of a merged summary is within SKETCH_RELATIVE_ACCURACY of the exact sample
+ * at the same rank, as long as the values span fewer than SKETCH_BINS buckets per sketch
+ */
+static void test_sketch_quantiles() {
+    const int sketches = 10, per_sketch = 10000, total = sketches * per_sketch;
+    double *samples = malloc(total * sizeof(double));
+    static SketchSummary summary;
+    QuantileSketch sketch;
+
+    srand(2);
+    memset(&summary, 0, sizeof(summary));
+    for (int s = 0; s < sketches; s++) {
+        memset(&sketch, 0, sizeof(sketch));
+        for (int i = 0; i < per_sketch; i++) {
+            // Log-uniform over four decades
+            double value = 0.5 * pow(10.0, 4.0 * rand() / RAND_MAX);
+            samples[s * per_sketch + i] = value;
+            add_to_sketch(&sketch, value);
+        }
+        merge_sketch(&summary, &sketch);
+    }
+    qsort(samples, total, sizeof(double), compare_doubles);
+
+    const double quantiles[] = {0.001, 0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99, 0.999};
+    for (size_t i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++) {
+        double exact = samples[(size_t)(quantiles[i] * (total - 1))];
+        double estimate = sketch_summary_quantile(&summary, quantiles[i]);
+        CHECK(fabs(estimate - exact) <= SKETCH_RELATIVE_ACCURACY * exact,
+              "p%g is %g, exact %g", quantiles[i] * 100, estimate, exact);
+    }
+    // The extremes are stored as floats
+    CHECK(sketch_summary_quantile(&summary, 0.0) == (float)samples[0], "minimum not kept");
+    CHECK(sketch_summary_quantile(&summary, 1.0) == (float)samples[total - 1], "maximum not kept");
+    free(samples);
+}
+
+/**
+ * A window the one-minute ring has wrapped inside falls through to the ten-minute level, even
+ * though a sketch left by an earlier session still sits in the finer ring before the window
+ */
+static void test_sketch_level_span() {
+    char directory[] = "/tmp/history-test-XXXXXX";
+    if (!mkdtemp(directory)) {
+        CHECK(0, "cannot create a scratch directory");
+        return;
+    }
+    setenv("XDG_DATA_HOME", directory, 1);
+
+    HistoryFile hf = HISTORY_FILE_INIT;
+    if (open_history_file(&hf, 1) != 0) {
+        CHECK(0, "cannot create a history file in %s", directory);
+        return;
+    }
+    TimeSeries *series = history_series("sketch_span_test");
+    series->file_series = history_file_series_id(&hf, series->name, 1);
+
+    // Default levels: one-minute sketches in 10 slots, ten-minute sketches in 36
+    const int64_t start = 1700000000 - 1700000000 % 3600;
+    update_history_sketches(&hf, series, start - 240, 5000.0);
+    uint64_t written = 0;
+    for (int64_t time = start; time < start + 1200; time++) {
+        if ((time / 60) % 10 == 6) continue;    // never overwrites the earlier session's slot
+        update_history_sketches(&hf, series, time, 1.0 + time % 50);
+        written++;
+    }
+
+    static SketchSummary summary;
+    CHECK(summarize_history_sketches(&hf, series->file_series, start, start + 1199, &summary) == 0, "no sketches");
+    CHECK(summary.period == 600, "a wrapped window used the %ds level", summary.period);
+    CHECK(summary.count == written, "merged %llu samples, wrote %llu", (unsigned long long)summary.count,
+          (unsigned long long)written);
+    CHECK(summary.max < 5000.0f, "a sketch from before the window was merged");
+
+    // The last nine minutes are inside the one-minute ring
+    CHECK(summarize_history_sketches(&hf, series->file_series, start + 660, start + 1199, &summary) == 0, "no sketches");
+    CHECK(summary.period == 60, "a window inside the finest ring used the %ds level", summary.period);
+    CHECK(summary.count == 8 * 60, "merged %llu samples from eight written minutes", (unsigned long long)summary.count);
+
+    close_history_file(&hf);
+    char command[128];
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    if (system(command) != 0) printf("Warning: could not remove %s\n", directory);
+}
+
+static void fill_wave(SampleBuffer *buffer, size_t count) {
+    free_sample_buffer(buffer);
+    for (size_t i = 0; i < count; i++) {
+        collect_history_sample(1000 + (int64_t)i * 10, sin(i / 25.0) * 50 + (i % 7) - (i == 400 ? 300 : 0), buffer);
+    }
+}
+
+/**
+ * LTTB returns exactly the requested number of points, keeps both endpoints and the time order,
+ * and keeps an isolated spike
+ */
+static void test_lttb() {
+    SampleBuffer buffer = {0};
+    const size_t thresholds[] = {3, 10, 100, 999};
+
+    for (size_t t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); t++) {
+        fill_wave(&buffer, 1000);
+        int64_t first = buffer.times[0], last = buffer.times[999];
+        double last_value = buffer.values[999];
+
+        downsample_lttb(&buffer, thresholds[t]);
+        CHECK(buffer.count == thresholds[t], "threshold %zu kept %zu points", thresholds[t], buffer.count);
+        CHECK(buffer.times[0] == first, "threshold %zu lost the first point", thresholds[t]);
+        CHECK(buffer.times[buffer.count - 1] == last && buffer.values[buffer.count - 1] == last_value,
+              "threshold %zu lost the last point", thresholds[t]);
+        for (size_t i = 1; i < buffer.count; i++) {
+            if (buffer.times[i] <= buffer.times[i - 1]) {
+                CHECK(0, "threshold %zu is out of order at %zu", thresholds[t], i);
+                break;
+            }
+        }
+    }
+
+    fill_wave(&buffer, 1000);
+    downsample_lttb(&buffer, 100);
+    int spike = 0;
+    for (size_t i = 0; i < buffer.count; i++) spike |= buffer.times[i] == 1000 + 400 * 10;
+    CHECK(spike, "the spike at sample 400 was dropped");
+
+    // Asking for more points than there are leaves the series alone
+    fill_wave(&buffer, 50);
+    downsample_lttb(&buffer, 100);
+    CHECK(buffer.count == 50, "a short series changed to %zu points", buffer.count);
+
+    fill_wave(&buffer, 50);
+    downsample_lttb(&buffer, 2);
+    CHECK(buffer.count == 2 && buffer.times[0] == 1000 && buffer.times[1] == 1000 + 49 * 10,
+          "threshold 2 did not keep just the endpoints");
+    free_sample_buffer(&buffer);
+}
+
+int main() {
+    test_gorilla_round_trip();
+    test_sketch_quantiles();
+    test_sketch_level_span();
+    test_lttb();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All history codec checks passed\n");
+    return 0;
+}
@@ -0,0 +1,156 @@
+/**
+ * Checks for the sd-journal reader against a journal file instead of the system journal
+ * fixtures/twelve-entries.journal.gz was written by systemd-journald 252 in a private namespace:
+ * twelve "fixture entry NN" messages from SYSLOG_IDENTIFIER=fixture, after journald's own
+ * start and usage entries and before its stop entry
+ */
+#define main system_monitor_main
+#include "../system-monitor.c"
+#undef main
+
+static int failures = 0;
+
+#define CHECK(condition, ...) do { \
+    if (!(condition)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+#define FIXTURE_ENTRIES 12
+
+static const char *const fixture_only[] = {"SYSLOG_IDENTIFIER=fixture", NULL};
+
+// Numbers of the fixture entries read, in order
+typedef struct {
+    int numbers[FIXTURE_ENTRIES * 2];
+    int count;
+} ReadEntries;
+
+static void collect_entry(const JournalEntry *entry, void *context) {
+    ReadEntries *read = context;
+    int number = -1;
+    if (read->count >= (int)(sizeof(read->numbers) / sizeof(read->numbers[0]))) return;
+    sscanf(entry->message, "fixture entry %d", &number);
+    read->numbers[read->count++] = number;
+}
+
+// Opens the fixture at cursor (or its last backlog entries) and reads everything after that point
+static int read_fixture(const char *file, const char *cursor, int backlog, ReadEntries *read, char **last_cursor) {
+    memset(read, 0, sizeof(*read));
+    sd_journal *journal = open_journal_at(cursor, file, backlog, fixture_only);
+    if (!journal) return -1;
+    read_journal_entries(journal, cursor ? JOURNAL_MAX_BATCH : backlog, collect_entry, read);
+    if (last_cursor && sd_journal_api.get_cursor(journal, last_cursor) < 0) *last_cursor = NULL;
+    sd_journal_api.close(journal);
+    return 0;
+}
+
+// Whether read holds the entries first..last and nothing else
+static int read_range(const ReadEntries *read, int first, int last) {
+    if (read->count != last - first + 1) return 0;
+    for (int i = 0; i < read->count; i++) {
+        if (read->numbers[i] != first + i) return 0;
+    }
+    return 1;
+}
+
+static void test_backlog(const char *file) {
+    ReadEntries read;
+
+    CHECK(read_fixture(file, NULL, 5, &read, NULL) == 0, "cannot open %s", file);
+    CHECK(read_range(&read, 8, 12), "a backlog of 5 read %d entries starting at %d", read.count, read.numbers[0]);
+
+    // A backlog longer than the journal starts at its head
+    CHECK(read_fixture(file, NULL, 50, &read, NULL) == 0, "cannot open %s", file);
+    CHECK(read_range(&read, 1, FIXTURE_ENTRIES), "a backlog of 50 read %d entries", read.count);
+
+    // Without a match the journald entries count too
+    memset(&read, 0, sizeof(read));
+    sd_journal *journal = open_journal_at(NULL, file, 50, NULL);
+    CHECK(journal != NULL, "cannot open %s", file);
+    if (journal) {
+        int count = read_journal_entries(journal, 50, collect_entry, &read);
+        CHECK(count == FIXTURE_ENTRIES + 3, "read %d entries without a match", count);
+        sd_journal_api.close(journal);
+    }
+}
+
+/**
+ * A cursor from an earlier read resumes right after its entry. A cursor whose entry is not in the
+ * file, as after rotation, lands on the next entry and has to return that entry too
+ */
+static void test_cursors(const char *file) {
+    ReadEntries read;
+    char *cursor = NULL;
+
+    // The cursor of entry 6: the last one of a 7-entry backlog read one short
+    sd_journal *journal = open_journal_at(NULL, file, 7, fixture_only);
+    CHECK(journal != NULL, "cannot open %s", file);
+    if (!journal) return;
+    memset(&read, 0, sizeof(read));
+    read_journal_entries(journal, 1, collect_entry, &read);
+    CHECK(read_range(&read, 6, 6), "expected entry 6, read %d", read.numbers[0]);
+    CHECK(sd_journal_api.get_cursor(journal, &cursor) >= 0 && cursor, "no cursor for entry 6");
+    sd_journal_api.close(journal);
+    if (!cursor) return;
+
+    CHECK(read_fixture(file, cursor, 0, &read, NULL) == 0, "cannot reopen at a cursor");
+    CHECK(read_range(&read, 7, FIXTURE_ENTRIES), "resuming after entry 6 read %d entries starting at %d",
+          read.count, read.numbers[0]);
+
+    // The same position from a file that was rotated away: another sequence number id, and a time
+    // just before entry 6, so seeking lands on entry 6 without it being the cursor's entry
+    char boot[33], rotated[256];
+    unsigned long long seqnum, monotonic, realtime, xor_hash;
+    CHECK(sscanf(cursor, "s=%*32[0-9a-f];i=%llx;b=%32[0-9a-f];m=%llx;t=%llx;x=%llx",
+                 &seqnum, boot, &monotonic, &realtime, &xor_hash) == 5, "unexpected cursor %s", cursor);
+    snprintf(rotated, sizeof(rotated), "s=0123456789abcdef0123456789abcdef;i=1;b=%s;m=%llx;t=%llx;x=1",
+             boot, monotonic - 1, realtime - 1);
+    CHECK(read_fixture(file, rotated, 0, &read, NULL) == 0, "cannot reopen at a rotated cursor");
+    CHECK(read_range(&read, 6, FIXTURE_ENTRIES), "a rotated cursor read %d entries starting at %d",
+          read.count, read.numbers[0]);
+
+    // The cursor of the last entry resumes with nothing
+    char *last = NULL;
+    CHECK(read_fixture(file, NULL, 50, &read, &last) == 0 && last, "no cursor after the last entry");
+    if (last) {
+        CHECK(read_fixture(file, last, 0, &read, NULL) == 0 && read.count == 0, "read %d entries after the end", read.count);
+        free(last);
+    }
+    free(cursor);
+}
+
+int main() {
+    if (load_sd_journal() != 0) {
+        printf("libsystemd is not available, skipping the journal reader checks\n");
+        return 0;
+    }
+
+    char directory[] = "/tmp/journal-test-XXXXXX", file[64], command[256];
+    if (!mkdtemp(directory)) {
+        printf("FAIL: cannot create a scratch directory\n");
+        return 1;
+    }
+    snprintf(file, sizeof(file), "%s/fixture.journal", directory);
+    snprintf(command, sizeof(command), "gzip -dc tests/fixtures/twelve-entries.journal.gz > %s", file);
+    if (system(command) != 0) {
+        printf("FAIL: cannot unpack the fixture; run the test from backend/\n");
+        return 1;
+    }
+
+    test_backlog(file);
+    test_cursors(file);
+
+    snprintf(command, sizeof(command), "rm -rf %s", directory);
+    if (system(command) != 0) printf("Warning: could not remove %s\n", directory);
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All journal reader checks passed\n");
+    return 0;
+}
@@ -0,0 +1,240 @@
+/**
+ * Checks for the SMART parsers: canned ATA IDENTIFY, SMART READ DATA and threshold sectors and
+ * NVMe Identify Controller and log page 0x02 buffers, formatted without touching a device
+ */
+#define main system_monitor_main
+#include "../system-monitor.c"
+#undef main
+
+static int failures = 0;
+
+#define CHECK(condition, ...) do { \
+    if (!(condition)) { \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+        failures++; \
+    } \
+} while (0)
+
+// The formatted report has to contain this exact line
+#define CHECK_LINE(report, line) \
+    CHECK(has_line(report, line), "missing \"%s\" in:\n%s", line, report)
+
+static int has_line(const char *report, const char *line) {
+    size_t length = strlen(line);
+    for (const char *p = strstr(report, line); p; p = strstr(p + 1, line)) {
+        if ((p == report || p[-1] == '\n') && (p[length] == '\n' || p[length] == '\0')) return 1;
+    }
+    return 0;
+}
+
+static int count_lines_starting(const char *report, const char *prefix) {
+    int count = 0;
+    for (const char *p = report; p && *p; p = strchr(p, '\n'), p = p ? p + 1 : NULL) {
+        if (strncmp(p, prefix, strlen(prefix)) == 0) count++;
+    }
+    return count;
+}
+
+// IDENTIFY strings hold two characters per word, the first in the high byte
+static void put_ata_string(uint8_t *identify, int first_word, int words, const char *text) {
+    for (int i = 0; i < words * 2; i++) {
+        char c = i < (int)strlen(text) ? text[i] : ' ';
+        identify[first_word * 2 + (i ^ 1)] = c;
+    }
+}
+
+static void put_ata_attribute(uint8_t *data, int slot, uint8_t id, uint8_t value, uint8_t worst,
+                              const uint8_t raw[6]) {
+    uint8_t *attr = data + 2 + slot * 12;
+    attr[0] = id;
+    attr[1] = 0x33;     // flags, ignored
+    attr[3] = value;
+    attr[4] = worst;
+    memcpy(attr + 5, raw, 6);
+}
+
+static void put_ata_threshold(uint8_t *thresholds, int slot, uint8_t id, uint8_t threshold) {
+    thresholds[2 + slot * 12] = id;
+    thresholds[3 + slot * 12] = threshold;
+}
+
+/**
+ * A 4 TB disk with a reallocated sector count, power-on hours, both temperature attributes,
+ * a six-byte LBA counter and an attribute id the name table does not know
+ */
+static void build_ata_fixture(uint8_t *identify, uint8_t *data, uint8_t *thresholds) {
+    memset(identify, 0, 512);
+    memset(data, 0, 512);
+    memset(thresholds, 0, 512);
+
+    put_ata_string(identify, 27, 20, "WDC WD40EFRX-68N32N0");
+    put_ata_string(identify, 10, 10, "  WD-WCC7K1234567");
+    put_ata_string(identify, 23, 4, "82.00A82");
+    // 7814037168 sectors, one little-endian word at a time from word 100
+    identify[200] = 0xB0; identify[201] = 0xBE;
+    identify[202] = 0xC0; identify[203] = 0xD1;
+    identify[204] = 0x01; identify[205] = 0x00;
+
+    data[0] = 0x10;     // revision
+    put_ata_attribute(data, 0, 5, 200, 200, (const uint8_t[6]){0x02, 0x01, 0, 0, 0, 0});
+    put_ata_attribute(data, 1, 9, 87, 87, (const uint8_t[6]){0x10, 0x27, 0, 0, 0, 0});
+    put_ata_attribute(data, 2, 190, 65, 55, (const uint8_t[6]){0x28, 0, 0, 0, 0, 0});
+    put_ata_attribute(data, 4, 194, 115, 100, (const uint8_t[6]){0x23, 0x00, 0x14, 0x00, 0x2D, 0x00});
+    put_ata_attribute(data, 5, 241, 100, 100, (const uint8_t[6]){0x01, 0x02, 0x03, 0x04, 0x05, 0x06});
+    put_ata_attribute(data, 6, 250, 100, 100, (const uint8_t[6]){0, 0, 0, 0, 0, 0});
+
+    put_ata_threshold(thresholds, 0, 5, 140);
+    put_ata_threshold(thresholds, 1, 9, 0);
+    put_ata_threshold(thresholds, 4, 194, 0);
+}
+
+static void test_ata_report() {
+    static uint8_t identify[512], data[512], thresholds[512];
+    StringBuffer out = {0};
+
+    build_ata_fixture(identify, data, thresholds);
+    format_ata_smart(identify, data, thresholds, 1, &out);
+    const char *report = out.data;
+
+    CHECK_LINE(report, "Device Model: WDC WD40EFRX-68N32N0");
+    CHECK_LINE(report, "Serial Number: WD-WCC7K1234567");
+    CHECK_LINE(report, "Firmware Version: 82.00A82");
+    CHECK_LINE(report, "User Capacity: 4000787030016 bytes");
+    CHECK_LINE(report, "SMART overall-health self-assessment test result: PASSED");
+
+    // Raw values are six little-endian bytes
+    CHECK_LINE(report, "Reallocated_Sector_Ct: id=5 value=200 worst=200 thresh=140 raw=258");
+    CHECK_LINE(report, "Power_On_Hours: id=9 value=87 worst=87 thresh=0 raw=10000");
+    CHECK_LINE(report, "Temperature_Celsius: id=194 value=115 worst=100 thresh=0 raw=193274839075");
+    CHECK_LINE(report, "Total_LBAs_Written: id=241 value=100 worst=100 raw=6618611909121");
+    CHECK_LINE(report, "Unknown_Attribute: id=250 value=100 worst=100 raw=0");
+    CHECK_LINE(report, "Airflow_Temperature_Cel: id=190 value=65 worst=55 raw=40");
+
+    // 194 wins over 190, and only its low raw byte is the temperature
+    CHECK_LINE(report, "Temperature: 35 Celsius");
+    CHECK(count_lines_starting(report, "Temperature:") == 1, "expected one temperature line in:\n%s", report);
+    CHECK(count_lines_starting(report, "Unknown_Attribute") == 1, "empty attribute slots were printed");
+    free_string_buffer(&out);
+}
+
+static void test_ata_health_and_fallbacks() {
+    static uint8_t identify[512], data[512], thresholds[512];
+    StringBuffer out = {0};
+
+    build_ata_fixture(identify, data, thresholds);
+    format_ata_smart(identify, data, thresholds, 0, &out);
+    CHECK_LINE(out.data, "SMART overall-health self-assessment test result: FAILED!");
+    free_string_buffer(&out);
+
+    // Without READ THRESHOLDS no attribute gets a thresh field
+    format_ata_smart(identify, data, NULL, -1, &out);
+    CHECK_LINE(out.data, "SMART overall-health self-assessment test result: UNKNOWN");
+    CHECK_LINE(out.data, "Reallocated_Sector_Ct: id=5 value=200 worst=200 raw=258");
+    CHECK(!strstr(out.data, "thresh="), "thresholds printed without a threshold sector");
+    free_string_buffer(&out);
+
+    // Only attribute 190: it becomes the temperature, and a disk without a 48-bit count has no capacity line
+    memset(data + 2 + 4 * 12, 0, 12);
+    memset(identify + 200, 0, 8);
+    format_ata_smart(identify, data, thresholds, 1, &out);
+    CHECK_LINE(out.data, "Temperature: 40 Celsius");
+    CHECK(!strstr(out.data, "User Capacity"), "capacity printed for a zero sector count");
+    free_string_buffer(&out);
+}
+
+static void put_le(uint8_t *p, int count, uint64_t value) {
+    for (int i = 0; i < count; i++) p[i] = value >> (8 * i);
+}
+
+/**
+ * A controller at 310 K with two of its sensors reporting, a read counter with only the low half set,
+ * a write counter past 2^64 and distinct bytes in each multi-byte field
+ */
+static void build_nvme_fixture(uint8_t *identify, uint8_t *log) {
+    memset(identify, 0, 4096);
+    memset(log, 0, 512);
+
+    memcpy(identify + 4, "S4EWNX0R123456      ", 20);
+    memcpy(identify + 24, "Samsung SSD 970 EVO Plus 1TB", 28);
+    memset(identify + 24 + 28, ' ', 12);
+    memcpy(identify + 64, "2B2QEXM7", 8);
+
+    put_le(log + 1, 2, 310);
+    log[3] = 100;
+    log[4] = 10;
+    log[5] = 3;
+    put_le(log + 32, 8, 1234567);
+    put_le(log + 48 + 8, 8, 1);                    // 2^64: high quadword only
+    put_le(log + 64, 8, 0x0102030405ULL);
+    put_le(log + 112, 8, 0x0201);
+    put_le(log + 128, 8, 0x3039);
+    put_le(log + 192, 4, 0x01020304);
+    put_le(log + 196, 4, 7);
+    put_le(log + 200, 2, 305);
+    put_le(log + 204, 2, 320);                     // sensor 3; sensor 2 is absent
+}
+
+static void test_nvme_report() {
+    static uint8_t identify[4096], log[512];
+    StringBuffer out = {0};
+
+    build_nvme_fixture(identify, log);
+    format_nvme_smart(identify, log, &out);
+    const char *report = out.data;
+
+    CHECK_LINE(report, "Model Number: Samsung SSD 970 EVO Plus 1TB");
+    CHECK_LINE(report, "Serial Number: S4EWNX0R123456");
+    CHECK_LINE(report, "Firmware Version: 2B2QEXM7");
+    CHECK_LINE(report, "SMART overall-health self-assessment test result: PASSED");
+    CHECK_LINE(report, "Critical Warning: 0x00");
+    CHECK_LINE(report, "Temperature: 37 Celsius");
+    CHECK_LINE(report, "Available Spare: 100%");
+    CHECK_LINE(report, "Available Spare Threshold: 10%");
+    CHECK_LINE(report, "Percentage Used: 3%");
+
+    // 128-bit little-endian counters
+    CHECK_LINE(report, "Data Units Read: 1234567 [632.1 GB]");
+    CHECK(strstr(report, "Data Units Written: 18446744073709551616 [") != NULL, "high quadword lost in:\n%s", report);
+    CHECK_LINE(report, "Host Read Commands: 4328719365");
+    CHECK_LINE(report, "Power Cycles: 513");
+    CHECK_LINE(report, "Power On Hours: 12345");
+    CHECK_LINE(report, "Unsafe Shutdowns: 0");
+    CHECK_LINE(report, "Warning  Comp. Temperature Time: 16909060");
+    CHECK_LINE(report, "Critical Comp. Temperature Time: 7");
+
+    CHECK_LINE(report, "Temperature Sensor 1: 32 Celsius");
+    CHECK_LINE(report, "Temperature Sensor 3: 47 Celsius");
+    CHECK(!strstr(report, "Temperature Sensor 2"), "an absent sensor was printed");
+    free_string_buffer(&out);
+}
+
+static void test_nvme_warning_without_identify() {
+    static uint8_t identify[4096], log[512];
+    StringBuffer out = {0};
+
+    build_nvme_fixture(identify, log);
+    log[0] = 0x04;      // reliability degraded
+    format_nvme_smart(NULL, log, &out);
+
+    CHECK_LINE(out.data, "SMART overall-health self-assessment test result: FAILED!");
+    CHECK_LINE(out.data, "Critical Warning: 0x04");
+    CHECK(!strstr(out.data, "Model Number"), "model printed without an Identify page");
+    CHECK_LINE(out.data, "Power On Hours: 12345");
+    free_string_buffer(&out);
+}
+
+int main() {
+    test_ata_report();
+    test_ata_health_and_fallbacks();
+    test_nvme_report();
+    test_nvme_warning_without_identify();
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All SMART parser checks passed\n");
+    return 0;
+}
@@ -388,9 +388,26 @@ const getPackageManagers = (setPackageManagers, setParsedData) => {
                         };
                         continue;
                     }
-                    if (currentManager && result[currentManager] && result[currentManager].available && line.trim() && !line.includes("WARNING:") && !line.includes("Listing...") && !line.includes("Installed packages for") && !line.match(/sh: .*not found/)) {
+                    // Differences from the cached package list: installed/removed/changed name=... version=...
+                    const changeMatch = line.match(/^\s*(installed|removed|changed) name=(\S+) version=(\S+) arch=(\S+)/);
+                    if (currentManager && result[currentManager] && changeMatch) {
+                        const [, change, packageName, version, arch] = changeMatch;
+                        result[currentManager].changes = result[currentManager].changes || [];
+                        result[currentManager].changes.push({ "change": change, "name": packageName, "version": version, "architecture": arch });
+                        continue;
+                    }
+                    if (currentManager && result[currentManager] && result[currentManager].available && line.trim() && !line.includes("WARNING:") && !line.includes("Listing...") && !line.includes("Installed packages for") && !line.includes("Package changes for") && !line.match(/sh: .*not found/)) {
+                        // Records read from the package database: name=... version=... arch=... size=...
+                        const recordMatch = line.match(/^\s*name=(\S+) version=(\S+) arch=(\S+) size=(\d+)/);
                         const packageMatch = line.match(/^\s*([^\/\s]+)\/([^,\s]+)(?:,([^ ]+))?\s+([^ ]+)\s+([^ ]+)\s+(\[.+\])?/);
-                        if (packageMatch) {
+                        if (recordMatch) {
+                            const [, packageName, version, arch, size] = recordMatch;
+                            result[currentManager].packages[packageName] = {
+                                "version": version,
+                                "architecture": arch,
+                                "size": Number(size),
+                            };
+                        } else if (packageMatch) {
                             const [, packageName, version, status, repo, arch, flags] = packageMatch;
                             const cleanPackageName = packageName.trim();
                             result[currentManager].packages[cleanPackageName] = {